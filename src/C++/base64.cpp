@@ -190,10 +190,10 @@ base64_decode(unsigned char *dest, int size, char *src)
 
 	for (i = 0, j = 0; i < slen;)
 	{
-		a = decoder[(int) src[i++]];
-		b = decoder[(int) src[i++]];
-		c = decoder[(int) src[i++]];
-		d = decoder[(int) src[i++]];
+		a = decoder[(unsigned char) src[i++]];
+		b = decoder[(unsigned char) src[i++]];
+		c = decoder[(unsigned char) src[i++]];
+		d = decoder[(unsigned char) src[i++]];
 
 		// Sextet 3 and 4 may be zero at the end
 		if (i == slen)
@@ -0,0 +1,935 @@
+/*
+G-Audio native benchmark suite.
+
+Measures decode, read, seek, encode and sample conversion throughput outside of LabVIEW.
+Build with make_bench.sh from src/C++, then run ./g_audio_bench from the same directory.
+
+Fixtures are generated locally before any timing takes place:
+- FLAC and WAV are written with the G-Audio write API.
+- MP3 and Vorbis are built by repeating the audio frames / pages of the unit test resources, as there are no encoders for either.
+
+Results are written as CSV, one row per measurement, so runs can be compared across builds.
+
+Usage: g_audio_bench [options]
+  --seconds N      Duration of the generated fixtures in seconds (default 60)
+  --repeats N      Timing repetitions per measurement, the fastest is reported (default 3)
+  --resources DIR  Unit test resource directory (default "../LabVIEW/Unit Tests/Resources")
+  --fixtures DIR   Directory to write fixtures to (default "bench_fixtures")
+  --filter TEXT    Only run benchmarks whose name contains TEXT (load, read, seek, write, convert)
+  --output FILE    Write CSV to FILE instead of stdout
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+
+#include "../sample_conversion.h"
+
+//////////////////
+// G-Audio API //
+//////////////////
+// Declared here rather than including g_audio.h, which also carries the single header library implementations.
+
+typedef int32_t ga_result;
+#define GA_SUCCESS 0
+
+typedef enum
+{
+	ga_codec_flac = 0,
+	ga_codec_mp3,
+	ga_codec_vorbis,
+	ga_codec_wav,
+	ga_codec_unsupported
+} ga_codec;
+
+typedef enum
+{
+	ga_data_type_u8 = 0,
+	ga_data_type_i16,
+	ga_data_type_i32,
+	ga_data_type_float,
+	ga_data_type_double
+} ga_data_type;
+
+typedef struct
+{
+	uint32_t compression_level;
+	uint32_t block_size;
+	uint32_t max_threads;
+} flac_specific;
+
+extern "C" ga_result get_audio_file_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, ga_codec* codec);
+extern "C" ga_result get_audio_file_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+extern "C" ga_result free_audio_file_tags(intptr_t tags, int32_t tag_count, intptr_t pictures, int32_t picture_count);
+extern "C" int16_t* load_audio_file_s16(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+extern "C" ga_result load_audio_files(const char** file_names, int32_t num_files, ga_data_type audio_type, intptr_t* buffers, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rates, ga_codec* codecs, ga_result* results);
+extern "C" void free_sample_data(int16_t* buffer);
+extern "C" ga_result open_audio_file(const char* file_name, int32_t* refnum);
+extern "C" ga_result open_audio_file_write(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, ga_codec codec, int32_t has_specific_info, void* codec_specific, int32_t* refnum);
+extern "C" ga_result seek_audio_file(int32_t refnum, uint64_t offset, uint64_t* new_offset);
+extern "C" ga_result read_audio_file(int32_t refnum, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+extern "C" ga_result write_audio_file(int32_t refnum, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
+extern "C" ga_result close_audio_file(int32_t refnum);
+extern "C" ga_result configure_vorbis_index_cache(uint8_t enabled);
+
+//////////////////////
+// Bench utilities //
+//////////////////////
+
+typedef struct
+{
+	double seconds;
+	int repeats;
+	std::string resources;
+	std::string fixtures;
+	std::string filter;
+	FILE* output;
+	int failures;
+} bench_config;
+
+typedef struct
+{
+	ga_codec codec;
+	std::string file_name;
+	uint64_t num_frames;
+	uint32_t channels;
+	uint32_t sample_rate;
+} bench_fixture;
+
+static const char* codec_names[] = { "flac", "mp3", "vorbis", "wav" };
+static const char* data_type_names[] = { "u8", "i16", "i32", "float", "double", "s24" };
+static const size_t data_type_sizes[] = { sizeof(uint8_t), sizeof(int16_t), sizeof(int32_t), sizeof(float), sizeof(double), 3 };
+// Packed 24-bit output of s32_to_s24. It isn't a ga_data_type, and only names and sizes the benchmark buffers.
+static const ga_data_type ga_data_type_s24 = (ga_data_type)(ga_data_type_double + 1);
+static const char* simd_names[] = { "none", "sse2", "avx2", "neon" };
+
+static double now_seconds()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool run_benchmark(const bench_config* config, const char* name)
+{
+	return config->filter.empty() || strstr(name, config->filter.c_str()) != NULL;
+}
+
+static void report(const bench_config* config, const char* benchmark, const char* codec, const char* data_type, uint64_t block_size, const char* simd, const char* unit, uint64_t count, double seconds)
+{
+	double rate = (seconds > 0 ? count / seconds : 0);
+	double ns = (count > 0 ? seconds * 1e9 / count : 0);
+	fprintf(config->output, "%s,%s,%s,%llu,%s,%s,%llu,%.6f,%.1f,%.3f\n", benchmark, codec, data_type, (unsigned long long)block_size, simd, unit, (unsigned long long)count, seconds, rate, ns);
+	fflush(config->output);
+}
+
+static bool read_file(const std::string& file_name, std::vector<uint8_t>& data)
+{
+	FILE* file = fopen(file_name.c_str(), "rb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	data.resize(size > 0 ? size : 0);
+	bool ok = (size > 0 && fread(data.data(), 1, data.size(), file) == data.size());
+	fclose(file);
+
+	return ok;
+}
+
+static bool write_file(const std::string& file_name, const std::vector<uint8_t>& data)
+{
+	FILE* file = fopen(file_name.c_str(), "wb");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	bool ok = (fwrite(data.data(), 1, data.size(), file) == data.size());
+	fclose(file);
+
+	return ok;
+}
+
+static void make_directory(const std::string& path)
+{
+#if defined(_WIN32)
+	_mkdir(path.c_str());
+#else
+	mkdir(path.c_str(), 0755);
+#endif
+}
+
+// Deterministic test signal. A few tones with slow amplitude modulation and a little noise, so it's neither silent nor trivially predictable.
+static std::vector<int16_t> generate_signal(uint64_t num_frames, uint32_t channels, uint32_t sample_rate)
+{
+	std::vector<int16_t> signal(num_frames * channels);
+	uint32_t noise = 22222;
+	const double two_pi = 6.283185307179586;
+
+	for (uint64_t i = 0; i < num_frames; i++)
+	{
+		double t = (double)i / sample_rate;
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			noise = noise * 1664525 + 1013904223;
+			double x = 0.30 * sin(two_pi * (220.0 + 110.0 * c) * t) * (0.6 + 0.4 * sin(two_pi * 0.25 * t));
+			x += 0.15 * sin(two_pi * 1375.0 * t + c);
+			x += 0.05 * sin(two_pi * 5512.5 * t);
+			x += ((int32_t)(noise >> 16) - 32768) / 32768.0 * 0.01;
+			signal[i * channels + c] = (int16_t)lrint(x * 32767.0);
+		}
+	}
+
+	return signal;
+}
+
+//////////////////////
+// MP3 fixture //
+//////////////////////
+
+static size_t mp3_frame_size(const uint8_t* header, size_t available)
+{
+	static const int bitrates[2][16] = {
+		{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 }, // MPEG-1 layer III
+		{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 } // MPEG-2/2.5 layer III
+	};
+	static const int sample_rates[4][3] = { { 11025, 12000, 8000 }, { 0, 0, 0 }, { 22050, 24000, 16000 }, { 44100, 48000, 32000 } };
+
+	if (available < 4 || header[0] != 0xFF || (header[1] & 0xE0) != 0xE0 || ((header[1] >> 1) & 3) != 1)
+	{
+		return 0;
+	}
+
+	int version = (header[1] >> 3) & 3;
+	int bitrate_index = header[2] >> 4;
+	int rate_index = (header[2] >> 2) & 3;
+	int padding = (header[2] >> 1) & 1;
+	if (version == 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3)
+	{
+		return 0;
+	}
+
+	int bitrate = bitrates[version == 3 ? 0 : 1][bitrate_index] * 1000;
+	int sample_rate = sample_rates[version][rate_index];
+	return (size_t)((version == 3 ? 144 : 72) * bitrate / sample_rate + padding);
+}
+
+// Repeat the audio frames of an MP3 file. ID3/APE tags and the Xing/Info frame are dropped, so the result is a plain CBR/VBR stream.
+static bool build_mp3_fixture(const std::string& source, const std::string& destination, double seconds, uint32_t sample_rate)
+{
+	std::vector<uint8_t> input;
+	if (!read_file(source, input))
+	{
+		return false;
+	}
+
+	size_t offset = 0;
+	if (input.size() > 10 && memcmp(input.data(), "ID3", 3) == 0)
+	{
+		offset = 10 + ((input[6] & 0x7F) << 21 | (input[7] & 0x7F) << 14 | (input[8] & 0x7F) << 7 | (input[9] & 0x7F));
+	}
+
+	std::vector<uint8_t> frames;
+	size_t frame_count = 0;
+	while (offset < input.size())
+	{
+		size_t size = mp3_frame_size(input.data() + offset, input.size() - offset);
+		if (size == 0 || offset + size > input.size())
+		{
+			break;
+		}
+
+		bool mono = ((input[offset + 3] >> 6) == 3);
+		bool mpeg1 = (((input[offset + 1] >> 3) & 3) == 3);
+		size_t tag_offset = 4 + (mpeg1 ? (mono ? 17 : 32) : (mono ? 9 : 17));
+		const uint8_t* tag = input.data() + offset + tag_offset;
+		bool info_frame = (tag_offset + 4 <= size && (memcmp(tag, "Xing", 4) == 0 || memcmp(tag, "Info", 4) == 0));
+
+		if (!info_frame)
+		{
+			frames.insert(frames.end(), input.begin() + offset, input.begin() + offset + size);
+			frame_count++;
+		}
+		offset += size;
+	}
+
+	if (frame_count == 0)
+	{
+		return false;
+	}
+
+	// Layer III MPEG-1 frames hold 1152 samples per channel.
+	uint64_t frames_wanted = (uint64_t)(seconds * sample_rate / 1152.0) + 1;
+	std::vector<uint8_t> output;
+	output.reserve(frames.size() * (frames_wanted / frame_count + 1));
+	for (uint64_t written = 0; written < frames_wanted; written += frame_count)
+	{
+		output.insert(output.end(), frames.begin(), frames.end());
+	}
+
+	return write_file(destination, output);
+}
+
+//////////////////////
+// Vorbis fixture //
+//////////////////////
+
+static uint32_t ogg_crc(const uint8_t* data, size_t size)
+{
+	static uint32_t table[256];
+	static bool table_ready = false;
+	if (!table_ready)
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t r = i << 24;
+			for (int b = 0; b < 8; b++)
+			{
+				r = (r & 0x80000000) ? (r << 1) ^ 0x04C11DB7 : (r << 1);
+			}
+			table[i] = r;
+		}
+		table_ready = true;
+	}
+
+	uint32_t crc = 0;
+	for (size_t i = 0; i < size; i++)
+	{
+		crc = (crc << 8) ^ table[((crc >> 24) & 0xFF) ^ data[i]];
+	}
+	return crc;
+}
+
+// Repeat the audio pages of an Ogg Vorbis file, rewriting the page sequence numbers, granule positions and CRCs.
+static bool build_vorbis_fixture(const std::string& source, const std::string& destination, double seconds, uint32_t sample_rate)
+{
+	std::vector<uint8_t> input;
+	if (!read_file(source, input))
+	{
+		return false;
+	}
+
+	std::vector<size_t> page_offsets;
+	std::vector<size_t> page_sizes;
+	size_t audio_start_page = 0;
+	int header_packets = 0;
+
+	for (size_t offset = 0; offset + 27 <= input.size() && memcmp(input.data() + offset, "OggS", 4) == 0; )
+	{
+		uint8_t segments = input[offset + 26];
+		size_t size = 27 + segments;
+		for (int i = 0; i < segments; i++)
+		{
+			uint8_t lacing = input[offset + 27 + i];
+			size += lacing;
+			if (lacing < 255 && header_packets < 3 && ++header_packets == 3)
+			{
+				audio_start_page = page_offsets.size() + 1;
+			}
+		}
+		if (offset + size > input.size())
+		{
+			break;
+		}
+		page_offsets.push_back(offset);
+		page_sizes.push_back(size);
+		offset += size;
+	}
+
+	if (audio_start_page == 0 || audio_start_page >= page_offsets.size())
+	{
+		return false;
+	}
+
+	size_t last = page_offsets.back();
+	int64_t granule_per_repeat = 0;
+	memcpy(&granule_per_repeat, input.data() + last + 6, sizeof(granule_per_repeat));
+	if (granule_per_repeat <= 0)
+	{
+		return false;
+	}
+
+	uint64_t repeats = (uint64_t)(seconds * sample_rate / granule_per_repeat) + 1;
+	std::vector<uint8_t> output(input.begin(), input.begin() + page_offsets[audio_start_page]);
+	uint32_t sequence = (uint32_t)audio_start_page;
+
+	for (uint64_t r = 0; r < repeats; r++)
+	{
+		for (size_t p = audio_start_page; p < page_offsets.size(); p++)
+		{
+			size_t page_start = output.size();
+			output.insert(output.end(), input.begin() + page_offsets[p], input.begin() + page_offsets[p] + page_sizes[p]);
+			uint8_t* page = output.data() + page_start;
+
+			int64_t granule;
+			memcpy(&granule, page + 6, sizeof(granule));
+			if (granule >= 0)
+			{
+				granule += (int64_t)r * granule_per_repeat;
+				memcpy(page + 6, &granule, sizeof(granule));
+			}
+			if (r + 1 < repeats)
+			{
+				page[5] &= ~0x04; // Clear end of stream
+			}
+			memcpy(page + 18, &sequence, sizeof(sequence));
+			sequence++;
+			memset(page + 22, 0, 4);
+			uint32_t crc = ogg_crc(page, page_sizes[p]);
+			memcpy(page + 22, &crc, sizeof(crc));
+		}
+	}
+
+	return write_file(destination, output);
+}
+
+//////////////////////
+// Fixture setup //
+//////////////////////
+
+static bool describe_fixture(bench_fixture* fixture)
+{
+	uint32_t bits_per_sample = 0;
+	ga_codec codec;
+	if (get_audio_file_info(fixture->file_name.c_str(), &fixture->num_frames, &fixture->channels, &fixture->sample_rate, &bits_per_sample, &codec) != GA_SUCCESS || codec != fixture->codec)
+	{
+		return false;
+	}
+	return fixture->num_frames > 0;
+}
+
+// Write 16-bit samples with the G-Audio write API, in blocks the size a logging application might use.
+static bool write_fixture(const std::string& file_name, ga_codec codec, flac_specific* settings, const std::vector<int16_t>& signal, uint64_t num_frames, uint32_t channels, uint32_t sample_rate)
+{
+	const uint64_t block_size = 4096;
+	int32_t refnum;
+	uint64_t total = 0;
+
+	if (open_audio_file_write(file_name.c_str(), channels, sample_rate, 16, codec, (settings != NULL ? 1 : 0), settings, &refnum) != GA_SUCCESS)
+	{
+		return false;
+	}
+
+	for (uint64_t offset = 0; offset < num_frames; offset += block_size)
+	{
+		uint64_t frames_written = 0;
+		uint64_t frames = (num_frames - offset < block_size ? num_frames - offset : block_size);
+		write_audio_file(refnum, frames, (void*)(signal.data() + (offset * channels)), &frames_written);
+		total += frames_written;
+	}
+
+	return (close_audio_file(refnum) == GA_SUCCESS && total == num_frames);
+}
+
+static std::vector<bench_fixture> create_fixtures(bench_config* config)
+{
+	std::vector<bench_fixture> fixtures;
+	const uint32_t channels = 2;
+	const uint32_t sample_rate = 44100;
+	uint64_t num_frames = (uint64_t)(config->seconds * sample_rate);
+	std::vector<int16_t> signal = generate_signal(num_frames, channels, sample_rate);
+
+	make_directory(config->fixtures);
+
+	bench_fixture flac = { ga_codec_flac, config->fixtures + "/bench.flac", 0, 0, 0 };
+	if (write_fixture(flac.file_name, ga_codec_flac, NULL, signal, num_frames, channels, sample_rate) && describe_fixture(&flac))
+	{
+		// Check the encoder round trips before trusting any timings.
+		uint64_t loaded_frames = 0;
+		uint32_t loaded_channels = 0, loaded_rate = 0;
+		ga_codec codec;
+		ga_result result;
+		int16_t* loaded = load_audio_file_s16(flac.file_name.c_str(), &loaded_frames, &loaded_channels, &loaded_rate, &codec, &result);
+		if (loaded != NULL && loaded_frames == num_frames && memcmp(loaded, signal.data(), signal.size() * sizeof(int16_t)) == 0)
+		{
+			fixtures.push_back(flac);
+		}
+		else
+		{
+			fprintf(stderr, "FLAC fixture failed to round trip, skipping FLAC.\n");
+			config->failures++;
+		}
+		free_sample_data(loaded);
+	}
+	else
+	{
+		fprintf(stderr, "Unable to create FLAC fixture.\n");
+		config->failures++;
+	}
+
+	bench_fixture mp3 = { ga_codec_mp3, config->fixtures + "/bench.mp3", 0, 0, 0 };
+	if (build_mp3_fixture(config->resources + "/mp3/44100-16-2ch-CBR-320.mp3", mp3.file_name, config->seconds, sample_rate) && describe_fixture(&mp3))
+	{
+		fixtures.push_back(mp3);
+	}
+	else
+	{
+		fprintf(stderr, "Unable to create MP3 fixture from %s, skipping MP3. Use --resources to set the unit test resource directory.\n", config->resources.c_str());
+	}
+
+	bench_fixture vorbis = { ga_codec_vorbis, config->fixtures + "/bench.ogg", 0, 0, 0 };
+	if (build_vorbis_fixture(config->resources + "/vorbis/44100-16-2ch-q10.ogg", vorbis.file_name, config->seconds, sample_rate) && describe_fixture(&vorbis))
+	{
+		fixtures.push_back(vorbis);
+	}
+	else
+	{
+		fprintf(stderr, "Unable to create Vorbis fixture from %s, skipping Vorbis. Use --resources to set the unit test resource directory.\n", config->resources.c_str());
+	}
+
+	bench_fixture wav = { ga_codec_wav, config->fixtures + "/bench.wav", 0, 0, 0 };
+	if (write_fixture(wav.file_name, ga_codec_wav, NULL, signal, num_frames, channels, sample_rate) && describe_fixture(&wav))
+	{
+		fixtures.push_back(wav);
+	}
+	else
+	{
+		fprintf(stderr, "Unable to create WAV fixture.\n");
+		config->failures++;
+	}
+
+	return fixtures;
+}
+
+//////////////////////
+// Benchmarks //
+//////////////////////
+
+static void bench_load(const bench_config* config, const bench_fixture* fixture)
+{
+	double best = -1;
+	uint64_t frames = 0;
+
+	for (int r = 0; r < config->repeats; r++)
+	{
+		uint64_t num_frames = 0;
+		uint32_t channels = 0, sample_rate = 0;
+		ga_codec codec;
+		ga_result result;
+		double start = now_seconds();
+		int16_t* data = load_audio_file_s16(fixture->file_name.c_str(), &num_frames, &channels, &sample_rate, &codec, &result);
+		double elapsed = now_seconds() - start;
+		free_sample_data(data);
+		if (data == NULL || result != GA_SUCCESS)
+		{
+			return;
+		}
+		frames = num_frames;
+		best = (best < 0 || elapsed < best ? elapsed : best);
+	}
+
+	report(config, "load_audio_file_s16", codec_names[fixture->codec], "i16", 0, simd_names[get_conversion_simd_level()], "frames", frames, best);
+}
+
+// Load every fixture in a single batch, against loading them one after another above.
+static void bench_load_batch(const bench_config* config, const std::vector<bench_fixture>& fixtures)
+{
+	size_t count = fixtures.size();
+	std::vector<const char*> file_names(count);
+	std::vector<intptr_t> buffers(count);
+	std::vector<uint64_t> num_frames(count);
+	std::vector<uint32_t> channels(count), sample_rates(count);
+	std::vector<ga_codec> codecs(count);
+	std::vector<ga_result> results(count);
+	double best = -1;
+	uint64_t frames = 0;
+
+	if (count == 0)
+	{
+		return;
+	}
+
+	for (size_t f = 0; f < count; f++)
+	{
+		file_names[f] = fixtures[f].file_name.c_str();
+	}
+
+	for (int r = 0; r < config->repeats; r++)
+	{
+		double start = now_seconds();
+		ga_result result = load_audio_files(file_names.data(), (int32_t)count, ga_data_type_i16, buffers.data(), num_frames.data(), channels.data(), sample_rates.data(), codecs.data(), results.data());
+		double elapsed = now_seconds() - start;
+		frames = 0;
+		for (size_t f = 0; f < count; f++)
+		{
+			free_sample_data((int16_t*)buffers[f]);
+			frames += num_frames[f];
+		}
+		if (result != GA_SUCCESS)
+		{
+			return;
+		}
+		best = (best < 0 || elapsed < best ? elapsed : best);
+	}
+
+	report(config, "load_audio_files", "all", "i16", 0, simd_names[get_conversion_simd_level()], "frames", frames, best);
+}
+
+static void bench_read(const bench_config* config, const bench_fixture* fixture, ga_data_type data_type, uint64_t block_size)
+{
+	std::vector<uint8_t> buffer(block_size * fixture->channels * data_type_sizes[data_type]);
+	double best = -1;
+	uint64_t total = 0;
+
+	for (int r = 0; r < config->repeats; r++)
+	{
+		int32_t refnum;
+		if (open_audio_file(fixture->file_name.c_str(), &refnum) != GA_SUCCESS)
+		{
+			return;
+		}
+
+		uint64_t frames_read = 0;
+		total = 0;
+		double start = now_seconds();
+		while (read_audio_file(refnum, block_size, data_type, &frames_read, buffer.data()) == GA_SUCCESS && frames_read > 0)
+		{
+			total += frames_read;
+		}
+		double elapsed = now_seconds() - start;
+		close_audio_file(refnum);
+
+		best = (best < 0 || elapsed < best ? elapsed : best);
+	}
+
+	report(config, "read_audio_file", codec_names[fixture->codec], data_type_names[data_type], block_size, simd_names[get_conversion_simd_level()], "frames", total, best);
+}
+
+// The first seek of a refnum may build a seek index, so its latency is reported separately from the seeks that follow.
+static void bench_seek(const bench_config* config, const bench_fixture* fixture)
+{
+	const int seek_count = 200;
+	double best = -1;
+	double best_first = -1;
+
+	for (int r = 0; r < config->repeats; r++)
+	{
+		int32_t refnum;
+
+		// Drop cached Vorbis page indexes, so every repeat measures an uncached first seek.
+		configure_vorbis_index_cache(0);
+		configure_vorbis_index_cache(1);
+
+		if (open_audio_file(fixture->file_name.c_str(), &refnum) != GA_SUCCESS)
+		{
+			return;
+		}
+
+		uint32_t state = 12345;
+		uint64_t new_offset;
+		double start = now_seconds();
+		seek_audio_file(refnum, fixture->num_frames / 2, &new_offset);
+		double first = now_seconds() - start;
+
+		start = now_seconds();
+		for (int i = 0; i < seek_count; i++)
+		{
+			state = state * 1664525 + 1013904223;
+			seek_audio_file(refnum, (uint64_t)(((double)state / 4294967296.0) * fixture->num_frames), &new_offset);
+		}
+		double elapsed = now_seconds() - start;
+		close_audio_file(refnum);
+
+		best = (best < 0 || elapsed < best ? elapsed : best);
+		best_first = (best_first < 0 || first < best_first ? first : best_first);
+	}
+
+	report(config, "seek_audio_file_first", codec_names[fixture->codec], "", 0, simd_names[get_conversion_simd_level()], "seeks", 1, best_first);
+	report(config, "seek_audio_file", codec_names[fixture->codec], "", 0, simd_names[get_conversion_simd_level()], "seeks", seek_count, best);
+}
+
+// File info and tags are read without decoding, so these measure the header parsing done by library scans.
+static void bench_metadata(const bench_config* config, const bench_fixture* fixture)
+{
+	const int file_count = 20;
+	double best_info = -1;
+	double best_tags = -1;
+	bool has_tags = true;
+	// The MP3 fixture is a bare stream without an ID3 tag, so MP3 tags are read from a test file with a tag holding several pictures.
+	std::string tag_file_name = (fixture->codec == ga_codec_mp3 ? config->resources + "/tags/pictures.mp3" : fixture->file_name);
+
+	for (int r = 0; r < config->repeats; r++)
+	{
+		uint64_t num_frames;
+		uint32_t channels, sample_rate, bits_per_sample;
+		ga_codec codec;
+		double start = now_seconds();
+		for (int i = 0; i < file_count; i++)
+		{
+			if (get_audio_file_info(fixture->file_name.c_str(), &num_frames, &channels, &sample_rate, &bits_per_sample, &codec) != GA_SUCCESS)
+			{
+				return;
+			}
+		}
+		double info_elapsed = now_seconds() - start;
+
+		start = now_seconds();
+		for (int i = 0; i < file_count; i++)
+		{
+			intptr_t tags = 0, pictures = 0;
+			int32_t tag_count = 0, picture_count = 0;
+			has_tags = (get_audio_file_tags(tag_file_name.c_str(), 0, &tags, &tag_count, &pictures, &picture_count) == GA_SUCCESS && has_tags);
+			free_audio_file_tags(tags, tag_count, pictures, picture_count);
+		}
+		double tags_elapsed = now_seconds() - start;
+
+		best_info = (best_info < 0 || info_elapsed < best_info ? info_elapsed : best_info);
+		best_tags = (best_tags < 0 || tags_elapsed < best_tags ? tags_elapsed : best_tags);
+	}
+
+	report(config, "get_audio_file_info", codec_names[fixture->codec], "", 0, simd_names[get_conversion_simd_level()], "files", file_count, best_info);
+	if (has_tags)
+	{
+		report(config, "get_audio_file_tags", codec_names[fixture->codec], "", 0, simd_names[get_conversion_simd_level()], "files", file_count, best_tags);
+	}
+}
+
+typedef struct
+{
+	const char* name;
+	ga_data_type type_in;
+	ga_data_type type_out;
+	void (*dispatch)(void* buffer_out, const void* buffer_in, size_t num_samples);
+	void (*scalar)(void* buffer_out, const void* buffer_in, size_t num_samples);
+} conversion_kernel;
+
+#define KERNEL(name, in, out) { #name, ga_data_type_##in, ga_data_type_##out, (void (*)(void*, const void*, size_t))name, (void (*)(void*, const void*, size_t))name##_scalar }
+
+// Encode the synthetic signal. FLAC is timed at the fastest, default and smallest levels, and with 8 channels at the fastest level as a logging workload.
+static void bench_write(bench_config* config)
+{
+	typedef struct
+	{
+		const char* name;
+		ga_codec codec;
+		int32_t level;
+		uint32_t channels;
+		uint32_t sample_rate;
+	} write_case;
+	static const write_case cases[] = {
+		{ "wav", ga_codec_wav, -1, 2, 44100 },
+		{ "flac-0", ga_codec_flac, 0, 2, 44100 },
+		{ "flac-5", ga_codec_flac, 5, 2, 44100 },
+		{ "flac-8", ga_codec_flac, 8, 2, 44100 },
+		{ "flac-0-8ch", ga_codec_flac, 0, 8, 48000 }
+	};
+
+	make_directory(config->fixtures);
+
+	for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+	{
+		const write_case* test = &cases[c];
+		uint64_t num_frames = (uint64_t)(config->seconds * test->sample_rate);
+		std::vector<int16_t> signal = generate_signal(num_frames, test->channels, test->sample_rate);
+		std::string file_name = config->fixtures + "/bench_write." + codec_names[test->codec];
+		flac_specific settings = { (uint32_t)test->level, 0, 0 };
+		double best = -1;
+
+		for (int r = 0; r < config->repeats; r++)
+		{
+			double start = now_seconds();
+			bool ok = write_fixture(file_name, test->codec, (test->level >= 0 ? &settings : NULL), signal, num_frames, test->channels, test->sample_rate);
+			double elapsed = now_seconds() - start;
+			if (!ok)
+			{
+				fprintf(stderr, "Unable to write %s.\n", file_name.c_str());
+				config->failures++;
+				return;
+			}
+			best = (best < 0 || elapsed < best ? elapsed : best);
+		}
+
+		report(config, "write_audio_file", test->name, "i16", 4096, simd_names[get_conversion_simd_level()], "frames", num_frames, best);
+		remove(file_name.c_str());
+	}
+}
+
+static void fill_samples(std::vector<uint8_t>& buffer, ga_data_type type, size_t num_samples)
+{
+	uint32_t state = 987654321;
+	for (size_t i = 0; i < num_samples; i++)
+	{
+		state = state * 1664525 + 1013904223;
+		// Slightly over full scale, to exercise clipping.
+		double x = ((double)state / 2147483648.0 - 1.0) * 1.05;
+		switch (type)
+		{
+			case ga_data_type_u8: ((uint8_t*)buffer.data())[i] = (uint8_t)(state >> 24); break;
+			case ga_data_type_i16: ((int16_t*)buffer.data())[i] = (int16_t)(state >> 16); break;
+			case ga_data_type_i32: ((int32_t*)buffer.data())[i] = (int32_t)state; break;
+			case ga_data_type_float: ((float*)buffer.data())[i] = (float)x; break;
+			case ga_data_type_double: ((double*)buffer.data())[i] = x; break;
+		}
+	}
+}
+
+static void bench_convert(bench_config* config)
+{
+	static const conversion_kernel kernels[] = {
+		KERNEL(u8_to_s16, u8, i16), KERNEL(u8_to_s32, u8, i32), KERNEL(u8_to_f32, u8, float), KERNEL(u8_to_f64, u8, double),
+		KERNEL(s16_to_u8, i16, u8), KERNEL(s16_to_s32, i16, i32), KERNEL(s16_to_f32, i16, float), KERNEL(s16_to_f64, i16, double),
+		KERNEL(s32_to_u8, i32, u8), KERNEL(s32_to_s16, i32, i16), KERNEL(s32_to_f32, i32, float), KERNEL(s32_to_f64, i32, double),
+		KERNEL(f32_to_u8, float, u8), KERNEL(f32_to_s16, float, i16), KERNEL(f32_to_s32, float, i32), KERNEL(f32_to_f64, float, double),
+		KERNEL(f64_to_u8, double, u8), KERNEL(f64_to_s16, double, i16), KERNEL(f64_to_s32, double, i32), KERNEL(f64_to_f32, double, float),
+		KERNEL(s32_to_s24, i32, s24)
+	};
+	// Odd length so the scalar tail of every kernel is exercised by the verification.
+	const size_t num_samples = (1 << 20) + 13;
+	const int iterations = 16;
+	ga_simd_level original_level = get_conversion_simd_level();
+	ga_simd_level supported_level = get_supported_simd_level();
+
+	for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+	{
+		const conversion_kernel* kernel = &kernels[k];
+		std::vector<uint8_t> input(num_samples * data_type_sizes[kernel->type_in]);
+		std::vector<uint8_t> output(num_samples * data_type_sizes[kernel->type_out]);
+		std::vector<uint8_t> reference(output.size());
+		fill_samples(input, kernel->type_in, num_samples);
+		kernel->scalar(reference.data(), input.data(), num_samples);
+
+		for (int level = ga_simd_none; level <= ga_simd_neon; level++)
+		{
+			if (level != ga_simd_none && (level == ga_simd_neon) != (supported_level == ga_simd_neon))
+			{
+				continue;
+			}
+			if (set_conversion_simd_level((ga_simd_level)level) != level)
+			{
+				continue;
+			}
+
+			double best = -1;
+			for (int r = 0; r < config->repeats; r++)
+			{
+				double start = now_seconds();
+				for (int i = 0; i < iterations; i++)
+				{
+					kernel->dispatch(output.data(), input.data(), num_samples);
+				}
+				double elapsed = now_seconds() - start;
+				best = (best < 0 || elapsed < best ? elapsed : best);
+			}
+
+			if (memcmp(output.data(), reference.data(), output.size()) != 0)
+			{
+				fprintf(stderr, "%s (%s) output differs from the scalar reference.\n", kernel->name, simd_names[level]);
+				config->failures++;
+			}
+
+			report(config, "convert", kernel->name, data_type_names[kernel->type_out], 0, simd_names[level], "samples", (uint64_t)num_samples * iterations, best);
+		}
+	}
+
+	set_conversion_simd_level(original_level);
+}
+
+int main(int argc, char** argv)
+{
+	bench_config config;
+	config.seconds = 60;
+	config.repeats = 3;
+	config.resources = "../LabVIEW/Unit Tests/Resources";
+	config.fixtures = "bench_fixtures";
+	config.output = stdout;
+	config.failures = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string arg = argv[i];
+		bool has_value = (i + 1 < argc);
+		if (arg == "--seconds" && has_value) { config.seconds = atof(argv[++i]); }
+		else if (arg == "--repeats" && has_value) { config.repeats = atoi(argv[++i]); }
+		else if (arg == "--resources" && has_value) { config.resources = argv[++i]; }
+		else if (arg == "--fixtures" && has_value) { config.fixtures = argv[++i]; }
+		else if (arg == "--filter" && has_value) { config.filter = argv[++i]; }
+		else if (arg == "--output" && has_value)
+		{
+			config.output = fopen(argv[++i], "w");
+			if (config.output == NULL)
+			{
+				fprintf(stderr, "Unable to open %s for writing.\n", argv[i]);
+				return 1;
+			}
+		}
+		else
+		{
+			fprintf(stderr, "Usage: %s [--seconds N] [--repeats N] [--resources DIR] [--fixtures DIR] [--filter TEXT] [--output FILE]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (config.seconds <= 0 || config.repeats <= 0)
+	{
+		fprintf(stderr, "--seconds and --repeats must be positive.\n");
+		return 1;
+	}
+
+	fprintf(config.output, "benchmark,codec,data_type,block_size,simd,unit,count,seconds,per_second,ns_per_unit\n");
+
+	if (run_benchmark(&config, "load_audio_file_s16") || run_benchmark(&config, "load_audio_files") || run_benchmark(&config, "read_audio_file") || run_benchmark(&config, "seek_audio_file") || run_benchmark(&config, "get_audio_file_info") || run_benchmark(&config, "get_audio_file_tags"))
+	{
+		std::vector<bench_fixture> fixtures = create_fixtures(&config);
+		static const uint64_t block_sizes[] = { 256, 1024, 4096, 16384 };
+
+		for (size_t f = 0; f < fixtures.size(); f++)
+		{
+			if (run_benchmark(&config, "load_audio_file_s16"))
+			{
+				bench_load(&config, &fixtures[f]);
+			}
+			if (run_benchmark(&config, "read_audio_file"))
+			{
+				for (int type = ga_data_type_u8; type <= ga_data_type_double; type++)
+				{
+					for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); b++)
+					{
+						bench_read(&config, &fixtures[f], (ga_data_type)type, block_sizes[b]);
+					}
+				}
+			}
+			if (run_benchmark(&config, "seek_audio_file"))
+			{
+				bench_seek(&config, &fixtures[f]);
+			}
+			if (run_benchmark(&config, "get_audio_file_info") || run_benchmark(&config, "get_audio_file_tags"))
+			{
+				bench_metadata(&config, &fixtures[f]);
+			}
+		}
+
+		if (run_benchmark(&config, "load_audio_files"))
+		{
+			bench_load_batch(&config, fixtures);
+		}
+	}
+
+	if (run_benchmark(&config, "write_audio_file"))
+	{
+		bench_write(&config);
+	}
+
+	if (run_benchmark(&config, "convert"))
+	{
+		bench_convert(&config);
+	}
+
+	if (config.output != stdout)
+	{
+		fclose(config.output);
+	}
+
+	return (config.failures > 0 ? 1 : 0);
+}
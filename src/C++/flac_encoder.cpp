@@ -0,0 +1,1329 @@
+/*
+G-Audio - An audio library for LabVIEW.
+
+See g_audio.h for license details.
+
+FLAC frame encoder. Frames are encoded independently of each other, so the stream writer in g_audio.cpp can spread them across threads.
+
+Each subframe tries a verbatim copy, the best fixed predictor (order 0-4) and, at higher levels, LPC predictors from a Tukey windowed
+autocorrelation, keeping whichever codes smallest. Residuals are Rice coded with the partition order chosen from partition sums,
+much like the reference encoder. Sizes are counted exactly before anything is written, so a frame never exceeds flac_max_frame_size().
+*/
+
+#include "stdafx.h"
+#include "flac_encoder.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define FLAC_SUBFRAME_CONSTANT	0
+#define FLAC_SUBFRAME_VERBATIM	1
+#define FLAC_SUBFRAME_FIXED		8
+#define FLAC_SUBFRAME_LPC		32
+
+#define FLAC_MAX_FIXED_ORDER	4
+#define FLAC_MAX_PARTITIONS		(1 << FLAC_ENCODER_MAX_PARTITION_ORDER)
+// One slot per input channel, plus mid and side for stereo.
+#define FLAC_MAX_SLOTS			(FLAC_ENCODER_MAX_CHANNELS + 2)
+// Residuals are kept well inside 32 bits so they fold to unsigned and fit a 5-bit Rice parameter.
+#define FLAC_MAX_RESIDUAL		(1 << 30)
+
+typedef struct
+{
+	uint32_t type;
+	uint32_t order;
+	uint32_t wasted_bits;
+	uint32_t bits_per_sample;		// Excluding wasted bits
+	int32_t qlp_coeffs[FLAC_ENCODER_MAX_LPC_ORDER];
+	uint32_t qlp_precision;
+	int32_t qlp_shift;
+	uint32_t partition_order;
+	uint8_t rice2;					// Rice parameters are 5 bits rather than 4
+	uint32_t rice_params[FLAC_MAX_PARTITIONS];
+	uint64_t bits;					// Exact size of the coded subframe
+	const int32_t* signal;
+	int32_t* residual;
+} flac_subframe;
+
+struct flac_frame_workspace
+{
+	uint32_t block_size;
+	uint32_t slot_count;
+	int32_t* samples[FLAC_MAX_SLOTS];
+	int32_t* shifted[FLAC_MAX_SLOTS];
+	int32_t* residual[FLAC_MAX_SLOTS][2];
+	flac_subframe subframes[FLAC_MAX_SLOTS];
+	uint32_t* folded;
+	double* windowed;
+	double* window;
+	uint32_t window_size;
+};
+
+typedef struct
+{
+	uint8_t* data;
+	size_t capacity;
+	size_t size;
+	uint64_t accumulator;
+	uint32_t bit_count;
+	uint8_t overflow;
+} flac_bit_writer;
+
+typedef struct
+{
+	uint8_t crc8[256];
+	uint16_t crc16[256];
+} flac_crc_tables;
+
+static flac_crc_tables build_crc_tables()
+{
+	flac_crc_tables tables;
+
+	for (uint32_t i = 0; i < 256; i++)
+	{
+		uint32_t crc8 = i;
+		uint32_t crc16 = i << 8;
+
+		for (int b = 0; b < 8; b++)
+		{
+			crc8 = (crc8 & 0x80) ? ((crc8 << 1) ^ 0x07) : (crc8 << 1);
+			crc16 = (crc16 & 0x8000) ? ((crc16 << 1) ^ 0x8005) : (crc16 << 1);
+		}
+
+		tables.crc8[i] = (uint8_t)crc8;
+		tables.crc16[i] = (uint16_t)crc16;
+	}
+
+	return tables;
+}
+
+// Initialized when the library is loaded.
+static const flac_crc_tables crc_tables = build_crc_tables();
+
+//////////////////
+// Bit writing //
+//////////////////
+
+static inline void flush_bits(flac_bit_writer* writer)
+{
+	while (writer->bit_count >= 8)
+	{
+		writer->bit_count -= 8;
+
+		if (writer->size < writer->capacity)
+		{
+			writer->data[writer->size++] = (uint8_t)(writer->accumulator >> writer->bit_count);
+		}
+		else
+		{
+			writer->overflow = 1;
+		}
+	}
+}
+
+// Write the low bits of value, up to 32.
+static inline void put_bits(flac_bit_writer* writer, uint32_t value, uint32_t bits)
+{
+	if (bits == 0)
+	{
+		return;
+	}
+
+	writer->accumulator = (writer->accumulator << bits) | (value & (0xFFFFFFFFu >> (32 - bits)));
+	writer->bit_count += bits;
+
+	// Keeps fewer than 32 bits pending, so the next write can't overflow the accumulator.
+	if (writer->bit_count >= 32)
+	{
+		flush_bits(writer);
+	}
+}
+
+static inline void put_zeros(flac_bit_writer* writer, uint32_t bits)
+{
+	while (bits > 32)
+	{
+		put_bits(writer, 0, 32);
+		bits -= 32;
+	}
+
+	put_bits(writer, 0, bits);
+}
+
+static void put_utf8(flac_bit_writer* writer, uint32_t value)
+{
+	uint32_t extra;
+
+	if (value < 0x80)
+	{
+		put_bits(writer, value, 8);
+		return;
+	}
+
+	extra = (value < 0x800 ? 1 : value < 0x10000 ? 2 : value < 0x200000 ? 3 : value < 0x4000000 ? 4 : 5);
+	put_bits(writer, ((0xFF00 >> (extra + 1)) & 0xFF) | (value >> (6 * extra)), 8);
+
+	for (int i = (int)extra - 1; i >= 0; i--)
+	{
+		put_bits(writer, 0x80 | ((value >> (6 * i)) & 0x3F), 8);
+	}
+}
+
+static inline void align_bits(flac_bit_writer* writer)
+{
+	if ((writer->bit_count & 7) != 0)
+	{
+		put_bits(writer, 0, 8 - (writer->bit_count & 7));
+	}
+
+	flush_bits(writer);
+}
+
+static inline uint32_t fold_residual(int32_t residual)
+{
+	return ((uint32_t)residual << 1) ^ (uint32_t)(residual >> 31);
+}
+
+static inline uint32_t floor_log2(uint64_t value)
+{
+	uint32_t result = 0;
+
+	while (value > 1)
+	{
+		value >>= 1;
+		result++;
+	}
+
+	return result;
+}
+
+////////////////////
+// Rice residuals //
+////////////////////
+
+static inline uint32_t rice_parameter(uint64_t sum, uint32_t count)
+{
+	uint32_t parameter;
+
+	if (count == 0 || sum < count)
+	{
+		return 0;
+	}
+
+	parameter = floor_log2(sum / count);
+
+	return (parameter > 30 ? 30 : parameter);
+}
+
+// Choose the partition order and Rice parameters for a subframe's residual, using the candidate's order. Returns the exact size in bits.
+static uint64_t plan_residual(const flac_encoder_config* config, flac_frame_workspace* workspace, const int32_t* residual, uint32_t num_frames, flac_subframe* subframe)
+{
+	uint32_t order = subframe->order;
+	uint32_t count = num_frames - order;
+	uint32_t* folded = workspace->folded;
+	uint64_t sums[FLAC_MAX_PARTITIONS];
+	uint64_t best_bits = UINT64_MAX;
+	uint32_t max_order = 0;
+	uint32_t partition_size;
+	uint32_t index = 0;
+	uint64_t bits;
+
+	for (uint32_t i = 0; i < count; i++)
+	{
+		folded[i] = fold_residual(residual[i]);
+	}
+
+	// Partitions must split the block evenly, and the first must be longer than the warmup.
+	while (max_order < config->max_partition_order && (num_frames & ((2u << max_order) - 1)) == 0 && (num_frames >> (max_order + 1)) > order)
+	{
+		max_order++;
+	}
+
+	partition_size = num_frames >> max_order;
+
+	for (uint32_t p = 0; p < (1u << max_order); p++)
+	{
+		uint32_t end = (p + 1) * partition_size - order;
+		uint64_t sum = 0;
+
+		for (; index < end; index++)
+		{
+			sum += folded[index];
+		}
+
+		sums[p] = sum;
+	}
+
+	for (int partition_order = (int)max_order; partition_order >= 0; partition_order--)
+	{
+		uint32_t partitions = 1u << partition_order;
+		uint32_t params[FLAC_MAX_PARTITIONS];
+		uint32_t max_param = 0;
+
+		if (partition_order < (int)max_order)
+		{
+			for (uint32_t p = 0; p < partitions; p++)
+			{
+				sums[p] = sums[2 * p] + sums[2 * p + 1];
+			}
+		}
+
+		partition_size = num_frames >> partition_order;
+		bits = 0;
+
+		for (uint32_t p = 0; p < partitions; p++)
+		{
+			uint32_t partition_count = partition_size - (p == 0 ? order : 0);
+			uint32_t k = rice_parameter(sums[p], partition_count);
+
+			params[p] = k;
+			max_param = (k > max_param ? k : max_param);
+			bits += (uint64_t)partition_count * (k + 1) + (sums[p] >> k);
+		}
+
+		bits += partitions * (max_param > 14 ? 5 : 4);
+
+		if (bits < best_bits)
+		{
+			best_bits = bits;
+			subframe->partition_order = (uint32_t)partition_order;
+			subframe->rice2 = (max_param > 14);
+			memcpy(subframe->rice_params, params, partitions * sizeof(uint32_t));
+		}
+	}
+
+	// The estimate above rounds each partition's quotients down, count them exactly.
+	partition_size = num_frames >> subframe->partition_order;
+	bits = 6;
+	index = 0;
+
+	for (uint32_t p = 0; p < (1u << subframe->partition_order); p++)
+	{
+		uint32_t k = subframe->rice_params[p];
+		uint32_t end = (p + 1) * partition_size - order;
+
+		bits += (subframe->rice2 ? 5 : 4) + (uint64_t)(end - index) * (k + 1);
+
+		for (; index < end; index++)
+		{
+			bits += folded[index] >> k;
+		}
+	}
+
+	return bits;
+}
+
+static void write_residual(flac_bit_writer* writer, const flac_subframe* subframe, uint32_t num_frames)
+{
+	uint32_t partition_size = num_frames >> subframe->partition_order;
+	uint32_t param_bits = (subframe->rice2 ? 5 : 4);
+	uint32_t index = 0;
+
+	put_bits(writer, subframe->rice2, 2);
+	put_bits(writer, subframe->partition_order, 4);
+
+	for (uint32_t p = 0; p < (1u << subframe->partition_order); p++)
+	{
+		uint32_t k = subframe->rice_params[p];
+		uint32_t mask = (1u << k) - 1;
+		uint32_t end = (p + 1) * partition_size - subframe->order;
+
+		put_bits(writer, k, param_bits);
+
+		for (; index < end; index++)
+		{
+			uint32_t value = fold_residual(subframe->residual[index]);
+			uint32_t quotient = value >> k;
+
+			// The unary quotient is the leading zeros of a single write when it fits.
+			if (quotient + k < 32)
+			{
+				put_bits(writer, (1u << k) | (value & mask), quotient + k + 1);
+			}
+			else
+			{
+				put_zeros(writer, quotient);
+				put_bits(writer, (1u << k) | (value & mask), k + 1);
+			}
+		}
+	}
+}
+
+////////////////
+// Predictors //
+////////////////
+
+// Sum of absolute residuals of each fixed predictor, over the samples every order can predict.
+static uint32_t best_fixed_order(const int32_t* signal, uint32_t num_frames, uint64_t* best_sum)
+{
+	uint64_t sums[FLAC_MAX_FIXED_ORDER + 1] = { 0, 0, 0, 0, 0 };
+	uint32_t best = 0;
+
+	if (num_frames <= FLAC_MAX_FIXED_ORDER)
+	{
+		for (uint32_t i = 0; i < num_frames; i++)
+		{
+			sums[0] += (uint32_t)(signal[i] < 0 ? -signal[i] : signal[i]);
+		}
+
+		*best_sum = sums[0];
+		return 0;
+	}
+
+	// Samples are at most 25 bits, so the 4th order difference can't overflow.
+	for (uint32_t i = FLAC_MAX_FIXED_ORDER; i < num_frames; i++)
+	{
+		int32_t d1 = signal[i] - signal[i - 1];
+		int32_t d1_prev = signal[i - 1] - signal[i - 2];
+		int32_t d1_prev2 = signal[i - 2] - signal[i - 3];
+		int32_t d1_prev3 = signal[i - 3] - signal[i - 4];
+		int32_t d2 = d1 - d1_prev;
+		int32_t d2_prev = d1_prev - d1_prev2;
+		int32_t d2_prev2 = d1_prev2 - d1_prev3;
+		int32_t d3 = d2 - d2_prev;
+		int32_t d4 = d3 - (d2_prev - d2_prev2);
+
+		sums[0] += (uint32_t)(signal[i] < 0 ? -signal[i] : signal[i]);
+		sums[1] += (uint32_t)(d1 < 0 ? -d1 : d1);
+		sums[2] += (uint32_t)(d2 < 0 ? -d2 : d2);
+		sums[3] += (uint32_t)(d3 < 0 ? -d3 : d3);
+		sums[4] += (uint32_t)(d4 < 0 ? -d4 : d4);
+	}
+
+	for (uint32_t order = 1; order <= FLAC_MAX_FIXED_ORDER; order++)
+	{
+		if (sums[order] < sums[best])
+		{
+			best = order;
+		}
+	}
+
+	*best_sum = sums[best];
+
+	return best;
+}
+
+static void fixed_residual(const int32_t* x, uint32_t num_frames, uint32_t order, int32_t* residual)
+{
+	switch (order)
+	{
+		case 0: memcpy(residual, x, num_frames * sizeof(int32_t)); break;
+		case 1: for (uint32_t i = 1; i < num_frames; i++) { residual[i - 1] = x[i] - x[i - 1]; } break;
+		case 2: for (uint32_t i = 2; i < num_frames; i++) { residual[i - 2] = x[i] - 2 * x[i - 1] + x[i - 2]; } break;
+		case 3: for (uint32_t i = 3; i < num_frames; i++) { residual[i - 3] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3]; } break;
+		case 4: for (uint32_t i = 4; i < num_frames; i++) { residual[i - 4] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4]; } break;
+		default: break;
+	}
+}
+
+static void update_window(flac_frame_workspace* workspace, uint32_t num_frames)
+{
+	// Tukey window with half of the block tapered, the reference encoder's default.
+	const double pi = 3.14159265358979323846;
+	uint32_t taper = num_frames / 4;
+
+	if (workspace->window_size == num_frames)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < num_frames; i++)
+	{
+		double w = 1.0;
+
+		if (i < taper)
+		{
+			w = 0.5 - 0.5 * cos(pi * i / taper);
+		}
+		else if (i >= num_frames - taper)
+		{
+			w = 0.5 - 0.5 * cos(pi * (num_frames - 1 - i) / taper);
+		}
+
+		workspace->window[i] = w;
+	}
+
+	workspace->window_size = num_frames;
+}
+
+// Levinson-Durbin recursion. Fills lp_coeffs[order - 1] and error[order - 1] for each order, returning the highest usable order.
+static uint32_t compute_lp_coeffs(const double* autoc, uint32_t max_order, double lp_coeffs[][FLAC_ENCODER_MAX_LPC_ORDER], double* error)
+{
+	double lpc[FLAC_ENCODER_MAX_LPC_ORDER];
+	double err = autoc[0];
+
+	for (uint32_t i = 0; i < max_order; i++)
+	{
+		double r = -autoc[i + 1];
+		uint32_t j;
+
+		for (j = 0; j < i; j++)
+		{
+			r -= lpc[j] * autoc[i - j];
+		}
+		r /= err;
+
+		lpc[i] = r;
+		for (j = 0; j < (i >> 1); j++)
+		{
+			double tmp = lpc[j];
+			lpc[j] += r * lpc[i - 1 - j];
+			lpc[i - 1 - j] += r * tmp;
+		}
+		if (i & 1)
+		{
+			lpc[j] += lpc[j] * r;
+		}
+
+		err *= (1.0 - r * r);
+
+		for (j = 0; j <= i; j++)
+		{
+			lp_coeffs[i][j] = -lpc[j];
+		}
+		error[i] = err;
+
+		if (err == 0.0)
+		{
+			return i + 1;
+		}
+	}
+
+	return max_order;
+}
+
+// Pick the order expected to code smallest, from each order's prediction error.
+static uint32_t estimate_lpc_order(const double* error, uint32_t max_order, uint32_t num_frames, uint32_t bits_per_order)
+{
+	double error_scale = 0.5 / num_frames;
+	double best_bits = HUGE_VAL;
+	uint32_t best = 1;
+
+	for (uint32_t order = 1; order <= max_order; order++)
+	{
+		double bits_per_sample = 0.0;
+
+		if (error[order - 1] > 0.0)
+		{
+			bits_per_sample = 0.5 * log(error_scale * error[order - 1]) / log(2.0);
+			bits_per_sample = (bits_per_sample > 0.0 ? bits_per_sample : 0.0);
+		}
+
+		double bits = bits_per_sample * (num_frames - order) + (double)order * bits_per_order;
+
+		if (bits < best_bits)
+		{
+			best_bits = bits;
+			best = order;
+		}
+	}
+
+	return best;
+}
+
+static bool quantize_lp_coeffs(const double* lp_coeffs, uint32_t order, uint32_t precision, int32_t* qlp_coeffs, int32_t* shift)
+{
+	int32_t qmax = (1 << (precision - 1)) - 1;
+	int32_t qmin = -(1 << (precision - 1));
+	double cmax = 0.0;
+	double error = 0.0;
+	int log2cmax;
+
+	for (uint32_t i = 0; i < order; i++)
+	{
+		double c = fabs(lp_coeffs[i]);
+		cmax = (c > cmax ? c : cmax);
+	}
+
+	if (cmax <= 0.0)
+	{
+		return false;
+	}
+
+	frexp(cmax, &log2cmax);
+	*shift = (int32_t)(precision - 1) - (log2cmax - 1);
+
+	// Negative shifts are valid in the format, but not supported by decoders.
+	if (*shift > 15)
+	{
+		*shift = 15;
+	}
+	else if (*shift < 0)
+	{
+		return false;
+	}
+
+	for (uint32_t i = 0; i < order; i++)
+	{
+		error += lp_coeffs[i] * (1 << *shift);
+		long q = lround(error);
+
+		q = (q > qmax ? qmax : (q < qmin ? qmin : q));
+		error -= q;
+		qlp_coeffs[i] = (int32_t)q;
+	}
+
+	return true;
+}
+
+static bool lpc_residual(const int32_t* signal, uint32_t num_frames, const flac_subframe* subframe, int32_t* residual)
+{
+	uint32_t order = subframe->order;
+
+	for (uint32_t i = order; i < num_frames; i++)
+	{
+		int64_t prediction = 0;
+
+		for (uint32_t j = 0; j < order; j++)
+		{
+			prediction += (int64_t)subframe->qlp_coeffs[j] * signal[i - 1 - j];
+		}
+
+		int64_t value = signal[i] - (prediction >> subframe->qlp_shift);
+
+		if (value >= FLAC_MAX_RESIDUAL || value <= -FLAC_MAX_RESIDUAL)
+		{
+			return false;
+		}
+
+		residual[i - order] = (int32_t)value;
+	}
+
+	return true;
+}
+
+static uint32_t qlp_precision(uint32_t bits_per_sample, uint32_t num_frames)
+{
+	if (bits_per_sample < 16)
+	{
+		uint32_t precision = 2 + bits_per_sample / 2;
+		return (precision > 5 ? precision : 5);
+	}
+
+	return (num_frames <= 192 ? 7 : num_frames <= 384 ? 8 : num_frames <= 576 ? 9 : num_frames <= 1152 ? 10 : num_frames <= 2304 ? 11 : num_frames <= 4608 ? 12 : 13);
+}
+
+////////////////
+// Subframes //
+////////////////
+
+// Keep a candidate if it's smaller than the current choice. The candidate's residual buffer becomes the slot's best.
+static void accept_candidate(flac_frame_workspace* workspace, uint32_t slot, flac_subframe* candidate)
+{
+	flac_subframe* subframe = &(workspace->subframes[slot]);
+
+	if (candidate->bits >= subframe->bits)
+	{
+		return;
+	}
+
+	*subframe = *candidate;
+	workspace->residual[slot][1] = workspace->residual[slot][0];
+	workspace->residual[slot][0] = candidate->residual;
+	candidate->residual = workspace->residual[slot][1];
+}
+
+static void plan_subframe(const flac_encoder_config* config, flac_frame_workspace* workspace, uint32_t slot, uint32_t num_frames, uint32_t bits_per_sample)
+{
+	const int32_t* samples = workspace->samples[slot];
+	flac_subframe* subframe = &(workspace->subframes[slot]);
+	flac_subframe candidate;
+	uint32_t or_bits = 0;
+	uint32_t wasted = 0;
+	uint32_t header_bits;
+	bool constant = true;
+
+	for (uint32_t i = 0; i < num_frames; i++)
+	{
+		or_bits |= (uint32_t)samples[i];
+		constant = constant && (samples[i] == samples[0]);
+	}
+
+	subframe->signal = samples;
+	subframe->wasted_bits = 0;
+	subframe->bits_per_sample = bits_per_sample;
+	subframe->order = 0;
+
+	if (constant)
+	{
+		subframe->type = FLAC_SUBFRAME_CONSTANT;
+		subframe->bits = 8 + bits_per_sample;
+		return;
+	}
+
+	// Low bits which are zero in every sample are stored once in the subframe header.
+	while (((or_bits >> wasted) & 1) == 0)
+	{
+		wasted++;
+	}
+
+	if (wasted > 0)
+	{
+		int32_t* shifted = workspace->shifted[slot];
+
+		for (uint32_t i = 0; i < num_frames; i++)
+		{
+			shifted[i] = samples[i] >> wasted;
+		}
+
+		subframe->signal = shifted;
+		subframe->wasted_bits = wasted;
+		subframe->bits_per_sample = bits_per_sample - wasted;
+	}
+
+	const int32_t* signal = subframe->signal;
+	uint32_t bits = subframe->bits_per_sample;
+	header_bits = 8 + wasted;
+
+	subframe->type = FLAC_SUBFRAME_VERBATIM;
+	subframe->bits = header_bits + (uint64_t)num_frames * bits;
+
+	candidate = *subframe;
+	candidate.residual = workspace->residual[slot][1];
+
+	uint64_t fixed_sum;
+	candidate.type = FLAC_SUBFRAME_FIXED;
+	candidate.order = best_fixed_order(signal, num_frames, &fixed_sum);
+	fixed_residual(signal, num_frames, candidate.order, candidate.residual);
+	candidate.bits = header_bits + (uint64_t)candidate.order * bits + plan_residual(config, workspace, candidate.residual, num_frames, &candidate);
+	accept_candidate(workspace, slot, &candidate);
+
+	uint32_t max_order = (config->max_lpc_order < num_frames - 1 ? config->max_lpc_order : num_frames - 1);
+
+	if (max_order == 0 || num_frames < 2 * FLAC_ENCODER_MAX_LPC_ORDER)
+	{
+		return;
+	}
+
+	double autoc[FLAC_ENCODER_MAX_LPC_ORDER + 1];
+	double lp_coeffs[FLAC_ENCODER_MAX_LPC_ORDER][FLAC_ENCODER_MAX_LPC_ORDER];
+	double error[FLAC_ENCODER_MAX_LPC_ORDER];
+	double* windowed = workspace->windowed;
+
+	update_window(workspace, num_frames);
+
+	for (uint32_t i = 0; i < num_frames; i++)
+	{
+		windowed[i] = signal[i] * workspace->window[i];
+	}
+
+	for (uint32_t lag = 0; lag <= max_order; lag++)
+	{
+		double sum = 0.0;
+
+		for (uint32_t i = lag; i < num_frames; i++)
+		{
+			sum += windowed[i] * windowed[i - lag];
+		}
+
+		autoc[lag] = sum;
+	}
+
+	if (autoc[0] == 0.0)
+	{
+		return;
+	}
+
+	max_order = compute_lp_coeffs(autoc, max_order, lp_coeffs, error);
+
+	uint32_t precision = qlp_precision(bits, num_frames);
+	uint32_t first_order = 1;
+
+	if (!config->search_lpc_order)
+	{
+		first_order = estimate_lpc_order(error, max_order, num_frames, precision + bits);
+		max_order = first_order;
+	}
+
+	for (uint32_t order = first_order; order <= max_order; order++)
+	{
+		uint32_t order_precision = precision;
+
+		// Keeps 16-bit predictions within 32 bits, for decoders with a faster path for those.
+		if (bits <= 17 && 32 - bits - floor_log2(order) < order_precision)
+		{
+			order_precision = 32 - bits - floor_log2(order);
+		}
+
+		candidate.type = FLAC_SUBFRAME_LPC;
+		candidate.order = order;
+		candidate.qlp_precision = order_precision;
+
+		if (!quantize_lp_coeffs(lp_coeffs[order - 1], order, order_precision, candidate.qlp_coeffs, &(candidate.qlp_shift)) || !lpc_residual(signal, num_frames, &candidate, candidate.residual))
+		{
+			continue;
+		}
+
+		candidate.bits = header_bits + (uint64_t)order * bits + 4 + 5 + (uint64_t)order * order_precision + plan_residual(config, workspace, candidate.residual, num_frames, &candidate);
+		accept_candidate(workspace, slot, &candidate);
+	}
+}
+
+static void write_subframe(flac_bit_writer* writer, const flac_subframe* subframe, uint32_t num_frames)
+{
+	uint32_t bits = subframe->bits_per_sample;
+	uint32_t type = subframe->type;
+
+	if (type == FLAC_SUBFRAME_FIXED)
+	{
+		type |= subframe->order;
+	}
+	else if (type == FLAC_SUBFRAME_LPC)
+	{
+		type |= subframe->order - 1;
+	}
+
+	// The wasted bits flag ends the header byte, followed by the count less one in unary.
+	put_bits(writer, (type << 1) | (subframe->wasted_bits > 0 ? 1 : 0), 8);
+	if (subframe->wasted_bits > 0)
+	{
+		put_zeros(writer, subframe->wasted_bits - 1);
+		put_bits(writer, 1, 1);
+	}
+
+	switch (subframe->type)
+	{
+		case FLAC_SUBFRAME_CONSTANT:
+			put_bits(writer, (uint32_t)subframe->signal[0], bits);
+			break;
+		case FLAC_SUBFRAME_VERBATIM:
+			for (uint32_t i = 0; i < num_frames; i++)
+			{
+				put_bits(writer, (uint32_t)subframe->signal[i], bits);
+			}
+			break;
+		case FLAC_SUBFRAME_FIXED:
+			for (uint32_t i = 0; i < subframe->order; i++)
+			{
+				put_bits(writer, (uint32_t)subframe->signal[i], bits);
+			}
+			write_residual(writer, subframe, num_frames);
+			break;
+		case FLAC_SUBFRAME_LPC:
+			for (uint32_t i = 0; i < subframe->order; i++)
+			{
+				put_bits(writer, (uint32_t)subframe->signal[i], bits);
+			}
+			put_bits(writer, subframe->qlp_precision - 1, 4);
+			put_bits(writer, (uint32_t)subframe->qlp_shift, 5);
+			for (uint32_t i = 0; i < subframe->order; i++)
+			{
+				put_bits(writer, (uint32_t)subframe->qlp_coeffs[i], subframe->qlp_precision);
+			}
+			write_residual(writer, subframe, num_frames);
+			break;
+		default:
+			break;
+	}
+}
+
+////////////
+// Frames //
+////////////
+
+static uint32_t block_size_code(uint32_t block_size)
+{
+	switch (block_size)
+	{
+		case 192: return 1;
+		case 576: return 2;
+		case 1152: return 3;
+		case 2304: return 4;
+		case 4608: return 5;
+		case 256: return 8;
+		case 512: return 9;
+		case 1024: return 10;
+		case 2048: return 11;
+		case 4096: return 12;
+		case 8192: return 13;
+		case 16384: return 14;
+		case 32768: return 15;
+		default: break;
+	}
+
+	// The block size follows the frame number, in 8 or 16 bits.
+	return (block_size <= 256 ? 6 : 7);
+}
+
+static uint32_t sample_rate_code(uint32_t sample_rate)
+{
+	switch (sample_rate)
+	{
+		case 88200: return 1;
+		case 176400: return 2;
+		case 192000: return 3;
+		case 8000: return 4;
+		case 16000: return 5;
+		case 22050: return 6;
+		case 24000: return 7;
+		case 32000: return 8;
+		case 44100: return 9;
+		case 48000: return 10;
+		case 96000: return 11;
+		default: break;
+	}
+
+	// Otherwise the rate follows the frame number in kHz, Hz or tens of Hz. 0 refers back to STREAMINFO.
+	if (sample_rate % 1000 == 0 && sample_rate / 1000 <= 255)
+	{
+		return 12;
+	}
+	else if (sample_rate <= 65535)
+	{
+		return 13;
+	}
+	else if (sample_rate % 10 == 0 && sample_rate / 10 <= 65535)
+	{
+		return 14;
+	}
+
+	return 0;
+}
+
+static uint32_t sample_size_code(uint32_t bits_per_sample)
+{
+	switch (bits_per_sample)
+	{
+		case 8: return 1;
+		case 12: return 2;
+		case 16: return 4;
+		case 20: return 5;
+		case 24: return 6;
+		case 32: return 7;
+		default: break;
+	}
+
+	return 0;
+}
+
+bool flac_encoder_config_init(flac_encoder_config* config, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, uint32_t level, uint32_t block_size)
+{
+	// Maximum LPC order, maximum partition order, stereo mode and LPC order search for each level.
+	static const uint32_t levels[FLAC_ENCODER_MAX_LEVEL + 1][4] = {
+		{ 0, 3, flac_stereo_independent, 0 },
+		{ 0, 3, flac_stereo_estimate, 0 },
+		{ 0, 3, flac_stereo_search, 0 },
+		{ 6, 4, flac_stereo_independent, 0 },
+		{ 8, 4, flac_stereo_estimate, 0 },
+		{ 8, 5, flac_stereo_estimate, 0 },
+		{ 8, 6, flac_stereo_search, 0 },
+		{ 12, 6, flac_stereo_search, 0 },
+		{ 12, 6, flac_stereo_search, 1 }
+	};
+
+	if (channels == 0 || channels > FLAC_ENCODER_MAX_CHANNELS || sample_rate == 0 || sample_rate >= (1 << 20) || (bits_per_sample != 8 && bits_per_sample != 16 && bits_per_sample != 24))
+	{
+		return false;
+	}
+
+	if (block_size == 0)
+	{
+		block_size = FLAC_ENCODER_DEFAULT_BLOCK_SIZE;
+	}
+
+	if (block_size < FLAC_ENCODER_MIN_BLOCK_SIZE || block_size > FLAC_ENCODER_MAX_BLOCK_SIZE)
+	{
+		return false;
+	}
+
+	if (level > FLAC_ENCODER_MAX_LEVEL)
+	{
+		level = FLAC_ENCODER_MAX_LEVEL;
+	}
+
+	config->channels = channels;
+	config->sample_rate = sample_rate;
+	config->bits_per_sample = bits_per_sample;
+	config->block_size = block_size;
+	config->max_lpc_order = levels[level][0];
+	config->max_partition_order = levels[level][1];
+	config->stereo_mode = (flac_stereo_mode)levels[level][2];
+	config->search_lpc_order = (uint8_t)levels[level][3];
+
+	return true;
+}
+
+flac_frame_workspace* flac_create_workspace(const flac_encoder_config* config)
+{
+	flac_frame_workspace* workspace = (flac_frame_workspace*)calloc(1, sizeof(flac_frame_workspace));
+	size_t block_bytes = config->block_size * sizeof(int32_t);
+	bool allocated = true;
+
+	if (workspace == NULL)
+	{
+		return NULL;
+	}
+
+	workspace->block_size = config->block_size;
+	workspace->slot_count = config->channels + (config->channels == 2 ? 2 : 0);
+
+	for (uint32_t slot = 0; slot < workspace->slot_count; slot++)
+	{
+		workspace->samples[slot] = (int32_t*)malloc(block_bytes);
+		workspace->shifted[slot] = (int32_t*)malloc(block_bytes);
+		workspace->residual[slot][0] = (int32_t*)malloc(block_bytes);
+		workspace->residual[slot][1] = (int32_t*)malloc(block_bytes);
+		allocated = allocated && workspace->samples[slot] != NULL && workspace->shifted[slot] != NULL && workspace->residual[slot][0] != NULL && workspace->residual[slot][1] != NULL;
+	}
+
+	workspace->folded = (uint32_t*)malloc(config->block_size * sizeof(uint32_t));
+	workspace->windowed = (double*)malloc(config->block_size * sizeof(double));
+	workspace->window = (double*)malloc(config->block_size * sizeof(double));
+
+	if (!allocated || workspace->folded == NULL || workspace->windowed == NULL || workspace->window == NULL)
+	{
+		flac_free_workspace(workspace);
+		return NULL;
+	}
+
+	return workspace;
+}
+
+void flac_free_workspace(flac_frame_workspace* workspace)
+{
+	if (workspace == NULL)
+	{
+		return;
+	}
+
+	for (uint32_t slot = 0; slot < workspace->slot_count; slot++)
+	{
+		free(workspace->samples[slot]);
+		free(workspace->shifted[slot]);
+		free(workspace->residual[slot][0]);
+		free(workspace->residual[slot][1]);
+	}
+
+	free(workspace->folded);
+	free(workspace->windowed);
+	free(workspace->window);
+	free(workspace);
+}
+
+size_t flac_max_frame_size(const flac_encoder_config* config)
+{
+	// Header, then verbatim subframes with the extra side channel bit and every wasted bit, the footer and padding.
+	size_t subframe_bits = 8 + 32 + (size_t)config->block_size * (config->bits_per_sample + 1);
+
+	return 16 + config->channels * ((subframe_bits + 7) / 8) + 3;
+}
+
+size_t flac_encode_frame(const flac_encoder_config* config, flac_frame_workspace* workspace, const int32_t* samples, uint32_t num_frames, uint32_t frame_number, uint8_t* output)
+{
+	uint32_t channels = config->channels;
+	uint32_t bits_per_sample = config->bits_per_sample;
+	uint32_t assignment = channels - 1;
+	uint32_t slots[FLAC_ENCODER_MAX_CHANNELS];
+	uint32_t block_code = block_size_code(num_frames);
+	uint32_t rate_code = sample_rate_code(config->sample_rate);
+	flac_bit_writer writer;
+
+	if (workspace == NULL || samples == NULL || output == NULL || num_frames == 0 || num_frames > workspace->block_size)
+	{
+		return 0;
+	}
+
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		int32_t* channel = workspace->samples[c];
+
+		for (uint32_t i = 0; i < num_frames; i++)
+		{
+			channel[i] = samples[i * channels + c];
+		}
+
+		slots[c] = c;
+	}
+
+	if (channels == 2 && config->stereo_mode != flac_stereo_independent)
+	{
+		const int32_t* left = workspace->samples[0];
+		const int32_t* right = workspace->samples[1];
+		int32_t* mid = workspace->samples[2];
+		int32_t* side = workspace->samples[3];
+		uint64_t costs[4];
+
+		for (uint32_t i = 0; i < num_frames; i++)
+		{
+			mid[i] = (left[i] + right[i]) >> 1;
+			side[i] = left[i] - right[i];
+		}
+
+		if (config->stereo_mode == flac_stereo_estimate)
+		{
+			for (uint32_t slot = 0; slot < 4; slot++)
+			{
+				best_fixed_order(workspace->samples[slot], num_frames, &costs[slot]);
+			}
+		}
+		else
+		{
+			for (uint32_t slot = 0; slot < 4; slot++)
+			{
+				plan_subframe(config, workspace, slot, num_frames, bits_per_sample + (slot == 3 ? 1 : 0));
+				costs[slot] = workspace->subframes[slot].bits;
+			}
+		}
+
+		// Independent, left / side, side / right, mid / side.
+		uint64_t pairs[4] = { costs[0] + costs[1], costs[0] + costs[3], costs[3] + costs[1], costs[2] + costs[3] };
+		static const uint32_t pair_slots[4][2] = { { 0, 1 }, { 0, 3 }, { 3, 1 }, { 2, 3 } };
+		uint32_t best = 0;
+
+		for (uint32_t p = 1; p < 4; p++)
+		{
+			if (pairs[p] < pairs[best])
+			{
+				best = p;
+			}
+		}
+
+		assignment = (best == 0 ? 1 : 7 + best);
+		slots[0] = pair_slots[best][0];
+		slots[1] = pair_slots[best][1];
+
+		if (config->stereo_mode == flac_stereo_estimate)
+		{
+			plan_subframe(config, workspace, slots[0], num_frames, bits_per_sample + (slots[0] == 3 ? 1 : 0));
+			plan_subframe(config, workspace, slots[1], num_frames, bits_per_sample + (slots[1] == 3 ? 1 : 0));
+		}
+	}
+	else
+	{
+		for (uint32_t c = 0; c < channels; c++)
+		{
+			plan_subframe(config, workspace, c, num_frames, bits_per_sample);
+		}
+	}
+
+	memset(&writer, 0, sizeof(writer));
+	writer.data = output;
+	writer.capacity = flac_max_frame_size(config);
+
+	put_bits(&writer, 0xFFF8, 16);
+	put_bits(&writer, block_code, 4);
+	put_bits(&writer, rate_code, 4);
+	put_bits(&writer, assignment, 4);
+	put_bits(&writer, sample_size_code(bits_per_sample), 3);
+	put_bits(&writer, 0, 1);
+	put_utf8(&writer, frame_number);
+
+	if (block_code == 6)
+	{
+		put_bits(&writer, num_frames - 1, 8);
+	}
+	else if (block_code == 7)
+	{
+		put_bits(&writer, num_frames - 1, 16);
+	}
+
+	if (rate_code == 12)
+	{
+		put_bits(&writer, config->sample_rate / 1000, 8);
+	}
+	else if (rate_code == 13)
+	{
+		put_bits(&writer, config->sample_rate, 16);
+	}
+	else if (rate_code == 14)
+	{
+		put_bits(&writer, config->sample_rate / 10, 16);
+	}
+
+	flush_bits(&writer);
+
+	uint8_t crc8 = 0;
+	for (size_t i = 0; i < writer.size; i++)
+	{
+		crc8 = crc_tables.crc8[crc8 ^ output[i]];
+	}
+	put_bits(&writer, crc8, 8);
+
+	for (uint32_t c = 0; c < channels; c++)
+	{
+		write_subframe(&writer, &(workspace->subframes[slots[c]]), num_frames);
+	}
+
+	align_bits(&writer);
+
+	uint16_t crc16 = 0;
+	for (size_t i = 0; i < writer.size; i++)
+	{
+		crc16 = (uint16_t)((crc16 << 8) ^ crc_tables.crc16[(crc16 >> 8) ^ output[i]]);
+	}
+	put_bits(&writer, crc16, 16);
+	flush_bits(&writer);
+
+	if (writer.overflow)
+	{
+		return 0;
+	}
+
+	return writer.size;
+}
+
+void flac_write_streaminfo(const flac_encoder_config* config, uint32_t min_frame_size, uint32_t max_frame_size, uint64_t total_frames, const uint8_t* md5, uint8_t* output)
+{
+	flac_bit_writer writer;
+
+	memset(&writer, 0, sizeof(writer));
+	writer.data = output;
+	writer.capacity = FLAC_STREAMINFO_SIZE;
+
+	put_bits(&writer, 0x664C6143, 32); // "fLaC"
+	put_bits(&writer, 1, 1); // Last metadata block
+	put_bits(&writer, 0, 7); // STREAMINFO
+	put_bits(&writer, 34, 24);
+	put_bits(&writer, config->block_size, 16);
+	put_bits(&writer, config->block_size, 16);
+	put_bits(&writer, min_frame_size, 24);
+	put_bits(&writer, max_frame_size, 24);
+	put_bits(&writer, config->sample_rate, 20);
+	put_bits(&writer, config->channels - 1, 3);
+	put_bits(&writer, config->bits_per_sample - 1, 5);
+	put_bits(&writer, (uint32_t)(total_frames >> 32), 4);
+	put_bits(&writer, (uint32_t)total_frames, 32);
+
+	for (int i = 0; i < 16; i++)
+	{
+		put_bits(&writer, (md5 != NULL ? md5[i] : 0), 8);
+	}
+
+	flush_bits(&writer);
+}
+
+/////////
+// MD5 //
+/////////
+
+static void md5_transform(uint32_t* state, const uint8_t* block)
+{
+	static const uint32_t k[64] = {
+		0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+		0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+		0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+		0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+		0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+		0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+		0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+		0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+	};
+	static const uint32_t r[64] = {
+		7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+		5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+		4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+		6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+	};
+	uint32_t w[16];
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+	for (int i = 0; i < 16; i++)
+	{
+		w[i] = (uint32_t)block[i * 4] | ((uint32_t)block[i * 4 + 1] << 8) | ((uint32_t)block[i * 4 + 2] << 16) | ((uint32_t)block[i * 4 + 3] << 24);
+	}
+
+	for (int i = 0; i < 64; i++)
+	{
+		uint32_t f, g;
+
+		if (i < 16)
+		{
+			f = (b & c) | (~b & d);
+			g = i;
+		}
+		else if (i < 32)
+		{
+			f = (d & b) | (~d & c);
+			g = (5 * i + 1) & 15;
+		}
+		else if (i < 48)
+		{
+			f = b ^ c ^ d;
+			g = (3 * i + 5) & 15;
+		}
+		else
+		{
+			f = c ^ (b | ~d);
+			g = (7 * i) & 15;
+		}
+
+		uint32_t t = a + f + k[i] + w[g];
+		a = d;
+		d = c;
+		c = b;
+		b = b + ((t << r[i]) | (t >> (32 - r[i])));
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+}
+
+void flac_md5_init(flac_md5* md5)
+{
+	md5->state[0] = 0x67452301;
+	md5->state[1] = 0xefcdab89;
+	md5->state[2] = 0x98badcfe;
+	md5->state[3] = 0x10325476;
+	md5->length = 0;
+}
+
+void flac_md5_update(flac_md5* md5, const uint8_t* data, size_t size)
+{
+	size_t buffered = (size_t)(md5->length & 63);
+
+	md5->length += size;
+
+	if (buffered > 0)
+	{
+		size_t fill = 64 - buffered;
+
+		if (size < fill)
+		{
+			memcpy(md5->buffer + buffered, data, size);
+			return;
+		}
+
+		memcpy(md5->buffer + buffered, data, fill);
+		md5_transform(md5->state, md5->buffer);
+		data += fill;
+		size -= fill;
+	}
+
+	while (size >= 64)
+	{
+		md5_transform(md5->state, data);
+		data += 64;
+		size -= 64;
+	}
+
+	memcpy(md5->buffer, data, size);
+}
+
+void flac_md5_final(flac_md5* md5, uint8_t* digest)
+{
+	uint64_t bit_length = md5->length * 8;
+	size_t buffered = (size_t)(md5->length & 63);
+	uint8_t padding[72];
+	size_t padding_size = (buffered < 56 ? 56 - buffered : 120 - buffered);
+
+	memset(padding, 0, sizeof(padding));
+	padding[0] = 0x80;
+
+	for (int i = 0; i < 8; i++)
+	{
+		padding[padding_size + i] = (uint8_t)(bit_length >> (8 * i));
+	}
+
+	flac_md5_update(md5, padding, padding_size + 8);
+
+	for (int i = 0; i < 4; i++)
+	{
+		for (int b = 0; b < 4; b++)
+		{
+			digest[i * 4 + b] = (uint8_t)(md5->state[i] >> (8 * b));
+		}
+	}
+}
@@ -0,0 +1,75 @@
+#ifndef _FLAC_ENCODER_H_
+#define _FLAC_ENCODER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// FLAC streams hold at most 8 channels.
+#define FLAC_ENCODER_MAX_CHANNELS		8
+#define FLAC_ENCODER_MIN_BLOCK_SIZE		16
+#define FLAC_ENCODER_MAX_BLOCK_SIZE		65535
+#define FLAC_ENCODER_DEFAULT_BLOCK_SIZE	4096
+#define FLAC_ENCODER_MAX_LPC_ORDER		12
+#define FLAC_ENCODER_MAX_PARTITION_ORDER	8
+// Level 0 is the fastest, using fixed predictors only. It's intended for real-time logging.
+#define FLAC_ENCODER_DEFAULT_LEVEL		5
+#define FLAC_ENCODER_MAX_LEVEL			8
+// Size of the "fLaC" marker, metadata block header and STREAMINFO block at the start of the file.
+#define FLAC_STREAMINFO_SIZE			42
+
+// How stereo streams choose between independent, left / side, side / right and mid / side channels.
+typedef enum
+{
+	flac_stereo_independent = 0,	// Always encode left and right
+	flac_stereo_estimate,			// Pick the pair with the smallest fixed predictor residual
+	flac_stereo_search				// Encode all four channels and keep the smallest pair
+} flac_stereo_mode;
+
+// Stream format and the compression settings selected by the level.
+typedef struct
+{
+	uint32_t channels;
+	uint32_t sample_rate;
+	uint32_t bits_per_sample;
+	uint32_t block_size;
+	uint32_t max_lpc_order;			// 0 uses fixed predictors only
+	uint32_t max_partition_order;
+	flac_stereo_mode stereo_mode;
+	uint8_t search_lpc_order;		// Encode every LPC order rather than estimating the best from the prediction error
+} flac_encoder_config;
+
+// Working memory for encoding frames. Each thread encoding frames needs its own workspace.
+typedef struct flac_frame_workspace flac_frame_workspace;
+
+typedef struct
+{
+	uint32_t state[4];
+	uint64_t length;
+	uint8_t buffer[64];
+} flac_md5;
+
+//////////////////
+// Frame coding //
+//////////////////
+// Fill in a config for the given format and compression level. Pass 0 as block_size to use the default.
+// Returns false if the format can't be stored in a FLAC stream. Only 8, 16 and 24 bits per sample are supported.
+bool flac_encoder_config_init(flac_encoder_config* config, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, uint32_t level, uint32_t block_size);
+flac_frame_workspace* flac_create_workspace(const flac_encoder_config* config);
+void flac_free_workspace(flac_frame_workspace* workspace);
+// Largest frame flac_encode_frame() can produce for this config.
+size_t flac_max_frame_size(const flac_encoder_config* config);
+// Encode num_frames (at most block_size) interleaved samples as a single FLAC frame. Frames encode independently, so any number
+// may be encoded concurrently with separate workspaces. output must hold flac_max_frame_size() bytes. Returns the frame size, or 0 on error.
+size_t flac_encode_frame(const flac_encoder_config* config, flac_frame_workspace* workspace, const int32_t* samples, uint32_t num_frames, uint32_t frame_number, uint8_t* output);
+// Write the "fLaC" marker and STREAMINFO block. Frame sizes of 0 and a zeroed MD5 mean unknown.
+void flac_write_streaminfo(const flac_encoder_config* config, uint32_t min_frame_size, uint32_t max_frame_size, uint64_t total_frames, const uint8_t* md5, uint8_t* output);
+
+/////////
+// MD5 //
+/////////
+// STREAMINFO holds the MD5 of the samples as interleaved, signed, little endian integers of (bits_per_sample + 7) / 8 bytes.
+void flac_md5_init(flac_md5* md5);
+void flac_md5_update(flac_md5* md5, const uint8_t* data, size_t size);
+void flac_md5_final(flac_md5* md5, uint8_t* digest);
+
+#endif
@@ -11,6 +11,19 @@ See g_audio.h for license details.
 // Global variables //
 //////////////////////
 ma_context* global_context = NULL;
+// Decoded files shared between loads and refnums. Protected by ga_mutex_sample_cache.
+sample_cache global_sample_cache;
+// MP3 seek indexes of recently opened files. Protected by ga_mutex_mp3_index.
+mp3_index_entry mp3_index_cache[MP3_INDEX_CACHE_ENTRIES] = {};
+uint64_t mp3_index_cache_clock = 0;
+uint8_t mp3_index_cache_enabled = 1;
+uint8_t mp3_index_sidecar_enabled = 0;
+// Vorbis page indexes of recently seeked files. Protected by ga_mutex_vorbis_index.
+vorbis_index_entry vorbis_index_cache[VORBIS_INDEX_CACHE_ENTRIES] = {};
+uint64_t vorbis_index_cache_clock = 0;
+uint8_t vorbis_index_cache_enabled = 1;
+// Worker threads available to parallel decodes started on this thread. Zero allows one per core.
+thread_local uint32_t thread_worker_budget = 0;
 
 ////////////////////////////
 // LabVIEW CLFN Callbacks //
@@ -29,144 +42,268 @@ extern "C" LV_DLL_EXPORT int32_t clfn_abort(void* data)
 extern "C" LV_DLL_EXPORT ga_result get_audio_file_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, ga_codec* codec)
 {
 	ga_result result;
+	uint8_t is_exact = 0;
 
-	result = get_audio_file_codec(file_name, codec);
+	result = get_audio_file_info_ex(file_name, 0, num_frames, channels, sample_rate, bits_per_sample, codec, &is_exact);
+
+	// Estimated lengths aren't good enough here, so scan the file.
+	if (result == GA_SUCCESS && !is_exact)
+	{
+		result = get_audio_file_info_ex(file_name, 1, num_frames, channels, sample_rate, bits_per_sample, codec, &is_exact);
+	}
+
+	return result;
+}
+
+extern "C" LV_DLL_EXPORT ga_result get_audio_file_info_ex(const char* file_name, uint8_t exact, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, ga_codec* codec, uint8_t* is_exact)
+{
+	ga_result result;
+	ga_io io;
+
+	*is_exact = 1;
+
+	result = ga_io_open(file_name, &io);
 
 	if (result != GA_SUCCESS)
 	{
 		return result;
 	}
 
-	switch (*codec)
+	result = get_io_codec(&io, codec);
+
+	if (result == GA_SUCCESS)
 	{
-		case ga_codec_flac: return get_flac_info(file_name, num_frames, channels, sample_rate, bits_per_sample); break;
-		case ga_codec_mp3: return get_mp3_info(file_name, num_frames, channels, sample_rate, bits_per_sample); break;
-		case ga_codec_vorbis: return get_vorbis_info(file_name, num_frames, channels, sample_rate, bits_per_sample); break;
-		case ga_codec_wav: return get_wav_info(file_name, num_frames, channels, sample_rate, bits_per_sample); break;
-		case ga_codec_unsupported: return GA_E_UNSUPPORTED_CODEC;
-		default: break;
+		result = get_codec_file_info(&io, *codec, exact, num_frames, channels, sample_rate, bits_per_sample, is_exact);
 	}
 
-	return GA_E_GENERIC;
+	ga_io_close(&io);
+
+	return result;
 }
 
 extern "C" LV_DLL_EXPORT int16_t* load_audio_file_s16(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
 {
-	int16_t* sample_data = NULL;
+	return (int16_t*)load_cached_samples(file_name, SAMPLE_CACHE_FORMAT_S16_LOAD, num_frames, channels, sample_rate, codec, result);
+}
 
-	*result = get_audio_file_codec(file_name, codec);
+extern "C" LV_DLL_EXPORT void* load_audio_file(const char* file_name, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
+{
+	return load_cached_samples(file_name, audio_type, num_frames, channels, sample_rate, codec, result);
+}
+
+extern "C" LV_DLL_EXPORT void* load_audio_memory(const uint8_t* data, uint64_t size, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
+{
+	ga_io io;
+	void* sample_data;
+
+	*num_frames = 0;
+
+	// The whole buffer is decoded before returning, so it's always borrowed.
+	*result = ga_io_open_memory(data, size, 0, &io);
 
 	if (*result != GA_SUCCESS)
 	{
 		return NULL;
 	}
 
-	switch (*codec)
+	sample_data = decode_audio_io(&io, audio_type, num_frames, channels, sample_rate, codec, result);
+	ga_io_close(&io);
+
+	return sample_data;
+}
+
+extern "C" LV_DLL_EXPORT ga_result load_audio_files(const char** file_names, int32_t num_files, ga_data_type audio_type, intptr_t* buffers, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rates, ga_codec* codecs, ga_result* results)
+{
+	if (num_files < 0 || (num_files > 0 && (file_names == NULL || buffers == NULL || num_frames == NULL || channels == NULL || sample_rates == NULL || codecs == NULL || results == NULL)))
 	{
-		case ga_codec_flac: sample_data = load_flac(file_name, num_frames, channels, sample_rate, result); break;
-		case ga_codec_mp3: sample_data = load_mp3(file_name, num_frames, channels, sample_rate, result); break;
-		case ga_codec_vorbis: sample_data = load_vorbis(file_name, num_frames, channels, sample_rate, result); break;
-		case ga_codec_wav: sample_data = load_wav(file_name, num_frames, channels, sample_rate, result); break;
-		case ga_codec_unsupported: *result = GA_E_UNSUPPORTED_CODEC; break;
-		default: *result = GA_E_GENERIC; break;
+		return GA_E_GENERIC;
 	}
 
-	if (*result != GA_SUCCESS)
+	if (num_files == 0)
 	{
-		free_sample_data(sample_data);
-		sample_data = NULL;
+		return GA_SUCCESS;
 	}
 
-	return sample_data;
+	batch_load_job job;
+	job.file_names = file_names;
+	job.num_files = num_files;
+	job.audio_type = audio_type;
+	job.buffers = buffers;
+	job.num_frames = num_frames;
+	job.channels = channels;
+	job.sample_rates = sample_rates;
+	job.codecs = codecs;
+	job.results = results;
+	job.next_file = 0;
+
+	uint32_t worker_count = get_worker_count();
+	if (worker_count > (uint32_t)num_files)
+	{
+		worker_count = (uint32_t)num_files;
+	}
+
+	// With fewer files than cores, the spare cores are shared out to each file's parallel decode.
+	job.worker_budget = get_worker_count() / worker_count;
+
+	// The calling thread acts as one of the workers.
+	ma_thread* threads = NULL;
+	uint32_t thread_count = 0;
+
+	if (worker_count > 1)
+	{
+		threads = (ma_thread*)malloc((worker_count - 1) * sizeof(ma_thread));
+	}
+
+	if (threads != NULL)
+	{
+		for (uint32_t i = 0; i < worker_count - 1; i++)
+		{
+			if (ma_thread_create(&threads[thread_count], ma_thread_priority_default, 0, batch_load_worker, &job, NULL) == MA_SUCCESS)
+			{
+				thread_count++;
+			}
+		}
+	}
+
+	batch_load_worker(&job);
+
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		ma_thread_wait(&threads[i]);
+#if defined(_WIN32)
+		CloseHandle((HANDLE)threads[i]);
+#endif
+	}
+
+	free(threads);
+
+	for (int32_t i = 0; i < num_files; i++)
+	{
+		if (results[i] != GA_SUCCESS)
+		{
+			return results[i];
+		}
+	}
+
+	return GA_SUCCESS;
+}
+
+ma_thread_result MA_THREADCALL batch_load_worker(void* user_data)
+{
+	batch_load_job* job = (batch_load_job*)user_data;
+	uint32_t previous_budget = thread_worker_budget;
+	uint32_t index;
+
+	thread_worker_budget = job->worker_budget;
+
+	while ((index = c89atomic_fetch_add_32(&job->next_file, 1)) < (uint32_t)job->num_files)
+	{
+		if (job->file_names[index] == NULL)
+		{
+			job->buffers[index] = 0;
+			job->results[index] = GA_E_FILE;
+			continue;
+		}
+
+		job->buffers[index] = (intptr_t)load_audio_file(job->file_names[index], job->audio_type, &(job->num_frames[index]), &(job->channels[index]), &(job->sample_rates[index]), &(job->codecs[index]), &(job->results[index]));
+	}
+
+	thread_worker_budget = previous_budget;
+
+	return (ma_thread_result)0;
 }
 
 extern "C" LV_DLL_EXPORT void free_sample_data(int16_t* buffer)
 {
+	if (buffer == NULL)
+	{
+		return;
+	}
+
+	lock_ga_mutex(ga_mutex_sample_cache);
+	//// START CRITICAL SECTION ////
+	for (size_t i = 0; i < global_sample_cache.entries.size(); i++)
+	{
+		if (global_sample_cache.entries[i]->data == (void*)buffer)
+		{
+			release_sample_cache_entry(global_sample_cache.entries[i]);
+			unlock_ga_mutex(ga_mutex_sample_cache);
+			return;
+		}
+	}
+	//// END CRITICAL SECTION ////
+	unlock_ga_mutex(ga_mutex_sample_cache);
+
 	free(buffer);
 }
 
 extern "C" LV_DLL_EXPORT ga_result open_audio_file(const char* file_name, int32_t* refnum)
 {
 	ga_result result;
-	ga_codec codec;
-	audio_file_codec* audio_file = (audio_file_codec*)malloc(sizeof(audio_file_codec));
-	if (audio_file == NULL)
+	ga_io io;
+
+	result = ga_io_open(file_name, &io);
+
+	if (result != GA_SUCCESS)
 	{
-		return GA_E_MEMORY;
+		return result;
 	}
 
-	audio_file->file_mode = ga_file_mode_read;
+	return open_audio_io(io, refnum);
+}
 
-	result = get_audio_file_codec(file_name, &codec);
+extern "C" LV_DLL_EXPORT ga_result open_audio_memory(const uint8_t* data, uint64_t size, uint8_t copy_data, int32_t* refnum)
+{
+	ga_result result;
+	ga_io io;
+
+	result = ga_io_open_memory(data, size, copy_data, &io);
 
 	if (result != GA_SUCCESS)
 	{
 		return result;
 	}
 
-	audio_file->codec = codec;
-	audio_file->decoder = NULL;
-	audio_file->encoder = NULL;
-	audio_file->read_offset = 0;
+	return open_audio_io(io, refnum);
+}
 
-	switch (audio_file->codec)
-	{
-		case ga_codec_flac:
-			audio_file->open = open_flac_file;
-			audio_file->get_basic_info = get_basic_flac_file_info;
-			audio_file->seek = seek_flac_file;
-			audio_file->read = read_flac_file;
-			audio_file->close = close_flac_file;
-			// These should never be called in read mode
-			audio_file->open_write = NULL;
-			audio_file->write = NULL;
-			break;
-		case ga_codec_mp3:
-			audio_file->open = open_mp3_file;
-			audio_file->get_basic_info = get_basic_mp3_file_info;
-			audio_file->seek = seek_mp3_file;
-			audio_file->read = read_mp3_file;
-			audio_file->close = close_mp3_file;
-			// These should never be called in read mode
-			audio_file->open_write = NULL;
-			audio_file->write = NULL;
-			break;
-		case ga_codec_vorbis:
-			audio_file->open = open_vorbis_file;
-			audio_file->get_basic_info = get_basic_vorbis_file_info;
-			audio_file->seek = seek_vorbis_file;
-			audio_file->read = read_vorbis_file;
-			audio_file->close = close_vorbis_file;
-			// These should never be called in read mode
-			audio_file->open_write = NULL;
-			audio_file->write = NULL;
-			break;
-		case ga_codec_wav:
-			audio_file->open = open_wav_file;
-			audio_file->get_basic_info = get_basic_wav_file_info;
-			audio_file->seek = seek_wav_file;
-			audio_file->read = read_wav_file;
-			audio_file->close = close_wav_file;
-			// These should never be called in read mode
-			audio_file->open_write = NULL;
-			audio_file->write = NULL;
-			break;
-		default:
-			free(audio_file);
-			audio_file = NULL;
-			return GA_E_UNSUPPORTED_CODEC;
-			break;
+ga_result open_audio_io(ga_io io, int32_t* refnum)
+{
+	ga_result result;
+	ga_codec codec;
+
+	result = get_io_codec(&io, &codec);
+
+	if (result != GA_SUCCESS)
+	{
+		ga_io_close(&io);
+		return result;
+	}
+
+	audio_file_codec* audio_file = (audio_file_codec*)malloc(sizeof(audio_file_codec));
+	if (audio_file == NULL)
+	{
+		ga_io_close(&io);
+		return GA_E_MEMORY;
 	}
 
-	if (audio_file->open == NULL)
+	result = init_audio_file_codec(audio_file, codec, ga_file_mode_read);
+
+	if (result != GA_SUCCESS)
 	{
+		ga_io_close(&io);
 		free(audio_file);
 		audio_file = NULL;
-		return GA_E_GENERIC;
+		return result;
 	}
+
+	// The decoder keeps a pointer to the io, so it must live in the refnum data.
+	audio_file->io = io;
+
 	void* decoder;
-	if (audio_file->open(file_name, &decoder) != GA_SUCCESS)
+	if (audio_file->open(&(audio_file->io), &decoder) != GA_SUCCESS)
 	{
+		ga_io_close(&(audio_file->io));
 		free(audio_file);
 		audio_file = NULL;
 		return GA_E_DECODER;
@@ -174,11 +311,21 @@ extern "C" LV_DLL_EXPORT ga_result open_audio_file(const char* file_name, int32_
 	else
 	{
 		audio_file->decoder = decoder;
+		// Only files can be found in the sample cache.
+		audio_file->cached = (audio_file->io.file_name != NULL ? acquire_sample_cache_stream(audio_file->io.file_name) : NULL);
 		thread_mutex_init(&(audio_file->mutex));
 		*refnum = create_insert_refnum_data(ga_refnum_audio_file, (void*)audio_file);
 
 		if (*refnum < 0)
 		{
+			if (audio_file->cached != NULL)
+			{
+				lock_ga_mutex(ga_mutex_sample_cache);
+				release_sample_cache_entry(audio_file->cached);
+				unlock_ga_mutex(ga_mutex_sample_cache);
+			}
+			audio_file->close(audio_file->decoder);
+			ga_io_close(&(audio_file->io));
 			thread_mutex_term(&(audio_file->mutex));
 			free(audio_file);
 			audio_file = NULL;
@@ -189,45 +336,66 @@ extern "C" LV_DLL_EXPORT ga_result open_audio_file(const char* file_name, int32_
 	return GA_SUCCESS;
 }
 
+extern "C" LV_DLL_EXPORT ga_result open_audio_file_read_ahead(const char* file_name, ga_data_type audio_type, uint32_t block_frames, uint32_t num_blocks, int32_t* refnum)
+{
+	ga_result result;
+
+	if (get_data_type_size(audio_type) == 0)
+	{
+		return GA_E_INVALID_TYPE;
+	}
+
+	result = open_audio_file(file_name, refnum);
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	audio_file_codec* audio_file = (audio_file_codec*)get_reference_data(ga_refnum_audio_file, *refnum);
+
+	if (audio_file == NULL)
+	{
+		return GA_E_REFNUM;
+	}
+
+	// Reads from the sample cache are already a copy, so there's nothing to decode ahead.
+	if (audio_file->cached != NULL)
+	{
+		return GA_SUCCESS;
+	}
+
+	thread_mutex_lock(&(audio_file->mutex));
+	result = init_read_ahead(audio_file, audio_type, block_frames, num_blocks);
+	thread_mutex_unlock(&(audio_file->mutex));
+
+	if (result != GA_SUCCESS)
+	{
+		close_audio_file(*refnum);
+		*refnum = -1;
+	}
+
+	return result;
+}
+
 extern "C" LV_DLL_EXPORT ga_result open_audio_file_write(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, ga_codec codec, int32_t has_specific_info, void* codec_specific, int32_t* refnum)
 {
+	ga_result result;
 	audio_file_codec* audio_file = (audio_file_codec*)malloc(sizeof(audio_file_codec));
 	if (audio_file == NULL)
 	{
 		return GA_E_MEMORY;
 	}
 
-	audio_file->file_mode = ga_file_mode_write;
-	audio_file->codec = codec;
-	audio_file->decoder = NULL;
-	audio_file->encoder = NULL;
-	audio_file->read_offset = 0;
-
-	switch (audio_file->codec)
-	{
-		case ga_codec_wav:
-			audio_file->open_write = open_wav_file_write;
-			audio_file->write = write_wav_file;
-			audio_file->close = close_wav_file;
-			// These should never be called in write mode
-			audio_file->open = NULL;
-			audio_file->get_basic_info = NULL;
-			audio_file->seek = NULL;
-			audio_file->read = NULL;
-			break;
-		default:
-			free(audio_file);
-			audio_file = NULL;
-			return GA_E_UNSUPPORTED_CODEC;
-			break;
-	}
+	result = init_audio_file_codec(audio_file, codec, ga_file_mode_write);
 
-	if (audio_file->open_write == NULL)
+	if (result != GA_SUCCESS)
 	{
 		free(audio_file);
 		audio_file = NULL;
-		return GA_E_GENERIC;
+		return result;
 	}
+
 	void* encoder;
 	if (audio_file->open_write(file_name, channels, sample_rate, bits_per_sample, (has_specific_info != 0 ? codec_specific : NULL), &encoder) != GA_SUCCESS)
 	{
@@ -238,11 +406,16 @@ extern "C" LV_DLL_EXPORT ga_result open_audio_file_write(const char* file_name,
 	else
 	{
 		audio_file->encoder = encoder;
+		audio_file->write_channels = channels;
+		audio_file->write_bits_per_sample = bits_per_sample;
+		// Only WAV files can hold float samples.
+		audio_file->write_float = (codec == ga_codec_wav && has_specific_info != 0 && codec_specific != NULL && ((wav_specific*)codec_specific)->data_format == DR_WAVE_FORMAT_IEEE_FLOAT);
 		thread_mutex_init(&(audio_file->mutex));
 		*refnum = create_insert_refnum_data(ga_refnum_audio_file, (void*)audio_file);
 
 		if (*refnum < 0)
 		{
+			audio_file->close(audio_file->encoder);
 			thread_mutex_term(&(audio_file->mutex));
 			free(audio_file);
 			audio_file = NULL;
@@ -253,6 +426,37 @@ extern "C" LV_DLL_EXPORT ga_result open_audio_file_write(const char* file_name,
 	return GA_SUCCESS;
 }
 
+extern "C" LV_DLL_EXPORT ga_result open_audio_file_write_behind(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, ga_codec codec, int32_t has_specific_info, void* codec_specific, uint32_t block_frames, uint32_t num_blocks, int32_t* refnum)
+{
+	ga_result result;
+
+	result = open_audio_file_write(file_name, channels, sample_rate, bits_per_sample, codec, has_specific_info, codec_specific, refnum);
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	audio_file_codec* audio_file = (audio_file_codec*)get_reference_data(ga_refnum_audio_file, *refnum);
+
+	if (audio_file == NULL)
+	{
+		return GA_E_REFNUM;
+	}
+
+	thread_mutex_lock(&(audio_file->mutex));
+	result = init_write_behind(audio_file, channels, bits_per_sample, block_frames, num_blocks);
+	thread_mutex_unlock(&(audio_file->mutex));
+
+	if (result != GA_SUCCESS)
+	{
+		close_audio_file(*refnum);
+		*refnum = -1;
+	}
+
+	return result;
+}
+
 extern "C" LV_DLL_EXPORT ga_result get_basic_audio_file_info(int32_t refnum, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
 {
 	ga_result result = GA_SUCCESS;
@@ -273,7 +477,21 @@ extern "C" LV_DLL_EXPORT ga_result get_basic_audio_file_info(int32_t refnum, uin
 		return GA_E_GENERIC;
 	}
 	thread_mutex_lock(&(audio_file->mutex));
-	result = audio_file->get_basic_info(audio_file->decoder, channels, sample_rate, read_offset);
+	if (audio_file->read_ahead != NULL)
+	{
+		// The decoder belongs to the worker while it's running.
+		*channels = audio_file->read_ahead->channels;
+		*sample_rate = audio_file->read_ahead->sample_rate;
+		*read_offset = audio_file->read_ahead->read_offset;
+	}
+	else
+	{
+		result = audio_file->get_basic_info(audio_file->decoder, channels, sample_rate, read_offset);
+		if (audio_file->cached != NULL)
+		{
+			*read_offset = audio_file->cached_offset;
+		}
+	}
 	thread_mutex_unlock(&(audio_file->mutex));
 
 	return result;
@@ -299,7 +517,43 @@ extern "C" LV_DLL_EXPORT ga_result seek_audio_file(int32_t refnum, uint64_t offs
 		return GA_E_GENERIC;
 	}
 	thread_mutex_lock(&(audio_file->mutex));
-	result = audio_file->seek(audio_file->decoder, offset, new_offset);
+	if (audio_file->cached != NULL)
+	{
+		// The decoder is only repositioned if it's needed for a read.
+		audio_file->cached_offset = (offset < audio_file->cached->num_frames ? offset : audio_file->cached->num_frames);
+		audio_file->decoder_synced = 0;
+		*new_offset = audio_file->cached_offset;
+	}
+	else if (audio_file->read_ahead != NULL)
+	{
+		// Discard the blocks decoded from the old position, and start refilling from the new one.
+		stop_read_ahead(audio_file);
+		result = audio_file->seek(audio_file->decoder, offset, new_offset);
+
+		if (result == GA_SUCCESS)
+		{
+			// Not every decoder reports where it landed, but they all stop at the end of the stream.
+			if (audio_file->read_ahead->num_frames > 0 && offset > audio_file->read_ahead->num_frames)
+			{
+				offset = audio_file->read_ahead->num_frames;
+			}
+
+			audio_file->read_ahead->read_offset = offset;
+			audio_file->read_ahead->decode_offset = offset;
+		}
+		else
+		{
+			// Reads carry on from the old position. The failed seek may have moved the decoder, so it's repositioned before decoding resumes.
+			audio_file->read_ahead->decode_offset = UINT64_MAX;
+		}
+
+		*new_offset = audio_file->read_ahead->read_offset;
+		start_read_ahead(audio_file);
+	}
+	else
+	{
+		result = audio_file->seek(audio_file->decoder, offset, new_offset);
+	}
 	thread_mutex_unlock(&(audio_file->mutex));
 
 	return result;
@@ -325,7 +579,18 @@ extern "C" LV_DLL_EXPORT ga_result read_audio_file(int32_t refnum, uint64_t fram
 		return GA_E_GENERIC;
 	}
 	thread_mutex_lock(&(audio_file->mutex));
-	result = audio_file->read(audio_file->decoder, frames_to_read, audio_type, frames_read, output_buffer);
+	if (audio_file->cached != NULL)
+	{
+		result = read_cached_samples(audio_file, frames_to_read, audio_type, frames_read, output_buffer);
+	}
+	else if (audio_file->read_ahead != NULL)
+	{
+		result = read_ahead_samples(audio_file, frames_to_read, audio_type, frames_read, output_buffer);
+	}
+	else
+	{
+		result = audio_file->read(audio_file->decoder, frames_to_read, audio_type, frames_read, output_buffer, &(audio_file->scratch));
+	}
 	thread_mutex_unlock(&(audio_file->mutex));
 
 	return result;
@@ -351,1311 +616,7656 @@ extern "C" LV_DLL_EXPORT ga_result write_audio_file(int32_t refnum, uint64_t fra
 		return GA_E_GENERIC;
 	}
 	thread_mutex_lock(&(audio_file->mutex));
-	result = audio_file->write(audio_file->encoder, frames_to_write, input_buffer, frames_written);
+	result = write_encoder_frames(audio_file, frames_to_write, input_buffer, frames_written);
 	thread_mutex_unlock(&(audio_file->mutex));
 
 	return result;
 }
 
-extern "C" LV_DLL_EXPORT ga_result close_audio_file(int32_t refnum)
+extern "C" LV_DLL_EXPORT ga_result write_audio_file_ex(int32_t refnum, uint64_t frames_to_write, ga_data_type audio_type, void* input_buffer, uint64_t* frames_written)
 {
-	audio_file_codec* audio_file = (audio_file_codec*)remove_reference(ga_refnum_audio_file, refnum);
+	ga_result result = GA_SUCCESS;
+
+	audio_file_codec* audio_file = (audio_file_codec*)get_reference_data(ga_refnum_audio_file, refnum);
 
 	if (audio_file == NULL)
 	{
 		return GA_E_REFNUM;
 	}
-
-	if (audio_file->close == NULL)
+	else if (audio_file->file_mode != ga_file_mode_write)
+	{
+		return GA_E_WRITE_MODE;
+	}
+
+	if (audio_file->write == NULL)
 	{
 		return GA_E_GENERIC;
 	}
+
+	size_t sample_size = get_data_type_size(audio_type);
+	uint32_t bits_per_sample = audio_file->write_bits_per_sample;
+	uint32_t channels = audio_file->write_channels;
+
+	if (sample_size == 0)
+	{
+		return GA_E_INVALID_TYPE;
+	}
+
+	if (input_buffer == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	// Input already in the file's format doesn't need staging.
+	uint8_t is_float_type = (audio_type == ga_data_type_float || audio_type == ga_data_type_double);
+	uint8_t is_native = (sample_size * 8 == bits_per_sample && is_float_type == audio_file->write_float);
+
 	thread_mutex_lock(&(audio_file->mutex));
-	if (audio_file->file_mode == ga_file_mode_read)
+	if (is_native)
 	{
-		audio_file->close(audio_file->decoder);
+		result = write_encoder_frames(audio_file, frames_to_write, input_buffer, frames_written);
 	}
-	else if (audio_file->file_mode == ga_file_mode_write)
+	else
 	{
-		audio_file->close(audio_file->encoder);
+		const uint8_t* input = (const uint8_t*)input_buffer;
+		// 24-bit samples are converted to 32-bit first, then packed in place.
+		size_t staged_sample_size = (bits_per_sample == 24 ? sizeof(int32_t) : bits_per_sample / 8);
+		void* staging = reserve_scratch_buffer(&(audio_file->scratch), (size_t)WRITE_CONVERT_BLOCK_FRAMES * channels * staged_sample_size);
+
+		*frames_written = 0;
+
+		if (staging == NULL)
+		{
+			result = GA_E_MEMORY;
+		}
+
+		while (result == GA_SUCCESS && *frames_written < frames_to_write)
+		{
+			uint64_t frames = frames_to_write - *frames_written;
+			uint64_t block_written = 0;
+
+			frames = (frames < WRITE_CONVERT_BLOCK_FRAMES ? frames : WRITE_CONVERT_BLOCK_FRAMES);
+			result = convert_write_samples(staging, input + (*frames_written * channels * sample_size), audio_type, bits_per_sample, audio_file->write_float, (size_t)(frames * channels));
+
+			if (result == GA_SUCCESS)
+			{
+				result = write_encoder_frames(audio_file, frames, staging, &block_written);
+				*frames_written += block_written;
+			}
+
+			if (block_written < frames)
+			{
+				break;
+			}
+		}
 	}
 	thread_mutex_unlock(&(audio_file->mutex));
-	thread_mutex_term(&(audio_file->mutex));
 
-	free(audio_file);
-	audio_file = NULL;
-
-	return GA_SUCCESS;
+	return result;
 }
 
-extern "C" LV_DLL_EXPORT ga_result get_audio_file_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+extern "C" LV_DLL_EXPORT ga_result flush_audio_file(int32_t refnum)
 {
-	ga_result result;
-	ga_codec codec;
+	ga_result result = GA_SUCCESS;
 
-	result = get_audio_file_codec(file_name, &codec);
+	audio_file_codec* audio_file = (audio_file_codec*)get_reference_data(ga_refnum_audio_file, refnum);
 
-	if (result != GA_SUCCESS)
+	if (audio_file == NULL)
 	{
-		return result;
+		return GA_E_REFNUM;
 	}
-
-	switch (codec)
+	else if (audio_file->file_mode != ga_file_mode_write)
 	{
-		case ga_codec_flac: return get_flac_tags(file_name, read_pictures, tags, tag_count, pictures, picture_count); break;
-		case ga_codec_mp3: return get_id3_tags(file_name, read_pictures, tags, tag_count, pictures, picture_count); break;
-		case ga_codec_vorbis: return get_vorbis_tags(file_name, read_pictures, tags, tag_count, pictures, picture_count); break;
-		case ga_codec_wav: return get_wav_tags(file_name, read_pictures, tags, tag_count, pictures, picture_count); break;
-		case ga_codec_unsupported:
-		default:
-			return GA_E_UNSUPPORTED_TAG;
-			break;
+		return GA_E_WRITE_MODE;
 	}
 
-	return GA_SUCCESS;
-}
+	thread_mutex_lock(&(audio_file->mutex));
+	if (audio_file->write_behind != NULL)
+	{
+		result = flush_write_behind(audio_file);
+	}
+	thread_mutex_unlock(&(audio_file->mutex));
 
-ga_result free_audio_file_tags(audio_file_tag_info tag_info)
-{
-	return free_audio_file_tags((intptr_t)tag_info.tags, tag_info.tag_count, (intptr_t)tag_info.pictures, tag_info.picture_count);
+	return result;
 }
 
-extern "C" LV_DLL_EXPORT ga_result free_audio_file_tags(intptr_t tags, int32_t tag_count, intptr_t pictures, int32_t picture_count)
+extern "C" LV_DLL_EXPORT ga_result get_write_behind_stats(int32_t refnum, uint64_t* queued_frames, uint64_t* high_water_frames, uint64_t* capacity_frames)
 {
-	audio_file_tag* tags_ptr = (audio_file_tag*)tags;
-	audio_file_picture* pictures_ptr = (audio_file_picture*)pictures;
+	audio_file_codec* audio_file = (audio_file_codec*)get_reference_data(ga_refnum_audio_file, refnum);
 
-	if (tags_ptr != NULL)
+	if (audio_file == NULL)
 	{
-		for (int i = 0; i < tag_count; i++)
-		{
-			free(tags_ptr[i].field);
-			free(tags_ptr[i].value);
-			tags_ptr[i].field = NULL;
-			tags_ptr[i].value = NULL;
-		}
-		free(tags_ptr);
-		tags_ptr = NULL;
-    }
+		return GA_E_REFNUM;
+	}
+	else if (audio_file->file_mode != ga_file_mode_write)
+	{
+		return GA_E_WRITE_MODE;
+	}
 
-	if (pictures_ptr != NULL)
+	*queued_frames = 0;
+	*high_water_frames = 0;
+	*capacity_frames = 0;
+
+	thread_mutex_lock(&(audio_file->mutex));
+	write_behind_state* write_behind = audio_file->write_behind;
+	if (write_behind != NULL)
 	{
-		for (int i = 0; i < picture_count; i++)
-		{
-			STBI_FREE(pictures_ptr[i].data);
-			pictures_ptr[i].data = NULL;
-		}
-		free(pictures_ptr);
-		pictures_ptr = NULL;
+		// Frames the worker is encoding stay in the ring until they're written, so they count as queued.
+		*queued_frames = ma_rb_available_read(&(write_behind->ring)) / write_behind->frame_size;
+		*high_water_frames = write_behind->high_water_frames;
+		*capacity_frames = write_behind->capacity_frames;
 	}
+	thread_mutex_unlock(&(audio_file->mutex));
 
 	return GA_SUCCESS;
 }
 
-ga_result get_audio_file_codec(const char* file_name, ga_codec* codec)
+extern "C" LV_DLL_EXPORT ga_result close_audio_file(int32_t refnum)
 {
-	FILE* pFile;
+	ga_result result = GA_SUCCESS;
 
-	*codec = ga_codec_unsupported;
+	audio_file_codec* audio_file = (audio_file_codec*)remove_reference(ga_refnum_audio_file, refnum);
 
-	pFile = ga_fopen(file_name);
-	if (pFile == NULL)
+	if (audio_file == NULL)
 	{
-		return GA_E_FILE;
+		return GA_E_REFNUM;
 	}
 
-	char signature[4];
-
-	fseek(pFile, 0, SEEK_SET);
-	fread(&signature, 1, sizeof(signature), pFile);
-	fclose(pFile);
-
-	// FLAC
-	if (!strncmp(signature, "fLaC", 4))
-	{
-		*codec = ga_codec_flac;
-	}
-	// MP3 (ID3v2)
-	else if (!strncmp(signature, "ID3", 3))
-	{
-		*codec = ga_codec_mp3;
-	}
-	// MP3 (no tag or ID3V1)
-	else if ((uint8_t)signature[0] == 0xFF && ((uint8_t)signature[1] == 0xFB || (uint8_t)signature[1] == 0xF3 || (uint8_t)signature[1] == 0xF2))
-	{
-		*codec = ga_codec_mp3;
-	}
-	// Ogg Vorbis
-	else if (!strncmp(signature, "OggS", 4))
+	if (audio_file->close == NULL)
 	{
-		*codec = ga_codec_vorbis;
+		return GA_E_GENERIC;
 	}
-	// WAV (RIFF format)
-	else if (!strncmp(signature, "RIFF", 4))
+	thread_mutex_lock(&(audio_file->mutex));
+	if (audio_file->file_mode == ga_file_mode_read)
 	{
-		*codec = ga_codec_wav;
+		free_read_ahead(audio_file);
+		audio_file->close(audio_file->decoder);
 	}
-	// WAV (Wave64 format)
-	else if (!strncmp(signature, "riff", 4))
+	else if (audio_file->file_mode == ga_file_mode_write)
 	{
-		*codec = ga_codec_wav;
+		result = free_write_behind(audio_file);
+		audio_file->close(audio_file->encoder);
 	}
-	else
+	ga_io_close(&(audio_file->io));
+	free_scratch_buffer(&(audio_file->scratch));
+	if (audio_file->cached != NULL)
 	{
-		*codec = ga_codec_unsupported;
-		return GA_E_UNSUPPORTED_CODEC;
+		lock_ga_mutex(ga_mutex_sample_cache);
+		release_sample_cache_entry(audio_file->cached);
+		unlock_ga_mutex(ga_mutex_sample_cache);
+		audio_file->cached = NULL;
 	}
-	return GA_SUCCESS;
-}
+	thread_mutex_unlock(&(audio_file->mutex));
+	thread_mutex_term(&(audio_file->mutex));
 
-///////////////////////////
-// FLAC decoding wrapper //
-///////////////////////////
+	free(audio_file);
+	audio_file = NULL;
 
-inline ga_result convert_flac_result(int32_t result)
+	return result;
+}
+
+extern "C" LV_DLL_EXPORT ga_result configure_mp3_index_cache(uint8_t enabled, uint8_t use_sidecar_files)
 {
-	switch (result)
+	lock_ga_mutex(ga_mutex_mp3_index);
+	mp3_index_cache_enabled = (enabled != 0);
+	mp3_index_sidecar_enabled = (use_sidecar_files != 0);
+
+	if (!mp3_index_cache_enabled)
 	{
-	case DRFLAC_SUCCESS:
-		return GA_SUCCESS; break;
-	default:
-		return GA_E_GENERIC; break;
+		for (int i = 0; i < MP3_INDEX_CACHE_ENTRIES; i++)
+		{
+			free_mp3_index_entry(&mp3_index_cache[i]);
+		}
 	}
+	unlock_ga_mutex(ga_mutex_mp3_index);
 
-	return GA_E_GENERIC;
+	return GA_SUCCESS;
 }
 
-ga_result get_flac_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
+extern "C" LV_DLL_EXPORT ga_result configure_vorbis_index_cache(uint8_t enabled)
 {
-	drflac* pFlac = NULL;
+	lock_ga_mutex(ga_mutex_vorbis_index);
+	vorbis_index_cache_enabled = (enabled != 0);
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	pFlac = drflac_open_file_w(wide_file_name, NULL);
-	free(wide_file_name);
-#else
-	pFlac = drflac_open_file(file_name, NULL);
-#endif
-	if (pFlac == NULL)
+	if (!vorbis_index_cache_enabled)
 	{
-		return GA_E_DECODER;
+		for (int i = 0; i < VORBIS_INDEX_CACHE_ENTRIES; i++)
+		{
+			free_vorbis_index_entry(&vorbis_index_cache[i]);
+		}
 	}
-
-	*num_frames = pFlac->totalPCMFrameCount;
-	*channels = pFlac->channels;
-	*sample_rate = pFlac->sampleRate;
-	*bits_per_sample = pFlac->bitsPerSample;
-
-	drflac_close(pFlac);
+	unlock_ga_mutex(ga_mutex_vorbis_index);
 
 	return GA_SUCCESS;
 }
 
-int16_t* load_flac(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
+extern "C" LV_DLL_EXPORT ga_result configure_sample_cache(uint64_t budget_bytes)
 {
-	drflac_uint64 flac_num_frames = 0;
-	drflac_uint32 flac_channels = 0;
-	drflac_uint32 flac_sample_rate = 0;
-	int16_t* sample_data = NULL;
+	lock_ga_mutex(ga_mutex_sample_cache);
+	global_sample_cache.budget = budget_bytes;
+	trim_sample_cache();
+	unlock_ga_mutex(ga_mutex_sample_cache);
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	sample_data = drflac_open_file_and_read_pcm_frames_s16_w(wide_file_name, &flac_channels, &flac_sample_rate, &flac_num_frames, NULL);
-	free(wide_file_name);
-#else
-	sample_data = drflac_open_file_and_read_pcm_frames_s16(file_name, &flac_channels, &flac_sample_rate, &flac_num_frames, NULL);
-#endif
+	return GA_SUCCESS;
+}
 
-	if (sample_data == NULL)
-	{
-		// Failed to open and decode FLAC file.
-		*result = GA_E_GENERIC;
+extern "C" LV_DLL_EXPORT ga_result get_sample_cache_stats(uint64_t* hits, uint64_t* misses, uint64_t* evictions, uint64_t* bytes_used, uint32_t* num_entries)
+{
+	lock_ga_mutex(ga_mutex_sample_cache);
+	*hits = global_sample_cache.hits;
+	*misses = global_sample_cache.misses;
+	*evictions = global_sample_cache.evictions;
+	*bytes_used = global_sample_cache.bytes_used;
+	*num_entries = 0;
+	for (size_t i = 0; i < global_sample_cache.entries.size(); i++)
+	{
+		if (!global_sample_cache.entries[i]->evicted)
+		{
+			(*num_entries)++;
+		}
 	}
+	unlock_ga_mutex(ga_mutex_sample_cache);
 
-	*num_frames = flac_num_frames;
-	*channels = flac_channels;
-	*sample_rate = flac_sample_rate;
-	*result = GA_SUCCESS;
-
-	return sample_data;
+	return GA_SUCCESS;
 }
 
-void free_flac(int16_t* sample_data)
+extern "C" LV_DLL_EXPORT ga_result get_audio_file_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
 {
-	drflac_free(sample_data, NULL);
+	return get_audio_file_tags_ex(file_name, (read_pictures ? ga_picture_rgba : ga_picture_none), 0, tags, tag_count, pictures, picture_count);
 }
 
-ga_result open_flac_file(const char* file_name, void** decoder)
+extern "C" LV_DLL_EXPORT ga_result get_audio_file_tags_ex(const char* file_name, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
 {
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	*decoder = (void*)drflac_open_file_w(wide_file_name, NULL);
-	free(wide_file_name);
-#else
-	*decoder = (void*)drflac_open_file(file_name, NULL);
-#endif
+	ga_result result;
+	ga_codec codec;
+	ga_io io;
 
-	if (*decoder == NULL)
+	result = ga_io_open(file_name, &io);
+
+	if (result != GA_SUCCESS)
 	{
-		return GA_E_GENERIC;
+		return result;
 	}
 
-	return GA_SUCCESS;
-}
+	result = get_io_codec(&io, &codec);
 
-ga_result get_basic_flac_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
-{
-	if (decoder == NULL)
+	if (result == GA_SUCCESS)
 	{
-		return GA_E_GENERIC;
+		if (picture_mode > ga_picture_thumbnail || (picture_mode == ga_picture_thumbnail && thumbnail_size == 0))
+		{
+			result = GA_E_GENERIC;
+		}
+		else
+		{
+			result = get_codec_file_tags(&io, codec, picture_mode, thumbnail_size, tags, tag_count, pictures, picture_count);
+		}
 	}
 
-	*channels = ((drflac*)decoder)->channels;
-	*sample_rate = ((drflac*)decoder)->sampleRate;
-	*read_offset = ((drflac*)decoder)->currentPCMFrame;
+	ga_io_close(&io);
+
+	return result;
+}
+
+extern "C" LV_DLL_EXPORT ga_result free_audio_file_tags(intptr_t tags, int32_t tag_count, intptr_t pictures, int32_t picture_count)
+{
+	// The pictures, strings and picture data are all in the block starting at the tag array.
+	// The counts and picture array are only kept in the signature for existing callers.
+	(void)tag_count;
+	(void)pictures;
+	(void)picture_count;
+	free((void*)tags);
 
 	return GA_SUCCESS;
 }
 
-ga_result seek_flac_file(void* decoder, uint64_t offset, uint64_t* new_offset)
+extern "C" LV_DLL_EXPORT ga_result set_audio_file_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten)
 {
-	if (decoder == NULL)
+	ga_result result;
+	ga_codec codec;
+	uint8_t file_rewritten = 0;
+
+	if (rewritten != NULL)
 	{
-		return GA_E_GENERIC;
+		*rewritten = 0;
 	}
 
-	if (drflac_seek_to_pcm_frame((drflac*)decoder, offset) == DRFLAC_FALSE)
+	if (file_name == NULL || tag_count < 0 || (tag_count > 0 && (fields == NULL || values == NULL)))
 	{
-		return GA_E_DECODER;
+		return GA_E_GENERIC;
 	}
-	
-	*new_offset = offset;
 
-	return GA_SUCCESS;
-}
+	result = check_tag_fields(fields, values, tag_count);
 
-ga_result read_flac_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer)
-{
-	if (decoder == NULL)
+	if (result != GA_SUCCESS)
 	{
-		return GA_E_GENERIC;
+		return result;
 	}
 
-	if (output_buffer == NULL)
+	result = get_audio_file_codec(file_name, &codec);
+
+	if (result != GA_SUCCESS)
 	{
-		return GA_E_MEMORY;
+		return result;
 	}
 
-	void* temp_buffer = NULL;
+	result = set_codec_file_tags(file_name, codec, fields, values, tag_count, &file_rewritten);
 
-	switch (audio_type)
+	if (rewritten != NULL)
 	{
-	case ga_data_type_u8:
-		temp_buffer = malloc(frames_to_read * ((drflac*)decoder)->channels * sizeof(drflac_int16));
-		*frames_read = drflac_read_pcm_frames_s16((drflac*)decoder, frames_to_read, (drflac_int16*)temp_buffer);
-		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, frames_to_read * ((drflac*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
-		break;
-	case ga_data_type_i16:
-		*frames_read = drflac_read_pcm_frames_s16((drflac*)decoder, frames_to_read, (drflac_int16*)output_buffer);
-		break;
-	case ga_data_type_i32:
-		*frames_read = drflac_read_pcm_frames_s32((drflac*)decoder, frames_to_read, (drflac_int32*)output_buffer);
-		break;
-	case ga_data_type_float:
-		*frames_read = drflac_read_pcm_frames_f32((drflac*)decoder, frames_to_read, (float*)output_buffer);
-		break;
-	case ga_data_type_double:
-		temp_buffer = malloc(frames_to_read * ((drflac*)decoder)->channels * sizeof(drflac_int32));
-		*frames_read = drflac_read_pcm_frames_s32((drflac*)decoder, frames_to_read, (drflac_int32*)temp_buffer);
-		s32_to_f64((double*)output_buffer, (int32_t*)temp_buffer, frames_to_read * ((drflac*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
-		break;
-	default:
-		return GA_E_INVALID_TYPE;
-		break;
+		*rewritten = file_rewritten;
 	}
 
-	return GA_SUCCESS;
+	return result;
 }
 
-ga_result close_flac_file(void* decoder)
+extern "C" LV_DLL_EXPORT ga_result start_library_scan(const char** file_names, int32_t num_files, uint8_t read_tags, uint8_t exact, int32_t* refnum)
 {
-	if (decoder == NULL)
+	return start_library_scan_ex(file_names, num_files, read_tags, exact, NULL, refnum);
+}
+
+extern "C" LV_DLL_EXPORT ga_result start_library_scan_ex(const char** file_names, int32_t num_files, uint8_t read_tags, uint8_t exact, const char* index_file_name, int32_t* refnum)
+{
+	if (num_files < 0 || (num_files > 0 && file_names == NULL))
 	{
 		return GA_E_GENERIC;
 	}
 
-	drflac_close((drflac*)decoder);
-
-	return GA_SUCCESS;
-}
+	library_scan* scan = (library_scan*)calloc(1, sizeof(library_scan));
 
-void flac_metadata_callback(void* pUserData, drflac_metadata* meta)
-{
-	if (pUserData == NULL)
+	if (scan == NULL)
 	{
-		return;
+		return GA_E_MEMORY;
 	}
 
-	audio_file_tag_info* tag_info = (audio_file_tag_info*)pUserData;
+	scan->num_files = num_files;
+	scan->read_tags = read_tags;
+	scan->exact = exact;
+	scan->file_names = (char**)calloc(num_files > 0 ? num_files : 1, sizeof(char*));
+	scan->files = (library_scan_file*)calloc(num_files > 0 ? num_files : 1, sizeof(library_scan_file));
+	thread_mutex_init(&(scan->mutex));
 
-	if (tag_info->result != GA_SUCCESS)
+	if (scan->file_names == NULL || scan->files == NULL)
 	{
-		return;
+		free_library_scan(scan);
+		return GA_E_MEMORY;
 	}
 
-	switch (meta->type)
+	for (int32_t i = 0; i < num_files; i++)
 	{
-		case DRFLAC_METADATA_BLOCK_TYPE_VORBIS_COMMENT:
+		// Files the workers don't get to before a cancel keep this result.
+		scan->files[i].entry.codec = ga_codec_unsupported;
+		scan->files[i].entry.result = GA_E_CANCELLED;
+
+		if (file_names[i] != NULL)
 		{
-			drflac_vorbis_comment_iterator iterator;
-			const char* comment;
-			uint32_t length;
-			int32_t token_offset;
-			int32_t field_length;
-			int32_t value_length;
+			scan->file_names[i] = (char*)malloc(strlen(file_names[i]) + 1);
 
-			tag_info->tag_count = 0;
-			if (meta->data.vorbis_comment.commentCount > 0)
+			if (scan->file_names[i] == NULL)
 			{
-				// Use calloc instead of malloc so all char* are set NULL
-				tag_info->tags = (audio_file_tag*)calloc(meta->data.vorbis_comment.commentCount, sizeof(audio_file_tag));
+				free_library_scan(scan);
+				return GA_E_MEMORY;
+			}
 
-				if (tag_info->tags == NULL)
-				{
-					tag_info->result = GA_E_MEMORY;
-					return;
-				}
+			strcpy(scan->file_names[i], file_names[i]);
+		}
+	}
 
-				drflac_init_vorbis_comment_iterator(&iterator, meta->data.vorbis_comment.commentCount, meta->data.vorbis_comment.pComments);
-				while ((comment = drflac_next_vorbis_comment(&iterator, &length)) != NULL)
-				{
-					token_offset = ga_find_token(comment, '=');
+	if (index_file_name != NULL)
+	{
+		scan->index_name = (char*)malloc(strlen(index_file_name) + 1);
 
-					if (token_offset > 0)
-					{
-						value_length = length - token_offset;
-						field_length = length - value_length - 1;
-
-						tag_info->tags[tag_info->tag_count].field = (char*)malloc(field_length + 1);
-						tag_info->tags[tag_info->tag_count].value = (char*)malloc(value_length + 1);
-
-						if (tag_info->tags[tag_info->tag_count].field == NULL || tag_info->tags[tag_info->tag_count].value == NULL)
-						{
-							tag_info->result = GA_E_MEMORY;
-							return;
-						}
-
-						memcpy(tag_info->tags[tag_info->tag_count].field, comment, field_length);
-						tag_info->tags[tag_info->tag_count].field[field_length] = '\0';
-						tag_info->tags[tag_info->tag_count].field_length = field_length;
-						memcpy(tag_info->tags[tag_info->tag_count].value, comment + token_offset, value_length);
-						tag_info->tags[tag_info->tag_count].value[value_length] = '\0';
-						tag_info->tags[tag_info->tag_count].value_length = value_length;
-						tag_info->tag_count++;
-					}
-				}
-			}
-			break;
-		}
-		case DRFLAC_METADATA_BLOCK_TYPE_PICTURE:
+		if (scan->index_name == NULL)
 		{
-			if (tag_info->read_pictures)
-			{
-				int32_t x, y, n;
-				audio_file_picture* temp_pictures_ptr = tag_info->pictures;
-				tag_info->pictures = (audio_file_picture*)realloc(temp_pictures_ptr, sizeof(audio_file_picture) * (tag_info->picture_count + 1));
+			free_library_scan(scan);
+			return GA_E_MEMORY;
+		}
 
-				if (tag_info->pictures == NULL)
-				{
-					tag_info->pictures = temp_pictures_ptr;
-					tag_info->result = GA_E_MEMORY;
-					return;
-				}
+		strcpy(scan->index_name, index_file_name);
 
-				tag_info->pictures[tag_info->picture_count].data = stbi_load_from_memory(meta->data.picture.pPictureData, meta->data.picture.pictureDataSize, &x, &y, &n, 4);
+		// A missing or invalid index is the same as an empty one, and every file is scanned.
+		open_library_index(scan->index_name, &(scan->index));
+	}
 
-				if (tag_info->pictures[tag_info->picture_count].data == NULL)
-				{
-					tag_info->result = GA_E_PICTURE;
-					return;
-				}
+	uint32_t worker_count = get_worker_count();
+	if (worker_count > (uint32_t)num_files)
+	{
+		worker_count = (uint32_t)num_files;
+	}
 
-				tag_info->pictures[tag_info->picture_count].data_size = sizeof(uint8_t) * x * y * 4;
-				tag_info->pictures[tag_info->picture_count].type = meta->data.picture.type;
-				tag_info->pictures[tag_info->picture_count].width = x;
-				tag_info->pictures[tag_info->picture_count].height = y;
-				tag_info->pictures[tag_info->picture_count].depth = n * 8;
-				tag_info->picture_count++;
+	if (worker_count > 0)
+	{
+		scan->threads = (ma_thread*)malloc(worker_count * sizeof(ma_thread));
+	}
+
+	if (scan->threads != NULL)
+	{
+		scan->workers_running = worker_count;
+
+		for (uint32_t i = 0; i < worker_count; i++)
+		{
+			if (ma_thread_create(&(scan->threads[scan->thread_count]), ma_thread_priority_default, 0, library_scan_worker, scan, NULL) == MA_SUCCESS)
+			{
+				scan->thread_count++;
+			}
+			else
+			{
+				c89atomic_fetch_sub_32(&scan->workers_running, 1);
 			}
-			break;
 		}
-		default: break;
 	}
-}
-
-ga_result get_flac_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
-{
-	drflac* decoder = NULL;
-	audio_file_tag_info* tag_info = (audio_file_tag_info*)malloc(sizeof(audio_file_tag_info));
 
-	if (tag_info == NULL)
+	// Without any workers the scan is done on this thread before returning.
+	if (scan->thread_count == 0 && num_files > 0)
 	{
-		return GA_E_MEMORY;
+		scan->workers_running = 1;
+		library_scan_worker(scan);
 	}
-	memset(tag_info, 0, sizeof(audio_file_tag_info));
-	tag_info->read_pictures = read_pictures;
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	decoder = drflac_open_file_with_metadata_w(wide_file_name, flac_metadata_callback, tag_info, NULL);
-	free(wide_file_name);
-#else
-	decoder = drflac_open_file_with_metadata(file_name, flac_metadata_callback, tag_info, NULL);
-#endif
+	*refnum = create_insert_refnum_data(ga_refnum_library_scan, (void*)scan);
 
-	if (decoder == NULL)
+	if (*refnum < 0)
 	{
-		free(tag_info);
-		return GA_E_TAG;
+		free_library_scan(scan);
+		return GA_E_REFNUM_LIMIT;
 	}
 
-	drflac_close(decoder);
+	return GA_SUCCESS;
+}
 
-	if (tag_info->result != GA_SUCCESS)
+extern "C" LV_DLL_EXPORT ga_result get_library_scan_progress(int32_t refnum, int32_t* files_scanned, int32_t* num_files, uint8_t* finished)
+{
+	library_scan* scan = (library_scan*)get_reference_data(ga_refnum_library_scan, refnum);
+
+	if (scan == NULL)
 	{
-		ga_result result = tag_info->result;
-		free_audio_file_tags(*tag_info);
-		free(tag_info);
-		return result;
+		return GA_E_REFNUM;
 	}
 
-	*tags = (intptr_t)tag_info->tags;
-	*tag_count = tag_info->tag_count;
-	*pictures = (intptr_t)tag_info->pictures;
-	*picture_count = tag_info->picture_count;
-
-	free(tag_info);
+	*files_scanned = (int32_t)c89atomic_load_32(&scan->files_scanned);
+	*num_files = scan->num_files;
+	*finished = (c89atomic_load_32(&scan->workers_running) == 0);
 
 	return GA_SUCCESS;
 }
 
-
-//////////////////////////
-// MP3 decoding wrapper //
-//////////////////////////
-
-inline ga_result convert_mp3_result(int32_t result)
+extern "C" LV_DLL_EXPORT ga_result cancel_library_scan(int32_t refnum)
 {
-	switch (result)
+	library_scan* scan = (library_scan*)get_reference_data(ga_refnum_library_scan, refnum);
+
+	if (scan == NULL)
 	{
-	case 0:
-		return GA_SUCCESS; break;
-	case MP3D_E_PARAM:
-		return GA_E_DECODER; break;
-	case MP3D_E_MEMORY:
-		return GA_E_MEMORY; break;
-	case MP3D_E_IOERROR:
-		return GA_E_FILE; break;
-	case MP3D_E_USER:
-		return GA_E_GENERIC; break;
-	case MP3D_E_DECODE:
-		return GA_E_DECODER; break;
-	default:
-		return GA_E_GENERIC; break;
+		return GA_E_REFNUM;
 	}
 
-	return GA_E_GENERIC;
+	c89atomic_exchange_32(&scan->cancelled, 1);
+
+	return GA_SUCCESS;
 }
 
-ga_result get_mp3_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
+extern "C" LV_DLL_EXPORT ga_result get_library_scan_results(int32_t refnum, intptr_t* entries, int32_t* entry_count, intptr_t* tags, int32_t* tag_count, intptr_t* strings, int32_t* strings_size)
 {
 	ga_result result = GA_SUCCESS;
-	mp3dec_t mp3d;
-	mp3dec_file_info_t info;
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	result = convert_mp3_result(mp3dec_load_w_no_decode(&mp3d, wide_file_name, &info, NULL, NULL));
-	free(wide_file_name);
-#else
-	result = convert_mp3_result(mp3dec_load_no_decode(&mp3d, file_name, &info, NULL, NULL));
-#endif
+	library_scan* scan = (library_scan*)get_reference_data(ga_refnum_library_scan, refnum);
 
-	if (result != GA_SUCCESS)
+	if (scan == NULL)
 	{
-		return result;
+		return GA_E_REFNUM;
 	}
-	else if (info.channels <= 0)
+
+	thread_mutex_lock(&(scan->mutex));
+	join_library_scan(scan);
+
+	if (scan->results == NULL)
 	{
-		return GA_E_DECODER;
+		result = flatten_library_scan(scan);
 	}
 
-	*num_frames = info.samples / info.channels;
-	*channels = info.channels;
-	*sample_rate = info.hz;
-	// Lossy codecs don't have a true "bits per sample", it's all floating point math. minimp3 decodes to 16-bit.
-	*bits_per_sample = 16;
+	// Index files are a best effort, eg. the index may be in a read-only folder.
+	if (result == GA_SUCCESS && scan->index_name != NULL && !scan->index_written)
+	{
+		write_library_index(scan);
+		scan->index_written = 1;
+	}
 
-	free_mp3(info.buffer);
+	if (result == GA_SUCCESS)
+	{
+		size_t tags_offset = scan->num_files * sizeof(library_scan_entry);
+		size_t strings_offset = tags_offset + scan->tag_count * sizeof(library_scan_tag);
+
+		*entries = (intptr_t)scan->results;
+		*entry_count = scan->num_files;
+		*tags = (intptr_t)(scan->results + tags_offset);
+		*tag_count = scan->tag_count;
+		*strings = (intptr_t)(scan->results + strings_offset);
+		*strings_size = scan->strings_size;
+	}
+	thread_mutex_unlock(&(scan->mutex));
 
 	return result;
 }
 
-int16_t* load_mp3(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
+extern "C" LV_DLL_EXPORT ga_result close_library_scan(int32_t refnum)
 {
-	mp3dec_t mp3d;
-	mp3dec_file_info_t info;
-
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	*result = convert_mp3_result(mp3dec_load_w(&mp3d, wide_file_name, &info, NULL, NULL));
-	free(wide_file_name);
-#else
-	*result = convert_mp3_result(mp3dec_load(&mp3d, file_name, &info, NULL, NULL));
-#endif
+	library_scan* scan = (library_scan*)remove_reference(ga_refnum_library_scan, refnum);
 
-	if (*result != GA_SUCCESS)
+	if (scan == NULL)
 	{
-		return NULL;
+		return GA_E_REFNUM;
 	}
-	else if (info.channels <= 0)
+
+	free_library_scan(scan);
+
+	return GA_SUCCESS;
+}
+
+void* reserve_scratch_buffer(ga_scratch_buffer* scratch, size_t size)
+{
+	if (scratch == NULL)
 	{
-		*result = GA_E_DECODER;
 		return NULL;
 	}
 
-	// MP3 decoder samples (ie. samples * channels), and not frames like the other decoders or LabVIEW wrapper. Convert to frames.
-	*num_frames = info.samples / info.channels;
-	*channels = info.channels;
-	*sample_rate = info.hz;
+	if (scratch->size < size)
+	{
+		// Contents don't need to be kept, so avoid the copy realloc would do.
+		free(scratch->data);
+		scratch->data = malloc(size);
+		scratch->size = (scratch->data != NULL ? size : 0);
+	}
 
-	return info.buffer;
+	return scratch->data;
 }
 
-void free_mp3(int16_t* sample_data)
+void free_scratch_buffer(ga_scratch_buffer* scratch)
 {
-	free(sample_data);
+	if (scratch == NULL)
+	{
+		return;
+	}
+
+	free(scratch->data);
+	scratch->data = NULL;
+	scratch->size = 0;
 }
 
-ga_result open_mp3_file(const char* file_name, void** decoder)
+ga_result get_codec_file_info(ga_io* io, ga_codec codec, uint8_t exact, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, uint8_t* is_exact)
 {
-	ga_result result = GA_SUCCESS;
-
-	mp3dec_ex_t* mp3_decoder = (mp3dec_ex_t*)malloc(sizeof(mp3dec_ex_t));
+	*is_exact = 1;
 
-	if (mp3_decoder == NULL)
+	switch (codec)
 	{
-		return GA_E_MEMORY;
+		case ga_codec_flac: return get_flac_info(io, num_frames, channels, sample_rate, bits_per_sample); break;
+		case ga_codec_mp3:
+			if (!exact && get_mp3_header_info(io, num_frames, channels, sample_rate, bits_per_sample, is_exact) == GA_SUCCESS)
+			{
+				return GA_SUCCESS;
+			}
+			*is_exact = 1;
+			return get_mp3_info(io, num_frames, channels, sample_rate, bits_per_sample);
+			break;
+		case ga_codec_vorbis: return get_vorbis_info(io, num_frames, channels, sample_rate, bits_per_sample); break;
+		case ga_codec_wav: return get_wav_info(io, num_frames, channels, sample_rate, bits_per_sample); break;
+		case ga_codec_unsupported: return GA_E_UNSUPPORTED_CODEC;
+		default: break;
 	}
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	result = convert_mp3_result(mp3dec_ex_open_w(mp3_decoder, wide_file_name, MP3D_SEEK_TO_SAMPLE));
-	free(wide_file_name);
-#else
-	result = convert_mp3_result(mp3dec_ex_open(mp3_decoder, file_name, MP3D_SEEK_TO_SAMPLE));
-#endif
+	return GA_E_GENERIC;
+}
 
-	if (result != GA_SUCCESS)
+ga_result get_codec_file_tags(ga_io* io, ga_codec codec, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+{
+	switch (codec)
 	{
-		free(mp3_decoder);
-		mp3_decoder = NULL;
-		return result;
+		case ga_codec_flac: return get_flac_tags(io, picture_mode, thumbnail_size, tags, tag_count, pictures, picture_count); break;
+		case ga_codec_mp3: return get_id3_tags(io, picture_mode, thumbnail_size, tags, tag_count, pictures, picture_count); break;
+		case ga_codec_vorbis: return get_vorbis_tags(io, picture_mode, thumbnail_size, tags, tag_count, pictures, picture_count); break;
+		case ga_codec_wav: return get_wav_tags(io, picture_mode, thumbnail_size, tags, tag_count, pictures, picture_count); break;
+		case ga_codec_unsupported:
+		default:
+			return GA_E_UNSUPPORTED_TAG;
+			break;
 	}
 
-	*decoder = (void*)mp3_decoder;
-
-	return result;
+	return GA_SUCCESS;
 }
 
-ga_result get_basic_mp3_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
+ga_result set_codec_file_tags(const char* file_name, ga_codec codec, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten)
 {
-	if (decoder == NULL)
+	switch (codec)
 	{
-		return GA_E_GENERIC;
+		case ga_codec_flac: return set_flac_tags(file_name, fields, values, tag_count, rewritten); break;
+		case ga_codec_mp3: return set_id3_tags(file_name, fields, values, tag_count, rewritten); break;
+		case ga_codec_vorbis: return set_vorbis_tags(file_name, fields, values, tag_count, rewritten); break;
+		case ga_codec_wav: return set_wav_tags(file_name, fields, values, tag_count, rewritten); break;
+		case ga_codec_unsupported:
+		default:
+			return GA_E_UNSUPPORTED_TAG;
+			break;
 	}
 
-	*channels = ((mp3dec_ex_t*)decoder)->info.channels;
-	*sample_rate = ((mp3dec_ex_t*)decoder)->info.hz;
-	*read_offset = ((mp3dec_ex_t*)decoder)->cur_sample / ((mp3dec_ex_t*)decoder)->info.channels;
-
 	return GA_SUCCESS;
 }
 
-ga_result seek_mp3_file(void* decoder, uint64_t offset, uint64_t* new_offset)
+ga_result add_audio_file_tag(audio_file_tag_info* tag_info, const char* field, size_t field_length, const char* value, size_t value_length)
 {
-	if (decoder == NULL)
+	size_t strings_size = tag_info->strings_size + field_length + value_length + 2;
+
+	// Offsets and lengths are int32_t in the LabVIEW clusters.
+	if (field_length > INT32_MAX || value_length > INT32_MAX || strings_size > INT32_MAX)
 	{
-		return GA_E_GENERIC;
+		return GA_E_TAG;
 	}
-	
-	// MP3 decoder offset values are in terms of samples, and not frames like the other decoders or LabVIEW wrapper.
-	// Multiply by channels to get actual number of samples to read.
-	return convert_mp3_result(mp3dec_ex_seek((mp3dec_ex_t*)decoder, offset * ((mp3dec_ex_t*)decoder)->info.channels));
-}
 
-ga_result read_mp3_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer)
-{
-	if (decoder == NULL)
+	if (tag_info->tag_count == tag_info->tag_capacity)
 	{
-		return GA_E_GENERIC;
-	}
+		int32_t capacity = (tag_info->tag_capacity > 0 ? tag_info->tag_capacity * 2 : 16);
+		library_scan_tag* tags = (library_scan_tag*)realloc(tag_info->tags, sizeof(library_scan_tag) * capacity);
 
-	int32_t num_channels = ((mp3dec_ex_t*)decoder)->info.channels;
+		if (tags == NULL)
+		{
+			return GA_E_MEMORY;
+		}
 
-	if (num_channels <= 0)
-	{
-		return GA_E_DECODER;
+		tag_info->tags = tags;
+		tag_info->tag_capacity = capacity;
 	}
 
-	if (output_buffer == NULL)
+	if (strings_size > tag_info->strings_capacity)
 	{
-		return GA_E_MEMORY;
+		size_t capacity = (tag_info->strings_capacity > 0 ? tag_info->strings_capacity * 2 : 1024);
+		capacity = (capacity > strings_size ? capacity : strings_size);
+		char* strings = (char*)realloc(tag_info->strings, capacity);
+
+		if (strings == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+
+		tag_info->strings = strings;
+		tag_info->strings_capacity = capacity;
 	}
 
-	void* temp_buffer = NULL;
+	library_scan_tag* tag = &(tag_info->tags[tag_info->tag_count]);
+	tag->field_offset = (int32_t)tag_info->strings_size;
+	tag->field_length = (int32_t)field_length;
+	tag->value_offset = (int32_t)(tag_info->strings_size + field_length + 1);
+	tag->value_length = (int32_t)value_length;
+
+	memcpy(tag_info->strings + tag->field_offset, field, field_length);
+	tag_info->strings[tag->field_offset + field_length] = '\0';
+	memcpy(tag_info->strings + tag->value_offset, value, value_length);
+	tag_info->strings[tag->value_offset + value_length] = '\0';
+
+	tag_info->strings_size = strings_size;
+	tag_info->tag_count++;
+
+	return GA_SUCCESS;
+}
+
+ga_result add_audio_file_picture(audio_file_tag_info* tag_info, const uint8_t* data, size_t size, uint32_t type)
+{
+	if (tag_info->picture_count == tag_info->picture_capacity)
+	{
+		int32_t capacity = (tag_info->picture_capacity > 0 ? tag_info->picture_capacity * 2 : 4);
+		audio_file_picture* pictures = (audio_file_picture*)realloc(tag_info->pictures, sizeof(audio_file_picture) * capacity);
+
+		if (pictures == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+
+		tag_info->pictures = pictures;
+		tag_info->picture_capacity = capacity;
+	}
+
+	ga_result result = load_tag_picture(data, size, type, tag_info->picture_mode, tag_info->thumbnail_size, &(tag_info->pictures[tag_info->picture_count]));
+
+	if (result == GA_SUCCESS)
+	{
+		tag_info->picture_count++;
+	}
+
+	return result;
+}
+
+ga_result pack_audio_file_tags(audio_file_tag_info* tag_info, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+{
+	// Tag array, picture array, strings, then the picture data aligned to 16 bytes.
+	size_t pictures_offset = sizeof(audio_file_tag) * tag_info->tag_count;
+	pictures_offset = (pictures_offset + 15) & ~(size_t)15;
+	size_t strings_offset = pictures_offset + sizeof(audio_file_picture) * tag_info->picture_count;
+	size_t data_offset = (strings_offset + tag_info->strings_size + 15) & ~(size_t)15;
+	size_t block_size = data_offset;
+
+	for (int32_t i = 0; i < tag_info->picture_count; i++)
+	{
+		block_size += ((size_t)tag_info->pictures[i].data_size + 15) & ~(size_t)15;
+	}
+
+	*tags = 0;
+	*tag_count = 0;
+	*pictures = 0;
+	*picture_count = 0;
+
+	uint8_t* block = (uint8_t*)malloc(block_size > 0 ? block_size : 1);
+
+	if (block == NULL)
+	{
+		free_audio_file_tag_info(tag_info);
+		return GA_E_MEMORY;
+	}
+
+	audio_file_tag* block_tags = (audio_file_tag*)block;
+	audio_file_picture* block_pictures = (audio_file_picture*)(block + pictures_offset);
+	char* block_strings = (char*)(block + strings_offset);
+
+	if (tag_info->strings_size > 0)
+	{
+		memcpy(block_strings, tag_info->strings, tag_info->strings_size);
+	}
+
+	for (int32_t i = 0; i < tag_info->tag_count; i++)
+	{
+		block_tags[i].field = block_strings + tag_info->tags[i].field_offset;
+		block_tags[i].value = block_strings + tag_info->tags[i].value_offset;
+		block_tags[i].field_length = tag_info->tags[i].field_length;
+		block_tags[i].value_length = tag_info->tags[i].value_length;
+	}
+
+	for (int32_t i = 0; i < tag_info->picture_count; i++)
+	{
+		block_pictures[i] = tag_info->pictures[i];
+		block_pictures[i].data = block + data_offset;
+		memcpy(block_pictures[i].data, tag_info->pictures[i].data, tag_info->pictures[i].data_size);
+		data_offset += ((size_t)tag_info->pictures[i].data_size + 15) & ~(size_t)15;
+	}
+
+	*tags = (intptr_t)block_tags;
+	*tag_count = tag_info->tag_count;
+	*pictures = (tag_info->picture_count > 0 ? (intptr_t)block_pictures : 0);
+	*picture_count = tag_info->picture_count;
+
+	free_audio_file_tag_info(tag_info);
+
+	return GA_SUCCESS;
+}
+
+void free_audio_file_tag_info(audio_file_tag_info* tag_info)
+{
+	for (int32_t i = 0; i < tag_info->picture_count; i++)
+	{
+		STBI_FREE(tag_info->pictures[i].data);
+	}
+
+	free(tag_info->pictures);
+	free(tag_info->tags);
+	free(tag_info->strings);
+
+	tag_info->tags = NULL;
+	tag_info->tag_count = 0;
+	tag_info->tag_capacity = 0;
+	tag_info->strings = NULL;
+	tag_info->strings_size = 0;
+	tag_info->strings_capacity = 0;
+	tag_info->pictures = NULL;
+	tag_info->picture_count = 0;
+	tag_info->picture_capacity = 0;
+}
+
+ga_result load_tag_picture(const uint8_t* data, size_t size, uint32_t type, ga_picture_mode picture_mode, uint32_t thumbnail_size, audio_file_picture* picture)
+{
+	int32_t x, y, n;
+
+	memset(picture, 0, sizeof(audio_file_picture));
+	picture->type = type;
+
+	if (data == NULL || size > INT_MAX)
+	{
+		return GA_E_PICTURE;
+	}
+
+	if (picture_mode == ga_picture_compressed)
+	{
+		picture->data = (uint8_t*)malloc(size > 0 ? size : 1);
+
+		if (picture->data == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+
+		memcpy(picture->data, data, size);
+		picture->data_size = (uint32_t)size;
+
+		if (stbi_info_from_memory(data, (int)size, &x, &y, &n))
+		{
+			picture->width = x;
+			picture->height = y;
+			picture->depth = n * 8;
+		}
+
+		return GA_SUCCESS;
+	}
+
+	picture->data = stbi_load_from_memory(data, (int)size, &x, &y, &n, 4);
+
+	if (picture->data == NULL)
+	{
+		return GA_E_PICTURE;
+	}
+
+	if (picture_mode == ga_picture_thumbnail && ((uint32_t)x > thumbnail_size || (uint32_t)y > thumbnail_size))
+	{
+		// Scale the longer side to thumbnail_size.
+		uint32_t width = (x >= y ? thumbnail_size : (uint32_t)((uint64_t)x * thumbnail_size / y));
+		uint32_t height = (y >= x ? thumbnail_size : (uint32_t)((uint64_t)y * thumbnail_size / x));
+		width = (width > 0 ? width : 1);
+		height = (height > 0 ? height : 1);
+
+		uint8_t* thumbnail = (uint8_t*)malloc((size_t)width * height * 4);
+
+		if (thumbnail == NULL)
+		{
+			STBI_FREE(picture->data);
+			picture->data = NULL;
+			return GA_E_MEMORY;
+		}
+
+		downscale_rgba(picture->data, x, y, thumbnail, width, height);
+		STBI_FREE(picture->data);
+		picture->data = thumbnail;
+		x = width;
+		y = height;
+	}
+
+	picture->data_size = sizeof(uint8_t) * x * y * 4;
+	picture->width = x;
+	picture->height = y;
+	picture->depth = n * 8;
+
+	return GA_SUCCESS;
+}
+
+void downscale_rgba(const uint8_t* input, uint32_t input_width, uint32_t input_height, uint8_t* output, uint32_t output_width, uint32_t output_height)
+{
+	for (uint32_t output_y = 0; output_y < output_height; output_y++)
+	{
+		uint32_t y_start = (uint32_t)((uint64_t)output_y * input_height / output_height);
+		uint32_t y_end = (uint32_t)((uint64_t)(output_y + 1) * input_height / output_height);
+
+		for (uint32_t output_x = 0; output_x < output_width; output_x++)
+		{
+			uint32_t x_start = (uint32_t)((uint64_t)output_x * input_width / output_width);
+			uint32_t x_end = (uint32_t)((uint64_t)(output_x + 1) * input_width / output_width);
+			uint64_t sum[4] = { 0, 0, 0, 0 };
+
+			for (uint32_t y = y_start; y < y_end; y++)
+			{
+				const uint8_t* pixel = input + ((size_t)y * input_width + x_start) * 4;
+
+				for (uint32_t x = x_start; x < x_end; x++)
+				{
+					sum[0] += pixel[0];
+					sum[1] += pixel[1];
+					sum[2] += pixel[2];
+					sum[3] += pixel[3];
+					pixel += 4;
+				}
+			}
+
+			uint64_t count = (uint64_t)(x_end - x_start) * (y_end - y_start);
+			uint8_t* output_pixel = output + ((size_t)output_y * output_width + output_x) * 4;
+
+			for (int c = 0; c < 4; c++)
+			{
+				output_pixel[c] = (uint8_t)((sum[c] + count / 2) / count);
+			}
+		}
+	}
+}
+
+ga_result get_audio_file_codec(const char* file_name, ga_codec* codec)
+{
+	FILE* pFile;
+
+	*codec = ga_codec_unsupported;
+
+	pFile = ga_fopen(file_name);
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	uint8_t signature[4];
+	size_t signature_size;
+
+	fseek(pFile, 0, SEEK_SET);
+	signature_size = fread(&signature, 1, sizeof(signature), pFile);
+	fclose(pFile);
+
+	return get_codec_from_signature(signature, signature_size, codec);
+}
+
+ga_result get_io_codec(ga_io* io, ga_codec* codec)
+{
+	if (io->data == NULL)
+	{
+		return get_audio_file_codec(io->file_name, codec);
+	}
+
+	return get_codec_from_signature(io->data, io->size, codec);
+}
+
+ga_result get_codec_from_signature(const uint8_t* signature, size_t size, ga_codec* codec)
+{
+	// FLAC
+	if (size >= 4 && !memcmp(signature, "fLaC", 4))
+	{
+		*codec = ga_codec_flac;
+	}
+	// MP3 (ID3v2)
+	else if (size >= 3 && !memcmp(signature, "ID3", 3))
+	{
+		*codec = ga_codec_mp3;
+	}
+	// MP3 (no tag or ID3V1)
+	else if (size >= 2 && signature[0] == 0xFF && (signature[1] == 0xFB || signature[1] == 0xF3 || signature[1] == 0xF2))
+	{
+		*codec = ga_codec_mp3;
+	}
+	// Ogg Vorbis
+	else if (size >= 4 && !memcmp(signature, "OggS", 4))
+	{
+		*codec = ga_codec_vorbis;
+	}
+	// WAV (RIFF format)
+	else if (size >= 4 && !memcmp(signature, "RIFF", 4))
+	{
+		*codec = ga_codec_wav;
+	}
+	// WAV (Wave64 format)
+	else if (size >= 4 && !memcmp(signature, "riff", 4))
+	{
+		*codec = ga_codec_wav;
+	}
+	else
+	{
+		*codec = ga_codec_unsupported;
+		return GA_E_UNSUPPORTED_CODEC;
+	}
+	return GA_SUCCESS;
+}
+
+ga_result ga_io_open(const char* file_name, ga_io* io)
+{
+	io->data = NULL;
+	io->size = 0;
+	io->owned_data = NULL;
+	io->file_name = (char*)malloc(strlen(file_name) + 1);
+
+	if (io->file_name == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	strcpy(io->file_name, file_name);
+
+	// Files which can't be mapped (eg. over GA_MAP_FILE_MAX_SIZE on a 32-bit build) are read by name.
+	if (ga_map_file(file_name, &(io->map)) == GA_SUCCESS)
+	{
+		io->data = io->map.data;
+		io->size = io->map.size;
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result ga_io_open_memory(const uint8_t* data, uint64_t size, uint8_t copy_data, ga_io* io)
+{
+	io->file_name = NULL;
+	io->data = NULL;
+	io->size = 0;
+	io->owned_data = NULL;
+	io->map.data = NULL;
+	io->map.size = 0;
+#if defined(_WIN32)
+	io->map.file = NULL;
+	io->map.mapping = NULL;
+#endif
+
+	if (data == NULL || size == 0)
+	{
+		return GA_E_GENERIC;
+	}
+
+	if (size > SIZE_MAX)
+	{
+		return GA_E_MEMORY;
+	}
+
+	if (copy_data)
+	{
+		io->owned_data = (uint8_t*)malloc((size_t)size);
+
+		if (io->owned_data == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+
+		memcpy(io->owned_data, data, (size_t)size);
+		data = io->owned_data;
+	}
+
+	io->data = data;
+	io->size = (size_t)size;
+
+	return GA_SUCCESS;
+}
+
+void ga_io_close(ga_io* io)
+{
+	ga_unmap_file(&(io->map));
+	free(io->file_name);
+	free(io->owned_data);
+	io->file_name = NULL;
+	io->owned_data = NULL;
+	io->data = NULL;
+	io->size = 0;
+}
+
+ga_result ga_io_get_file_stamp(const ga_io* io, uint64_t* file_size, int64_t* modified_time, uint64_t* file_id)
+{
+	if (io->map.data != NULL)
+	{
+		return ga_get_file_info_stamp(&(io->map.info), file_size, modified_time, file_id);
+	}
+
+	if (io->file_name == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	return ga_get_file_stamp(io->file_name, file_size, modified_time, file_id);
+}
+
+ga_result init_audio_file_codec(audio_file_codec* audio_file, ga_codec codec, ga_file_mode file_mode)
+{
+	audio_file->refnum = -1;
+	audio_file->codec = codec;
+	audio_file->file_mode = file_mode;
+	audio_file->decoder = NULL;
+	audio_file->encoder = NULL;
+	audio_file->read_offset = 0;
+	audio_file->scratch.data = NULL;
+	audio_file->scratch.size = 0;
+	audio_file->cached = NULL;
+	audio_file->cached_offset = 0;
+	audio_file->decoder_synced = 1;
+	audio_file->read_ahead = NULL;
+	audio_file->write_behind = NULL;
+	audio_file->write_channels = 0;
+	audio_file->write_bits_per_sample = 0;
+	audio_file->write_float = 0;
+	audio_file->io.file_name = NULL;
+	audio_file->io.data = NULL;
+	audio_file->io.size = 0;
+	audio_file->io.map.data = NULL;
+	audio_file->io.map.size = 0;
+	audio_file->io.owned_data = NULL;
+#if defined(_WIN32)
+	audio_file->io.map.file = NULL;
+	audio_file->io.map.mapping = NULL;
+#endif
+	audio_file->open = NULL;
+	audio_file->open_write = NULL;
+	audio_file->get_basic_info = NULL;
+	audio_file->get_length = NULL;
+	audio_file->seek = NULL;
+	audio_file->read = NULL;
+	audio_file->write = NULL;
+	audio_file->close = NULL;
+
+	if (file_mode == ga_file_mode_read)
+	{
+		switch (codec)
+		{
+			case ga_codec_flac:
+				audio_file->open = open_flac_file;
+				audio_file->get_basic_info = get_basic_flac_file_info;
+				audio_file->get_length = get_flac_file_length;
+				audio_file->seek = seek_flac_file;
+				audio_file->read = read_flac_file;
+				audio_file->close = close_flac_file;
+				break;
+			case ga_codec_mp3:
+				audio_file->open = open_mp3_file;
+				audio_file->get_basic_info = get_basic_mp3_file_info;
+				audio_file->get_length = get_mp3_file_length;
+				audio_file->seek = seek_mp3_file;
+				audio_file->read = read_mp3_file;
+				audio_file->close = close_mp3_file;
+				break;
+			case ga_codec_vorbis:
+				audio_file->open = open_vorbis_file;
+				audio_file->get_basic_info = get_basic_vorbis_file_info;
+				audio_file->get_length = get_vorbis_file_length;
+				audio_file->seek = seek_vorbis_file;
+				audio_file->read = read_vorbis_file;
+				audio_file->close = close_vorbis_file;
+				break;
+			case ga_codec_wav:
+				audio_file->open = open_wav_file;
+				audio_file->get_basic_info = get_basic_wav_file_info;
+				audio_file->get_length = get_wav_file_length;
+				audio_file->seek = seek_wav_file;
+				audio_file->read = read_wav_file;
+				audio_file->close = close_wav_file;
+				break;
+			default:
+				return GA_E_UNSUPPORTED_CODEC;
+				break;
+		}
+	}
+	else if (file_mode == ga_file_mode_write)
+	{
+		switch (codec)
+		{
+			case ga_codec_flac:
+				audio_file->open_write = open_flac_file_write;
+				audio_file->write = write_flac_file;
+				audio_file->close = close_flac_file_write;
+				break;
+			case ga_codec_wav:
+				audio_file->open_write = open_wav_file_write;
+				audio_file->write = write_wav_file;
+				audio_file->close = close_wav_file_write;
+				break;
+			default:
+				return GA_E_UNSUPPORTED_CODEC;
+				break;
+		}
+	}
+	else
+	{
+		return GA_E_GENERIC;
+	}
+
+	return GA_SUCCESS;
+}
+
+size_t get_data_type_size(ga_data_type audio_type)
+{
+	switch (audio_type)
+	{
+		case ga_data_type_u8: return sizeof(uint8_t); break;
+		case ga_data_type_i16: return sizeof(int16_t); break;
+		case ga_data_type_i32: return sizeof(int32_t); break;
+		case ga_data_type_float: return sizeof(float); break;
+		case ga_data_type_double: return sizeof(double); break;
+		default: break;
+	}
+
+	return 0;
+}
+
+ga_result write_encoder_frames(audio_file_codec* audio_file, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written)
+{
+	if (audio_file->write_behind != NULL)
+	{
+		return queue_write_behind(audio_file, frames_to_write, input_buffer, frames_written);
+	}
+
+	return audio_file->write(audio_file->encoder, frames_to_write, input_buffer, frames_written);
+}
+
+ga_result convert_write_samples(void* buffer_out, const void* buffer_in, ga_data_type audio_type, uint32_t bits_per_sample, uint8_t is_float, size_t num_samples)
+{
+	if (is_float)
+	{
+		if (bits_per_sample == 32)
+		{
+			switch (audio_type)
+			{
+				case ga_data_type_u8: u8_to_f32((float*)buffer_out, (const uint8_t*)buffer_in, num_samples); break;
+				case ga_data_type_i16: s16_to_f32((float*)buffer_out, (const int16_t*)buffer_in, num_samples); break;
+				case ga_data_type_i32: s32_to_f32((float*)buffer_out, (const int32_t*)buffer_in, num_samples); break;
+				case ga_data_type_float: memcpy(buffer_out, buffer_in, num_samples * sizeof(float)); break;
+				case ga_data_type_double: f64_to_f32((float*)buffer_out, (const double*)buffer_in, num_samples); break;
+				default: return GA_E_INVALID_TYPE; break;
+			}
+		}
+		else if (bits_per_sample == 64)
+		{
+			switch (audio_type)
+			{
+				case ga_data_type_u8: u8_to_f64((double*)buffer_out, (const uint8_t*)buffer_in, num_samples); break;
+				case ga_data_type_i16: s16_to_f64((double*)buffer_out, (const int16_t*)buffer_in, num_samples); break;
+				case ga_data_type_i32: s32_to_f64((double*)buffer_out, (const int32_t*)buffer_in, num_samples); break;
+				case ga_data_type_float: f32_to_f64((double*)buffer_out, (const float*)buffer_in, num_samples); break;
+				case ga_data_type_double: memcpy(buffer_out, buffer_in, num_samples * sizeof(double)); break;
+				default: return GA_E_INVALID_TYPE; break;
+			}
+		}
+		else
+		{
+			return GA_E_INVALID_TYPE;
+		}
+
+		return GA_SUCCESS;
+	}
+
+	switch (bits_per_sample)
+	{
+		case 8:
+			switch (audio_type)
+			{
+				case ga_data_type_u8: memcpy(buffer_out, buffer_in, num_samples); break;
+				case ga_data_type_i16: s16_to_u8((uint8_t*)buffer_out, (const int16_t*)buffer_in, num_samples); break;
+				case ga_data_type_i32: s32_to_u8((uint8_t*)buffer_out, (const int32_t*)buffer_in, num_samples); break;
+				case ga_data_type_float: f32_to_u8((uint8_t*)buffer_out, (const float*)buffer_in, num_samples); break;
+				case ga_data_type_double: f64_to_u8((uint8_t*)buffer_out, (const double*)buffer_in, num_samples); break;
+				default: return GA_E_INVALID_TYPE; break;
+			}
+			break;
+		case 16:
+			switch (audio_type)
+			{
+				case ga_data_type_u8: u8_to_s16((int16_t*)buffer_out, (const uint8_t*)buffer_in, num_samples); break;
+				case ga_data_type_i16: memcpy(buffer_out, buffer_in, num_samples * sizeof(int16_t)); break;
+				case ga_data_type_i32: s32_to_s16((int16_t*)buffer_out, (const int32_t*)buffer_in, num_samples); break;
+				case ga_data_type_float: f32_to_s16((int16_t*)buffer_out, (const float*)buffer_in, num_samples); break;
+				case ga_data_type_double: f64_to_s16((int16_t*)buffer_out, (const double*)buffer_in, num_samples); break;
+				default: return GA_E_INVALID_TYPE; break;
+			}
+			break;
+		case 24:
+			// 32-bit input is packed directly. Other types are widened to 32-bit in the output buffer, then packed in place.
+			if (audio_type == ga_data_type_i32)
+			{
+				s32_to_s24((uint8_t*)buffer_out, (const int32_t*)buffer_in, num_samples);
+				break;
+			}
+			switch (audio_type)
+			{
+				case ga_data_type_u8: u8_to_s32((int32_t*)buffer_out, (const uint8_t*)buffer_in, num_samples); break;
+				case ga_data_type_i16: s16_to_s32((int32_t*)buffer_out, (const int16_t*)buffer_in, num_samples); break;
+				case ga_data_type_float: f32_to_s32((int32_t*)buffer_out, (const float*)buffer_in, num_samples); break;
+				case ga_data_type_double: f64_to_s32((int32_t*)buffer_out, (const double*)buffer_in, num_samples); break;
+				default: return GA_E_INVALID_TYPE; break;
+			}
+			s32_to_s24((uint8_t*)buffer_out, (const int32_t*)buffer_out, num_samples);
+			break;
+		case 32:
+			switch (audio_type)
+			{
+				case ga_data_type_u8: u8_to_s32((int32_t*)buffer_out, (const uint8_t*)buffer_in, num_samples); break;
+				case ga_data_type_i16: s16_to_s32((int32_t*)buffer_out, (const int16_t*)buffer_in, num_samples); break;
+				case ga_data_type_i32: memcpy(buffer_out, buffer_in, num_samples * sizeof(int32_t)); break;
+				case ga_data_type_float: f32_to_s32((int32_t*)buffer_out, (const float*)buffer_in, num_samples); break;
+				case ga_data_type_double: f64_to_s32((int32_t*)buffer_out, (const double*)buffer_in, num_samples); break;
+				default: return GA_E_INVALID_TYPE; break;
+			}
+			break;
+		default:
+			return GA_E_INVALID_TYPE;
+			break;
+	}
+
+	return GA_SUCCESS;
+}
+
+int16_t* decode_audio_file_s16(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
+{
+	int16_t* sample_data = NULL;
+
+	*result = get_audio_file_codec(file_name, codec);
+
+	if (*result != GA_SUCCESS)
+	{
+		return NULL;
+	}
+
+	switch (*codec)
+	{
+		case ga_codec_flac: sample_data = load_flac(file_name, num_frames, channels, sample_rate, result); break;
+		case ga_codec_mp3: sample_data = load_mp3(file_name, num_frames, channels, sample_rate, result); break;
+		case ga_codec_vorbis: sample_data = load_vorbis(file_name, num_frames, channels, sample_rate, result); break;
+		case ga_codec_wav: sample_data = load_wav(file_name, num_frames, channels, sample_rate, result); break;
+		case ga_codec_unsupported: *result = GA_E_UNSUPPORTED_CODEC; break;
+		default: *result = GA_E_GENERIC; break;
+	}
+
+	if (*result != GA_SUCCESS)
+	{
+		free_sample_data(sample_data);
+		sample_data = NULL;
+	}
+
+	return sample_data;
+}
+
+void* decode_audio_file(const char* file_name, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
+{
+	ga_io io;
+	void* sample_data;
+
+	*num_frames = 0;
+
+	*result = ga_io_open(file_name, &io);
+
+	if (*result != GA_SUCCESS)
+	{
+		return NULL;
+	}
+
+	sample_data = decode_audio_io(&io, audio_type, num_frames, channels, sample_rate, codec, result);
+	ga_io_close(&io);
+
+	return sample_data;
+}
+
+void* decode_audio_io(ga_io* io, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
+{
+	// Frames decoded per read. Keeps the scratch buffer small for types which need an intermediate conversion.
+	const uint64_t block_frames = 65536;
+	audio_file_codec audio_file;
+	void* decoder = NULL;
+	uint8_t* sample_data = NULL;
+	uint64_t capacity = 0;
+	uint64_t total_frames = 0;
+	uint64_t read_offset = 0;
+	uint8_t length_known = 0;
+	size_t sample_size = get_data_type_size(audio_type);
+
+	*num_frames = 0;
+
+	if (sample_size == 0)
+	{
+		*result = GA_E_INVALID_TYPE;
+		return NULL;
+	}
+
+	*result = get_io_codec(io, codec);
+
+	if (*result == GA_SUCCESS)
+	{
+		*result = init_audio_file_codec(&audio_file, *codec, ga_file_mode_read);
+	}
+
+	if (*result != GA_SUCCESS)
+	{
+		return NULL;
+	}
+
+	if (audio_file.open(io, &decoder) != GA_SUCCESS)
+	{
+		*result = GA_E_DECODER;
+		return NULL;
+	}
+
+	*result = audio_file.get_basic_info(decoder, channels, sample_rate, &read_offset);
+
+	if (*result == GA_SUCCESS && *channels == 0)
+	{
+		*result = GA_E_DECODER;
+	}
+
+	// Size the output from the stream length up front. The length isn't always known (eg. FLAC streams without a total frame count), in which case grow as data is decoded.
+	if (*result == GA_SUCCESS && audio_file.get_length(decoder, &capacity) == GA_SUCCESS && capacity > 0)
+	{
+		length_known = 1;
+		// Corrupt headers can report any length, so make sure the buffer size doesn't overflow.
+		if (capacity <= SIZE_MAX / (*channels * sample_size))
+		{
+			sample_data = (uint8_t*)malloc((size_t)capacity * *channels * sample_size);
+		}
+		if (sample_data == NULL)
+		{
+			*result = GA_E_MEMORY;
+		}
+	}
+	else
+	{
+		capacity = 0;
+	}
+
+	// FLAC frames decode independently, so split the whole stream across threads. On failure fall back to reading from the start.
+	if (*result == GA_SUCCESS && length_known && *codec == ga_codec_flac)
+	{
+		if (decode_flac_parallel(io, 0, capacity, *channels, audio_type, sample_data) == GA_SUCCESS)
+		{
+			total_frames = capacity;
+		}
+	}
+
+	while (*result == GA_SUCCESS)
+	{
+		if (total_frames == capacity)
+		{
+			// A known length is trusted, so a full buffer means the whole stream has been read.
+			if (length_known)
+			{
+				break;
+			}
+
+			uint64_t new_capacity = (capacity > 0 ? capacity * 2 : block_frames * 16);
+			uint8_t* new_data = NULL;
+			if (new_capacity <= SIZE_MAX / (*channels * sample_size))
+			{
+				new_data = (uint8_t*)realloc(sample_data, (size_t)new_capacity * *channels * sample_size);
+			}
+			if (new_data == NULL)
+			{
+				*result = GA_E_MEMORY;
+				break;
+			}
+			sample_data = new_data;
+			capacity = new_capacity;
+		}
+
+		uint64_t frames_to_read = (capacity - total_frames < block_frames ? capacity - total_frames : block_frames);
+		uint64_t frames_read = 0;
+
+		*result = audio_file.read(decoder, frames_to_read, audio_type, &frames_read, sample_data + (total_frames * *channels * sample_size), &(audio_file.scratch));
+		total_frames += frames_read;
+
+		if (frames_read < frames_to_read)
+		{
+			break;
+		}
+	}
+
+	audio_file.close(decoder);
+	free_scratch_buffer(&(audio_file.scratch));
+
+	if (*result != GA_SUCCESS)
+	{
+		free(sample_data);
+		return NULL;
+	}
+
+	// Release any unused space if the stream was shorter than reported, or the buffer was grown.
+	if (total_frames > 0 && total_frames < capacity)
+	{
+		uint8_t* shrunk_data = (uint8_t*)realloc(sample_data, total_frames * *channels * sample_size);
+		if (shrunk_data != NULL)
+		{
+			sample_data = shrunk_data;
+		}
+	}
+
+	*num_frames = total_frames;
+
+	return (void*)sample_data;
+}
+
+void* load_cached_samples(const char* file_name, int32_t format, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result)
+{
+	uint64_t file_size = 0;
+	int64_t modified_time = 0;
+	uint64_t file_id = 0;
+	void* sample_data = NULL;
+	uint8_t enabled;
+
+	lock_ga_mutex(ga_mutex_sample_cache);
+	enabled = (global_sample_cache.budget > 0);
+	unlock_ga_mutex(ga_mutex_sample_cache);
+
+	// Entries are matched on the file's size, modification time and ID, so a file which has changed is decoded again.
+	if (enabled && ga_get_file_stamp(file_name, &file_size, &modified_time, &file_id) != GA_SUCCESS)
+	{
+		enabled = 0;
+	}
+
+	if (enabled)
+	{
+		lock_ga_mutex(ga_mutex_sample_cache);
+		//// START CRITICAL SECTION ////
+		for (size_t i = 0; i < global_sample_cache.entries.size(); i++)
+		{
+			sample_cache_entry* entry = global_sample_cache.entries[i];
+
+			if (!entry->evicted && entry->format == format && entry->file_size == file_size && entry->modified_time == modified_time && entry->file_id == file_id && !strcmp(entry->file_name, file_name))
+			{
+				entry->ref_count++;
+				entry->last_used = ++global_sample_cache.clock;
+				global_sample_cache.hits++;
+
+				*num_frames = entry->num_frames;
+				*channels = entry->channels;
+				*sample_rate = entry->sample_rate;
+				*codec = entry->codec;
+				*result = GA_SUCCESS;
+				sample_data = entry->data;
+
+				unlock_ga_mutex(ga_mutex_sample_cache);
+				return sample_data;
+			}
+		}
+		global_sample_cache.misses++;
+		//// END CRITICAL SECTION ////
+		unlock_ga_mutex(ga_mutex_sample_cache);
+	}
+
+	if (format == SAMPLE_CACHE_FORMAT_S16_LOAD)
+	{
+		sample_data = decode_audio_file_s16(file_name, num_frames, channels, sample_rate, codec, result);
+	}
+	else
+	{
+		sample_data = decode_audio_file(file_name, (ga_data_type)format, num_frames, channels, sample_rate, codec, result);
+	}
+
+	if (!enabled || *result != GA_SUCCESS || sample_data == NULL)
+	{
+		return sample_data;
+	}
+
+	sample_cache_entry* entry = (sample_cache_entry*)malloc(sizeof(sample_cache_entry));
+	char* entry_file_name = (char*)malloc(strlen(file_name) + 1);
+
+	// The load still succeeds if it can't be cached.
+	if (entry == NULL || entry_file_name == NULL)
+	{
+		free(entry);
+		free(entry_file_name);
+		return sample_data;
+	}
+
+	strcpy(entry_file_name, file_name);
+	entry->file_name = entry_file_name;
+	entry->file_size = file_size;
+	entry->modified_time = modified_time;
+	entry->file_id = file_id;
+	entry->format = format;
+	entry->data = sample_data;
+	entry->data_size = (size_t)(*num_frames * *channels * (format == SAMPLE_CACHE_FORMAT_S16_LOAD ? sizeof(int16_t) : get_data_type_size((ga_data_type)format)));
+	entry->num_frames = *num_frames;
+	entry->channels = *channels;
+	entry->sample_rate = *sample_rate;
+	entry->codec = *codec;
+	entry->ref_count = 1;
+	entry->evicted = 0;
+
+	lock_ga_mutex(ga_mutex_sample_cache);
+	//// START CRITICAL SECTION ////
+	if (entry->data_size <= global_sample_cache.budget)
+	{
+		entry->last_used = ++global_sample_cache.clock;
+		global_sample_cache.entries.push_back(entry);
+		global_sample_cache.bytes_used += entry->data_size;
+		trim_sample_cache();
+		entry = NULL;
+	}
+	//// END CRITICAL SECTION ////
+	unlock_ga_mutex(ga_mutex_sample_cache);
+
+	// Too large for the budget, so the caller owns the data.
+	if (entry != NULL)
+	{
+		free(entry->file_name);
+		free(entry);
+	}
+
+	return sample_data;
+}
+
+sample_cache_entry* acquire_sample_cache_stream(const char* file_name)
+{
+	uint64_t file_size = 0;
+	int64_t modified_time = 0;
+	uint64_t file_id = 0;
+	sample_cache_entry* found = NULL;
+
+	lock_ga_mutex(ga_mutex_sample_cache);
+	uint8_t enabled = (global_sample_cache.budget > 0);
+	unlock_ga_mutex(ga_mutex_sample_cache);
+
+	if (!enabled || ga_get_file_stamp(file_name, &file_size, &modified_time, &file_id) != GA_SUCCESS)
+	{
+		return NULL;
+	}
+
+	lock_ga_mutex(ga_mutex_sample_cache);
+	//// START CRITICAL SECTION ////
+	for (size_t i = 0; i < global_sample_cache.entries.size(); i++)
+	{
+		sample_cache_entry* entry = global_sample_cache.entries[i];
+
+		// Only load_audio_file() entries decode identically to the refnum's decoder.
+		if (!entry->evicted && entry->format != SAMPLE_CACHE_FORMAT_S16_LOAD && entry->file_size == file_size && entry->modified_time == modified_time && entry->file_id == file_id && !strcmp(entry->file_name, file_name))
+		{
+			entry->ref_count++;
+			entry->last_used = ++global_sample_cache.clock;
+			global_sample_cache.hits++;
+			found = entry;
+			break;
+		}
+	}
+	//// END CRITICAL SECTION ////
+	unlock_ga_mutex(ga_mutex_sample_cache);
+
+	return found;
+}
+
+void release_sample_cache_entry(sample_cache_entry* entry)
+{
+	entry->ref_count--;
+
+	if (entry->ref_count <= 0 && entry->evicted)
+	{
+		remove_sample_cache_entry(entry);
+	}
+}
+
+void remove_sample_cache_entry(sample_cache_entry* entry)
+{
+	for (size_t i = 0; i < global_sample_cache.entries.size(); i++)
+	{
+		if (global_sample_cache.entries[i] == entry)
+		{
+			global_sample_cache.entries.erase(global_sample_cache.entries.begin() + i);
+			break;
+		}
+	}
+
+	free(entry->data);
+	free(entry->file_name);
+	free(entry);
+}
+
+void trim_sample_cache()
+{
+	while (global_sample_cache.bytes_used > global_sample_cache.budget)
+	{
+		sample_cache_entry* oldest = NULL;
+
+		for (size_t i = 0; i < global_sample_cache.entries.size(); i++)
+		{
+			sample_cache_entry* entry = global_sample_cache.entries[i];
+
+			if (!entry->evicted && (oldest == NULL || entry->last_used < oldest->last_used))
+			{
+				oldest = entry;
+			}
+		}
+
+		if (oldest == NULL)
+		{
+			break;
+		}
+
+		// Entries still referenced by a caller or refnum are freed when they're released.
+		oldest->evicted = 1;
+		global_sample_cache.bytes_used -= oldest->data_size;
+		global_sample_cache.evictions++;
+
+		if (oldest->ref_count <= 0)
+		{
+			remove_sample_cache_entry(oldest);
+		}
+	}
+}
+
+ga_result read_cached_samples(audio_file_codec* audio_file, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer)
+{
+	sample_cache_entry* entry = audio_file->cached;
+	ga_result result;
+
+	if (audio_type == (ga_data_type)entry->format)
+	{
+		uint64_t frames_available = (entry->num_frames > audio_file->cached_offset ? entry->num_frames - audio_file->cached_offset : 0);
+		size_t frame_size = entry->channels * get_data_type_size(audio_type);
+
+		*frames_read = (frames_to_read < frames_available ? frames_to_read : frames_available);
+
+		if (*frames_read > 0)
+		{
+			memcpy(output_buffer, (uint8_t*)entry->data + (audio_file->cached_offset * frame_size), (size_t)(*frames_read * frame_size));
+		}
+
+		audio_file->cached_offset += *frames_read;
+		audio_file->decoder_synced = 0;
+
+		return GA_SUCCESS;
+	}
+
+	// Other types are decoded, picking up from the cached read position.
+	if (!audio_file->decoder_synced)
+	{
+		uint64_t new_offset = 0;
+		result = audio_file->seek(audio_file->decoder, audio_file->cached_offset, &new_offset);
+
+		if (result != GA_SUCCESS)
+		{
+			return result;
+		}
+
+		audio_file->decoder_synced = 1;
+	}
+
+	result = audio_file->read(audio_file->decoder, frames_to_read, audio_type, frames_read, output_buffer, &(audio_file->scratch));
+	audio_file->cached_offset += *frames_read;
+
+	return result;
+}
+
+
+////////////////
+// Read-ahead //
+////////////////
+
+ga_result init_read_ahead(audio_file_codec* audio_file, ga_data_type audio_type, uint32_t block_frames, uint32_t num_blocks)
+{
+	ga_result result;
+	uint32_t channels = 0;
+	uint32_t sample_rate = 0;
+	uint64_t read_offset = 0;
+
+	if (block_frames == 0)
+	{
+		block_frames = READ_AHEAD_DEFAULT_BLOCK_FRAMES;
+	}
+
+	if (num_blocks == 0)
+	{
+		num_blocks = READ_AHEAD_DEFAULT_BLOCKS;
+	}
+
+	result = audio_file->get_basic_info(audio_file->decoder, &channels, &sample_rate, &read_offset);
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	size_t sample_size = get_data_type_size(audio_type);
+
+	if (sample_size == 0 || channels == 0)
+	{
+		return GA_E_INVALID_TYPE;
+	}
+
+	// The ring is limited to 2GB, and is filled a whole block at a time.
+	uint64_t ring_size = (uint64_t)block_frames * num_blocks * channels * sample_size;
+
+	if (ring_size > 0x7FFFFFFF - MA_SIMD_ALIGNMENT)
+	{
+		return GA_E_BUFFER_SIZE;
+	}
+
+	read_ahead_state* read_ahead = (read_ahead_state*)calloc(1, sizeof(read_ahead_state));
+
+	if (read_ahead == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	ma_result rb_result = ma_rb_init((size_t)ring_size, NULL, NULL, &(read_ahead->ring));
+
+	if (rb_result != MA_SUCCESS)
+	{
+		free(read_ahead);
+		return (ga_result)rb_result + MA_ERROR_OFFSET;
+	}
+
+	ma_event_init(&(read_ahead->data_ready));
+	ma_event_init(&(read_ahead->space_ready));
+	read_ahead->audio_type = audio_type;
+	read_ahead->channels = channels;
+	read_ahead->sample_rate = sample_rate;
+	if (audio_file->get_length(audio_file->decoder, &(read_ahead->num_frames)) != GA_SUCCESS)
+	{
+		read_ahead->num_frames = 0;
+	}
+	read_ahead->frame_size = channels * sample_size;
+	read_ahead->block_frames = block_frames;
+	read_ahead->running = 0;
+	read_ahead->read_offset = read_offset;
+	read_ahead->decode_offset = read_offset;
+	audio_file->read_ahead = read_ahead;
+
+	// Reads fall back to the decoder if the worker can't be started, so this isn't fatal.
+	start_read_ahead(audio_file);
+
+	return GA_SUCCESS;
+}
+
+void free_read_ahead(audio_file_codec* audio_file)
+{
+	read_ahead_state* read_ahead = audio_file->read_ahead;
+
+	if (read_ahead == NULL)
+	{
+		return;
+	}
+
+	stop_read_ahead(audio_file);
+	ma_rb_uninit(&(read_ahead->ring));
+	ma_event_uninit(&(read_ahead->data_ready));
+	ma_event_uninit(&(read_ahead->space_ready));
+	free(read_ahead);
+	audio_file->read_ahead = NULL;
+}
+
+ga_result start_read_ahead(audio_file_codec* audio_file)
+{
+	read_ahead_state* read_ahead = audio_file->read_ahead;
+	ga_result result;
+
+	if (read_ahead->running)
+	{
+		return GA_SUCCESS;
+	}
+
+	result = sync_read_ahead_decoder(audio_file);
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	c89atomic_exchange_32(&read_ahead->stop, 0);
+	c89atomic_exchange_32(&read_ahead->finished, 0);
+	c89atomic_exchange_32(&read_ahead->result, (ma_uint32)GA_SUCCESS);
+
+	if (ma_thread_create(&(read_ahead->thread), ma_thread_priority_default, 0, read_ahead_worker, audio_file, NULL) != MA_SUCCESS)
+	{
+		return GA_E_GENERIC;
+	}
+
+	read_ahead->running = 1;
+
+	return GA_SUCCESS;
+}
+
+void stop_read_ahead(audio_file_codec* audio_file)
+{
+	read_ahead_state* read_ahead = audio_file->read_ahead;
+
+	if (!read_ahead->running)
+	{
+		return;
+	}
+
+	c89atomic_exchange_32(&read_ahead->stop, 1);
+	ma_event_signal(&(read_ahead->space_ready));
+	ma_thread_wait(&(read_ahead->thread));
+#if defined(_WIN32)
+	CloseHandle((HANDLE)read_ahead->thread);
+#endif
+	read_ahead->running = 0;
+	ma_rb_reset(&(read_ahead->ring));
+}
+
+ga_result sync_read_ahead_decoder(audio_file_codec* audio_file)
+{
+	read_ahead_state* read_ahead = audio_file->read_ahead;
+	ga_result result;
+	uint64_t new_offset = 0;
+
+	if (read_ahead->decode_offset == read_ahead->read_offset)
+	{
+		return GA_SUCCESS;
+	}
+
+	result = audio_file->seek(audio_file->decoder, read_ahead->read_offset, &new_offset);
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	read_ahead->decode_offset = read_ahead->read_offset;
+
+	return GA_SUCCESS;
+}
+
+ga_result read_ahead_samples(audio_file_codec* audio_file, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer)
+{
+	read_ahead_state* read_ahead = audio_file->read_ahead;
+	ga_result result = GA_SUCCESS;
+
+	*frames_read = 0;
+
+	if (audio_type == read_ahead->audio_type && !read_ahead->running)
+	{
+		start_read_ahead(audio_file);
+	}
+
+	// Other types, or a worker that couldn't be started, are decoded on this thread from the read position.
+	// The worker is restarted by the next read of its type.
+	if (audio_type != read_ahead->audio_type || !read_ahead->running)
+	{
+		stop_read_ahead(audio_file);
+		result = sync_read_ahead_decoder(audio_file);
+
+		if (result != GA_SUCCESS)
+		{
+			return result;
+		}
+
+		result = audio_file->read(audio_file->decoder, frames_to_read, audio_type, frames_read, output_buffer, &(audio_file->scratch));
+		read_ahead->read_offset += *frames_read;
+		read_ahead->decode_offset = read_ahead->read_offset;
+
+		return result;
+	}
+
+	uint8_t* output = (uint8_t*)output_buffer;
+	size_t frame_size = read_ahead->frame_size;
+
+	while (*frames_read < frames_to_read)
+	{
+		// Check for the end of the stream before the ring, as the worker commits its last block before finishing.
+		ma_uint32 finished = c89atomic_load_32(&read_ahead->finished);
+		size_t available = ma_rb_available_read(&(read_ahead->ring));
+
+		if (available == 0)
+		{
+			if (finished)
+			{
+				result = (ga_result)c89atomic_load_32(&read_ahead->result);
+				break;
+			}
+
+			ma_event_wait(&(read_ahead->data_ready));
+			continue;
+		}
+
+		uint64_t bytes_wanted = (frames_to_read - *frames_read) * frame_size;
+		size_t size = (bytes_wanted < available ? (size_t)bytes_wanted : available);
+		void* buffer = NULL;
+
+		ma_rb_acquire_read(&(read_ahead->ring), &size, &buffer);
+		memcpy(output + (*frames_read * frame_size), buffer, size);
+		ma_rb_commit_read(&(read_ahead->ring), size);
+		ma_event_signal(&(read_ahead->space_ready));
+
+		*frames_read += size / frame_size;
+	}
+
+	read_ahead->read_offset += *frames_read;
+
+	return result;
+}
+
+ma_thread_result MA_THREADCALL read_ahead_worker(void* user_data)
+{
+	audio_file_codec* audio_file = (audio_file_codec*)user_data;
+	read_ahead_state* read_ahead = audio_file->read_ahead;
+	size_t block_size = read_ahead->block_frames * read_ahead->frame_size;
+	ga_result result = GA_SUCCESS;
+
+	while (c89atomic_load_32(&read_ahead->stop) == 0)
+	{
+		if (ma_rb_available_write(&(read_ahead->ring)) < block_size)
+		{
+			ma_event_wait(&(read_ahead->space_ready));
+			continue;
+		}
+
+		// The ring is a whole number of blocks and is only written a block at a time, so free space is always contiguous.
+		size_t size = block_size;
+		void* buffer = NULL;
+		uint64_t frames_read = 0;
+
+		ma_rb_acquire_write(&(read_ahead->ring), &size, &buffer);
+		result = audio_file->read(audio_file->decoder, read_ahead->block_frames, read_ahead->audio_type, &frames_read, buffer, &(audio_file->scratch));
+		ma_rb_commit_write(&(read_ahead->ring), (size_t)(frames_read * read_ahead->frame_size));
+		read_ahead->decode_offset += frames_read;
+
+		if (result != GA_SUCCESS || frames_read < read_ahead->block_frames)
+		{
+			break;
+		}
+
+		ma_event_signal(&(read_ahead->data_ready));
+	}
+
+	c89atomic_exchange_32(&read_ahead->result, (ma_uint32)result);
+	c89atomic_exchange_32(&read_ahead->finished, 1);
+	ma_event_signal(&(read_ahead->data_ready));
+
+	return (ma_thread_result)0;
+}
+
+
+//////////////////
+// Write-behind //
+//////////////////
+
+ga_result init_write_behind(audio_file_codec* audio_file, uint32_t channels, uint32_t bits_per_sample, uint32_t block_frames, uint32_t num_blocks)
+{
+	if (block_frames == 0)
+	{
+		block_frames = WRITE_BEHIND_DEFAULT_BLOCK_FRAMES;
+	}
+
+	if (num_blocks == 0)
+	{
+		num_blocks = WRITE_BEHIND_DEFAULT_BLOCKS;
+	}
+
+	// Frames are queued as they're passed in, so they need to be a whole number of bytes.
+	if (channels == 0 || bits_per_sample == 0 || (bits_per_sample % 8) != 0)
+	{
+		return GA_E_INVALID_TYPE;
+	}
+
+	size_t frame_size = channels * (bits_per_sample / 8);
+
+	// The ring is limited to 2GB. Its size is a whole number of frames, so the readable and writable regions always are too.
+	uint64_t ring_size = (uint64_t)block_frames * num_blocks * frame_size;
+
+	if (ring_size > 0x7FFFFFFF - MA_SIMD_ALIGNMENT)
+	{
+		return GA_E_BUFFER_SIZE;
+	}
+
+	write_behind_state* write_behind = (write_behind_state*)calloc(1, sizeof(write_behind_state));
+
+	if (write_behind == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	ma_result rb_result = ma_rb_init((size_t)ring_size, NULL, NULL, &(write_behind->ring));
+
+	if (rb_result != MA_SUCCESS)
+	{
+		free(write_behind);
+		return (ga_result)rb_result + MA_ERROR_OFFSET;
+	}
+
+	ma_event_init(&(write_behind->data_ready));
+	ma_event_init(&(write_behind->space_ready));
+	write_behind->frame_size = frame_size;
+	write_behind->block_frames = block_frames;
+	write_behind->capacity_frames = (uint64_t)block_frames * num_blocks;
+	write_behind->high_water_frames = 0;
+	c89atomic_exchange_32(&write_behind->result, (ma_uint32)GA_SUCCESS);
+	audio_file->write_behind = write_behind;
+
+	// Unlike read-ahead there's no fallback once frames are queued, so the worker has to start.
+	if (ma_thread_create(&(write_behind->thread), ma_thread_priority_default, 0, write_behind_worker, audio_file, NULL) != MA_SUCCESS)
+	{
+		audio_file->write_behind = NULL;
+		ma_rb_uninit(&(write_behind->ring));
+		ma_event_uninit(&(write_behind->data_ready));
+		ma_event_uninit(&(write_behind->space_ready));
+		free(write_behind);
+		return GA_E_GENERIC;
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result free_write_behind(audio_file_codec* audio_file)
+{
+	write_behind_state* write_behind = audio_file->write_behind;
+
+	if (write_behind == NULL)
+	{
+		return GA_SUCCESS;
+	}
+
+	// The worker writes out whatever is left in the queue before it stops.
+	c89atomic_exchange_32(&write_behind->stop, 1);
+	ma_event_signal(&(write_behind->data_ready));
+	ma_thread_wait(&(write_behind->thread));
+#if defined(_WIN32)
+	CloseHandle((HANDLE)write_behind->thread);
+#endif
+
+	ga_result result = (ga_result)c89atomic_load_32(&write_behind->result);
+
+	ma_rb_uninit(&(write_behind->ring));
+	ma_event_uninit(&(write_behind->data_ready));
+	ma_event_uninit(&(write_behind->space_ready));
+	free(write_behind);
+	audio_file->write_behind = NULL;
+
+	return result;
+}
+
+ga_result queue_write_behind(audio_file_codec* audio_file, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written)
+{
+	write_behind_state* write_behind = audio_file->write_behind;
+	ga_result result = (ga_result)c89atomic_load_32(&write_behind->result);
+
+	*frames_written = 0;
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	if (input_buffer == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	const uint8_t* input = (const uint8_t*)input_buffer;
+	size_t frame_size = write_behind->frame_size;
+
+	while (*frames_written < frames_to_write)
+	{
+		size_t available = ma_rb_available_write(&(write_behind->ring));
+
+		// The worker keeps emptying the queue after an error, discarding the frames, so there's always space to wait for.
+		if (available == 0)
+		{
+			ma_event_wait(&(write_behind->space_ready));
+			continue;
+		}
+
+		uint64_t bytes_wanted = (frames_to_write - *frames_written) * frame_size;
+		size_t size = (bytes_wanted < available ? (size_t)bytes_wanted : available);
+		void* buffer = NULL;
+
+		// The writable region may wrap around the end of the ring, in which case it's filled over two passes.
+		ma_rb_acquire_write(&(write_behind->ring), &size, &buffer);
+		memcpy(buffer, input + (*frames_written * frame_size), size);
+		ma_rb_commit_write(&(write_behind->ring), size);
+		ma_event_signal(&(write_behind->data_ready));
+
+		*frames_written += size / frame_size;
+
+		uint64_t queued_frames = ma_rb_available_read(&(write_behind->ring)) / frame_size;
+
+		if (queued_frames > write_behind->high_water_frames)
+		{
+			write_behind->high_water_frames = queued_frames;
+		}
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result flush_write_behind(audio_file_codec* audio_file)
+{
+	write_behind_state* write_behind = audio_file->write_behind;
+
+	c89atomic_exchange_32(&write_behind->flush, 1);
+	ma_event_signal(&(write_behind->data_ready));
+
+	while (ma_rb_available_read(&(write_behind->ring)) > 0)
+	{
+		ma_event_wait(&(write_behind->space_ready));
+	}
+
+	c89atomic_exchange_32(&write_behind->flush, 0);
+
+	return (ga_result)c89atomic_load_32(&write_behind->result);
+}
+
+ma_thread_result MA_THREADCALL write_behind_worker(void* user_data)
+{
+	audio_file_codec* audio_file = (audio_file_codec*)user_data;
+	write_behind_state* write_behind = audio_file->write_behind;
+	size_t block_size = write_behind->block_frames * write_behind->frame_size;
+	ga_result result = GA_SUCCESS;
+
+	while (1)
+	{
+		ma_uint32 stop = c89atomic_load_32(&write_behind->stop);
+		size_t available = ma_rb_available_read(&(write_behind->ring));
+
+		if (available == 0)
+		{
+			if (stop)
+			{
+				break;
+			}
+
+			ma_event_wait(&(write_behind->data_ready));
+			continue;
+		}
+
+		// Coalesce small writes into blocks, unless the queue is being emptied.
+		if (available < block_size && !stop && !c89atomic_load_32(&write_behind->flush))
+		{
+			ma_event_wait(&(write_behind->data_ready));
+			continue;
+		}
+
+		size_t size = available;
+		void* buffer = NULL;
+		uint64_t frames_written = 0;
+
+		ma_rb_acquire_read(&(write_behind->ring), &size, &buffer);
+
+		if (result == GA_SUCCESS)
+		{
+			uint64_t frames = size / write_behind->frame_size;
+			result = audio_file->write(audio_file->encoder, frames, buffer, &frames_written);
+
+			if (result == GA_SUCCESS && frames_written < frames)
+			{
+				result = GA_E_FILE;
+			}
+
+			if (result != GA_SUCCESS)
+			{
+				c89atomic_exchange_32(&write_behind->result, (ma_uint32)result);
+			}
+		}
+
+		ma_rb_commit_read(&(write_behind->ring), size);
+		ma_event_signal(&(write_behind->space_ready));
+	}
+
+	return (ma_thread_result)0;
+}
+
+
+/////////////////////
+// Library scanner //
+/////////////////////
+
+ga_result scan_library_file(ga_io* io, uint8_t read_tags, uint8_t exact, library_scan_file* file)
+{
+	library_scan_entry* entry = &(file->entry);
+	ga_codec codec = ga_codec_unsupported;
+	uint8_t is_exact = 1;
+	ga_result result;
+
+	memset(entry, 0, sizeof(library_scan_entry));
+	entry->codec = ga_codec_unsupported;
+	entry->is_exact = 1;
+	file->tags = NULL;
+	file->tag_count = 0;
+	// Set even if the tags can't be read, as the result is the same until the file changes.
+	file->tags_read = read_tags;
+
+	if (io == NULL)
+	{
+		entry->result = GA_E_FILE;
+		return entry->result;
+	}
+
+	result = get_io_codec(io, &codec);
+	entry->codec = codec;
+
+	if (result == GA_SUCCESS)
+	{
+		result = get_codec_file_info(io, codec, exact, &(entry->num_frames), &(entry->channels), &(entry->sample_rate), &(entry->bits_per_sample), &is_exact);
+		entry->is_exact = is_exact;
+	}
+
+	if (result == GA_SUCCESS && read_tags)
+	{
+		intptr_t tags = 0;
+		intptr_t pictures = 0;
+		int32_t tag_count = 0;
+		int32_t picture_count = 0;
+
+		result = get_codec_file_tags(io, codec, ga_picture_none, 0, &tags, &tag_count, &pictures, &picture_count);
+
+		if (result == GA_SUCCESS)
+		{
+			file->tags = (audio_file_tag*)tags;
+			file->tag_count = tag_count;
+		}
+	}
+
+	entry->result = result;
+
+	return result;
+}
+
+ga_result scan_next_library_file(library_scan* scan, uint32_t index)
+{
+	library_scan_file* file = &(scan->files[index]);
+	const char* file_name = scan->file_names[index];
+	ga_result result;
+	ga_io io;
+
+	if (file_name == NULL)
+	{
+		return scan_library_file(NULL, scan->read_tags, scan->exact, file);
+	}
+
+	result = ga_io_open(file_name, &io);
+
+	if (result != GA_SUCCESS)
+	{
+		scan_library_file(NULL, scan->read_tags, scan->exact, file);
+		file->entry.result = result;
+		return result;
+	}
+
+	// The stamp is from opening the file, before it's scanned, so a change made during the scan is picked up by the next one.
+	if (scan->index_name != NULL && ga_io_get_file_stamp(&io, &(file->file_size), &(file->modified_time), &(file->file_id)) == GA_SUCCESS)
+	{
+		file->has_stamp = 1;
+
+		if (find_library_index_file(&(scan->index), file_name, file->file_size, file->modified_time, file->file_id, scan->read_tags, scan->exact, file) == GA_SUCCESS)
+		{
+			ga_io_close(&io);
+			return file->entry.result;
+		}
+
+		c89atomic_fetch_add_32(&scan->index_misses, 1);
+	}
+
+	result = scan_library_file(&io, scan->read_tags, scan->exact, file);
+	ga_io_close(&io);
+
+	return result;
+}
+
+void join_library_scan(library_scan* scan)
+{
+	if (scan->joined)
+	{
+		return;
+	}
+
+	for (uint32_t i = 0; i < scan->thread_count; i++)
+	{
+		ma_thread_wait(&(scan->threads[i]));
+#if defined(_WIN32)
+		CloseHandle((HANDLE)scan->threads[i]);
+#endif
+	}
+
+	free(scan->threads);
+	scan->threads = NULL;
+	scan->thread_count = 0;
+	scan->joined = 1;
+}
+
+ga_result flatten_library_scan(library_scan* scan)
+{
+	uint64_t tag_count = 0;
+	uint64_t strings_size = 0;
+
+	for (int32_t i = 0; i < scan->num_files; i++)
+	{
+		library_scan_file* file = &(scan->files[i]);
+
+		tag_count += file->tag_count;
+
+		for (int32_t t = 0; t < file->tag_count; t++)
+		{
+			strings_size += (uint64_t)file->tags[t].field_length + 1;
+			strings_size += (uint64_t)file->tags[t].value_length + 1;
+		}
+	}
+
+	// Offsets in the results are 32-bit to match the LabVIEW clusters.
+	if (tag_count > INT32_MAX || strings_size > INT32_MAX)
+	{
+		return GA_E_MEMORY;
+	}
+
+	size_t tags_offset = scan->num_files * sizeof(library_scan_entry);
+	size_t strings_offset = tags_offset + (size_t)tag_count * sizeof(library_scan_tag);
+	uint8_t* results = (uint8_t*)malloc(strings_offset + (size_t)strings_size + 1);
+
+	if (results == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	library_scan_entry* entries = (library_scan_entry*)results;
+	library_scan_tag* tags = (library_scan_tag*)(results + tags_offset);
+	char* strings = (char*)(results + strings_offset);
+	int32_t tag_index = 0;
+	int32_t string_offset = 0;
+
+	for (int32_t i = 0; i < scan->num_files; i++)
+	{
+		library_scan_file* file = &(scan->files[i]);
+
+		entries[i] = file->entry;
+		entries[i].tag_index = tag_index;
+		entries[i].tag_count = file->tag_count;
+
+		for (int32_t t = 0; t < file->tag_count; t++)
+		{
+			audio_file_tag* tag = &(file->tags[t]);
+
+			tags[tag_index].field_offset = string_offset;
+			tags[tag_index].field_length = tag->field_length;
+			memcpy(strings + string_offset, tag->field, tag->field_length);
+			string_offset += tag->field_length;
+			strings[string_offset++] = '\0';
+
+			tags[tag_index].value_offset = string_offset;
+			tags[tag_index].value_length = tag->value_length;
+			memcpy(strings + string_offset, tag->value, tag->value_length);
+			string_offset += tag->value_length;
+			strings[string_offset++] = '\0';
+
+			tag_index++;
+		}
+
+		// The tags are only needed in the flattened form from here on.
+		free_audio_file_tags((intptr_t)file->tags, file->tag_count, 0, 0);
+		file->tags = NULL;
+	}
+
+	scan->results = results;
+	scan->tag_count = (int32_t)tag_count;
+	scan->strings_size = (int32_t)strings_size;
+
+	return GA_SUCCESS;
+}
+
+void free_library_scan(library_scan* scan)
+{
+	thread_mutex_lock(&(scan->mutex));
+	c89atomic_exchange_32(&scan->cancelled, 1);
+	join_library_scan(scan);
+
+	for (int32_t i = 0; i < scan->num_files; i++)
+	{
+		if (scan->file_names != NULL)
+		{
+			free(scan->file_names[i]);
+		}
+
+		if (scan->files != NULL)
+		{
+			free_audio_file_tags((intptr_t)scan->files[i].tags, scan->files[i].tag_count, 0, 0);
+		}
+	}
+
+	close_library_index(&(scan->index));
+	free(scan->index_name);
+	free(scan->file_names);
+	free(scan->files);
+	free(scan->results);
+	thread_mutex_unlock(&(scan->mutex));
+	thread_mutex_term(&(scan->mutex));
+	free(scan);
+}
+
+ma_thread_result MA_THREADCALL library_scan_worker(void* user_data)
+{
+	library_scan* scan = (library_scan*)user_data;
+	uint32_t index;
+
+	while (c89atomic_load_32(&scan->cancelled) == 0 && (index = c89atomic_fetch_add_32(&scan->next_file, 1)) < (uint32_t)scan->num_files)
+	{
+		scan_next_library_file(scan, index);
+
+		c89atomic_fetch_add_32(&scan->files_scanned, 1);
+	}
+
+	c89atomic_fetch_sub_32(&scan->workers_running, 1);
+
+	return (ma_thread_result)0;
+}
+
+// Index layout, all values little endian:
+// magic (4) | version (4) | record count (4) | bucket count (4) | tag count (4) | reserved (4) | strings size (8)
+// buckets: record number + 1 of each slot, or 0 if empty (4 each)
+// records: path offset (8) | file size (8) | modification time (8) | frames (8) | tag index (4) | tag count (4) | path length (4) | channels (4)
+//          sample rate (4) | bits per sample (4) | result (4) | codec (1) | flags (1) | reserved (2) | file ID (8)
+// tags: string offset (8) | field length (4) | value length (4), where the field and value are NULL terminated and stored one after the other
+// strings: paths, fields and values
+ga_result open_library_index(const char* file_name, library_index* index)
+{
+	memset(index, 0, sizeof(library_index));
+
+	if (ga_map_file(file_name, &(index->map)) != GA_SUCCESS)
+	{
+		return GA_E_FILE;
+	}
+
+	const uint8_t* data = index->map.data;
+	size_t size = index->map.size;
+
+	if (size < LIBRARY_INDEX_HEADER_SIZE || memcmp(data, LIBRARY_INDEX_MAGIC, 4) != 0 || data[4] != LIBRARY_INDEX_VERSION || data[5] != 0 || data[6] != 0 || data[7] != 0)
+	{
+		close_library_index(index);
+		return GA_E_FILE;
+	}
+
+	index->record_count = read_u32_le(data + 8);
+	index->bucket_count = read_u32_le(data + 12);
+	index->tag_count = read_u32_le(data + 16);
+	index->strings_size = read_u64_le(data + 24);
+
+	// The bucket count is a power of two, with at least one empty slot to end a search.
+	uint64_t buckets_size = 4 * (uint64_t)index->bucket_count;
+	uint64_t records_size = LIBRARY_INDEX_RECORD_SIZE * (uint64_t)index->record_count;
+	uint64_t tags_size = LIBRARY_INDEX_TAG_SIZE * (uint64_t)index->tag_count;
+
+	if (index->bucket_count == 0 || (index->bucket_count & (index->bucket_count - 1)) != 0 || index->bucket_count <= index->record_count
+		|| index->strings_size > size || LIBRARY_INDEX_HEADER_SIZE + buckets_size + records_size + tags_size + index->strings_size != size)
+	{
+		close_library_index(index);
+		return GA_E_FILE;
+	}
+
+	index->buckets = data + LIBRARY_INDEX_HEADER_SIZE;
+	index->records = index->buckets + buckets_size;
+	index->tags = index->records + records_size;
+	index->strings = (const char*)(index->tags + tags_size);
+
+	return GA_SUCCESS;
+}
+
+void close_library_index(library_index* index)
+{
+	ga_unmap_file(&(index->map));
+	memset(index, 0, sizeof(library_index));
+}
+
+ga_result find_library_index_file(const library_index* index, const char* file_name, uint64_t file_size, int64_t modified_time, uint64_t file_id, uint8_t read_tags, uint8_t exact, library_scan_file* file)
+{
+	if (index->bucket_count == 0)
+	{
+		return GA_E_FILE;
+	}
+
+	size_t length = strlen(file_name);
+	uint64_t hash = hash_library_index_path(file_name, length);
+	uint32_t mask = index->bucket_count - 1;
+	const uint8_t* record = NULL;
+
+	for (uint32_t probe = 0; probe < index->bucket_count; probe++)
+	{
+		uint32_t slot = read_u32_le(index->buckets + 4 * (size_t)((hash + probe) & mask));
+
+		if (slot == 0 || slot > index->record_count)
+		{
+			return GA_E_FILE;
+		}
+
+		const uint8_t* candidate = index->records + (size_t)(slot - 1) * LIBRARY_INDEX_RECORD_SIZE;
+		uint64_t path_offset = read_u64_le(candidate);
+
+		if (read_u32_le(candidate + 40) == length && path_offset <= index->strings_size && index->strings_size - path_offset >= length
+			&& memcmp(index->strings + path_offset, file_name, length) == 0)
+		{
+			record = candidate;
+			break;
+		}
+	}
+
+	if (record == NULL || read_u64_le(record + 8) != file_size || (int64_t)read_u64_le(record + 16) != modified_time || read_u64_le(record + 64) != file_id)
+	{
+		return GA_E_FILE;
+	}
+
+	uint8_t flags = record[61];
+	uint32_t tag_index = read_u32_le(record + 32);
+	uint32_t tag_count = read_u32_le(record + 36);
+
+	// Flag bit 0 is set when the tags were read, and bit 1 when the length is exact.
+	if ((read_tags && !(flags & 0x01)) || (exact && !(flags & 0x02)) || tag_index > index->tag_count || tag_count > index->tag_count - tag_index)
+	{
+		return GA_E_FILE;
+	}
+
+	audio_file_tag* tags = NULL;
+
+	if (read_tags && tag_count > 0)
+	{
+		tags = (audio_file_tag*)malloc(tag_count * sizeof(audio_file_tag));
+
+		if (tags == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+
+		for (uint32_t i = 0; i < tag_count; i++)
+		{
+			const uint8_t* tag = index->tags + (size_t)(tag_index + i) * LIBRARY_INDEX_TAG_SIZE;
+			uint64_t string_offset = read_u64_le(tag);
+			uint32_t field_length = read_u32_le(tag + 8);
+			uint32_t value_length = read_u32_le(tag + 12);
+
+			if (field_length > INT32_MAX || value_length > INT32_MAX || string_offset > index->strings_size
+				|| index->strings_size - string_offset < (uint64_t)field_length + value_length + 2)
+			{
+				free(tags);
+				return GA_E_FILE;
+			}
+
+			tags[i].field = (char*)(index->strings + string_offset);
+			tags[i].value = tags[i].field + field_length + 1;
+			tags[i].field_length = (int32_t)field_length;
+			tags[i].value_length = (int32_t)value_length;
+		}
+	}
+
+	memset(&(file->entry), 0, sizeof(library_scan_entry));
+	file->entry.num_frames = read_u64_le(record + 24);
+	file->entry.channels = read_u32_le(record + 44);
+	file->entry.sample_rate = read_u32_le(record + 48);
+	file->entry.bits_per_sample = read_u32_le(record + 52);
+	file->entry.result = (ga_result)read_u32_le(record + 56);
+	file->entry.codec = (ga_codec)record[60];
+	file->entry.is_exact = (flags & 0x02) ? 1 : 0;
+	file->tags = tags;
+	file->tag_count = (tags != NULL ? (int32_t)tag_count : 0);
+	file->tags_read = read_tags;
+
+	return GA_SUCCESS;
+}
+
+ga_result write_library_index(library_scan* scan)
+{
+	const library_scan_entry* entries = (const library_scan_entry*)scan->results;
+	const library_scan_tag* tags = (const library_scan_tag*)(scan->results + scan->num_files * sizeof(library_scan_entry));
+	const char* strings = (const char*)tags + scan->tag_count * sizeof(library_scan_tag);
+	uint64_t record_count = 0;
+	uint64_t bucket_count = 16;
+
+	// Results which could change without the file changing aren't kept.
+	for (int32_t i = 0; i < scan->num_files; i++)
+	{
+		ga_result result = entries[i].result;
+		record_count += (scan->files[i].has_stamp && result != GA_E_CANCELLED && result != GA_E_FILE && result != GA_E_MEMORY);
+	}
+
+	if (c89atomic_load_32(&scan->cancelled) != 0 || (c89atomic_load_32(&scan->index_misses) == 0 && record_count == scan->index.record_count))
+	{
+		close_library_index(&(scan->index));
+		return GA_SUCCESS;
+	}
+
+	// The old index has to be unmapped before it can be replaced.
+	close_library_index(&(scan->index));
+
+	// Keep the table at most half full, so searches stay short.
+	while (bucket_count < 2 * record_count)
+	{
+		bucket_count *= 2;
+	}
+
+	if (bucket_count > UINT32_MAX)
+	{
+		return GA_E_MEMORY;
+	}
+
+	tag_buffer buckets = {};
+	tag_buffer records = {};
+	tag_buffer tag_records = {};
+	tag_buffer index_strings = {};
+	uint32_t record_index = 0;
+	uint32_t tag_index = 0;
+	ga_result result = append_tag_buffer(&buckets, NULL, 4 * (size_t)bucket_count);
+
+	for (int32_t i = 0; i < scan->num_files && result == GA_SUCCESS; i++)
+	{
+		const library_scan_entry* entry = &(entries[i]);
+		const library_scan_file* file = &(scan->files[i]);
+		const char* file_name = scan->file_names[i];
+
+		if (!file->has_stamp || entry->result == GA_E_CANCELLED || entry->result == GA_E_FILE || entry->result == GA_E_MEMORY)
+		{
+			continue;
+		}
+
+		size_t length = strlen(file_name);
+		uint8_t record[LIBRARY_INDEX_RECORD_SIZE] = {};
+
+		write_u64_le(record, index_strings.size);
+		write_u64_le(record + 8, file->file_size);
+		write_u64_le(record + 16, (uint64_t)file->modified_time);
+		write_u64_le(record + 24, entry->num_frames);
+		write_u32_le(record + 32, tag_index);
+		write_u32_le(record + 36, (uint32_t)entry->tag_count);
+		write_u32_le(record + 40, (uint32_t)length);
+		write_u32_le(record + 44, entry->channels);
+		write_u32_le(record + 48, entry->sample_rate);
+		write_u32_le(record + 52, entry->bits_per_sample);
+		write_u32_le(record + 56, (uint32_t)entry->result);
+		record[60] = (uint8_t)entry->codec;
+		record[61] = (file->tags_read ? 0x01 : 0) | (entry->is_exact ? 0x02 : 0);
+		write_u64_le(record + 64, file->file_id);
+
+		result = append_tag_buffer(&records, record, LIBRARY_INDEX_RECORD_SIZE);
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&index_strings, file_name, length + 1);
+		}
+
+		for (int32_t t = 0; t < entry->tag_count && result == GA_SUCCESS; t++)
+		{
+			const library_scan_tag* tag = &(tags[entry->tag_index + t]);
+			uint8_t tag_record[LIBRARY_INDEX_TAG_SIZE];
+
+			write_u64_le(tag_record, index_strings.size);
+			write_u32_le(tag_record + 8, (uint32_t)tag->field_length);
+			write_u32_le(tag_record + 12, (uint32_t)tag->value_length);
+
+			result = append_tag_buffer(&tag_records, tag_record, LIBRARY_INDEX_TAG_SIZE);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(&index_strings, strings + tag->field_offset, (size_t)tag->field_length + 1);
+			}
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(&index_strings, strings + tag->value_offset, (size_t)tag->value_length + 1);
+			}
+		}
+
+		tag_index += entry->tag_count;
+
+		// Linear probing from the path's hash.
+		uint64_t slot = hash_library_index_path(file_name, length) & (bucket_count - 1);
+
+		while (read_u32_le(buckets.data + 4 * slot) != 0)
+		{
+			slot = (slot + 1) & (bucket_count - 1);
+		}
+
+		write_u32_le(buckets.data + 4 * slot, ++record_index);
+	}
+
+	FILE* pFile = NULL;
+	char* temp_name = NULL;
+	uint8_t header[LIBRARY_INDEX_HEADER_SIZE] = {};
+
+	memcpy(header, LIBRARY_INDEX_MAGIC, 4);
+	header[4] = LIBRARY_INDEX_VERSION;
+	write_u32_le(header + 8, record_index);
+	write_u32_le(header + 12, (uint32_t)bucket_count);
+	write_u32_le(header + 16, tag_index);
+	write_u64_le(header + 24, index_strings.size);
+
+	if (result == GA_SUCCESS && (pFile = open_rewrite_file(scan->index_name, &temp_name)) == NULL)
+	{
+		result = GA_E_FILE;
+	}
+
+	if (pFile != NULL)
+	{
+		if (fwrite(header, 1, LIBRARY_INDEX_HEADER_SIZE, pFile) != LIBRARY_INDEX_HEADER_SIZE
+			|| fwrite(buckets.data, 1, buckets.size, pFile) != buckets.size
+			|| fwrite(records.data, 1, records.size, pFile) != records.size
+			|| fwrite(tag_records.data, 1, tag_records.size, pFile) != tag_records.size
+			|| fwrite(index_strings.data, 1, index_strings.size, pFile) != index_strings.size)
+		{
+			result = GA_E_FILE;
+		}
+
+		result = finish_rewrite_file(pFile, temp_name, scan->index_name, result);
+	}
+
+	free(temp_name);
+	free_tag_buffer(&buckets);
+	free_tag_buffer(&records);
+	free_tag_buffer(&tag_records);
+	free_tag_buffer(&index_strings);
+
+	return result;
+}
+
+uint64_t hash_library_index_path(const char* file_name, size_t length)
+{
+	uint64_t hash = 14695981039346656037ULL;
+
+	for (size_t i = 0; i < length; i++)
+	{
+		hash = (hash ^ (uint8_t)file_name[i]) * 1099511628211ULL;
+	}
+
+	return hash;
+}
+
+
+////////////////
+// Tag writer //
+////////////////
+
+ga_result append_tag_buffer(tag_buffer* buffer, const void* data, size_t size)
+{
+	if (size > buffer->capacity - buffer->size)
+	{
+		size_t capacity = (buffer->capacity > 0 ? buffer->capacity : 1024);
+
+		while (size > capacity - buffer->size)
+		{
+			if (capacity > SIZE_MAX / 2)
+			{
+				return GA_E_MEMORY;
+			}
+			capacity *= 2;
+		}
+
+		uint8_t* new_data = (uint8_t*)realloc(buffer->data, capacity);
+
+		if (new_data == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+
+		buffer->data = new_data;
+		buffer->capacity = capacity;
+	}
+
+	if (data != NULL)
+	{
+		memcpy(buffer->data + buffer->size, data, size);
+	}
+	else
+	{
+		memset(buffer->data + buffer->size, 0, size);
+	}
+
+	buffer->size += size;
+
+	return GA_SUCCESS;
+}
+
+void free_tag_buffer(tag_buffer* buffer)
+{
+	free(buffer->data);
+	memset(buffer, 0, sizeof(tag_buffer));
+}
+
+ga_result check_tag_fields(const char** fields, const char** values, int32_t tag_count)
+{
+	for (int32_t i = 0; i < tag_count; i++)
+	{
+		if (fields[i] == NULL || values[i] == NULL || fields[i][0] == '\0')
+		{
+			return GA_E_GENERIC;
+		}
+
+		for (const char* c = fields[i]; *c != '\0'; c++)
+		{
+			if (*c < 0x20 || *c > 0x7D || *c == '=')
+			{
+				return GA_E_GENERIC;
+			}
+		}
+	}
+
+	return GA_SUCCESS;
+}
+
+uint8_t tag_field_equals(const char* field, const char* name)
+{
+	for (; *field != '\0' && *name != '\0'; field++, name++)
+	{
+		char a = (*field >= 'a' && *field <= 'z') ? *field - 'a' + 'A' : *field;
+		char b = (*name >= 'a' && *name <= 'z') ? *name - 'a' + 'A' : *name;
+
+		if (a != b)
+		{
+			return 0;
+		}
+	}
+
+	return (*field == *name);
+}
+
+const char* find_tag_value(const char** fields, const char** values, int32_t tag_count, const char* name)
+{
+	for (int32_t i = 0; i < tag_count; i++)
+	{
+		if (tag_field_equals(fields[i], name))
+		{
+			return values[i];
+		}
+	}
+
+	return NULL;
+}
+
+ga_result build_vorbis_comment(const uint8_t* old_comment, size_t old_size, const char** fields, const char** values, int32_t tag_count, tag_buffer* comment)
+{
+	const char* default_vendor = "G-Audio";
+	const uint8_t* vendor = (const uint8_t*)default_vendor;
+	uint32_t vendor_length = (uint32_t)strlen(default_vendor);
+	const uint8_t* old_comments = NULL;
+	uint32_t old_count = 0;
+	size_t old_remaining = 0;
+	uint32_t picture_count = 0;
+	uint8_t length_data[4];
+	ga_result result;
+
+	// Keep the vendor string and pictures of the old block, as long as it can be parsed.
+	if (old_comment != NULL && old_size >= 8 && read_u32_le(old_comment) <= old_size - 8)
+	{
+		vendor_length = read_u32_le(old_comment);
+		vendor = old_comment + 4;
+		old_remaining = old_size - 8 - vendor_length;
+		old_count = read_u32_le(old_comment + 4 + vendor_length);
+		old_comments = old_comment + 8 + vendor_length;
+	}
+
+	// First pass counts the pictures, second writes them.
+	for (int pass = 0; pass < 2; pass++)
+	{
+		const uint8_t* entry = old_comments;
+		size_t remaining = old_remaining;
+
+		if (pass == 1)
+		{
+			write_u32_le(length_data, vendor_length);
+			result = append_tag_buffer(comment, length_data, 4);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(comment, vendor, vendor_length);
+			}
+			write_u32_le(length_data, picture_count + (uint32_t)tag_count);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(comment, length_data, 4);
+			}
+
+			for (int32_t i = 0; i < tag_count && result == GA_SUCCESS; i++)
+			{
+				size_t field_length = strlen(fields[i]);
+				size_t value_length = strlen(values[i]);
+
+				if (field_length + value_length + 1 > UINT32_MAX)
+				{
+					return GA_E_TAG;
+				}
+
+				write_u32_le(length_data, (uint32_t)(field_length + value_length + 1));
+				result = append_tag_buffer(comment, length_data, 4);
+				if (result == GA_SUCCESS)
+				{
+					result = append_tag_buffer(comment, fields[i], field_length);
+				}
+				if (result == GA_SUCCESS)
+				{
+					result = append_tag_buffer(comment, "=", 1);
+				}
+				if (result == GA_SUCCESS)
+				{
+					result = append_tag_buffer(comment, values[i], value_length);
+				}
+			}
+
+			if (result != GA_SUCCESS)
+			{
+				return result;
+			}
+		}
+
+		for (uint32_t i = 0; i < old_count && remaining >= 4; i++)
+		{
+			uint32_t length = read_u32_le(entry);
+
+			if (length > remaining - 4)
+			{
+				break;
+			}
+
+			const char* picture_field = "METADATA_BLOCK_PICTURE=";
+			size_t picture_field_length = strlen(picture_field);
+			uint8_t is_picture = (length >= picture_field_length);
+
+			for (size_t c = 0; c < picture_field_length && is_picture; c++)
+			{
+				char a = (char)entry[4 + c];
+				is_picture = ((a >= 'a' && a <= 'z' ? a - 'a' + 'A' : a) == picture_field[c]);
+			}
+
+			if (is_picture)
+			{
+				if (pass == 0)
+				{
+					picture_count++;
+				}
+				else if ((result = append_tag_buffer(comment, entry, 4 + (size_t)length)) != GA_SUCCESS)
+				{
+					return result;
+				}
+			}
+
+			entry += 4 + (size_t)length;
+			remaining -= 4 + (size_t)length;
+		}
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result copy_file_data(FILE* input, FILE* output, uint64_t size)
+{
+	const size_t buffer_size = 1 << 20;
+	uint8_t* buffer = (uint8_t*)malloc(buffer_size);
+
+	if (buffer == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	while (size > 0)
+	{
+		size_t bytes_read = fread(buffer, 1, (size < buffer_size ? (size_t)size : buffer_size), input);
+
+		if (bytes_read == 0)
+		{
+			break;
+		}
+
+		if (fwrite(buffer, 1, bytes_read, output) != bytes_read)
+		{
+			free(buffer);
+			return GA_E_FILE;
+		}
+
+		if (size != UINT64_MAX)
+		{
+			size -= bytes_read;
+		}
+	}
+
+	free(buffer);
+
+	return ((size == 0 || size == UINT64_MAX) && !ferror(input) ? GA_SUCCESS : GA_E_FILE);
+}
+
+FILE* open_rewrite_file(const char* file_name, char** temp_name)
+{
+	const char* suffix = ".gatmp";
+	size_t length = strlen(file_name);
+
+	*temp_name = (char*)malloc(length + strlen(suffix) + 1);
+
+	if (*temp_name == NULL)
+	{
+		return NULL;
+	}
+
+	memcpy(*temp_name, file_name, length);
+	strcpy(*temp_name + length, suffix);
+
+	return ga_fopen_write(*temp_name);
+}
+
+ga_result finish_rewrite_file(FILE* pFile, const char* temp_name, const char* file_name, ga_result result)
+{
+	if (fclose(pFile) != 0 && result == GA_SUCCESS)
+	{
+		result = GA_E_FILE;
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		result = ga_replace_file(temp_name, file_name);
+	}
+
+	if (result != GA_SUCCESS)
+	{
+		ga_delete_file(temp_name);
+	}
+
+	return result;
+}
+
+
+///////////////////////////
+// FLAC decoding wrapper //
+///////////////////////////
+
+inline ga_result convert_flac_result(int32_t result)
+{
+	switch (result)
+	{
+	case DRFLAC_SUCCESS:
+		return GA_SUCCESS; break;
+	default:
+		return GA_E_GENERIC; break;
+	}
+
+	return GA_E_GENERIC;
+}
+
+ga_result get_flac_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
+{
+	drflac* pFlac = NULL;
+
+	if (io->data != NULL)
+	{
+		pFlac = drflac_open_memory(io->data, io->size, NULL);
+	}
+	else
+	{
+#if defined(_WIN32)
+		wchar_t* wide_file_name = widen(io->file_name);
+		pFlac = drflac_open_file_w(wide_file_name, NULL);
+		free(wide_file_name);
+#else
+		pFlac = drflac_open_file(io->file_name, NULL);
+#endif
+	}
+
+	if (pFlac == NULL)
+	{
+		return GA_E_DECODER;
+	}
+
+	*num_frames = pFlac->totalPCMFrameCount;
+	*channels = pFlac->channels;
+	*sample_rate = pFlac->sampleRate;
+	*bits_per_sample = pFlac->bitsPerSample;
+
+	drflac_close(pFlac);
+
+	return GA_SUCCESS;
+}
+
+int16_t* load_flac(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
+{
+	drflac_uint64 flac_num_frames = 0;
+	drflac_uint32 flac_channels = 0;
+	drflac_uint32 flac_sample_rate = 0;
+	int16_t* sample_data = NULL;
+	uint64_t info_num_frames = 0;
+	uint32_t info_channels = 0;
+	uint32_t info_sample_rate = 0;
+	uint32_t info_bits_per_sample = 0;
+	ga_io io;
+
+	// Decode in parallel when the stream info gives the total frame count, otherwise fall back to a single decoder.
+	if (ga_io_open(file_name, &io) == GA_SUCCESS)
+	{
+		if (get_flac_info(&io, &info_num_frames, &info_channels, &info_sample_rate, &info_bits_per_sample) == GA_SUCCESS && info_num_frames > 0 && info_channels > 0)
+		{
+			sample_data = (int16_t*)malloc(info_num_frames * info_channels * sizeof(int16_t));
+			if (sample_data != NULL && decode_flac_parallel(&io, 0, info_num_frames, info_channels, ga_data_type_i16, sample_data) == GA_SUCCESS)
+			{
+				ga_io_close(&io);
+				*num_frames = info_num_frames;
+				*channels = info_channels;
+				*sample_rate = info_sample_rate;
+				*result = GA_SUCCESS;
+
+				return sample_data;
+			}
+
+			free(sample_data);
+			sample_data = NULL;
+		}
+
+		ga_io_close(&io);
+	}
+
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	sample_data = drflac_open_file_and_read_pcm_frames_s16_w(wide_file_name, &flac_channels, &flac_sample_rate, &flac_num_frames, NULL);
+	free(wide_file_name);
+#else
+	sample_data = drflac_open_file_and_read_pcm_frames_s16(file_name, &flac_channels, &flac_sample_rate, &flac_num_frames, NULL);
+#endif
+
+	if (sample_data == NULL)
+	{
+		// Failed to open and decode FLAC file.
+		*result = GA_E_GENERIC;
+		return NULL;
+	}
+
+	*num_frames = flac_num_frames;
+	*channels = flac_channels;
+	*sample_rate = flac_sample_rate;
+	*result = GA_SUCCESS;
+
+	return sample_data;
+}
+
+void free_flac(int16_t* sample_data)
+{
+	drflac_free(sample_data, NULL);
+}
+
+ga_result open_flac_file(ga_io* io, void** decoder)
+{
+	flac_decoder* decoder_data = (flac_decoder*)malloc(sizeof(flac_decoder));
+
+	if (decoder_data == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	decoder_data->io = io;
+
+	if (io->data != NULL)
+	{
+		decoder_data->flac = drflac_open_memory(io->data, io->size, NULL);
+	}
+	else
+	{
+#if defined(_WIN32)
+		wchar_t* wide_file_name = widen(io->file_name);
+		decoder_data->flac = drflac_open_file_w(wide_file_name, NULL);
+		free(wide_file_name);
+#else
+		decoder_data->flac = drflac_open_file(io->file_name, NULL);
+#endif
+	}
+
+	if (decoder_data->flac == NULL)
+	{
+		free(decoder_data);
+		return GA_E_GENERIC;
+	}
+
+	*decoder = (void*)decoder_data;
+
+	return GA_SUCCESS;
+}
+
+ga_result get_basic_flac_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	drflac* flac = ((flac_decoder*)decoder)->flac;
+
+	*channels = flac->channels;
+	*sample_rate = flac->sampleRate;
+	*read_offset = flac->currentPCMFrame;
+
+	return GA_SUCCESS;
+}
+
+ga_result get_flac_file_length(void* decoder, uint64_t* num_frames)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	// Zero if the stream info doesn't record the total frame count.
+	*num_frames = ((flac_decoder*)decoder)->flac->totalPCMFrameCount;
+
+	return GA_SUCCESS;
+}
+
+ga_result seek_flac_file(void* decoder, uint64_t offset, uint64_t* new_offset)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	if (drflac_seek_to_pcm_frame(((flac_decoder*)decoder)->flac, offset) == DRFLAC_FALSE)
+	{
+		return GA_E_DECODER;
+	}
+	
+	*new_offset = offset;
+
+	return GA_SUCCESS;
+}
+
+ga_result read_flac_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	if (output_buffer == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	drflac* flac = ((flac_decoder*)decoder)->flac;
+	void* temp_buffer = NULL;
+
+	// Large reads of a stream with a known length are split across worker threads, then the decoder is moved past the decoded range.
+	if (frames_to_read >= FLAC_PARALLEL_MIN_READ && flac->totalPCMFrameCount > flac->currentPCMFrame && get_data_type_size(audio_type) > 0)
+	{
+		uint64_t start_frame = flac->currentPCMFrame;
+		uint64_t frames_available = flac->totalPCMFrameCount - start_frame;
+		uint64_t frames_to_decode = (frames_to_read < frames_available ? frames_to_read : frames_available);
+
+		if (decode_flac_parallel(((flac_decoder*)decoder)->io, start_frame, frames_to_decode, flac->channels, audio_type, output_buffer) == GA_SUCCESS)
+		{
+			// drflac can't seek to the end of the stream, so seek to the last frame and consume it instead.
+			if (start_frame + frames_to_decode < flac->totalPCMFrameCount)
+			{
+				if (drflac_seek_to_pcm_frame(flac, start_frame + frames_to_decode) == DRFLAC_FALSE)
+				{
+					return GA_E_DECODER;
+				}
+			}
+			else
+			{
+				drflac_seek_to_pcm_frame(flac, flac->totalPCMFrameCount - 1);
+				drflac_read_pcm_frames_s32(flac, 1, NULL);
+			}
+
+			*frames_read = frames_to_decode;
+			return GA_SUCCESS;
+		}
+
+		// Fall back to a sequential read from the original position.
+		if (flac->currentPCMFrame != start_frame && drflac_seek_to_pcm_frame(flac, start_frame) == DRFLAC_FALSE)
+		{
+			return GA_E_DECODER;
+		}
+	}
+
+	switch (audio_type)
+	{
+	case ga_data_type_u8:
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * flac->channels * sizeof(drflac_int16));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = drflac_read_pcm_frames_s16(flac, frames_to_read, (drflac_int16*)temp_buffer);
+		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, *frames_read * flac->channels);
+		break;
+	case ga_data_type_i16:
+		*frames_read = drflac_read_pcm_frames_s16(flac, frames_to_read, (drflac_int16*)output_buffer);
+		break;
+	case ga_data_type_i32:
+		*frames_read = drflac_read_pcm_frames_s32(flac, frames_to_read, (drflac_int32*)output_buffer);
+		break;
+	case ga_data_type_float:
+		*frames_read = drflac_read_pcm_frames_f32(flac, frames_to_read, (float*)output_buffer);
+		break;
+	case ga_data_type_double:
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * flac->channels * sizeof(drflac_int32));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = drflac_read_pcm_frames_s32(flac, frames_to_read, (drflac_int32*)temp_buffer);
+		s32_to_f64((double*)output_buffer, (int32_t*)temp_buffer, *frames_read * flac->channels);
+		break;
+	default:
+		return GA_E_INVALID_TYPE;
+		break;
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result close_flac_file(void* decoder)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	drflac_close(((flac_decoder*)decoder)->flac);
+	free(decoder);
+
+	return GA_SUCCESS;
+}
+
+ga_result open_flac_file_write(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, void* codec_specific, void** encoder)
+{
+	flac_specific settings = { FLAC_ENCODER_DEFAULT_LEVEL, 0, 0 };
+	uint8_t streaminfo[FLAC_STREAMINFO_SIZE];
+
+	if (codec_specific != NULL)
+	{
+		settings = *((flac_specific*)codec_specific);
+	}
+
+	flac_encoder* flac = (flac_encoder*)calloc(1, sizeof(flac_encoder));
+
+	if (flac == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	if (!flac_encoder_config_init(&(flac->config), channels, sample_rate, bits_per_sample, settings.compression_level, settings.block_size))
+	{
+		free(flac);
+		return GA_E_GENERIC;
+	}
+
+	flac->worker_count = get_worker_count();
+	if (settings.max_threads > 0 && flac->worker_count > settings.max_threads)
+	{
+		flac->worker_count = settings.max_threads;
+	}
+
+	// A couple of blocks per worker evens out the load when some blocks are slower to encode.
+	flac->batch_blocks = flac->worker_count * 2;
+	flac->max_frame_size = flac_max_frame_size(&(flac->config));
+	flac->samples = (int32_t*)malloc((size_t)flac->batch_blocks * flac->config.block_size * channels * sizeof(int32_t));
+	flac->frames = (uint8_t*)malloc(flac->batch_blocks * flac->max_frame_size);
+	flac->frame_sizes = (size_t*)malloc(flac->batch_blocks * sizeof(size_t));
+	flac->workspaces = (flac_frame_workspace**)calloc(flac->worker_count, sizeof(flac_frame_workspace*));
+	flac->result = GA_SUCCESS;
+	flac_md5_init(&(flac->md5));
+
+	if (flac->samples == NULL || flac->frames == NULL || flac->frame_sizes == NULL || flac->workspaces == NULL)
+	{
+		free_flac_encoder(flac);
+		return GA_E_MEMORY;
+	}
+
+	for (uint32_t i = 0; i < flac->worker_count; i++)
+	{
+		flac->workspaces[i] = flac_create_workspace(&(flac->config));
+
+		if (flac->workspaces[i] == NULL)
+		{
+			free_flac_encoder(flac);
+			return GA_E_MEMORY;
+		}
+	}
+
+	flac->file = ga_fopen_write(file_name);
+
+	if (flac->file == NULL)
+	{
+		free_flac_encoder(flac);
+		return GA_E_FILE;
+	}
+
+	// Reserve space for STREAMINFO, which is filled in on close.
+	flac_write_streaminfo(&(flac->config), 0, 0, 0, NULL, streaminfo);
+
+	if (fwrite(streaminfo, 1, FLAC_STREAMINFO_SIZE, flac->file) != FLAC_STREAMINFO_SIZE)
+	{
+		fclose(flac->file);
+		flac->file = NULL;
+		free_flac_encoder(flac);
+		return GA_E_FILE;
+	}
+
+	*encoder = (void*)flac;
+
+	return GA_SUCCESS;
+}
+
+ga_result write_flac_file(void* encoder, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written)
+{
+	if (encoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	if (input_buffer == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	flac_encoder* flac = (flac_encoder*)encoder;
+	uint32_t channels = flac->config.channels;
+	uint32_t bytes_per_sample = flac->config.bits_per_sample / 8;
+	uint64_t batch_frames = (uint64_t)flac->batch_blocks * flac->config.block_size;
+	const uint8_t* input = (const uint8_t*)input_buffer;
+
+	*frames_written = 0;
+
+	if (flac->result != GA_SUCCESS)
+	{
+		return flac->result;
+	}
+
+	while (*frames_written < frames_to_write)
+	{
+		uint64_t frames = frames_to_write - *frames_written;
+		size_t num_samples;
+		int32_t* samples = flac->samples + (flac->buffered_frames * channels);
+
+		if (frames > batch_frames - flac->buffered_frames)
+		{
+			frames = batch_frames - flac->buffered_frames;
+		}
+
+		num_samples = (size_t)(frames * channels);
+
+		switch (flac->config.bits_per_sample)
+		{
+			case 8:
+				// Unsigned in WAV, signed in FLAC and its MD5.
+				for (size_t i = 0; i < num_samples; i++)
+				{
+					samples[i] = (int32_t)input[i] - 128;
+				}
+				for (size_t i = 0; i < num_samples; )
+				{
+					uint8_t signed_bytes[1024];
+					size_t count = (num_samples - i < sizeof(signed_bytes) ? num_samples - i : sizeof(signed_bytes));
+
+					for (size_t j = 0; j < count; j++)
+					{
+						signed_bytes[j] = input[i + j] ^ 0x80;
+					}
+					flac_md5_update(&(flac->md5), signed_bytes, count);
+					i += count;
+				}
+				break;
+			case 16:
+				for (size_t i = 0; i < num_samples; i++)
+				{
+					samples[i] = ((const int16_t*)input)[i];
+				}
+				flac_md5_update(&(flac->md5), input, num_samples * 2);
+				break;
+			case 24:
+				for (size_t i = 0; i < num_samples; i++)
+				{
+					const uint8_t* sample = input + (i * 3);
+					samples[i] = (int32_t)(((uint32_t)sample[0] << 8) | ((uint32_t)sample[1] << 16) | ((uint32_t)sample[2] << 24)) >> 8;
+				}
+				flac_md5_update(&(flac->md5), input, num_samples * 3);
+				break;
+			default:
+				return GA_E_INVALID_TYPE;
+		}
+
+		input += num_samples * bytes_per_sample;
+		flac->buffered_frames += frames;
+		*frames_written += frames;
+
+		if (flac->buffered_frames == batch_frames)
+		{
+			flac->result = encode_flac_batch(flac);
+
+			if (flac->result != GA_SUCCESS)
+			{
+				return flac->result;
+			}
+		}
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result close_flac_file_write(void* encoder)
+{
+	ga_result result;
+	uint8_t md5[16];
+	uint8_t streaminfo[FLAC_STREAMINFO_SIZE];
+
+	if (encoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	flac_encoder* flac = (flac_encoder*)encoder;
+
+	if (flac->result == GA_SUCCESS && flac->buffered_frames > 0)
+	{
+		flac->result = encode_flac_batch(flac);
+	}
+
+	result = flac->result;
+
+	if (result == GA_SUCCESS)
+	{
+		flac_md5_final(&(flac->md5), md5);
+		flac_write_streaminfo(&(flac->config), flac->min_written_size, flac->max_written_size, flac->total_frames, md5, streaminfo);
+
+		if (fseek(flac->file, 0, SEEK_SET) != 0 || fwrite(streaminfo, 1, FLAC_STREAMINFO_SIZE, flac->file) != FLAC_STREAMINFO_SIZE)
+		{
+			result = GA_E_FILE;
+		}
+	}
+
+	if (fclose(flac->file) != 0 && result == GA_SUCCESS)
+	{
+		result = GA_E_FILE;
+	}
+
+	flac->file = NULL;
+	free_flac_encoder(flac);
+
+	return result;
+}
+
+void free_flac_encoder(flac_encoder* encoder)
+{
+	if (encoder->workspaces != NULL)
+	{
+		for (uint32_t i = 0; i < encoder->worker_count; i++)
+		{
+			flac_free_workspace(encoder->workspaces[i]);
+		}
+	}
+
+	free(encoder->workspaces);
+	free(encoder->samples);
+	free(encoder->frames);
+	free(encoder->frame_sizes);
+	free(encoder);
+}
+
+ga_result encode_flac_batch(flac_encoder* encoder)
+{
+	flac_encode_job job;
+	uint32_t block_size = encoder->config.block_size;
+	uint32_t worker_count = encoder->worker_count;
+
+	job.encoder = encoder;
+	job.num_frames = encoder->buffered_frames;
+	job.num_blocks = (uint32_t)((encoder->buffered_frames + block_size - 1) / block_size);
+	job.next_block = 0;
+	job.next_worker = 0;
+	job.failed = 0;
+
+	if (worker_count > job.num_blocks)
+	{
+		worker_count = job.num_blocks;
+	}
+
+	// The calling thread acts as one of the workers.
+	ma_thread* threads = NULL;
+	uint32_t thread_count = 0;
+
+	if (worker_count > 1)
+	{
+		threads = (ma_thread*)malloc((worker_count - 1) * sizeof(ma_thread));
+	}
+
+	if (threads != NULL)
+	{
+		for (uint32_t i = 0; i < worker_count - 1; i++)
+		{
+			if (ma_thread_create(&threads[thread_count], ma_thread_priority_default, 0, flac_encode_worker, &job, NULL) == MA_SUCCESS)
+			{
+				thread_count++;
+			}
+		}
+	}
+
+	flac_encode_worker(&job);
+
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		ma_thread_wait(&threads[i]);
+#if defined(_WIN32)
+		CloseHandle((HANDLE)threads[i]);
+#endif
+	}
+
+	free(threads);
+
+	if (job.failed != 0)
+	{
+		return GA_E_DECODER;
+	}
+
+	for (uint32_t block = 0; block < job.num_blocks; block++)
+	{
+		size_t size = encoder->frame_sizes[block];
+
+		if (fwrite(encoder->frames + (block * encoder->max_frame_size), 1, size, encoder->file) != size)
+		{
+			return GA_E_FILE;
+		}
+
+		if (encoder->min_written_size == 0 || size < encoder->min_written_size)
+		{
+			encoder->min_written_size = (uint32_t)size;
+		}
+		if (size > encoder->max_written_size)
+		{
+			encoder->max_written_size = (uint32_t)size;
+		}
+	}
+
+	encoder->frame_number += job.num_blocks;
+	encoder->total_frames += encoder->buffered_frames;
+	encoder->buffered_frames = 0;
+
+	return GA_SUCCESS;
+}
+
+ma_thread_result MA_THREADCALL flac_encode_worker(void* user_data)
+{
+	flac_encode_job* job = (flac_encode_job*)user_data;
+	flac_encoder* encoder = job->encoder;
+	uint32_t block_size = encoder->config.block_size;
+	uint32_t channels = encoder->config.channels;
+	flac_frame_workspace* workspace = encoder->workspaces[c89atomic_fetch_add_32(&job->next_worker, 1)];
+	uint32_t block;
+
+	while (job->failed == 0 && (block = c89atomic_fetch_add_32(&job->next_block, 1)) < job->num_blocks)
+	{
+		uint64_t start = (uint64_t)block * block_size;
+		uint32_t num_frames = (uint32_t)(job->num_frames - start < block_size ? job->num_frames - start : block_size);
+
+		encoder->frame_sizes[block] = flac_encode_frame(&(encoder->config), workspace, encoder->samples + (start * channels), num_frames, encoder->frame_number + block, encoder->frames + (block * encoder->max_frame_size));
+
+		if (encoder->frame_sizes[block] == 0)
+		{
+			c89atomic_exchange_32(&job->failed, 1);
+		}
+	}
+
+	return (ma_thread_result)0;
+}
+
+ga_result decode_flac_parallel(ga_io* io, uint64_t start_frame, uint64_t num_frames, uint32_t channels, ga_data_type audio_type, void* output_buffer)
+{
+	flac_parallel_job job;
+	uint32_t worker_count = get_worker_count();
+
+	if (io == NULL || output_buffer == NULL || channels == 0)
+	{
+		return GA_E_GENERIC;
+	}
+
+	job.io = io;
+	job.start_frame = start_frame;
+	job.num_frames = num_frames;
+	job.channels = channels;
+	job.audio_type = audio_type;
+	job.sample_size = get_data_type_size(audio_type);
+	job.output_buffer = (uint8_t*)output_buffer;
+	job.next_range = 0;
+	job.failed = 0;
+
+	if (job.sample_size == 0)
+	{
+		return GA_E_INVALID_TYPE;
+	}
+
+	if (num_frames == 0)
+	{
+		return GA_SUCCESS;
+	}
+
+	// A few ranges per worker evens out the load when some parts of the stream are slower to decode.
+	job.range_frames = num_frames / ((uint64_t)worker_count * 4);
+	if (job.range_frames < FLAC_PARALLEL_MIN_RANGE)
+	{
+		job.range_frames = FLAC_PARALLEL_MIN_RANGE;
+	}
+	job.num_ranges = (uint32_t)((num_frames + job.range_frames - 1) / job.range_frames);
+
+	if (worker_count > job.num_ranges)
+	{
+		worker_count = job.num_ranges;
+	}
+
+	// The calling thread acts as one of the workers.
+	ma_thread* threads = NULL;
+	uint32_t thread_count = 0;
+
+	if (worker_count > 1)
+	{
+		threads = (ma_thread*)malloc((worker_count - 1) * sizeof(ma_thread));
+	}
+
+	if (threads != NULL)
+	{
+		for (uint32_t i = 0; i < worker_count - 1; i++)
+		{
+			if (ma_thread_create(&threads[thread_count], ma_thread_priority_default, 0, flac_parallel_worker, &job, NULL) == MA_SUCCESS)
+			{
+				thread_count++;
+			}
+		}
+	}
+
+	flac_parallel_worker(&job);
+
+	for (uint32_t i = 0; i < thread_count; i++)
+	{
+		ma_thread_wait(&threads[i]);
+#if defined(_WIN32)
+		CloseHandle((HANDLE)threads[i]);
+#endif
+	}
+
+	free(threads);
+
+	return (job.failed == 0 ? GA_SUCCESS : GA_E_DECODER);
+}
+
+ma_thread_result MA_THREADCALL flac_parallel_worker(void* user_data)
+{
+	// Decode in blocks so types converted through the scratch buffer keep it small.
+	const uint64_t block_frames = 65536;
+	flac_parallel_job* job = (flac_parallel_job*)user_data;
+	void* decoder = NULL;
+	ga_scratch_buffer scratch = { NULL, 0 };
+	uint32_t range;
+
+	if (open_flac_file(job->io, &decoder) != GA_SUCCESS)
+	{
+		c89atomic_exchange_32(&job->failed, 1);
+		return (ma_thread_result)0;
+	}
+
+	while (job->failed == 0 && (range = c89atomic_fetch_add_32(&job->next_range, 1)) < job->num_ranges)
+	{
+		uint64_t range_start = (uint64_t)range * job->range_frames;
+		uint64_t range_end = range_start + job->range_frames;
+		uint64_t new_offset;
+
+		if (range_end > job->num_frames)
+		{
+			range_end = job->num_frames;
+		}
+
+		if (seek_flac_file(decoder, job->start_frame + range_start, &new_offset) != GA_SUCCESS)
+		{
+			c89atomic_exchange_32(&job->failed, 1);
+			break;
+		}
+
+		for (uint64_t offset = range_start; offset < range_end; )
+		{
+			uint64_t frames_to_read = (range_end - offset < block_frames ? range_end - offset : block_frames);
+			uint64_t frames_read = 0;
+
+			if (read_flac_file(decoder, frames_to_read, job->audio_type, &frames_read, job->output_buffer + (offset * job->channels * job->sample_size), &scratch) != GA_SUCCESS || frames_read != frames_to_read)
+			{
+				// The stream is shorter than its stream info claims, or failed to decode.
+				c89atomic_exchange_32(&job->failed, 1);
+				break;
+			}
+
+			offset += frames_read;
+		}
+	}
+
+	close_flac_file(decoder);
+	free_scratch_buffer(&scratch);
+
+	return (ma_thread_result)0;
+}
+
+uint32_t get_worker_count()
+{
+	long count = 1;
+
+#if defined(_WIN32)
+	SYSTEM_INFO system_info;
+	GetSystemInfo(&system_info);
+	count = (long)system_info.dwNumberOfProcessors;
+#else
+	count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+	if (thread_worker_budget > 0 && (uint32_t)count > thread_worker_budget)
+	{
+		count = (long)thread_worker_budget;
+	}
+
+	return (count > 1 ? (uint32_t)count : 1);
+}
+
+void flac_metadata_callback(void* pUserData, drflac_metadata* meta)
+{
+	if (pUserData == NULL)
+	{
+		return;
+	}
+
+	audio_file_tag_info* tag_info = (audio_file_tag_info*)pUserData;
+
+	if (tag_info->result != GA_SUCCESS)
+	{
+		return;
+	}
+
+	switch (meta->type)
+	{
+		case DRFLAC_METADATA_BLOCK_TYPE_VORBIS_COMMENT:
+		{
+			drflac_vorbis_comment_iterator iterator;
+			const char* comment;
+			uint32_t length;
+			int32_t token_offset;
+			int32_t field_length;
+			int32_t value_length;
+
+			drflac_init_vorbis_comment_iterator(&iterator, meta->data.vorbis_comment.commentCount, meta->data.vorbis_comment.pComments);
+			while ((comment = drflac_next_vorbis_comment(&iterator, &length)) != NULL)
+			{
+				token_offset = ga_find_token(comment, '=');
+
+				if (token_offset > 0 && (uint32_t)token_offset <= length)
+				{
+					value_length = length - token_offset;
+					field_length = length - value_length - 1;
+
+					tag_info->result = add_audio_file_tag(tag_info, comment, field_length, comment + token_offset, value_length);
+
+					if (tag_info->result != GA_SUCCESS)
+					{
+						return;
+					}
+				}
+			}
+			break;
+		}
+		case DRFLAC_METADATA_BLOCK_TYPE_PICTURE:
+		{
+			if (tag_info->picture_mode != ga_picture_none)
+			{
+				tag_info->result = add_audio_file_picture(tag_info, meta->data.picture.pPictureData, meta->data.picture.pictureDataSize, meta->data.picture.type);
+			}
+			break;
+		}
+		default: break;
+	}
+}
+
+ga_result get_flac_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+{
+	drflac* decoder = NULL;
+	audio_file_tag_info* tag_info = (audio_file_tag_info*)malloc(sizeof(audio_file_tag_info));
+
+	if (tag_info == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+	memset(tag_info, 0, sizeof(audio_file_tag_info));
+	tag_info->picture_mode = picture_mode;
+	tag_info->thumbnail_size = thumbnail_size;
+
+	if (io->data != NULL)
+	{
+		decoder = drflac_open_memory_with_metadata(io->data, io->size, flac_metadata_callback, tag_info, NULL);
+	}
+	else
+	{
+#if defined(_WIN32)
+		wchar_t* wide_file_name = widen(io->file_name);
+		decoder = drflac_open_file_with_metadata_w(wide_file_name, flac_metadata_callback, tag_info, NULL);
+		free(wide_file_name);
+#else
+		decoder = drflac_open_file_with_metadata(io->file_name, flac_metadata_callback, tag_info, NULL);
+#endif
+	}
+
+	if (decoder == NULL)
+	{
+		free_audio_file_tag_info(tag_info);
+		free(tag_info);
+		return GA_E_TAG;
+	}
+
+	drflac_close(decoder);
+
+	ga_result result = tag_info->result;
+
+	if (result == GA_SUCCESS)
+	{
+		result = pack_audio_file_tags(tag_info, tags, tag_count, pictures, picture_count);
+	}
+	else
+	{
+		free_audio_file_tag_info(tag_info);
+	}
+
+	free(tag_info);
+
+	return result;
+}
+
+
+void set_flac_block_header(uint8_t* header, uint8_t type, uint8_t last, uint32_t size)
+{
+	header[0] = (last ? 0x80 : 0) | type;
+	header[1] = (uint8_t)(size >> 16);
+	header[2] = (uint8_t)(size >> 8);
+	header[3] = (uint8_t)size;
+}
+
+ga_result set_flac_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten)
+{
+	typedef struct
+	{
+		uint64_t offset;	// Offset of the block header
+		uint32_t size;		// Size of the block data
+		uint8_t type;
+	} flac_block;
+
+	const uint8_t block_padding = 1;
+	const uint8_t block_vorbis_comment = 4;
+	flac_block blocks[256];
+	uint32_t block_count = 0;
+	int32_t comment_index = -1;
+	uint8_t* old_comment = NULL;
+	uint64_t audio_offset = 4;
+	uint8_t header[4];
+	tag_buffer comment = {};
+	ga_result result;
+	FILE* pFile;
+
+	pFile = ga_fopen(file_name);
+
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	if (fread(header, 1, 4, pFile) != 4 || memcmp(header, "fLaC", 4) != 0)
+	{
+		fclose(pFile);
+		return GA_E_DECODER;
+	}
+
+	// Walk the metadata blocks, keeping the old comment block for its vendor string and any pictures in it.
+	for (;;)
+	{
+		if (block_count == sizeof(blocks) / sizeof(blocks[0]) || fread(header, 1, 4, pFile) != 4 || (header[0] & 0x7F) == 127)
+		{
+			free(old_comment);
+			fclose(pFile);
+			return GA_E_DECODER;
+		}
+
+		flac_block* block = &blocks[block_count++];
+		block->offset = audio_offset;
+		block->type = header[0] & 0x7F;
+		block->size = ((uint32_t)header[1] << 16) | ((uint32_t)header[2] << 8) | header[3];
+		audio_offset += 4 + (uint64_t)block->size;
+
+		if (block->type == block_vorbis_comment && comment_index < 0)
+		{
+			comment_index = block_count - 1;
+			old_comment = (uint8_t*)malloc(block->size + 1);
+
+			if (old_comment == NULL || fread(old_comment, 1, block->size, pFile) != block->size)
+			{
+				free(old_comment);
+				fclose(pFile);
+				return (old_comment == NULL ? GA_E_MEMORY : GA_E_DECODER);
+			}
+		}
+		else if (ga_fseek(pFile, block->size, SEEK_CUR) != 0)
+		{
+			free(old_comment);
+			fclose(pFile);
+			return GA_E_DECODER;
+		}
+
+		if (header[0] & 0x80)
+		{
+			break;
+		}
+	}
+
+	fclose(pFile);
+
+	// STREAMINFO must come first.
+	if (blocks[0].type != 0)
+	{
+		free(old_comment);
+		return GA_E_DECODER;
+	}
+
+	result = build_vorbis_comment(old_comment, (comment_index >= 0 ? blocks[comment_index].size : 0), fields, values, tag_count, &comment);
+	free(old_comment);
+
+	if (result == GA_SUCCESS && comment.size > 0xFFFFFF)
+	{
+		result = GA_E_TAG;
+	}
+
+	if (result != GA_SUCCESS)
+	{
+		free_tag_buffer(&comment);
+		return result;
+	}
+
+	// The old comment block and padding blocks are free space. Runs of them next to each other are merged into holes, and the comment is written
+	// into the hole holding the old comment if it fits, otherwise the first hole it fits. Any space left in the hole becomes a padding block.
+	uint64_t comment_block_size = 4 + (uint64_t)comment.size;
+	uint64_t target_start = 0, target_end = 0;
+	uint64_t old_start = 0, old_end = 0;
+
+	for (uint32_t i = 1; i < block_count; i++)
+	{
+		if (blocks[i].type != block_padding && (int32_t)i != comment_index)
+		{
+			continue;
+		}
+
+		uint64_t hole_start = blocks[i].offset;
+		uint8_t has_comment = 0;
+
+		for (; i < block_count && (blocks[i].type == block_padding || (int32_t)i == comment_index); i++)
+		{
+			has_comment |= ((int32_t)i == comment_index);
+		}
+
+		uint64_t hole_end = (i < block_count ? blocks[i].offset : audio_offset);
+		uint64_t hole_size = hole_end - hole_start;
+		uint8_t fits = (hole_size == comment_block_size || (hole_size >= comment_block_size + 4 && hole_size - comment_block_size - 4 <= 0xFFFFFF));
+
+		if (has_comment)
+		{
+			old_start = hole_start;
+			old_end = hole_end;
+		}
+
+		if (fits && (has_comment || target_end == 0))
+		{
+			target_start = hole_start;
+			target_end = hole_end;
+		}
+	}
+
+	// A block's size is 24 bits, so a large old hole can't always be turned into a single padding block.
+	if (old_end != 0 && old_start != target_start && old_end - old_start - 4 > 0xFFFFFF)
+	{
+		target_end = 0;
+	}
+
+	if (target_end != 0)
+	{
+		tag_buffer hole = {};
+
+		pFile = ga_fopen_update(file_name);
+
+		if (pFile == NULL)
+		{
+			free_tag_buffer(&comment);
+			return GA_E_FILE;
+		}
+
+		// Comment block, then padding for the rest of the hole. The last block before the audio is flagged as such.
+		set_flac_block_header(header, block_vorbis_comment, (target_end == audio_offset && target_end - target_start == comment_block_size), (uint32_t)comment.size);
+		result = append_tag_buffer(&hole, header, 4);
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&hole, comment.data, comment.size);
+		}
+
+		if (result == GA_SUCCESS && target_end - target_start > comment_block_size)
+		{
+			uint64_t padding_size = target_end - target_start - comment_block_size - 4;
+			set_flac_block_header(header, block_padding, (target_end == audio_offset), (uint32_t)padding_size);
+			result = append_tag_buffer(&hole, header, 4);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(&hole, NULL, (size_t)padding_size);
+			}
+		}
+
+		if (result == GA_SUCCESS && (ga_fseek(pFile, target_start, SEEK_SET) != 0 || fwrite(hole.data, 1, hole.size, pFile) != hole.size))
+		{
+			result = GA_E_FILE;
+		}
+
+		// If the comment moved to another hole, its old hole becomes padding.
+		if (result == GA_SUCCESS && old_end != 0 && old_start != target_start)
+		{
+			uint64_t padding_size = old_end - old_start - 4;
+			hole.size = 0;
+			set_flac_block_header(header, block_padding, (old_end == audio_offset), (uint32_t)padding_size);
+			result = append_tag_buffer(&hole, header, 4);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(&hole, NULL, (size_t)padding_size);
+			}
+
+			if (result == GA_SUCCESS && (ga_fseek(pFile, old_start, SEEK_SET) != 0 || fwrite(hole.data, 1, hole.size, pFile) != hole.size))
+			{
+				result = GA_E_FILE;
+			}
+		}
+
+		if (fclose(pFile) != 0 && result == GA_SUCCESS)
+		{
+			result = GA_E_FILE;
+		}
+
+		free_tag_buffer(&hole);
+		free_tag_buffer(&comment);
+		return result;
+	}
+
+	// No room, so rewrite the file with the other blocks in their old order, the comment in place of the old one (or after STREAMINFO), and padding last.
+	tag_buffer head = {};
+	FILE* pOutput;
+	char* temp_name = NULL;
+
+	pFile = ga_fopen(file_name);
+
+	if (pFile == NULL)
+	{
+		free_tag_buffer(&comment);
+		return GA_E_FILE;
+	}
+
+	result = append_tag_buffer(&head, "fLaC", 4);
+
+	for (uint32_t i = 0; i < block_count && result == GA_SUCCESS; i++)
+	{
+		if (blocks[i].type == block_padding)
+		{
+			continue;
+		}
+
+		if ((int32_t)i != comment_index)
+		{
+			size_t block_start = head.size;
+			result = append_tag_buffer(&head, NULL, 4 + (size_t)blocks[i].size);
+
+			if (result == GA_SUCCESS && (ga_fseek(pFile, blocks[i].offset, SEEK_SET) != 0 || fread(head.data + block_start, 1, 4 + (size_t)blocks[i].size, pFile) != 4 + (size_t)blocks[i].size))
+			{
+				result = GA_E_DECODER;
+			}
+
+			if (result == GA_SUCCESS)
+			{
+				head.data[block_start] &= 0x7F;
+			}
+		}
+
+		if (result == GA_SUCCESS && ((int32_t)i == comment_index || (i == 0 && comment_index < 0)))
+		{
+			set_flac_block_header(header, block_vorbis_comment, 0, (uint32_t)comment.size);
+			result = append_tag_buffer(&head, header, 4);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(&head, comment.data, comment.size);
+			}
+		}
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		set_flac_block_header(header, block_padding, 1, TAG_PADDING_SIZE);
+		result = append_tag_buffer(&head, header, 4);
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&head, NULL, TAG_PADDING_SIZE);
+		}
+	}
+
+	free_tag_buffer(&comment);
+
+	if (result != GA_SUCCESS)
+	{
+		free_tag_buffer(&head);
+		fclose(pFile);
+		return result;
+	}
+
+	pOutput = open_rewrite_file(file_name, &temp_name);
+
+	if (pOutput == NULL)
+	{
+		free(temp_name);
+		free_tag_buffer(&head);
+		fclose(pFile);
+		return GA_E_FILE;
+	}
+
+	if (fwrite(head.data, 1, head.size, pOutput) != head.size || ga_fseek(pFile, audio_offset, SEEK_SET) != 0)
+	{
+		result = GA_E_FILE;
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		result = copy_file_data(pFile, pOutput, UINT64_MAX);
+	}
+
+	fclose(pFile);
+	result = finish_rewrite_file(pOutput, temp_name, file_name, result);
+	free(temp_name);
+	free_tag_buffer(&head);
+
+	if (result == GA_SUCCESS)
+	{
+		*rewritten = 1;
+	}
+
+	return result;
+}
+
+
+//////////////////////////
+// MP3 decoding wrapper //
+//////////////////////////
+
+inline ga_result convert_mp3_result(int32_t result)
+{
+	switch (result)
+	{
+	case 0:
+		return GA_SUCCESS; break;
+	case MP3D_E_PARAM:
+		return GA_E_DECODER; break;
+	case MP3D_E_MEMORY:
+		return GA_E_MEMORY; break;
+	case MP3D_E_IOERROR:
+		return GA_E_FILE; break;
+	case MP3D_E_USER:
+		return GA_E_GENERIC; break;
+	case MP3D_E_DECODE:
+		return GA_E_DECODER; break;
+	default:
+		return GA_E_GENERIC; break;
+	}
+
+	return GA_E_GENERIC;
+}
+
+ga_result get_mp3_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
+{
+	ga_result result = GA_SUCCESS;
+	mp3dec_t mp3d;
+	mp3dec_file_info_t info;
+
+	if (io->data != NULL)
+	{
+		result = convert_mp3_result(mp3dec_load_buf_no_decode(&mp3d, io->data, io->size, &info, NULL, NULL));
+	}
+	else
+	{
+#if defined(_WIN32)
+		wchar_t* wide_file_name = widen(io->file_name);
+		result = convert_mp3_result(mp3dec_load_w_no_decode(&mp3d, wide_file_name, &info, NULL, NULL));
+		free(wide_file_name);
+#else
+		result = convert_mp3_result(mp3dec_load_no_decode(&mp3d, io->file_name, &info, NULL, NULL));
+#endif
+	}
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+	else if (info.channels <= 0)
+	{
+		return GA_E_DECODER;
+	}
+
+	*num_frames = info.samples / info.channels;
+	*channels = info.channels;
+	*sample_rate = info.hz;
+	// Lossy codecs don't have a true "bits per sample", it's all floating point math. Report minimp3's 16-bit integer output.
+	*bits_per_sample = 16;
+
+	free(info.buffer);
+
+	return result;
+}
+
+ga_result get_mp3_header_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, uint8_t* is_exact)
+{
+	ga_result result;
+
+	// Only the start and end of the file are touched, so mapping avoids reading the whole file.
+	if (io->data == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	result = parse_mp3_header_info(io->data, io->size, num_frames, channels, sample_rate, is_exact);
+
+	// Lossy codecs don't have a true "bits per sample", it's all floating point math. Report minimp3's 16-bit integer output.
+	*bits_per_sample = 16;
+
+	return result;
+}
+
+ga_result parse_mp3_header_info(const uint8_t* data, size_t size, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint8_t* is_exact)
+{
+	const uint8_t* buf = data;
+	size_t buf_size = size;
+	int free_format_bytes = 0;
+	int frame_size = 0;
+	uint32_t frames = 0;
+	int delay = 0;
+	int padding = 0;
+
+	// Skip ID3v2, ID3v1 and APEv2 tags, and find the first frame the same way the decoder does.
+	mp3dec_skip_id3(&buf, &buf_size);
+
+	int offset = mp3d_find_frame(buf, (int)MINIMP3_MIN(buf_size, (size_t)INT_MAX), &free_format_bytes, &frame_size);
+
+	if (!frame_size)
+	{
+		return GA_E_DECODER;
+	}
+
+	const uint8_t* hdr = buf + offset;
+	size_t stream_size = buf_size - offset;
+	uint32_t frame_channels = HDR_IS_MONO(hdr) ? 1 : 2;
+	uint64_t frame_samples = hdr_frame_samples(hdr);
+
+	*channels = frame_channels;
+	*sample_rate = hdr_sample_rate_hz(hdr);
+
+	// Xing / Info header, with the encoder delay and padding from the LAME extension.
+	// The decoder trims the same delay and padding, so the length matches a full decode.
+	if (HDR_GET_LAYER(hdr) == 1)
+	{
+		int vbr_tag = mp3dec_check_vbrtag(hdr, frame_size, &frames, &delay, &padding);
+
+		if (vbr_tag > 0)
+		{
+			uint64_t samples = frame_samples * frames * frame_channels;
+
+			if (samples >= (uint64_t)delay * frame_channels)
+			{
+				samples -= (uint64_t)delay * frame_channels;
+			}
+			if (padding > 0 && samples >= (uint64_t)padding * frame_channels)
+			{
+				samples -= (uint64_t)padding * frame_channels;
+			}
+
+			if (samples == 0)
+			{
+				return GA_E_DECODER;
+			}
+
+			*num_frames = samples / frame_channels;
+			*is_exact = 1;
+
+			// A truncated file holds fewer frames than the header claims. The tag's byte count is checked against the file to catch this.
+			const uint8_t* tag = hdr + HDR_SIZE + (HDR_IS_CRC(hdr) ? 2 : 0) + (HDR_TEST_MPEG1(hdr) ? (frame_channels == 1 ? 17 : 32) : (frame_channels == 1 ? 9 : 17));
+			if (tag + 16 <= hdr + frame_size && (tag[7] & 2))
+			{
+				uint64_t tag_bytes = ((uint64_t)tag[12] << 24) | ((uint64_t)tag[13] << 16) | ((uint64_t)tag[14] << 8) | tag[15];
+				uint64_t file_bytes = size - (hdr - data);
+
+				if (tag_bytes > file_bytes)
+				{
+					*num_frames = *num_frames * file_bytes / tag_bytes;
+					*is_exact = 0;
+				}
+			}
+
+			return GA_SUCCESS;
+		}
+		else if (vbr_tag < 0)
+		{
+			// Xing header without a frame count.
+			return GA_E_DECODER;
+		}
+	}
+
+	// VBRI header, written by the Fraunhofer encoder 32 bytes after the frame header.
+	// The decoder doesn't recognise it and outputs the header frame as silence, so it's included in the count.
+	if (frame_size >= HDR_SIZE + 32 + 18 && !memcmp(hdr + HDR_SIZE + 32, "VBRI", 4))
+	{
+		const uint8_t* tag = hdr + HDR_SIZE + 32;
+		frames = ((uint32_t)tag[14] << 24) | ((uint32_t)tag[15] << 16) | ((uint32_t)tag[16] << 8) | tag[17];
+
+		if (frames == 0)
+		{
+			return GA_E_DECODER;
+		}
+
+		*num_frames = frame_samples * ((uint64_t)frames + 1);
+		*is_exact = 0;
+
+		return GA_SUCCESS;
+	}
+
+	// No header, so estimate from the bitrate if the first few frames suggest the file is CBR.
+	unsigned bitrate_kbps = hdr_bitrate_kbps(hdr);
+	const uint8_t* next = hdr;
+
+	if (bitrate_kbps == 0 || HDR_IS_FREE_FORMAT(hdr))
+	{
+		return GA_E_DECODER;
+	}
+
+	for (int i = 0; i < 8; i++)
+	{
+		int next_size = hdr_frame_bytes(next, 0) + hdr_padding(next);
+		next += next_size;
+
+		if (next_size <= 0 || next + HDR_SIZE > buf + buf_size)
+		{
+			break;
+		}
+
+		if (!hdr_compare(hdr, next) || hdr_bitrate_kbps(next) != bitrate_kbps)
+		{
+			return GA_E_DECODER;
+		}
+	}
+
+	*num_frames = (uint64_t)stream_size * 8 * (*sample_rate) / ((uint64_t)bitrate_kbps * 1000);
+	*is_exact = 0;
+
+	return GA_SUCCESS;
+}
+
+int16_t* load_mp3(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
+{
+	mp3dec_t mp3d;
+	mp3dec_file_info_t info;
+
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	*result = convert_mp3_result(mp3dec_load_w(&mp3d, wide_file_name, &info, NULL, NULL));
+	free(wide_file_name);
+#else
+	*result = convert_mp3_result(mp3dec_load(&mp3d, file_name, &info, NULL, NULL));
+#endif
+
+	if (*result != GA_SUCCESS)
+	{
+		return NULL;
+	}
+	else if (info.channels <= 0)
+	{
+		*result = GA_E_DECODER;
+		return NULL;
+	}
+
+	// MP3 decoder samples (ie. samples * channels), and not frames like the other decoders or LabVIEW wrapper. Convert to frames.
+	*num_frames = info.samples / info.channels;
+	*channels = info.channels;
+	*sample_rate = info.hz;
+
+	return info.buffer;
+}
+
+void free_mp3(int16_t* sample_data)
+{
+	free(sample_data);
+}
+
+ga_result open_mp3_file(ga_io* io, void** decoder)
+{
+	ga_result result = GA_SUCCESS;
+	uint64_t start_offset = 0;
+	uint64_t samples = 0;
+	mp3dec_frame_t* frames = NULL;
+	size_t num_frames = 0;
+	uint8_t index_applied = 0;
+
+	mp3_decoder* decoder_data = (mp3_decoder*)malloc(sizeof(mp3_decoder));
+
+	if (decoder_data == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	decoder_data->io = io;
+	decoder_data->index_cached = 0;
+	decoder_data->mp3_f32 = NULL;
+	decoder_data->f32_current = 0;
+
+	if (ga_io_get_file_stamp(io, &(decoder_data->file_size), &(decoder_data->modified_time), &(decoder_data->file_id)) != GA_SUCCESS)
+	{
+		// Without a stamp, a cached index can't be matched to this version of the file. Data in memory is never cached.
+		decoder_data->index_cached = 1;
+	}
+	else if (find_mp3_index(io->file_name, decoder_data->file_size, decoder_data->modified_time, decoder_data->file_id, &start_offset, &samples, &frames, &num_frames) == GA_SUCCESS)
+	{
+		// With a cached index there's no need to scan every frame, so only the first frame is parsed.
+		if (open_mp3_decoder(io, &(decoder_data->mp3), MP3D_SEEK_TO_SAMPLE | MP3D_DO_NOT_SCAN) == GA_SUCCESS)
+		{
+			if (decoder_data->mp3.start_offset == start_offset)
+			{
+				decoder_data->mp3.index.frames = frames;
+				decoder_data->mp3.index.num_frames = num_frames;
+				decoder_data->mp3.index.capacity = num_frames;
+				decoder_data->mp3.samples = samples;
+				decoder_data->mp3.indexes_built = 1;
+				decoder_data->index_cached = 1;
+				frames = NULL;
+				index_applied = 1;
+			}
+			else
+			{
+				mp3dec_ex_close(&(decoder_data->mp3));
+			}
+		}
+
+		free(frames);
+	}
+
+	if (!index_applied)
+	{
+		result = open_mp3_decoder(io, &(decoder_data->mp3), MP3D_SEEK_TO_SAMPLE);
+
+		if (result != GA_SUCCESS)
+		{
+			free(decoder_data);
+			decoder_data = NULL;
+			return result;
+		}
+
+		// Files without a VBR tag are fully scanned when opened, so their index is already built.
+		cache_mp3_index(decoder_data);
+	}
+
+	*decoder = (void*)decoder_data;
+
+	return result;
+}
+
+ga_result open_mp3_decoder(ga_io* io, mp3dec_ex_t* mp3, int flags)
+{
+	if (io->data != NULL)
+	{
+		return convert_mp3_result(mp3dec_ex_open_buf(mp3, io->data, io->size, flags));
+	}
+
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(io->file_name);
+	ga_result result = convert_mp3_result(mp3dec_ex_open_w(mp3, wide_file_name, flags));
+	free(wide_file_name);
+	return result;
+#else
+	return convert_mp3_result(mp3dec_ex_open(mp3, io->file_name, flags));
+#endif
+}
+
+ga_result open_mp3_f32_decoder(ga_io* io, mp3_f32_decoder** mp3_f32, int flags)
+{
+	if (io->data != NULL)
+	{
+		return convert_mp3_result(mp3_f32_open_buf(mp3_f32, io->data, io->size, flags));
+	}
+
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(io->file_name);
+	ga_result result = convert_mp3_result(mp3_f32_open_file_w(mp3_f32, wide_file_name, flags));
+	free(wide_file_name);
+	return result;
+#else
+	return convert_mp3_result(mp3_f32_open_file(mp3_f32, io->file_name, flags));
+#endif
+}
+
+ga_result select_mp3_s16_decoder(mp3_decoder* decoder)
+{
+	ga_result result = GA_SUCCESS;
+
+	if (!decoder->f32_current)
+	{
+		return GA_SUCCESS;
+	}
+
+	uint64_t position = mp3_f32_get_position(decoder->mp3_f32);
+
+	if (decoder->mp3.cur_sample != position)
+	{
+		result = convert_mp3_result(mp3dec_ex_seek(&(decoder->mp3), position));
+
+		// Files with a VBR tag build their index on the first seek.
+		cache_mp3_index(decoder);
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		decoder->f32_current = 0;
+	}
+
+	return result;
+}
+
+ga_result select_mp3_f32_decoder(mp3_decoder* decoder)
+{
+	ga_result result = GA_SUCCESS;
+
+	if (decoder->f32_current)
+	{
+		return GA_SUCCESS;
+	}
+
+	if (decoder->mp3_f32 == NULL)
+	{
+		// The 16-bit decoder has already found the frames, so only the first frame is parsed and its index is reused.
+		// Without an index, the float decoder builds its own if it needs to seek.
+		result = open_mp3_f32_decoder(decoder->io, &(decoder->mp3_f32), MP3D_SEEK_TO_SAMPLE | MP3D_DO_NOT_SCAN);
+
+		if (result != GA_SUCCESS)
+		{
+			return result;
+		}
+
+		if (decoder->mp3.indexes_built)
+		{
+			mp3_f32_set_index(decoder->mp3_f32, decoder->mp3.start_offset, decoder->mp3.samples, decoder->mp3.index.frames, decoder->mp3.index.num_frames);
+		}
+	}
+
+	if (mp3_f32_get_position(decoder->mp3_f32) != decoder->mp3.cur_sample)
+	{
+		result = convert_mp3_result(mp3_f32_seek(decoder->mp3_f32, decoder->mp3.cur_sample));
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		decoder->f32_current = 1;
+	}
+
+	return result;
+}
+
+uint64_t get_mp3_read_position(const mp3_decoder* decoder)
+{
+	return decoder->f32_current ? mp3_f32_get_position(decoder->mp3_f32) : decoder->mp3.cur_sample;
+}
+
+ga_result get_basic_mp3_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	*channels = ((mp3_decoder*)decoder)->mp3.info.channels;
+	*sample_rate = ((mp3_decoder*)decoder)->mp3.info.hz;
+	*read_offset = get_mp3_read_position((mp3_decoder*)decoder) / ((mp3_decoder*)decoder)->mp3.info.channels;
+
+	return GA_SUCCESS;
+}
+
+ga_result get_mp3_file_length(void* decoder, uint64_t* num_frames)
+{
+	if (decoder == NULL || ((mp3_decoder*)decoder)->mp3.info.channels <= 0)
+	{
+		return GA_E_GENERIC;
+	}
+
+	// The decoder is opened with MP3D_SEEK_TO_SAMPLE, so the sample count is known from the frame index.
+	*num_frames = ((mp3_decoder*)decoder)->mp3.samples / ((mp3_decoder*)decoder)->mp3.info.channels;
+
+	return GA_SUCCESS;
+}
+
+ga_result seek_mp3_file(void* decoder, uint64_t offset, uint64_t* new_offset)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+	
+	// MP3 decoder offset values are in terms of samples, and not frames like the other decoders or LabVIEW wrapper.
+	// Multiply by channels to get actual number of samples to read.
+	ga_result result = convert_mp3_result(mp3dec_ex_seek(&(((mp3_decoder*)decoder)->mp3), offset * ((mp3_decoder*)decoder)->mp3.info.channels));
+
+	// Files with a VBR tag build their index on the first seek.
+	cache_mp3_index((mp3_decoder*)decoder);
+
+	// The float decoder catches up on its next read.
+	((mp3_decoder*)decoder)->f32_current = 0;
+
+	return result;
+}
+
+ga_result read_mp3_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	int32_t num_channels = ((mp3_decoder*)decoder)->mp3.info.channels;
+
+	if (num_channels <= 0)
+	{
+		return GA_E_DECODER;
+	}
+
+	if (output_buffer == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	// Integer types use minimp3's native 16-bit output. Float types use the float build, rather than widening 16-bit samples.
+	ga_result result = (audio_type == ga_data_type_float || audio_type == ga_data_type_double) ? select_mp3_f32_decoder((mp3_decoder*)decoder) : select_mp3_s16_decoder((mp3_decoder*)decoder);
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	void* temp_buffer = NULL;
+
+	// MP3 decoder offset values are in terms of total samples (ie. samples * channels), and not samples/ch like the other decoders or LabVIEW wrapper.
+	// Multiply by channels to get actual number of samples to read. Divide result by channels to get samples/ch.
+	switch (audio_type)
+	{
+	case ga_data_type_u8:
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * num_channels * sizeof(mp3d_sample_t));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = mp3dec_ex_read(&(((mp3_decoder*)decoder)->mp3), (mp3d_sample_t*)temp_buffer, frames_to_read * num_channels) / num_channels;
+		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, *frames_read * num_channels);
+		break;
+	case ga_data_type_i16:
+		*frames_read = mp3dec_ex_read(&(((mp3_decoder*)decoder)->mp3), (mp3d_sample_t*)output_buffer, frames_to_read * num_channels) / num_channels;
+		break;
+	case ga_data_type_i32:
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * num_channels * sizeof(mp3d_sample_t));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = mp3dec_ex_read(&(((mp3_decoder*)decoder)->mp3), (mp3d_sample_t*)temp_buffer, frames_to_read * num_channels) / num_channels;
+		s16_to_s32((int32_t*)output_buffer, (int16_t*)temp_buffer, *frames_read * num_channels);
+		break;
+	case ga_data_type_float:
+		*frames_read = mp3_f32_read(((mp3_decoder*)decoder)->mp3_f32, (float*)output_buffer, frames_to_read * num_channels) / num_channels;
+		break;
+	case ga_data_type_double:
+		// Decode to float in the upper half of the output buffer, then widen in place.
+		temp_buffer = (float*)output_buffer + (frames_to_read * num_channels);
+		*frames_read = mp3_f32_read(((mp3_decoder*)decoder)->mp3_f32, (float*)temp_buffer, frames_to_read * num_channels) / num_channels;
+		f32_to_f64((double*)output_buffer, (float*)temp_buffer, *frames_read * num_channels);
+		break;
+	default:
+		return GA_E_INVALID_TYPE;
+		break;
+	}
+
+	if (*frames_read < 0)
+	{
+		*frames_read = 0;
+		return GA_E_GENERIC;
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result close_mp3_file(void* decoder)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	mp3dec_ex_close(&(((mp3_decoder*)decoder)->mp3));
+	mp3_f32_close(((mp3_decoder*)decoder)->mp3_f32);
+	free(decoder);
+
+	return GA_SUCCESS;
+}
+
+ga_result find_mp3_index(const char* file_name, uint64_t file_size, int64_t modified_time, uint64_t file_id, uint64_t* start_offset, uint64_t* samples, mp3dec_frame_t** frames, size_t* num_frames)
+{
+	mp3_index_entry index;
+	uint8_t use_sidecar;
+
+	lock_ga_mutex(ga_mutex_mp3_index);
+	//// START CRITICAL SECTION ////
+	use_sidecar = mp3_index_sidecar_enabled;
+
+	if (!mp3_index_cache_enabled)
+	{
+		unlock_ga_mutex(ga_mutex_mp3_index);
+		return GA_E_GENERIC;
+	}
+
+	for (int i = 0; i < MP3_INDEX_CACHE_ENTRIES; i++)
+	{
+		mp3_index_entry* entry = &mp3_index_cache[i];
+
+		if (entry->file_name != NULL && !strcmp(entry->file_name, file_name))
+		{
+			if (entry->file_size != file_size || entry->modified_time != modified_time || entry->file_id != file_id)
+			{
+				// The file has changed since it was indexed.
+				free_mp3_index_entry(entry);
+				break;
+			}
+
+			*frames = decode_mp3_index(entry->data, entry->data_size, entry->num_frames);
+
+			if (*frames == NULL)
+			{
+				break;
+			}
+
+			*start_offset = entry->start_offset;
+			*samples = entry->samples;
+			*num_frames = (size_t)entry->num_frames;
+			entry->last_used = ++mp3_index_cache_clock;
+
+			unlock_ga_mutex(ga_mutex_mp3_index);
+			return GA_SUCCESS;
+		}
+	}
+	//// END CRITICAL SECTION ////
+	unlock_ga_mutex(ga_mutex_mp3_index);
+
+	if (!use_sidecar || read_mp3_index_sidecar(file_name, file_size, modified_time, file_id, &index) != GA_SUCCESS)
+	{
+		return GA_E_GENERIC;
+	}
+
+	*frames = decode_mp3_index(index.data, index.data_size, index.num_frames);
+
+	if (*frames != NULL)
+	{
+		lock_ga_mutex(ga_mutex_mp3_index);
+		insert_mp3_index(&index);
+		unlock_ga_mutex(ga_mutex_mp3_index);
+
+		*start_offset = index.start_offset;
+		*samples = index.samples;
+		*num_frames = (size_t)index.num_frames;
+	}
+
+	free(index.data);
+
+	return (*frames != NULL ? GA_SUCCESS : GA_E_GENERIC);
+}
+
+void cache_mp3_index(mp3_decoder* decoder)
+{
+	mp3_index_entry index;
+	uint8_t enabled;
+	uint8_t use_sidecar;
+
+	if (decoder->index_cached || !decoder->mp3.indexes_built || decoder->mp3.index.num_frames == 0)
+	{
+		return;
+	}
+
+	decoder->index_cached = 1;
+
+	lock_ga_mutex(ga_mutex_mp3_index);
+	enabled = mp3_index_cache_enabled;
+	use_sidecar = mp3_index_sidecar_enabled;
+	unlock_ga_mutex(ga_mutex_mp3_index);
+
+	if (!enabled)
+	{
+		return;
+	}
+
+	index.file_name = decoder->io->file_name;
+	index.file_size = decoder->file_size;
+	index.modified_time = decoder->modified_time;
+	index.file_id = decoder->file_id;
+	index.start_offset = decoder->mp3.start_offset;
+	index.samples = decoder->mp3.samples;
+	index.num_frames = decoder->mp3.index.num_frames;
+	index.data = encode_mp3_index(decoder->mp3.index.frames, decoder->mp3.index.num_frames, &(index.data_size));
+	index.last_used = 0;
+
+	if (index.data == NULL)
+	{
+		return;
+	}
+
+	lock_ga_mutex(ga_mutex_mp3_index);
+	if (mp3_index_cache_enabled)
+	{
+		insert_mp3_index(&index);
+	}
+	unlock_ga_mutex(ga_mutex_mp3_index);
+
+	if (use_sidecar)
+	{
+		write_mp3_index_sidecar(&index);
+	}
+
+	free(index.data);
+}
+
+ga_result insert_mp3_index(const mp3_index_entry* index)
+{
+	int slot = -1;
+
+	// Replace the file's existing entry, then use an empty entry, and finally evict the least recently used entry.
+	for (int i = 0; i < MP3_INDEX_CACHE_ENTRIES && slot < 0; i++)
+	{
+		if (mp3_index_cache[i].file_name != NULL && !strcmp(mp3_index_cache[i].file_name, index->file_name))
+		{
+			slot = i;
+		}
+	}
+
+	for (int i = 0; i < MP3_INDEX_CACHE_ENTRIES && slot < 0; i++)
+	{
+		if (mp3_index_cache[i].file_name == NULL)
+		{
+			slot = i;
+		}
+	}
+
+	if (slot < 0)
+	{
+		slot = 0;
+		for (int i = 1; i < MP3_INDEX_CACHE_ENTRIES; i++)
+		{
+			if (mp3_index_cache[i].last_used < mp3_index_cache[slot].last_used)
+			{
+				slot = i;
+			}
+		}
+	}
+
+	char* file_name = (char*)malloc(strlen(index->file_name) + 1);
+	uint8_t* data = (uint8_t*)malloc(index->data_size);
+
+	if (file_name == NULL || data == NULL)
+	{
+		free(file_name);
+		free(data);
+		return GA_E_MEMORY;
+	}
+
+	strcpy(file_name, index->file_name);
+	memcpy(data, index->data, index->data_size);
+
+	free_mp3_index_entry(&mp3_index_cache[slot]);
+	mp3_index_cache[slot] = *index;
+	mp3_index_cache[slot].file_name = file_name;
+	mp3_index_cache[slot].data = data;
+	mp3_index_cache[slot].last_used = ++mp3_index_cache_clock;
+
+	return GA_SUCCESS;
+}
+
+void free_mp3_index_entry(mp3_index_entry* entry)
+{
+	free(entry->file_name);
+	free(entry->data);
+	memset(entry, 0, sizeof(mp3_index_entry));
+}
+
+// Frames are stored as the difference from the previous frame's offset and sample position, which fit in two or three bytes each.
+uint8_t* encode_mp3_index(const mp3dec_frame_t* frames, size_t num_frames, size_t* data_size)
+{
+	uint64_t last_offset = 0;
+	uint64_t last_sample = 0;
+	size_t position = 0;
+
+	// Each value takes at most 10 bytes.
+	uint8_t* data = (uint8_t*)malloc(num_frames * 20);
+
+	if (data == NULL)
+	{
+		return NULL;
+	}
+
+	for (size_t i = 0; i < num_frames; i++)
+	{
+		if (frames[i].offset < last_offset || frames[i].sample < last_sample)
+		{
+			free(data);
+			return NULL;
+		}
+
+		position += write_varint(data + position, frames[i].offset - last_offset);
+		position += write_varint(data + position, frames[i].sample - last_sample);
+		last_offset = frames[i].offset;
+		last_sample = frames[i].sample;
+	}
+
+	uint8_t* shrunk_data = (uint8_t*)realloc(data, position);
+	if (shrunk_data != NULL)
+	{
+		data = shrunk_data;
+	}
+
+	*data_size = position;
+
+	return data;
+}
+
+mp3dec_frame_t* decode_mp3_index(const uint8_t* data, size_t data_size, uint64_t num_frames)
+{
+	uint64_t offset = 0;
+	uint64_t sample = 0;
+	uint64_t delta = 0;
+	size_t position = 0;
+
+	// Every frame takes at least two bytes, which also guards against allocating for a corrupt frame count.
+	if (data == NULL || num_frames == 0 || num_frames > data_size / 2)
+	{
+		return NULL;
+	}
+
+	mp3dec_frame_t* frames = (mp3dec_frame_t*)malloc((size_t)num_frames * sizeof(mp3dec_frame_t));
+
+	if (frames == NULL)
+	{
+		return NULL;
+	}
+
+	for (uint64_t i = 0; i < num_frames; i++)
+	{
+		if (read_varint(data, data_size, &position, &delta) != GA_SUCCESS)
+		{
+			free(frames);
+			return NULL;
+		}
+		offset += delta;
+
+		if (read_varint(data, data_size, &position, &delta) != GA_SUCCESS)
+		{
+			free(frames);
+			return NULL;
+		}
+		sample += delta;
+
+		frames[i].offset = offset;
+		frames[i].sample = sample;
+	}
+
+	if (position != data_size)
+	{
+		free(frames);
+		return NULL;
+	}
+
+	return frames;
+}
+
+// Sidecar layout, all values little endian:
+// magic (4) | version (4) | file size (8) | modification time (8) | start offset (8) | samples (8) | frame count (8) | data size (8) | file ID (8) | encoded frames
+ga_result read_mp3_index_sidecar(const char* file_name, uint64_t file_size, int64_t modified_time, uint64_t file_id, mp3_index_entry* index)
+{
+	FILE* pFile;
+	uint8_t header[MP3_INDEX_SIDECAR_HEADER_SIZE];
+	char* sidecar_name = get_mp3_index_sidecar_name(file_name);
+
+	if (sidecar_name == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	pFile = ga_fopen(sidecar_name);
+	free(sidecar_name);
+
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	if (fread(header, 1, MP3_INDEX_SIDECAR_HEADER_SIZE, pFile) != MP3_INDEX_SIDECAR_HEADER_SIZE
+		|| memcmp(header, MP3_INDEX_SIDECAR_MAGIC, 4)
+		|| header[4] != MP3_INDEX_SIDECAR_VERSION || header[5] != 0 || header[6] != 0 || header[7] != 0
+		|| read_u64_le(header + 8) != file_size
+		|| (int64_t)read_u64_le(header + 16) != modified_time
+		|| read_u64_le(header + 56) != file_id)
+	{
+		fclose(pFile);
+		return GA_E_FILE;
+	}
+
+	index->file_name = (char*)file_name;
+	index->file_size = file_size;
+	index->modified_time = modified_time;
+	index->file_id = file_id;
+	index->start_offset = read_u64_le(header + 24);
+	index->samples = read_u64_le(header + 32);
+	index->num_frames = read_u64_le(header + 40);
+	index->last_used = 0;
+
+	uint64_t data_size = read_u64_le(header + 48);
+
+	// The index can't be larger than the file it describes.
+	if (data_size == 0 || data_size > file_size)
+	{
+		fclose(pFile);
+		return GA_E_FILE;
+	}
+
+	index->data_size = (size_t)data_size;
+	index->data = (uint8_t*)malloc(index->data_size);
+
+	if (index->data == NULL)
+	{
+		fclose(pFile);
+		return GA_E_MEMORY;
+	}
+
+	if (fread(index->data, 1, index->data_size, pFile) != index->data_size)
+	{
+		fclose(pFile);
+		free(index->data);
+		index->data = NULL;
+		return GA_E_FILE;
+	}
+
+	fclose(pFile);
+
+	return GA_SUCCESS;
+}
+
+ga_result write_mp3_index_sidecar(const mp3_index_entry* index)
+{
+	FILE* pFile;
+	ga_result result = GA_SUCCESS;
+	uint8_t header[MP3_INDEX_SIDECAR_HEADER_SIZE];
+	char* sidecar_name = get_mp3_index_sidecar_name(index->file_name);
+
+	if (sidecar_name == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	memcpy(header, MP3_INDEX_SIDECAR_MAGIC, 4);
+	header[4] = MP3_INDEX_SIDECAR_VERSION;
+	header[5] = 0;
+	header[6] = 0;
+	header[7] = 0;
+	write_u64_le(header + 8, index->file_size);
+	write_u64_le(header + 16, (uint64_t)index->modified_time);
+	write_u64_le(header + 24, index->start_offset);
+	write_u64_le(header + 32, index->samples);
+	write_u64_le(header + 40, index->num_frames);
+	write_u64_le(header + 48, index->data_size);
+	write_u64_le(header + 56, index->file_id);
+
+	// Sidecars are a best effort, eg. the MP3 may be in a read-only folder.
+	pFile = ga_fopen_write(sidecar_name);
+	free(sidecar_name);
+
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	if (fwrite(header, 1, MP3_INDEX_SIDECAR_HEADER_SIZE, pFile) != MP3_INDEX_SIDECAR_HEADER_SIZE || fwrite(index->data, 1, index->data_size, pFile) != index->data_size)
+	{
+		result = GA_E_FILE;
+	}
+
+	fclose(pFile);
+
+	return result;
+}
+
+char* get_mp3_index_sidecar_name(const char* file_name)
+{
+	char* sidecar_name = (char*)malloc(strlen(file_name) + strlen(MP3_INDEX_SIDECAR_EXTENSION) + 1);
+
+	if (sidecar_name != NULL)
+	{
+		strcpy(sidecar_name, file_name);
+		strcat(sidecar_name, MP3_INDEX_SIDECAR_EXTENSION);
+	}
+
+	return sidecar_name;
+}
+
+// LEB128 style variable length integer, 7 bits per byte with the high bit set on all but the last byte.
+size_t write_varint(uint8_t* data, uint64_t value)
+{
+	size_t length = 0;
+
+	while (value >= 0x80)
+	{
+		data[length++] = (uint8_t)(value | 0x80);
+		value >>= 7;
+	}
+	data[length++] = (uint8_t)value;
+
+	return length;
+}
+
+ga_result read_varint(const uint8_t* data, size_t data_size, size_t* position, uint64_t* value)
+{
+	uint64_t result = 0;
+
+	for (uint32_t shift = 0; shift < 64 && *position < data_size; shift += 7)
+	{
+		uint8_t byte = data[(*position)++];
+		result |= (uint64_t)(byte & 0x7F) << shift;
+
+		if (!(byte & 0x80))
+		{
+			*value = result;
+			return GA_SUCCESS;
+		}
+	}
+
+	return GA_E_GENERIC;
+}
+
+void write_u64_le(uint8_t* data, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		data[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+uint64_t read_u64_le(const uint8_t* data)
+{
+	uint64_t value = 0;
+
+	for (int i = 0; i < 8; i++)
+	{
+		value |= (uint64_t)data[i] << (i * 8);
+	}
+
+	return value;
+}
+
+void write_u32_le(uint8_t* data, uint32_t value)
+{
+	for (int i = 0; i < 4; i++)
+	{
+		data[i] = (uint8_t)(value >> (i * 8));
+	}
+}
+
+uint32_t read_u32_le(const uint8_t* data)
+{
+	return (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+
+id3tag_t* load_id3_tag(ga_io* io, ID3TAG_U32 fields)
+{
+	id3_reader reader = { NULL, io->data, io->size, 0 };
+	ID3TAG_U8 tag_size_data[10] = { 0 };
+	size_t tag_size;
+	void* tag_data;
+	id3tag_t* id3tag;
+
+	if (io->data == NULL)
+	{
+		reader.file = ga_fopen(io->file_name);
+		if (reader.file == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	read_id3_data(&reader, &tag_size_data, sizeof(tag_size_data));
+
+	tag_size = id3tag_size(tag_size_data);
+	// ID3v2 tag found
+	if (tag_size > 0)
+	{
+		size_t compact_size = 0;
+		tag_data = read_id3_frames(&reader, tag_size_data, tag_size, fields, &compact_size);
+		if (reader.file != NULL)
+		{
+			fclose(reader.file);
+		}
+
+		if (tag_data == NULL)
+		{
+			return NULL;
+		}
+
+		id3tag = id3tag_load(tag_data, compact_size, fields, NULL);
+		free(tag_data);
+	}
+	// No ID3V2 tag, try ID3v1
+	else
+	{
+		// Zeroed, so a file too short for the tag doesn't leave it uninitialised.
+		tag_data = calloc(1, 128);
+
+		if (tag_data == NULL)
+		{
+			if (reader.file != NULL)
+			{
+				fclose(reader.file);
+			}
+			return NULL;
+		}
+
+		if (reader.file != NULL)
+		{
+			fseek(reader.file, -128, SEEK_END);
+			fread(tag_data, 1, 128, reader.file);
+			fclose(reader.file);
+		}
+		else if (reader.size >= 128)
+		{
+			memcpy(tag_data, reader.data + reader.size - 128, 128);
+		}
+		id3tag = id3tag_load_id3v1(tag_data, 128, NULL);
+		free(tag_data);
+	}
+
+	return id3tag;
+}
+
+uint8_t is_id3_frame_wanted(const char* frame_id, ID3TAG_U32 fields)
+{
+	// Text (including TXXX user text) and comment frames are all the tag parser reads, besides pictures.
+	if (frame_id[0] == 'T' || strcmp(frame_id, "COMM") == 0 || strcmp(frame_id, "COM") == 0)
+	{
+		return 1;
+	}
+
+	if ((fields & ID3TAG_FIELD_PICS) && (strcmp(frame_id, "APIC") == 0 || strcmp(frame_id, "PIC") == 0))
+	{
+		return 1;
+	}
+
+	return 0;
+}
+
+size_t read_id3_data(id3_reader* reader, void* output, size_t size)
+{
+	if (reader->file != NULL)
+	{
+		return fread(output, 1, size, reader->file);
+	}
+
+	if (reader->position >= reader->size)
+	{
+		return 0;
+	}
+
+	size_t bytes_read = reader->size - reader->position;
+	if (bytes_read > size)
+	{
+		bytes_read = size;
+	}
+
+	memcpy(output, reader->data + reader->position, bytes_read);
+	reader->position += bytes_read;
+
+	return bytes_read;
+}
+
+int skip_id3_data(id3_reader* reader, size_t size)
+{
+	if (reader->file != NULL)
+	{
+		return fseek(reader->file, (long)size, SEEK_CUR);
+	}
+
+	// Like fseek(), skipping past the end succeeds, and later reads return nothing.
+	reader->position += size;
+
+	return 0;
+}
+
+void* read_id3_frames(id3_reader* reader, const ID3TAG_U8* header, size_t tag_size, ID3TAG_U32 fields, size_t* compact_size)
+{
+	// Frames are walked as id3tag_load() walks them, so the frames kept and where the walk stops match reading the whole tag.
+	const size_t padding_size = 10;
+	const int version = header[3];
+	const size_t frame_header_size = (version >= 3 ? 10 : 6);
+	const size_t frame_size_end = (version >= 3 ? 8 : 6);
+	size_t data_size = 10;
+	size_t data_capacity = 4096;
+	size_t position = 10;
+	uint8_t* data = (uint8_t*)malloc(data_capacity);
+
+	if (data == NULL)
+	{
+		return NULL;
+	}
+
+	memcpy(data, header, 10);
+
+	while (position + 10 <= tag_size)
+	{
+		ID3TAG_U8 frame_header[10];
+
+		if (read_id3_data(reader, frame_header, frame_header_size) != frame_header_size)
+		{
+			break;
+		}
+
+		// End of frames, in padding
+		if (frame_header[0] == 0 && frame_header[1] == 0 && frame_header[2] == 0 && (version < 3 || frame_header[3] == 0))
+		{
+			break;
+		}
+
+		char frame_id[5] = { (char)frame_header[0], (char)frame_header[1], (char)frame_header[2], '\0', '\0' };
+		int frame_size = 0;
+		if (version >= 4)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				frame_size |= ((ID3TAG_U32)frame_header[4 + i]) << (7 * (3 - i));
+			}
+			frame_id[3] = (char)frame_header[3];
+		}
+		else if (version >= 3)
+		{
+			for (int i = 0; i < 4; i++)
+			{
+				frame_size |= ((ID3TAG_U32)frame_header[4 + i]) << (8 * (3 - i));
+			}
+			frame_id[3] = (char)frame_header[3];
+		}
+		else
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				frame_size |= ((ID3TAG_U32)frame_header[3 + i]) << (8 * (2 - i));
+			}
+		}
+
+		if (frame_size <= 0 || (size_t)frame_size >= tag_size - (position + frame_size_end))
+		{
+			break;
+		}
+
+		if (is_id3_frame_wanted(frame_id, fields))
+		{
+			size_t frame_end = data_size + frame_header_size + frame_size;
+
+			if (frame_end + padding_size > data_capacity)
+			{
+				while (frame_end + padding_size > data_capacity)
+				{
+					data_capacity *= 2;
+				}
+
+				uint8_t* new_data = (uint8_t*)realloc(data, data_capacity);
+				if (new_data == NULL)
+				{
+					free(data);
+					return NULL;
+				}
+				data = new_data;
+			}
+
+			memcpy(data + data_size, frame_header, frame_header_size);
+			size_t bytes_read = read_id3_data(reader, data + data_size + frame_header_size, frame_size);
+
+			// A frame cut short by the end of the file is kept with the data there is, and ends the walk.
+			if (bytes_read < (size_t)frame_size)
+			{
+				if (bytes_read > 0)
+				{
+					uint8_t* size_data = data + data_size + (version >= 3 ? 4 : 3);
+					for (int i = (version >= 3 ? 3 : 2), shift = 0; i >= 0; i--, shift += (version >= 4 ? 7 : 8))
+					{
+						size_data[i] = (uint8_t)((bytes_read >> shift) & (version >= 4 ? 0x7F : 0xFF));
+					}
+					data_size += frame_header_size + bytes_read;
+				}
+				break;
+			}
+			data_size = frame_end;
+		}
+		else if (skip_id3_data(reader, frame_size) != 0)
+		{
+			break;
+		}
+
+		position += frame_header_size + frame_size;
+	}
+
+	// Zeroed padding ends the frames, and keeps the last frame clear of the tag end for id3tag_load().
+	memset(data + data_size, 0, padding_size);
+	data_size += padding_size;
+
+	// Rewrite the header with the size of the frames kept. The size is stored in 7-bit bytes.
+	size_t frames_size = data_size - 10;
+	data[6] = (uint8_t)((frames_size >> 21) & 0x7F);
+	data[7] = (uint8_t)((frames_size >> 14) & 0x7F);
+	data[8] = (uint8_t)((frames_size >> 7) & 0x7F);
+	data[9] = (uint8_t)(frames_size & 0x7F);
+
+	*compact_size = data_size;
+	return data;
+}
+
+ga_result get_id3_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+{
+	enum fields_t
+	{
+		FIELD_TITLE,
+		FIELD_ARTIST,
+		FIELD_ALBUM_ARTIST,
+		FIELD_ALBUM,
+		FIELD_GENRE,
+		FIELD_YEAR,
+		FIELD_TRACK,
+		FIELD_TRACKS,
+		FIELD_DISC,
+		FIELD_DISCS,
+		FIELD_COMPILATION,
+		FIELD_BPM,
+		FIELD_COMMENT,
+		FIELD_USER_TEXT,
+
+		FIELDCOUNT
+	};
+
+	const char* tag_field_prefix[FIELDCOUNT] =
+	{
+		"TITLE",
+		"ARTIST",
+		"ALBUMARTIST",
+		"ALBUM",
+		"GENRE",
+		"DATE",
+		"TRACKNUMBER",
+		"TRACKTOTAL",
+		"DISCNUMBER",
+		"DISCTOTAL",
+		"COMPILATION",
+		"BPM",
+		"COMMENT"
+	};
+
+	audio_file_tag_info tag_info = {};
+	const char* current_tag = NULL;
+	id3tag_t* id3tag;
+
+	// Pictures are only read from the file if they're wanted, and other binary frames never are.
+	id3tag = load_id3_tag(io, (picture_mode != ga_picture_none ? ID3TAG_ALL_FIELDS : ID3TAG_ALL_FIELDS & ~ID3TAG_FIELD_PICS));
+
+	if (id3tag == NULL)
+	{
+		return GA_E_TAG;
+	}
+
+	tag_info.picture_mode = picture_mode;
+	tag_info.thumbnail_size = thumbnail_size;
+
+	for (int field_index = 0; field_index < FIELDCOUNT; field_index++)
+	{
+		ga_result result = GA_SUCCESS;
+
+		current_tag = NULL;
+		switch (field_index)
+		{
+			case FIELD_TITLE:        if (id3tag->title != NULL) { current_tag = id3tag->title; } break;
+			case FIELD_ARTIST:       if (id3tag->artist != NULL) { current_tag = id3tag->artist; } break;
+			case FIELD_ALBUM_ARTIST: if (id3tag->album_artist != NULL) { current_tag = id3tag->album_artist; } break;
+			case FIELD_ALBUM:        if (id3tag->album != NULL) { current_tag = id3tag->album; } break;
+			case FIELD_GENRE:        if (id3tag->genre != NULL) { current_tag = id3tag->genre; } break;
+			case FIELD_YEAR:         if (id3tag->year != NULL) { current_tag = id3tag->year; } break;
+			case FIELD_TRACK:        if (id3tag->track != NULL) { current_tag = id3tag->track; } break;
+			case FIELD_TRACKS:       if (id3tag->tracks != NULL) { current_tag = id3tag->tracks; } break;
+			case FIELD_DISC:         if (id3tag->disc != NULL) { current_tag = id3tag->disc; } break;
+			case FIELD_DISCS:        if (id3tag->discs != NULL) { current_tag = id3tag->discs; } break;
+			case FIELD_COMPILATION:  if (id3tag->compilation != NULL) { current_tag = id3tag->compilation; } break;
+			case FIELD_BPM:          if (id3tag->bpm != NULL) { current_tag = id3tag->bpm; } break;
+			case FIELD_COMMENT:      if (id3tag->comment != NULL) { current_tag = id3tag->comment; } break;
+			default:                 current_tag = NULL; break;
+		}
+
+		if (current_tag != NULL)
+		{
+			result = add_audio_file_tag(&tag_info, tag_field_prefix[field_index], strlen(tag_field_prefix[field_index]), current_tag, strlen(current_tag));
+		}
+
+		if (field_index == FIELD_USER_TEXT && id3tag->user_text != NULL)
+		{
+			for (int user_text_index = 0; user_text_index < id3tag->user_text_count && result == GA_SUCCESS; user_text_index++)
+			{
+				const char* desc = id3tag->user_text[user_text_index].desc;
+				const char* value = id3tag->user_text[user_text_index].value;
+				result = add_audio_file_tag(&tag_info, desc, strlen(desc), value, strlen(value));
+			}
+		}
+
+		if (result != GA_SUCCESS)
+		{
+			free_audio_file_tag_info(&tag_info);
+			id3tag_free(id3tag);
+			return result;
+		}
+	}
+
+	if (picture_mode != ga_picture_none)
+	{
+		for (int i = 0; i < id3tag->pics_count; i++)
+		{
+			ga_result result = add_audio_file_picture(&tag_info, (const uint8_t*)id3tag->pics[i].data, id3tag->pics[i].size, id3tag->pics[i].pic_type);
+
+			if (result != GA_SUCCESS)
+			{
+				free_audio_file_tag_info(&tag_info);
+				id3tag_free(id3tag);
+				return result;
+			}
+		}
+	}
+
+	id3tag_free(id3tag);
+
+	return pack_audio_file_tags(&tag_info, tags, tag_count, pictures, picture_count);
+}
+
+
+ga_result set_id3_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten)
+{
+	typedef struct
+	{
+		uint64_t offset;	// Offset of the frame header
+		uint32_t size;		// Size including the header
+	} id3_frame;
+
+	uint8_t header[10];
+	size_t tag_size;
+	size_t frames_end = 10;
+	size_t position = 10;
+	int version = 3;
+	id3_frame* kept_frames = NULL;
+	uint32_t kept_count = 0;
+	uint32_t kept_capacity = 0;
+	size_t kept_size = 0;
+	tag_buffer frames = {};
+	ga_result result = GA_SUCCESS;
+	FILE* pFile;
+
+	pFile = ga_fopen(file_name);
+
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	if (fread(header, 1, 10, pFile) != 10)
+	{
+		fclose(pFile);
+		return GA_E_DECODER;
+	}
+
+	tag_size = id3tag_size(header);
+
+	if (tag_size > 0)
+	{
+		version = header[3];
+
+		// Frames are copied as they are, so tag-wide unsynchronisation (and v2.2's three letter frames) aren't supported. Footers can't follow padding.
+		if (version < 3 || version > 4 || (header[5] & 0x80) || (header[5] & 0x10))
+		{
+			fclose(pFile);
+			return GA_E_UNSUPPORTED_TAG;
+		}
+
+		// The extended header is dropped.
+		if (header[5] & 0x40)
+		{
+			uint8_t extended_size[4];
+
+			if (fread(extended_size, 1, 4, pFile) != 4)
+			{
+				fclose(pFile);
+				return GA_E_DECODER;
+			}
+
+			if (version == 3)
+			{
+				position += 4 + (((size_t)extended_size[0] << 24) | ((size_t)extended_size[1] << 16) | ((size_t)extended_size[2] << 8) | extended_size[3]);
+			}
+			else
+			{
+				position += ((size_t)(extended_size[0] & 0x7F) << 21) | ((size_t)(extended_size[1] & 0x7F) << 14) | ((size_t)(extended_size[2] & 0x7F) << 7) | (extended_size[3] & 0x7F);
+			}
+		}
+
+		// Find the frames to keep. The walk stops at padding, or a frame that runs past the end of the tag.
+		while (position + 10 <= tag_size)
+		{
+			uint8_t frame_header[10];
+
+			if (ga_fseek(pFile, position, SEEK_SET) != 0 || fread(frame_header, 1, 10, pFile) != 10 || frame_header[0] == 0)
+			{
+				break;
+			}
+
+			char frame_id[5] = { (char)frame_header[0], (char)frame_header[1], (char)frame_header[2], (char)frame_header[3], '\0' };
+			size_t frame_size;
+
+			if (version == 4)
+			{
+				frame_size = ((size_t)(frame_header[4] & 0x7F) << 21) | ((size_t)(frame_header[5] & 0x7F) << 14) | ((size_t)(frame_header[6] & 0x7F) << 7) | (frame_header[7] & 0x7F);
+			}
+			else
+			{
+				frame_size = ((size_t)frame_header[4] << 24) | ((size_t)frame_header[5] << 16) | ((size_t)frame_header[6] << 8) | frame_header[7];
+			}
+
+			if (frame_size > tag_size - position - 10)
+			{
+				break;
+			}
+
+			static const char* text_frames[] = { "TIT2", "TPE1", "TPE2", "TALB", "TCON", "TYER", "TDRC", "TRCK", "TPOS", "TCMP", "TBPM", "COMM", "TXXX" };
+			uint8_t is_text_frame = 0;
+
+			for (size_t i = 0; i < sizeof(text_frames) / sizeof(text_frames[0]); i++)
+			{
+				is_text_frame |= (strcmp(frame_id, text_frames[i]) == 0);
+			}
+
+			if (!is_text_frame)
+			{
+				if (kept_count == kept_capacity)
+				{
+					kept_capacity = (kept_capacity > 0 ? kept_capacity * 2 : 16);
+					id3_frame* new_frames = (id3_frame*)realloc(kept_frames, kept_capacity * sizeof(id3_frame));
+
+					if (new_frames == NULL)
+					{
+						free(kept_frames);
+						fclose(pFile);
+						return GA_E_MEMORY;
+					}
+
+					kept_frames = new_frames;
+				}
+
+				kept_frames[kept_count].offset = position;
+				kept_frames[kept_count].size = (uint32_t)(10 + frame_size);
+				kept_count++;
+				kept_size += 10 + frame_size;
+			}
+
+			position += 10 + frame_size;
+		}
+
+		frames_end = position;
+	}
+
+	// The kept frames go first, followed by the text frames. Once a file has been written, later edits only touch the text frames at the end of the tag.
+	tag_buffer text_frames = {};
+	result = build_id3_text_frames(fields, values, tag_count, version, &text_frames);
+
+	uint8_t in_place = (tag_size > 0 && 10 + kept_size + text_frames.size <= tag_size);
+	size_t write_start = 10;
+
+	if (result == GA_SUCCESS)
+	{
+		result = append_tag_buffer(&frames, NULL, 10);
+	}
+
+	for (uint32_t i = 0; i < kept_count && result == GA_SUCCESS; i++)
+	{
+		size_t frame_start = frames.size;
+		result = append_tag_buffer(&frames, NULL, kept_frames[i].size);
+
+		// Leading frames that stay where they are don't need to be read or written. Frames only move towards the start of the tag,
+		// so once one has moved, all the frames after it have too.
+		if (in_place && kept_frames[i].offset == frame_start && write_start == frame_start)
+		{
+			write_start += kept_frames[i].size;
+			continue;
+		}
+
+		if (result == GA_SUCCESS && (ga_fseek(pFile, kept_frames[i].offset, SEEK_SET) != 0 || fread(frames.data + frame_start, 1, kept_frames[i].size, pFile) != kept_frames[i].size))
+		{
+			result = GA_E_DECODER;
+		}
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		result = append_tag_buffer(&frames, text_frames.data, text_frames.size);
+	}
+
+	free_tag_buffer(&text_frames);
+	free(kept_frames);
+
+	if (result != GA_SUCCESS)
+	{
+		fclose(pFile);
+		free_tag_buffer(&frames);
+		return result;
+	}
+
+	if (in_place)
+	{
+		fclose(pFile);
+
+		// Old frames past the new ones are cleared to padding.
+		if (frames.size < frames_end)
+		{
+			result = append_tag_buffer(&frames, NULL, frames_end - frames.size);
+		}
+
+		pFile = (result == GA_SUCCESS ? ga_fopen_update(file_name) : NULL);
+
+		if (pFile == NULL)
+		{
+			free_tag_buffer(&frames);
+			return (result == GA_SUCCESS ? GA_E_FILE : result);
+		}
+
+		// The header only changes if the extended header was dropped.
+		header[5] &= ~0x40;
+
+		if (fwrite(header, 1, 10, pFile) != 10
+			|| (frames.size > write_start && (ga_fseek(pFile, write_start, SEEK_SET) != 0 || fwrite(frames.data + write_start, 1, frames.size - write_start, pFile) != frames.size - write_start)))
+		{
+			result = GA_E_FILE;
+		}
+
+		if (fclose(pFile) != 0 && result == GA_SUCCESS)
+		{
+			result = GA_E_FILE;
+		}
+
+		free_tag_buffer(&frames);
+		return (result == GA_SUCCESS ? update_id3v1_tag(file_name, fields, values, tag_count) : result);
+	}
+
+	// Rewrite the file with a new tag, padded for later edits. Anything after the old tag is copied as it is.
+	FILE* pOutput;
+	char* temp_name = NULL;
+	size_t new_tag_size = frames.size + TAG_PADDING_SIZE;
+
+	if (new_tag_size - 10 > 0x0FFFFFFF)
+	{
+		fclose(pFile);
+		free_tag_buffer(&frames);
+		return GA_E_TAG;
+	}
+
+	result = append_tag_buffer(&frames, NULL, TAG_PADDING_SIZE);
+
+	if (result != GA_SUCCESS)
+	{
+		fclose(pFile);
+		free_tag_buffer(&frames);
+		return result;
+	}
+
+	frames.data[0] = 'I';
+	frames.data[1] = 'D';
+	frames.data[2] = '3';
+	frames.data[3] = (uint8_t)version;
+	frames.data[4] = 0;
+	frames.data[5] = 0;
+	frames.data[6] = (uint8_t)(((new_tag_size - 10) >> 21) & 0x7F);
+	frames.data[7] = (uint8_t)(((new_tag_size - 10) >> 14) & 0x7F);
+	frames.data[8] = (uint8_t)(((new_tag_size - 10) >> 7) & 0x7F);
+	frames.data[9] = (uint8_t)((new_tag_size - 10) & 0x7F);
+
+	pOutput = open_rewrite_file(file_name, &temp_name);
+
+	if (pOutput == NULL)
+	{
+		free(temp_name);
+		fclose(pFile);
+		free_tag_buffer(&frames);
+		return GA_E_FILE;
+	}
+
+	if (fwrite(frames.data, 1, frames.size, pOutput) != frames.size || ga_fseek(pFile, tag_size, SEEK_SET) != 0)
+	{
+		result = GA_E_FILE;
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		result = copy_file_data(pFile, pOutput, UINT64_MAX);
+	}
+
+	fclose(pFile);
+	result = finish_rewrite_file(pOutput, temp_name, file_name, result);
+	free(temp_name);
+	free_tag_buffer(&frames);
+
+	if (result == GA_SUCCESS)
+	{
+		*rewritten = 1;
+		result = update_id3v1_tag(file_name, fields, values, tag_count);
+	}
+
+	return result;
+}
+
+ga_result update_id3v1_tag(const char* file_name, const char** fields, const char** values, int32_t tag_count)
+{
+	// Field offsets and sizes in the tag. The comment is two bytes short of the ID3v1 size, to make room for the ID3v1.1 track number.
+	static const char* text_fields[] = { "TITLE", "ARTIST", "ALBUM", "DATE", "COMMENT" };
+	static const size_t text_offsets[] = { 3, 33, 63, 93, 97 };
+	static const size_t text_sizes[] = { 30, 30, 30, 4, 28 };
+	uint8_t tag[128];
+	ga_result result = GA_SUCCESS;
+	FILE* pFile = ga_fopen_update(file_name);
+
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	if (ga_fseek(pFile, -128, SEEK_END) != 0 || fread(tag, 1, 128, pFile) != 128 || memcmp(tag, "TAG", 3) != 0)
+	{
+		fclose(pFile);
+		return GA_SUCCESS;
+	}
+
+	// Fields that aren't set are cleared, as they are in the ID3v2 tag.
+	memset(tag + 3, 0, 125);
+
+	for (size_t i = 0; i < sizeof(text_fields) / sizeof(text_fields[0]); i++)
+	{
+		const char* value = find_tag_value(fields, values, tag_count, text_fields[i]);
+
+		if (value != NULL)
+		{
+			utf8_to_latin1(value, tag + text_offsets[i], text_sizes[i]);
+		}
+	}
+
+	const char* track = find_tag_value(fields, values, tag_count, "TRACKNUMBER");
+	int track_number = (track != NULL ? atoi(track) : 0);
+	tag[126] = (uint8_t)(track_number > 0 && track_number < 256 ? track_number : 0);
+
+	// Genres outside the ID3v1 list are left unset.
+	const char* genre = find_tag_value(fields, values, tag_count, "GENRE");
+	tag[127] = 255;
+
+	for (int i = 0; i < 192 && genre != NULL; i++)
+	{
+		if (tag_field_equals(genre, id3tag_id3v1_genre_text(i)))
+		{
+			tag[127] = (uint8_t)i;
+			break;
+		}
+	}
+
+	if (ga_fseek(pFile, -128, SEEK_END) != 0 || fwrite(tag, 1, 128, pFile) != 128)
+	{
+		result = GA_E_FILE;
+	}
+
+	if (fclose(pFile) != 0 && result == GA_SUCCESS)
+	{
+		result = GA_E_FILE;
+	}
+
+	return result;
+}
+
+ga_result build_id3_text_frames(const char** fields, const char** values, int32_t tag_count, int version, tag_buffer* frames)
+{
+	// The fields get_id3_tags() returns, and their frames. Track and disc totals are written with the number, as "number/total".
+	static const char* field_frames[][2] =
+	{
+		{ "TITLE", "TIT2" },
+		{ "ARTIST", "TPE1" },
+		{ "ALBUMARTIST", "TPE2" },
+		{ "ALBUM", "TALB" },
+		{ "GENRE", "TCON" },
+		{ "DATE", "TYER" },
+		{ "COMPILATION", "TCMP" },
+		{ "BPM", "TBPM" },
+		{ "COMMENT", "COMM" },
+		{ "TRACKNUMBER", "TRCK" },
+		{ "TRACKTOTAL", "TRCK" },
+		{ "DISCNUMBER", "TPOS" },
+		{ "DISCTOTAL", "TPOS" }
+	};
+	const size_t field_frame_count = sizeof(field_frames) / sizeof(field_frames[0]);
+	ga_result result = GA_SUCCESS;
+
+	for (size_t f = 0; f < field_frame_count && result == GA_SUCCESS; f++)
+	{
+		const char* value = find_tag_value(fields, values, tag_count, field_frames[f][0]);
+		const char* frame_id = field_frames[f][1];
+
+		if (strcmp(frame_id, "TRCK") == 0 || strcmp(frame_id, "TPOS") == 0)
+		{
+			// Number and total share a frame, written once for the pair.
+			if (strcmp(field_frames[f][0], "TRACKTOTAL") == 0 || strcmp(field_frames[f][0], "DISCTOTAL") == 0)
+			{
+				continue;
+			}
+
+			const char* total = find_tag_value(fields, values, tag_count, field_frames[f + 1][0]);
+
+			if (value == NULL && total == NULL)
+			{
+				continue;
+			}
+
+			char* position = (char*)malloc((value != NULL ? strlen(value) : 1) + (total != NULL ? strlen(total) + 1 : 0) + 1);
+
+			if (position == NULL)
+			{
+				return GA_E_MEMORY;
+			}
+
+			strcpy(position, (value != NULL ? value : "0"));
+
+			if (total != NULL)
+			{
+				strcat(position, "/");
+				strcat(position, total);
+			}
+
+			result = append_id3_text_frame(frames, frame_id, (const char**)&position, 1, version);
+			free(position);
+			continue;
+		}
+
+		if (value == NULL)
+		{
+			continue;
+		}
+
+		// ID3v2.4 replaced the year with a recording time.
+		if (strcmp(frame_id, "TYER") == 0 && version == 4)
+		{
+			frame_id = "TDRC";
+		}
+
+		result = append_id3_text_frame(frames, frame_id, &value, 1, version);
+	}
+
+	// Everything else is user text, with the field as its description.
+	for (int32_t i = 0; i < tag_count && result == GA_SUCCESS; i++)
+	{
+		uint8_t has_frame = 0;
+
+		for (size_t f = 0; f < field_frame_count; f++)
+		{
+			has_frame |= tag_field_equals(fields[i], field_frames[f][0]);
+		}
+
+		if (!has_frame)
+		{
+			const char* strings[2] = { fields[i], values[i] };
+			result = append_id3_text_frame(frames, "TXXX", strings, 2, version);
+		}
+	}
+
+	return result;
+}
+
+ga_result append_id3_text_frame(tag_buffer* frames, const char* frame_id, const char** strings, int32_t string_count, int version)
+{
+	uint8_t is_comment = (strcmp(frame_id, "COMM") == 0);
+	uint8_t encoding = 0;
+	size_t frame_start = frames->size;
+	ga_result result;
+
+	// id3tag only finds the end of a comment's description when it's UTF-16, so comments always are.
+	for (int32_t i = 0; i < string_count; i++)
+	{
+		for (const char* c = strings[i]; *c != '\0'; c++)
+		{
+			encoding |= ((uint8_t)*c >= 0x80);
+		}
+	}
+	encoding |= is_comment;
+
+	result = append_tag_buffer(frames, frame_id, 4);
+	if (result == GA_SUCCESS)
+	{
+		result = append_tag_buffer(frames, NULL, 6);
+	}
+	if (result == GA_SUCCESS)
+	{
+		result = append_tag_buffer(frames, &encoding, 1);
+	}
+
+	// Language, then an empty description.
+	if (result == GA_SUCCESS && is_comment)
+	{
+		const uint8_t description[6] = { 'e', 'n', 'g', 0xFF, 0xFE, 0 };
+		result = append_tag_buffer(frames, description, 6);
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(frames, NULL, 1);
+		}
+	}
+
+	for (int32_t i = 0; i < string_count && result == GA_SUCCESS; i++)
+	{
+		uint8_t terminated = (i < string_count - 1);
+
+		if (encoding == 0)
+		{
+			result = append_tag_buffer(frames, strings[i], strlen(strings[i]) + terminated);
+		}
+		else
+		{
+			const uint8_t bom[2] = { 0xFF, 0xFE };
+			size_t utf16_size = utf8_to_utf16_le(strings[i], NULL);
+			size_t string_start = frames->size + 2;
+
+			result = append_tag_buffer(frames, bom, 2);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(frames, NULL, utf16_size + (terminated ? 2 : 0));
+			}
+			if (result == GA_SUCCESS)
+			{
+				utf8_to_utf16_le(strings[i], frames->data + string_start);
+			}
+		}
+	}
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	size_t frame_size = frames->size - frame_start - 10;
+
+	if (frame_size > 0x0FFFFFFF)
+	{
+		return GA_E_TAG;
+	}
+
+	uint8_t* size_data = frames->data + frame_start + 4;
+
+	for (int i = 0; i < 4; i++)
+	{
+		size_data[i] = (uint8_t)(version == 4 ? (frame_size >> (7 * (3 - i))) & 0x7F : (frame_size >> (8 * (3 - i))) & 0xFF);
+	}
+
+	return GA_SUCCESS;
+}
+
+uint32_t read_utf8_code_point(const uint8_t* c, int* length)
+{
+	uint32_t code_point = 0xFFFD;
+	*length = 1;
+
+	if (c[0] < 0x80)
+	{
+		code_point = c[0];
+	}
+	else if ((c[0] & 0xE0) == 0xC0 && (c[1] & 0xC0) == 0x80)
+	{
+		code_point = ((c[0] & 0x1Fu) << 6) | (c[1] & 0x3F);
+		*length = 2;
+	}
+	else if ((c[0] & 0xF0) == 0xE0 && (c[1] & 0xC0) == 0x80 && (c[2] & 0xC0) == 0x80)
+	{
+		code_point = ((c[0] & 0x0Fu) << 12) | ((c[1] & 0x3Fu) << 6) | (c[2] & 0x3F);
+		*length = 3;
+	}
+	else if ((c[0] & 0xF8) == 0xF0 && (c[1] & 0xC0) == 0x80 && (c[2] & 0xC0) == 0x80 && (c[3] & 0xC0) == 0x80)
+	{
+		code_point = ((c[0] & 0x07u) << 18) | ((c[1] & 0x3Fu) << 12) | ((c[2] & 0x3Fu) << 6) | (c[3] & 0x3F);
+		*length = 4;
+	}
+
+	if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF))
+	{
+		code_point = 0xFFFD;
+	}
+
+	return code_point;
+}
+
+size_t utf8_to_utf16_le(const char* input, uint8_t* output)
+{
+	const uint8_t* c = (const uint8_t*)input;
+	size_t size = 0;
+
+	while (*c != '\0')
+	{
+		int length;
+		uint32_t code_point = read_utf8_code_point(c, &length);
+
+		if (code_point >= 0x10000)
+		{
+			uint32_t high = 0xD800 + ((code_point - 0x10000) >> 10);
+			uint32_t low = 0xDC00 + ((code_point - 0x10000) & 0x3FF);
+
+			if (output != NULL)
+			{
+				output[size] = (uint8_t)high;
+				output[size + 1] = (uint8_t)(high >> 8);
+				output[size + 2] = (uint8_t)low;
+				output[size + 3] = (uint8_t)(low >> 8);
+			}
+			size += 4;
+		}
+		else
+		{
+			if (output != NULL)
+			{
+				output[size] = (uint8_t)code_point;
+				output[size + 1] = (uint8_t)(code_point >> 8);
+			}
+			size += 2;
+		}
+
+		c += length;
+	}
+
+	return size;
+}
+
+void utf8_to_latin1(const char* input, uint8_t* output, size_t output_size)
+{
+	const uint8_t* c = (const uint8_t*)input;
+
+	for (size_t i = 0; i < output_size && *c != '\0'; i++)
+	{
+		int length;
+		uint32_t code_point = read_utf8_code_point(c, &length);
+
+		output[i] = (uint8_t)(code_point <= 0xFF ? code_point : '?');
+		c += length;
+	}
+}
+
+
+/////////////////////////////////
+// Ogg Vorbis decoding wrapper //
+/////////////////////////////////
+
+inline ga_result convert_vorbis_result(int32_t result)
+{
+	switch (result)
+	{
+	case VORBIS__no_error:
+		return GA_SUCCESS; break;
+	case VORBIS_outofmem:
+		return GA_E_MEMORY; break;
+	case VORBIS_file_open_failure:
+	case VORBIS_unexpected_eof:
+		return GA_E_FILE; break;
+	case VORBIS_invalid_setup:
+	case VORBIS_invalid_stream:
+	case VORBIS_missing_capture_pattern:
+	case VORBIS_invalid_stream_structure_version:
+	case VORBIS_continued_packet_flag_invalid:
+	case VORBIS_incorrect_stream_serial_number:
+	case VORBIS_invalid_first_page:
+	case VORBIS_bad_packet_type:
+	case VORBIS_cant_find_last_page:
+	case VORBIS_seek_failed:
+	case VORBIS_ogg_skeleton_not_supported:
+		return GA_E_DECODER; break;
+	default:
+		return GA_E_GENERIC; break;
+	}
+
+	return GA_E_GENERIC;
+}
+
+ga_result get_vorbis_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
+{
+	ga_result result = GA_SUCCESS;
+	int error = 0;
+	stb_vorbis* info;
+
+	// Only the first page and the end of the file are touched, so mapped files skip setting up a decoder.
+	if (io->data != NULL)
+	{
+		ogg_vorbis_headers headers;
+
+		result = read_ogg_vorbis_headers(io->data, io->size, 0, &headers);
+
+		if (result == GA_SUCCESS)
+		{
+			*num_frames = get_ogg_vorbis_length(io->data, io->size, headers.headers_end);
+			*channels = headers.channels;
+			*sample_rate = headers.sample_rate;
+			// Lossy codecs don't have a true "bits per sample", it's all floating point math. stb_vorbis decodes to 16-bit.
+			*bits_per_sample = 16;
+
+			free_ogg_vorbis_headers(&headers);
+
+			return GA_SUCCESS;
+		}
+
+		// stb_vorbis opens some files the header parser rejects, like those cut short in the setup header, so it has the final say.
+		free_ogg_vorbis_headers(&headers);
+	}
+
+	// The fallback reads by name, as stb_vorbis reports different errors for damaged data in memory.
+	if (io->file_name == NULL)
+	{
+		return GA_E_DECODER;
+	}
+
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(io->file_name);
+	info = stb_vorbis_open_filename_w(wide_file_name, &error, NULL);
+	free(wide_file_name);
+#else
+	info = stb_vorbis_open_filename(io->file_name, &error, NULL);
+#endif
+
+	result = convert_vorbis_result(error);
+
+	if (info == NULL || result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	*num_frames = (uint64_t)stb_vorbis_stream_length_in_samples(info);
+	*channels = (uint32_t)info->channels;
+	*sample_rate = (uint32_t)info->sample_rate;
+	// Lossy codecs don't have a true "bits per sample", it's all floating point math. stb_vorbis decodes to 16-bit.
+	*bits_per_sample = 16;
+
+	stb_vorbis_close(info);
+
+	return result;
+}
+
+int16_t* load_vorbis(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
+{
+	int ogg_num_frames = 0;
+	int ogg_channels = 0;
+	int ogg_sample_rate = 0;
+	int ogg_error_code = 0;
+	short* sample_data = NULL;
+
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	ogg_num_frames = stb_vorbis_decode_filename_w(wide_file_name, &ogg_channels, &ogg_sample_rate, &sample_data);
+	free(wide_file_name);
+#else
+	ogg_num_frames = stb_vorbis_decode_filename(file_name, &ogg_channels, &ogg_sample_rate, &sample_data);
+#endif
+
+	if (ogg_num_frames < 0)
+	{
+		*result = GA_E_GENERIC;
+		return NULL;
+	}
+
+	*num_frames = (uint64_t)ogg_num_frames;
+	*channels = (uint32_t)ogg_channels;
+	*sample_rate = (uint32_t)ogg_sample_rate;
+	*result = GA_SUCCESS;
+
+	return (int16*)sample_data;
+}
+
+void free_vorbis(int16_t* sample_data)
+{
+	free(sample_data);
+}
+
+ga_result open_vorbis_file(ga_io* io, void** decoder)
+{
+	ga_result result = GA_SUCCESS;
+	int error = 0;
+	stb_vorbis* vorbis;
+
+	// stb_vorbis takes an int length, so larger mappings are read through the file instead.
+	if (io->data != NULL && io->size <= INT_MAX)
+	{
+		vorbis = stb_vorbis_open_memory(io->data, (int)io->size, &error, NULL);
+	}
+	else if (io->file_name == NULL)
+	{
+		// Data in memory has no file to fall back to.
+		return GA_E_DECODER;
+	}
+	else
+	{
+#if defined(_WIN32)
+		wchar_t* wide_file_name = widen(io->file_name);
+		vorbis = stb_vorbis_open_filename_w(wide_file_name, &error, NULL);
+		free(wide_file_name);
+#else
+		vorbis = stb_vorbis_open_filename(io->file_name, &error, NULL);
+#endif
+	}
+
+	result = convert_vorbis_result(error);
+
+	if (vorbis == NULL || result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	vorbis_decoder* decoder_data = (vorbis_decoder*)malloc(sizeof(vorbis_decoder));
+
+	if (decoder_data == NULL)
+	{
+		stb_vorbis_close(vorbis);
+		return GA_E_MEMORY;
+	}
+
+	decoder_data->vorbis = vorbis;
+	decoder_data->io = io;
+	decoder_data->pages = NULL;
+	decoder_data->num_pages = 0;
+	decoder_data->index_built = 0;
+
+	*decoder = (void*)decoder_data;
+
+	return result;
+}
+
+ga_result get_basic_vorbis_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	stb_vorbis* vorbis = ((vorbis_decoder*)decoder)->vorbis;
+
+	*channels = vorbis->channels;
+	*sample_rate = vorbis->sample_rate;
+	*read_offset = stb_vorbis_get_sample_offset(vorbis);
+
+	return GA_SUCCESS;
+}
+
+ga_result get_vorbis_file_length(void* decoder, uint64_t* num_frames)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	stb_vorbis* vorbis = ((vorbis_decoder*)decoder)->vorbis;
+
+	// Finds the final page of the stream and restores the read position.
+	unsigned int length = stb_vorbis_stream_length_in_samples(vorbis);
+
+	// Clear any error from searching for the last page, the stream can still be decoded.
+	stb_vorbis_get_error(vorbis);
+
+	// Zero when the last page couldn't be found, and saturated for streams longer than 32 bits of samples.
+	if (length == 0 || length >= 0xFFFFFFFE)
+	{
+		*num_frames = 0;
+		return GA_E_DECODER;
+	}
+
+	*num_frames = (uint64_t)length;
+
+	return GA_SUCCESS;
+}
+
+ga_result seek_vorbis_file(void* decoder, uint64_t offset, uint64_t* new_offset)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	vorbis_decoder* decoder_data = (vorbis_decoder*)decoder;
+	stb_vorbis* vorbis = decoder_data->vorbis;
+
+	if (!decoder_data->index_built)
+	{
+		build_vorbis_index(decoder_data);
+	}
+
+	// Clear any previous errors
+	stb_vorbis_get_error(vorbis);
+
+	if (decoder_data->pages != NULL)
+	{
+		stb_vorbis_seek_indexed(vorbis, decoder_data->pages, decoder_data->num_pages, (unsigned int)offset);
+	}
+	else
+	{
+		stb_vorbis_seek(vorbis, (unsigned int)offset);
+	}
+
+	return convert_vorbis_result(stb_vorbis_get_error(vorbis));
+}
+
+ga_result read_vorbis_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	stb_vorbis* vorbis = ((vorbis_decoder*)decoder)->vorbis;
+
+	// Clear any previous errors
+	stb_vorbis_get_error(vorbis);
+
+	void* temp_buffer = NULL;
 
-	// MP3 decoder offset values are in terms of total samples (ie. samples * channels), and not samples/ch like the other decoders or LabVIEW wrapper.
-	// Multiply by channels to get actual number of samples to read. Divide result by channels to get samples/ch.
 	switch (audio_type)
 	{
 	case ga_data_type_u8:
-		temp_buffer = malloc(frames_to_read * num_channels * sizeof(mp3d_sample_t));
-		*frames_read = mp3dec_ex_read((mp3dec_ex_t*)decoder, (mp3d_sample_t*)temp_buffer, frames_to_read * num_channels) / num_channels;
-		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, frames_to_read * num_channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * vorbis->channels * sizeof(short));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = stb_vorbis_get_samples_short_interleaved(vorbis, vorbis->channels, (short*)temp_buffer, frames_to_read * vorbis->channels);
+		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, *frames_read * vorbis->channels);
 		break;
 	case ga_data_type_i16:
-		*frames_read = mp3dec_ex_read((mp3dec_ex_t*)decoder, (mp3d_sample_t*)output_buffer, frames_to_read * num_channels) / num_channels;
+		*frames_read = stb_vorbis_get_samples_short_interleaved(vorbis, vorbis->channels, (short*)output_buffer, frames_to_read * vorbis->channels);
 		break;
 	case ga_data_type_i32:
-		temp_buffer = malloc(frames_to_read * num_channels * sizeof(mp3d_sample_t));
-		*frames_read = mp3dec_ex_read((mp3dec_ex_t*)decoder, (mp3d_sample_t*)temp_buffer, frames_to_read * num_channels) / num_channels;
-		s16_to_s32((int32_t*)output_buffer, (int16_t*)temp_buffer, frames_to_read * num_channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * vorbis->channels * sizeof(short));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = stb_vorbis_get_samples_short_interleaved(vorbis, vorbis->channels, (short*)temp_buffer, frames_to_read * vorbis->channels);
+		s16_to_s32((int32_t*)output_buffer, (int16_t*)temp_buffer, *frames_read * vorbis->channels);
 		break;
 	case ga_data_type_float:
-		temp_buffer = malloc(frames_to_read * num_channels * sizeof(mp3d_sample_t));
-		*frames_read = mp3dec_ex_read((mp3dec_ex_t*)decoder, (mp3d_sample_t*)temp_buffer, frames_to_read * num_channels) / num_channels;
-		s16_to_f32((float*)output_buffer, (int16_t*)temp_buffer, frames_to_read * num_channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
+		*frames_read = stb_vorbis_get_samples_float_interleaved(vorbis, vorbis->channels, (float*)output_buffer, frames_to_read * vorbis->channels);
 		break;
 	case ga_data_type_double:
-		temp_buffer = malloc(frames_to_read * num_channels * sizeof(mp3d_sample_t));
-		*frames_read = mp3dec_ex_read((mp3dec_ex_t*)decoder, (mp3d_sample_t*)temp_buffer, frames_to_read * num_channels) / num_channels;
-		s16_to_f64((double*)output_buffer, (int16_t*)temp_buffer, frames_to_read * num_channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
+		// Decode to float in the upper half of the output buffer, then widen in place.
+		temp_buffer = (float*)output_buffer + (frames_to_read * vorbis->channels);
+		*frames_read = stb_vorbis_get_samples_float_interleaved(vorbis, vorbis->channels, (float*)temp_buffer, frames_to_read * vorbis->channels);
+		f32_to_f64((double*)output_buffer, (float*)temp_buffer, *frames_read * vorbis->channels);
 		break;
 	default:
 		return GA_E_INVALID_TYPE;
 		break;
 	}
 
-	if (*frames_read < 0)
+	return convert_vorbis_result(stb_vorbis_get_error(vorbis));
+}
+
+ga_result close_vorbis_file(void* decoder)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	vorbis_decoder* decoder_data = (vorbis_decoder*)decoder;
+
+	stb_vorbis_close(decoder_data->vorbis);
+	free(decoder_data->pages);
+	free(decoder_data);
+
+	return GA_SUCCESS;
+}
+
+void build_vorbis_index(vorbis_decoder* decoder)
+{
+	vorbis_index_entry index;
+	uint64_t file_size = 0;
+	int64_t modified_time = 0;
+	uint64_t file_id = 0;
+	const char* file_name = decoder->io->file_name;
+	// Data in memory has no stamp to match a cached index against, so it's indexed but never cached.
+	uint8_t use_cache = (file_name != NULL && ga_io_get_file_stamp(decoder->io, &file_size, &modified_time, &file_id) == GA_SUCCESS);
+
+	decoder->index_built = 1;
+
+	if (use_cache)
+	{
+		lock_ga_mutex(ga_mutex_vorbis_index);
+		//// START CRITICAL SECTION ////
+		use_cache = vorbis_index_cache_enabled;
+
+		for (int i = 0; i < VORBIS_INDEX_CACHE_ENTRIES && use_cache; i++)
+		{
+			vorbis_index_entry* entry = &vorbis_index_cache[i];
+
+			if (entry->file_name != NULL && !strcmp(entry->file_name, file_name))
+			{
+				if (entry->file_size != file_size || entry->modified_time != modified_time || entry->file_id != file_id)
+				{
+					// The file has changed since it was indexed.
+					free_vorbis_index_entry(entry);
+					break;
+				}
+
+				decoder->pages = (vorbis_page*)malloc(entry->num_pages * sizeof(vorbis_page));
+
+				if (decoder->pages != NULL)
+				{
+					memcpy(decoder->pages, entry->pages, entry->num_pages * sizeof(vorbis_page));
+					decoder->num_pages = entry->num_pages;
+					entry->last_used = ++vorbis_index_cache_clock;
+				}
+				break;
+			}
+		}
+		//// END CRITICAL SECTION ////
+		unlock_ga_mutex(ga_mutex_vorbis_index);
+
+		if (decoder->pages != NULL)
+		{
+			return;
+		}
+	}
+
+	if (!stb_vorbis_build_page_index(decoder->vorbis, &(decoder->pages), &(decoder->num_pages)))
+	{
+		// Seeks fall back to stb_vorbis_seek.
+		stb_vorbis_get_error(decoder->vorbis);
+		return;
+	}
+
+	if (use_cache)
+	{
+		index.file_name = (char*)file_name;
+		index.file_size = file_size;
+		index.modified_time = modified_time;
+		index.file_id = file_id;
+		index.pages = decoder->pages;
+		index.num_pages = decoder->num_pages;
+		index.last_used = 0;
+
+		lock_ga_mutex(ga_mutex_vorbis_index);
+		if (vorbis_index_cache_enabled)
+		{
+			insert_vorbis_index(&index);
+		}
+		unlock_ga_mutex(ga_mutex_vorbis_index);
+	}
+}
+
+ga_result insert_vorbis_index(const vorbis_index_entry* index)
+{
+	int slot = -1;
+
+	// Replace the file's existing entry, then use an empty entry, and finally evict the least recently used entry.
+	for (int i = 0; i < VORBIS_INDEX_CACHE_ENTRIES && slot < 0; i++)
+	{
+		if (vorbis_index_cache[i].file_name != NULL && !strcmp(vorbis_index_cache[i].file_name, index->file_name))
+		{
+			slot = i;
+		}
+	}
+
+	for (int i = 0; i < VORBIS_INDEX_CACHE_ENTRIES && slot < 0; i++)
+	{
+		if (vorbis_index_cache[i].file_name == NULL)
+		{
+			slot = i;
+		}
+	}
+
+	if (slot < 0)
+	{
+		slot = 0;
+		for (int i = 1; i < VORBIS_INDEX_CACHE_ENTRIES; i++)
+		{
+			if (vorbis_index_cache[i].last_used < vorbis_index_cache[slot].last_used)
+			{
+				slot = i;
+			}
+		}
+	}
+
+	char* file_name = (char*)malloc(strlen(index->file_name) + 1);
+	vorbis_page* pages = (vorbis_page*)malloc(index->num_pages * sizeof(vorbis_page));
+
+	if (file_name == NULL || pages == NULL)
+	{
+		free(file_name);
+		free(pages);
+		return GA_E_MEMORY;
+	}
+
+	strcpy(file_name, index->file_name);
+	memcpy(pages, index->pages, index->num_pages * sizeof(vorbis_page));
+
+	free_vorbis_index_entry(&vorbis_index_cache[slot]);
+	vorbis_index_cache[slot] = *index;
+	vorbis_index_cache[slot].file_name = file_name;
+	vorbis_index_cache[slot].pages = pages;
+	vorbis_index_cache[slot].last_used = ++vorbis_index_cache_clock;
+
+	return GA_SUCCESS;
+}
+
+void free_vorbis_index_entry(vorbis_index_entry* entry)
+{
+	free(entry->file_name);
+	free(entry->pages);
+	memset(entry, 0, sizeof(vorbis_index_entry));
+}
+
+ga_result get_vorbis_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+{
+	ga_result result = GA_SUCCESS;
+	int error = 0;
+	stb_vorbis* vorbis_decoder;
+	audio_file_tag_info tag_info = {};
+
+	tag_info.picture_mode = picture_mode;
+	tag_info.thumbnail_size = thumbnail_size;
+
+	// The comments are in the second packet, so mapped files are parsed directly rather than building a decoder from the setup header.
+	if (io->data != NULL)
+	{
+		ogg_vorbis_headers headers;
+
+		result = read_ogg_vorbis_headers(io->data, io->size, 1, &headers);
+
+		if (result == GA_SUCCESS)
+		{
+			result = get_vorbis_comment_tags(headers.comment_list, headers.comment_count, &tag_info);
+		}
+		else if (result != GA_E_MEMORY)
+		{
+			result = GA_E_TAG;
+		}
+
+		free_ogg_vorbis_headers(&headers);
+	}
+	else
+	{
+#if defined(_WIN32)
+		wchar_t* wide_file_name = widen(io->file_name);
+		vorbis_decoder = stb_vorbis_open_filename_w(wide_file_name, &error, NULL);
+		free(wide_file_name);
+#else
+		vorbis_decoder = stb_vorbis_open_filename(io->file_name, &error, NULL);
+#endif
+
+		result = convert_vorbis_result(error);
+
+		if (vorbis_decoder == NULL || result != GA_SUCCESS)
+		{
+			return GA_E_TAG;
+		}
+
+		result = get_vorbis_comment_tags(vorbis_decoder->comment_list, vorbis_decoder->comment_list_length, &tag_info);
+		stb_vorbis_close(vorbis_decoder);
+	}
+
+	if (result != GA_SUCCESS)
+	{
+		free_audio_file_tag_info(&tag_info);
+		return result;
+	}
+
+	return pack_audio_file_tags(&tag_info, tags, tag_count, pictures, picture_count);
+}
+
+ga_result get_vorbis_comment_tags(char** comment_list, int32_t comment_count, audio_file_tag_info* tag_info)
+{
+	int32_t length;
+	int32_t token_offset;
+	int32_t field_length;
+	int32_t value_length;
+
+	for (int i = 0; i < comment_count; i++)
+	{
+		token_offset = ga_find_token(comment_list[i], '=');
+
+		if (token_offset > 0)
+		{
+			length = strlen(comment_list[i]);
+			value_length = length - token_offset;
+			field_length = length - value_length - 1;
+
+			if (strncmp(comment_list[i], "METADATA_BLOCK_PICTURE", field_length) == 0)
+			{
+				if (tag_info->picture_mode != ga_picture_none)
+				{
+					int32_t block_size;
+					const uint8_t* picture_block = (const uint8_t*)base64_dec_malloc(comment_list[i] + token_offset, &block_size);
+					// Pictures that can't be read are skipped.
+					parse_metadata_block_picture(picture_block, block_size, tag_info);
+					free((void*)picture_block);
+				}
+			}
+			else
+			{
+				ga_result result = add_audio_file_tag(tag_info, comment_list[i], field_length, comment_list[i] + token_offset, value_length);
+
+				if (result != GA_SUCCESS)
+				{
+					return result;
+				}
+			}
+		}
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result read_ogg_vorbis_headers(const uint8_t* data, size_t size, uint8_t read_comments, ogg_vorbis_headers* headers)
+{
+	size_t page_size;
+	size_t packet_size = 0;
+	const uint8_t* packet;
+
+	memset(headers, 0, sizeof(ogg_vorbis_headers));
+
+	// The first page starts the stream, and holds only the 30 byte identification header. These are the checks stb_vorbis makes when opening.
+	page_size = get_ogg_page_size(data, size, 0);
+
+	if (page_size == 0 || !(data[5] & 0x02) || (data[5] & 0x05) || data[26] != 1 || data[27] != 30)
+	{
+		return GA_E_DECODER;
+	}
+
+	packet = data + 28;
+
+	if (packet[0] != 1 || memcmp(packet + 1, "vorbis", 6) != 0 || read_u32_le(packet + 7) != 0)
+	{
+		return GA_E_DECODER;
+	}
+
+	uint32_t log0 = packet[28] & 15;
+	uint32_t log1 = packet[28] >> 4;
+	headers->channels = packet[11];
+	headers->sample_rate = read_u32_le(packet + 12);
+
+	if (headers->channels == 0 || headers->channels > STB_VORBIS_MAX_CHANNELS || headers->sample_rate == 0
+		|| log0 < 6 || log0 > 13 || log1 < 6 || log1 > 13 || log0 > log1 || !(packet[29] & 1))
+	{
+		return GA_E_DECODER;
+	}
+
+	// The comment header starts on the second page, and may continue over several pages if it holds pictures.
+	// It's followed by the setup header, which only needs to be complete. Audio starts on the page after it.
+	size_t offset = page_size;
+	uint32_t segment = 0;
+	size_t comment_offset = offset;
+	size_t setup_size;
+	ga_result result = read_ogg_packet(data, size, &offset, &segment, NULL, &packet_size);
+
+	if (result == GA_SUCCESS)
+	{
+		result = read_ogg_packet(data, size, &offset, &segment, NULL, &setup_size);
+	}
+
+	if (result != GA_SUCCESS)
+	{
+		return result;
+	}
+
+	// stb_vorbis only records where the audio starts when the setup header ends a page.
+	headers->headers_end = (segment == 0 ? offset : 0);
+
+	if (!read_comments)
+	{
+		return GA_SUCCESS;
+	}
+
+	headers->comment_data = (uint8_t*)malloc(packet_size + 1);
+
+	if (headers->comment_data == NULL)
+	{
+		return GA_E_MEMORY;
+	}
+
+	offset = comment_offset;
+	segment = 0;
+	read_ogg_packet(data, size, &offset, &segment, headers->comment_data, &packet_size);
+
+	// Packet type, "vorbis", vendor string, comment count, the comments and the framing bit.
+	// Each comment is moved over its length so it can be terminated in place.
+	uint8_t* comment = headers->comment_data;
+	size_t remaining = packet_size;
+
+	if (remaining < 11 || comment[0] != 3 || memcmp(comment + 1, "vorbis", 6) != 0)
+	{
+		return GA_E_DECODER;
+	}
+
+	uint32_t vendor_length = read_u32_le(comment + 7);
+	comment += 11;
+	remaining -= 11;
+
+	if (vendor_length > remaining || remaining - vendor_length < 4)
+	{
+		return GA_E_DECODER;
+	}
+
+	comment += vendor_length;
+	remaining -= vendor_length;
+	uint32_t comment_count = read_u32_le(comment);
+	comment += 4;
+	remaining -= 4;
+
+	if (comment_count > remaining / 4)
+	{
+		return GA_E_DECODER;
+	}
+
+	if (comment_count > 0)
+	{
+		headers->comment_list = (char**)malloc(sizeof(char*) * comment_count);
+
+		if (headers->comment_list == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+	}
+
+	for (uint32_t i = 0; i < comment_count; i++)
+	{
+		uint32_t length;
+
+		if (remaining < 4 || (length = read_u32_le(comment)) > remaining - 4)
+		{
+			return GA_E_DECODER;
+		}
+
+		memmove(comment, comment + 4, length);
+		comment[length] = '\0';
+		headers->comment_list[i] = (char*)comment;
+		headers->comment_count++;
+		comment += length + 4;
+		remaining -= length + 4;
+	}
+
+	if (remaining < 1 || !(comment[0] & 1))
+	{
+		return GA_E_DECODER;
+	}
+
+	return GA_SUCCESS;
+}
+
+void free_ogg_vorbis_headers(ogg_vorbis_headers* headers)
+{
+	free(headers->comment_list);
+	free(headers->comment_data);
+	memset(headers, 0, sizeof(ogg_vorbis_headers));
+}
+
+ga_result read_ogg_packet(const uint8_t* data, size_t size, size_t* offset, uint32_t* segment, uint8_t* output, size_t* packet_size)
+{
+	size_t position = 0;
+
+	for (;;)
+	{
+		size_t page_size = get_ogg_page_size(data, size, *offset);
+
+		if (page_size == 0)
+		{
+			return GA_E_DECODER;
+		}
+
+		uint32_t segments = data[*offset + 26];
+		const uint8_t* lacing = data + *offset + 27;
+		const uint8_t* body = lacing + segments;
+
+		for (uint32_t i = 0; i < *segment; i++)
+		{
+			body += lacing[i];
+		}
+
+		while (*segment < segments)
+		{
+			uint8_t length = lacing[*segment];
+
+			if (output != NULL)
+			{
+				memcpy(output + position, body, length);
+			}
+
+			position += length;
+			body += length;
+			(*segment)++;
+
+			// A lacing value under 255 ends the packet.
+			if (length < 255)
+			{
+				if (*segment == segments)
+				{
+					*offset += page_size;
+					*segment = 0;
+				}
+
+				*packet_size = position;
+				return GA_SUCCESS;
+			}
+		}
+
+		*offset += page_size;
+		*segment = 0;
+	}
+}
+
+size_t get_ogg_page_size(const uint8_t* data, size_t size, size_t offset)
+{
+	if (offset > size || size - offset < 27 || memcmp(data + offset, "OggS", 4) != 0 || data[offset + 4] != 0)
 	{
-		*frames_read = 0;
-		return GA_E_GENERIC;
+		return 0;
 	}
 
-	return GA_SUCCESS;
-}
+	uint32_t segments = data[offset + 26];
+	size_t page_size = 27 + segments;
 
-ga_result close_mp3_file(void* decoder)
-{
-	if (decoder == NULL)
+	if (size - offset < page_size)
 	{
-		return GA_E_GENERIC;
+		return 0;
 	}
 
-	mp3dec_ex_close((mp3dec_ex_t*)decoder);
-	free(decoder);
+	for (uint32_t i = 0; i < segments; i++)
+	{
+		page_size += data[offset + 27 + i];
+	}
 
-	return GA_SUCCESS;
+	return (size - offset < page_size ? 0 : page_size);
 }
 
-id3tag_t* load_id3_tag(const char* file_name)
+uint8_t find_ogg_page(const uint8_t* data, size_t size, size_t offset, size_t* page_start, size_t* page_end, uint8_t* last_page)
 {
-	FILE* pFile;
-	ID3TAG_U8 tag_size_data[10];
-	size_t tag_size;
-	void* tag_data;
-	id3tag_t* id3tag;
-
-	pFile = ga_fopen(file_name);
-	if (pFile == NULL)
+	for (size_t i = offset; i < size; i++)
 	{
-		return NULL;
-	}
+		if (data[i] != 'O')
+		{
+			continue;
+		}
 
-	fseek(pFile, 0, SEEK_SET);
-	fread(&tag_size_data, 1, sizeof(tag_size_data), pFile);
+		// No page can start this close to the end of the file.
+		if (size - i < 27)
+		{
+			return 0;
+		}
 
-	tag_size = id3tag_size(tag_size_data);
-	// ID3v2 tag found
-	if (tag_size > 0)
-	{
-		tag_data = malloc(tag_size);
+		if (memcmp(data + i, "OggS", 4) != 0 || data[i + 4] != 0)
+		{
+			continue;
+		}
 
-		if (tag_data == NULL)
+		// stb_vorbis reads past the end of the file as zeros, so a final page cut short still matches if the missing bytes were zero (eg. padding).
+		// The CRC is calculated with the checksum field zeroed.
+		uint32_t segments = data[i + 26];
+		size_t header_size = 27 + segments;
+		size_t page_size = header_size;
+		uint32_t crc = 0;
+
+		for (size_t j = 0; j < header_size; j++)
 		{
-			fclose(pFile);
-			return NULL;
+			uint8_t value = (j >= 22 && j < 26) ? 0 : (size - i > j ? data[i + j] : 0);
+			crc = crc32_update(crc, value);
+			page_size += (j >= 27 ? value : 0);
 		}
 
-		fseek(pFile, 0, SEEK_SET);
-		fread(tag_data, 1, tag_size, pFile);
-		fclose(pFile);
-		id3tag = id3tag_load(tag_data, tag_size, ID3TAG_ALL_FIELDS, NULL);
-		free(tag_data);
-	}
-	// No ID3V2 tag, try ID3v1
-	else
-	{
-		tag_data = malloc(128);
+		// A page whose lacing values run past the end of the file stops the search.
+		if (page_size > header_size && size - i < header_size)
+		{
+			return 0;
+		}
 
-		if (tag_data == NULL)
+		for (size_t j = header_size; j < page_size; j++)
 		{
-			fclose(pFile);
-			return NULL;
+			crc = crc32_update(crc, size - i > j ? data[i + j] : 0);
 		}
 
-		fseek(pFile, -128, SEEK_END);
-		fread(tag_data, 1, 128, pFile);
-		fclose(pFile);
-		id3tag = id3tag_load_id3v1(tag_data, 128, NULL);
-		free(tag_data);
+		if (crc == read_u32_le(data + i + 22))
+		{
+			*page_start = i;
+			*page_end = (size - i < page_size ? size : i + page_size);
+			*last_page = (data[i + 5] & 0x04) ? 1 : 0;
+			return 1;
+		}
 	}
 
-	return id3tag;
+	return 0;
 }
 
-ga_result get_id3_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+uint64_t get_ogg_vorbis_length(const uint8_t* data, size_t size, size_t audio_offset)
 {
-	enum fields_t
-	{
-		FIELD_TITLE,
-		FIELD_ARTIST,
-		FIELD_ALBUM_ARTIST,
-		FIELD_ALBUM,
-		FIELD_GENRE,
-		FIELD_YEAR,
-		FIELD_TRACK,
-		FIELD_TRACKS,
-		FIELD_DISC,
-		FIELD_DISCS,
-		FIELD_COMPILATION,
-		FIELD_BPM,
-		FIELD_COMMENT,
-		FIELD_USER_TEXT,
+	size_t page_start;
+	size_t page_end;
+	size_t last_page_start;
+	uint8_t last_page;
 
-		FIELDCOUNT
-	};
+	crc32_init();
 
-	const char* tag_field_prefix[FIELDCOUNT] =
+	// The last page is at most a little less than 64KB, so the search starts that far from the end of the file.
+	if (!find_ogg_page(data, size, (size >= 65536 && size - 65536 >= audio_offset) ? size - 65536 : audio_offset, &page_start, &page_end, &last_page))
 	{
-		"TITLE",
-		"ARTIST",
-		"ALBUMARTIST",
-		"ALBUM",
-		"GENRE",
-		"DATE",
-		"TRACKNUMBER",
-		"TRACKTOTAL",
-		"DISCNUMBER",
-		"DISCTOTAL",
-		"COMPILATION",
-		"BPM",
-		"COMMENT"
-	};
-
-	audio_file_tag_info tag_info = {};
-	const char* current_tag = NULL;
-	id3tag_t* id3tag;
+		return 0;
+	}
 
-	id3tag = load_id3_tag(file_name);
+	last_page_start = page_start;
 
-	if (id3tag == NULL)
+	while (!last_page && find_ogg_page(data, size, page_end, &page_start, &page_end, &last_page))
 	{
-		return GA_E_TAG;
+		last_page_start = page_start;
 	}
 
-	tag_info.tag_count = 0;
-	tag_info.tags = (audio_file_tag*)calloc(FIELDCOUNT, sizeof(audio_file_tag));
+	uint32_t lo = read_u32_le(data + last_page_start + 6);
+	uint32_t hi = read_u32_le(data + last_page_start + 10);
 
-	if (tag_info.tags == NULL)
+	if (lo == 0xffffffff && hi == 0xffffffff)
 	{
-		free_audio_file_tags(tag_info);
-		id3tag_free(id3tag);
-		return GA_E_MEMORY;
+		return 0;
 	}
 
-	for (int field_index = 0; field_index < FIELDCOUNT; field_index++)
-	{
-		current_tag = NULL;
-		switch (field_index)
-		{
-			case FIELD_TITLE:        if (id3tag->title != NULL) { current_tag = id3tag->title; } break;
-			case FIELD_ARTIST:       if (id3tag->artist != NULL) { current_tag = id3tag->artist; } break;
-			case FIELD_ALBUM_ARTIST: if (id3tag->album_artist != NULL) { current_tag = id3tag->album_artist; } break;
-			case FIELD_ALBUM:        if (id3tag->album != NULL) { current_tag = id3tag->album; } break;
-			case FIELD_GENRE:        if (id3tag->genre != NULL) { current_tag = id3tag->genre; } break;
-			case FIELD_YEAR:         if (id3tag->year != NULL) { current_tag = id3tag->year; } break;
-			case FIELD_TRACK:        if (id3tag->track != NULL) { current_tag = id3tag->track; } break;
-			case FIELD_TRACKS:       if (id3tag->tracks != NULL) { current_tag = id3tag->tracks; } break;
-			case FIELD_DISC:         if (id3tag->disc != NULL) { current_tag = id3tag->disc; } break;
-			case FIELD_DISCS:        if (id3tag->discs != NULL) { current_tag = id3tag->discs; } break;
-			case FIELD_COMPILATION:  if (id3tag->compilation != NULL) { current_tag = id3tag->compilation; } break;
-			case FIELD_BPM:          if (id3tag->bpm != NULL) { current_tag = id3tag->bpm; } break;
-			case FIELD_COMMENT:      if (id3tag->comment != NULL) { current_tag = id3tag->comment; } break;
-			default:                 current_tag = NULL; break;
-		}
-
-		if (current_tag != NULL)
-		{
-			int tag_index = tag_info.tag_count;
+	// stb_vorbis counts samples in 32 bits, and saturates longer streams.
+	return (hi ? 0xfffffffe : lo);
+}
 
-			tag_info.tags[tag_index].field_length = strlen(tag_field_prefix[field_index]);
-			tag_info.tags[tag_index].value_length = strlen(current_tag);
 
-			tag_info.tags[tag_index].field = (char*)malloc(tag_info.tags[tag_index].field_length + 1); // Add 1 for '\0' terminatation
-			tag_info.tags[tag_index].value = (char*)malloc(tag_info.tags[tag_index].value_length + 1); // Add 1 for '\0' terminatation
+ga_result set_vorbis_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten)
+{
+	tag_buffer pages = {};
+	tag_buffer packet = {};
+	tag_buffer new_pages = {};
+	uint8_t* setup = NULL;
+	size_t id_page_size = 0;
+	size_t page_size = 0;
+	size_t comment_size = 0;
+	size_t setup_size = 0;
+	uint32_t header_page_count = 0;
+	uint32_t packets_ended = 0;
+	uint32_t serial;
+	uint32_t sequence;
+	ga_result result;
+	FILE* pFile;
 
-			if (tag_info.tags[tag_index].field == NULL || tag_info.tags[tag_index].value == NULL)
-			{
-				free_audio_file_tags(tag_info);
-				id3tag_free(id3tag);
-				return GA_E_MEMORY;
-			}
+	pFile = ga_fopen(file_name);
 
-			memcpy(tag_info.tags[tag_index].field, tag_field_prefix[field_index], tag_info.tags[tag_index].field_length);
-			tag_info.tags[tag_index].field[tag_info.tags[tag_index].field_length] = '\0';
-			memcpy(tag_info.tags[tag_index].value, current_tag, tag_info.tags[tag_index].value_length);
-			tag_info.tags[tag_index].value[tag_info.tags[tag_index].value_length] = '\0';
-			tag_info.tag_count++;
-		}
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
 
-		if (field_index == FIELD_USER_TEXT && id3tag->user_text != NULL && id3tag->user_text_count > 0)
-		{
-			int tag_offset = tag_info.tag_count;
-			int tag_index = 0;
-			int temp_count = tag_info.tag_count + id3tag->user_text_count;
-			audio_file_tag* temp_tags_ptr = tag_info.tags;
+	// The identification header is alone on the first page.
+	result = read_ogg_page(pFile, &pages, &id_page_size);
 
-			tag_info.tags = (audio_file_tag*)realloc(temp_tags_ptr, sizeof(audio_file_tag) * temp_count);
-			if (tag_info.tags == NULL)
-			{
-				tag_info.tags = temp_tags_ptr;
-				free_audio_file_tags(tag_info);
-				id3tag_free(id3tag);
-				return GA_E_MEMORY;
-			}
+	if (result == GA_SUCCESS && (id_page_size == 0 || !(pages.data[5] & 0x02) || pages.data[26] != 1 || pages.data[27] != 30 || pages.data[28] != 1 || memcmp(pages.data + 29, "vorbis", 6) != 0))
+	{
+		result = GA_E_DECODER;
+	}
 
-			memset(tag_info.tags + tag_offset, 0, sizeof(audio_file_tag) * id3tag->user_text_count);
-			tag_info.tag_count = temp_count;
+	serial = (result == GA_SUCCESS ? read_u32_le(pages.data + 14) : 0);
+	sequence = (result == GA_SUCCESS ? read_u32_le(pages.data + 18) + 1 : 0);
 
-			for (int user_text_index = 0; user_text_index < id3tag->user_text_count; user_text_index++)
-			{
-				tag_index = tag_offset + user_text_index;
+	// Read the pages of the comment and setup headers. Audio has to start on the page after them, and pages of other streams
+	// can't be mixed in, otherwise the headers can't be rewritten on their own.
+	while (result == GA_SUCCESS && packets_ended < 2)
+	{
+		size_t page_start = pages.size;
+		result = read_ogg_page(pFile, &pages, &page_size);
 
-				tag_info.tags[tag_index].field_length = strlen(id3tag->user_text[user_text_index].desc);
-				tag_info.tags[tag_index].value_length = strlen(id3tag->user_text[user_text_index].value);
+		if (result != GA_SUCCESS || page_size == 0)
+		{
+			result = GA_E_DECODER;
+			break;
+		}
 
-				tag_info.tags[tag_index].field = (char*)malloc(tag_info.tags[tag_index].field_length + 1); // Add 1 for '\0' terminatation
-				tag_info.tags[tag_index].value = (char*)malloc(tag_info.tags[tag_index].value_length + 1); // Add 1 for '\0' terminatation
+		const uint8_t* page = pages.data + page_start;
+		uint32_t segments = page[26];
 
-				if (tag_info.tags[tag_index].field == NULL || tag_info.tags[tag_index].value == NULL)
-				{
-					free_audio_file_tags(tag_info);
-					id3tag_free(id3tag);
-					return GA_E_MEMORY;
-				}
+		if (read_u32_le(page + 14) != serial || (page[5] & 0x02))
+		{
+			result = GA_E_UNSUPPORTED_TAG;
+			break;
+		}
 
-				memcpy(tag_info.tags[tag_index].field, id3tag->user_text[user_text_index].desc, tag_info.tags[tag_index].field_length);
-				tag_info.tags[tag_index].field[tag_info.tags[tag_index].field_length] = '\0';
-				memcpy(tag_info.tags[tag_index].value, id3tag->user_text[user_text_index].value, tag_info.tags[tag_index].value_length);
-				tag_info.tags[tag_index].value[tag_info.tags[tag_index].value_length] = '\0';
+		for (uint32_t i = 0; i < segments; i++)
+		{
+			if (page[27 + i] < 255 && ++packets_ended == 2 && i != segments - 1)
+			{
+				result = GA_E_UNSUPPORTED_TAG;
 			}
 		}
+
+		header_page_count++;
 	}
 
-	if (read_pictures)
+	if (result == GA_SUCCESS)
 	{
-		int32_t x, y, n;
-		tag_info.pictures = (audio_file_picture*)calloc(id3tag->pics_count, sizeof(audio_file_picture));
+		size_t offset = id_page_size;
+		uint32_t segment = 0;
 
-		if (tag_info.pictures == NULL)
+		result = read_ogg_packet(pages.data, pages.size, &offset, &segment, NULL, &comment_size);
+		if (result == GA_SUCCESS)
 		{
-			free_audio_file_tags(tag_info);
-			id3tag_free(id3tag);
-			return GA_E_MEMORY;
+			result = read_ogg_packet(pages.data, pages.size, &offset, &segment, NULL, &setup_size);
+		}
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&packet, NULL, comment_size);
+		}
+		if (result == GA_SUCCESS)
+		{
+			setup = (uint8_t*)malloc(setup_size > 0 ? setup_size : 1);
+		}
+		if (result == GA_SUCCESS && setup == NULL)
+		{
+			result = GA_E_MEMORY;
 		}
 
-		tag_info.picture_count = 0;
-		for (int i = 0; i < id3tag->pics_count; i++)
+		if (result == GA_SUCCESS)
 		{
-			tag_info.pictures[i].data = stbi_load_from_memory((stbi_uc*)id3tag->pics[i].data, id3tag->pics[i].size, &x, &y, &n, 4);
+			offset = id_page_size;
+			segment = 0;
+			read_ogg_packet(pages.data, pages.size, &offset, &segment, packet.data, &comment_size);
+			read_ogg_packet(pages.data, pages.size, &offset, &segment, setup, &setup_size);
 
-			if (tag_info.pictures[i].data == NULL)
+			if (comment_size < 7 || packet.data[0] != 3 || memcmp(packet.data + 1, "vorbis", 6) != 0)
 			{
-
-				free_audio_file_tags(tag_info);
-				id3tag_free(id3tag);
-				return GA_E_MEMORY;
+				result = GA_E_DECODER;
 			}
-
-			tag_info.pictures[i].data_size = sizeof(uint8_t) * x * y * 4;
-			tag_info.pictures[i].type = id3tag->pics[i].pic_type;
-			tag_info.pictures[i].width = x;
-			tag_info.pictures[i].height = y;
-			tag_info.pictures[i].depth = n * 8;
-			tag_info.picture_count++;
 		}
 	}
 
-	id3tag_free(id3tag);
+	// Build the new comment packet over the old one: packet type and "vorbis", the comment block, then the framing bit.
+	if (result == GA_SUCCESS)
+	{
+		tag_buffer comment = {};
+		result = build_vorbis_comment(packet.data + 7, comment_size - 7, fields, values, tag_count, &comment);
+		packet.size = 7;
 
-	*tags = (intptr_t)tag_info.tags;
-	*tag_count = tag_info.tag_count;
-	*pictures = (intptr_t)tag_info.pictures;
-	*picture_count = tag_info.picture_count;
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&packet, comment.data, comment.size);
+		}
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&packet, "\x01", 1);
+		}
 
-	return GA_SUCCESS;
-}
+		free_tag_buffer(&comment);
+	}
 
+	if (result != GA_SUCCESS)
+	{
+		fclose(pFile);
+		free(setup);
+		free_tag_buffer(&pages);
+		free_tag_buffer(&packet);
+		return result;
+	}
 
-/////////////////////////////////
-// Ogg Vorbis decoding wrapper //
-/////////////////////////////////
+	// Find a comment size that lays out over the same pages in exactly the same number of bytes. Decoders skip anything after the framing bit,
+	// so the comment is padded with zeros to that size. Each extra byte adds a byte to the pages, plus a lacing value every 255 bytes.
+	uint64_t header_size = pages.size - id_page_size;
+	size_t padded_size = 0;
 
-inline ga_result convert_vorbis_result(int32_t result)
-{
-	switch (result)
+	for (size_t size = packet.size; ; size++)
 	{
-	case VORBIS__no_error:
-		return GA_SUCCESS; break;
-	case VORBIS_outofmem:
-		return GA_E_MEMORY; break;
-	case VORBIS_file_open_failure:
-	case VORBIS_unexpected_eof:
-		return GA_E_FILE; break;
-	case VORBIS_invalid_setup:
-	case VORBIS_invalid_stream:
-	case VORBIS_missing_capture_pattern:
-	case VORBIS_invalid_stream_structure_version:
-	case VORBIS_continued_packet_flag_invalid:
-	case VORBIS_incorrect_stream_serial_number:
-	case VORBIS_invalid_first_page:
-	case VORBIS_bad_packet_type:
-	case VORBIS_cant_find_last_page:
-	case VORBIS_seek_failed:
-	case VORBIS_ogg_skeleton_not_supported:
-		return GA_E_DECODER; break;
-	default:
-		return GA_E_GENERIC; break;
+		uint64_t pages_size = get_ogg_header_pages_size(size, setup_size, header_page_count);
+
+		if (pages_size == header_size)
+		{
+			padded_size = size;
+			break;
+		}
+
+		// Sizes too small for a lacing value on every page give 0, and are skipped.
+		if (pages_size > header_size || (pages_size == 0 && size / 255 + 1 + setup_size / 255 + 1 > 255 * (uint64_t)header_page_count))
+		{
+			break;
+		}
 	}
 
-	return GA_E_GENERIC;
-}
+	if (padded_size > 0)
+	{
+		uint32_t page_count = header_page_count;
 
-ga_result get_vorbis_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
-{
-	ga_result result = GA_SUCCESS;
-	int error = 0;
-	stb_vorbis* info;
+		fclose(pFile);
+		result = append_tag_buffer(&packet, NULL, padded_size - packet.size);
+		if (result == GA_SUCCESS)
+		{
+			result = write_ogg_header_pages(packet.data, packet.size, setup, setup_size, serial, sequence, &page_count, &new_pages);
+		}
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	info = stb_vorbis_open_filename_w(wide_file_name, &error, NULL);
-	free(wide_file_name);
-#else
-	info = stb_vorbis_open_filename(file_name, &error, NULL);
-#endif
+		pFile = (result == GA_SUCCESS ? ga_fopen_update(file_name) : NULL);
 
-	result = convert_vorbis_result(error);
+		if (pFile == NULL)
+		{
+			result = (result == GA_SUCCESS ? GA_E_FILE : result);
+		}
+		else
+		{
+			if (ga_fseek(pFile, id_page_size, SEEK_SET) != 0 || fwrite(new_pages.data, 1, new_pages.size, pFile) != new_pages.size)
+			{
+				result = GA_E_FILE;
+			}
+
+			if (fclose(pFile) != 0 && result == GA_SUCCESS)
+			{
+				result = GA_E_FILE;
+			}
+		}
 
-	if (info == NULL || result != GA_SUCCESS)
-	{
+		free(setup);
+		free_tag_buffer(&pages);
+		free_tag_buffer(&packet);
+		free_tag_buffer(&new_pages);
 		return result;
 	}
 
-	*num_frames = (uint64_t)stb_vorbis_stream_length_in_samples(info);
-	*channels = (uint32_t)info->channels;
-	*sample_rate = (uint32_t)info->sample_rate;
-	// Lossy codecs don't have a true "bits per sample", it's all floating point math. stb_vorbis decodes to 16-bit.
-	*bits_per_sample = 16;
+	// Rewrite the file, with padding in the comment for later edits. If the headers take a different number of pages, the pages after them are renumbered.
+	FILE* pOutput = NULL;
+	char* temp_name = NULL;
+	uint32_t page_count = 0;
 
-	stb_vorbis_close(info);
+	result = append_tag_buffer(&packet, NULL, TAG_PADDING_SIZE);
+	if (result == GA_SUCCESS)
+	{
+		result = write_ogg_header_pages(packet.data, packet.size, setup, setup_size, serial, sequence, &page_count, &new_pages);
+	}
+	if (result == GA_SUCCESS && (pOutput = open_rewrite_file(file_name, &temp_name)) == NULL)
+	{
+		result = GA_E_FILE;
+	}
 
-	return result;
-}
+	free(setup);
+	free_tag_buffer(&packet);
 
-int16_t* load_vorbis(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
-{
-	int ogg_num_frames = 0;
-	int ogg_channels = 0;
-	int ogg_sample_rate = 0;
-	int ogg_error_code = 0;
-	short* sample_data = NULL;
+	if (result != GA_SUCCESS)
+	{
+		fclose(pFile);
+		free(temp_name);
+		free_tag_buffer(&pages);
+		free_tag_buffer(&new_pages);
+		return result;
+	}
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	ogg_num_frames = stb_vorbis_decode_filename_w(wide_file_name, &ogg_channels, &ogg_sample_rate, &sample_data);
-	free(wide_file_name);
-#else
-	ogg_num_frames = stb_vorbis_decode_filename(file_name, &ogg_channels, &ogg_sample_rate, &sample_data);
-#endif
+	if (fwrite(pages.data, 1, id_page_size, pOutput) != id_page_size || fwrite(new_pages.data, 1, new_pages.size, pOutput) != new_pages.size)
+	{
+		result = GA_E_FILE;
+	}
 
-	if (ogg_num_frames < 0)
+	if (result == GA_SUCCESS)
 	{
-		*result = GA_E_GENERIC;
-		return NULL;
+		if (page_count == header_page_count)
+		{
+			result = copy_file_data(pFile, pOutput, UINT64_MAX);
+		}
+		else
+		{
+			result = copy_ogg_pages(pFile, pOutput, serial, (int32_t)page_count - (int32_t)header_page_count);
+		}
 	}
 
-	*num_frames = (uint64_t)ogg_num_frames;
-	*channels = (uint32_t)ogg_channels;
-	*sample_rate = (uint32_t)ogg_sample_rate;
-	*result = GA_SUCCESS;
+	fclose(pFile);
+	result = finish_rewrite_file(pOutput, temp_name, file_name, result);
+	free(temp_name);
+	free_tag_buffer(&pages);
+	free_tag_buffer(&new_pages);
 
-	return (int16*)sample_data;
-}
+	if (result == GA_SUCCESS)
+	{
+		*rewritten = 1;
+	}
 
-void free_vorbis(int16_t* sample_data)
-{
-	free(sample_data);
+	return result;
 }
 
-ga_result open_vorbis_file(const char* file_name, void** decoder)
+ga_result read_ogg_page(FILE* pFile, tag_buffer* pages, size_t* page_size)
 {
-	ga_result result = GA_SUCCESS;
-	int error = 0;
-	stb_vorbis* vorbis_decoder;
-
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	vorbis_decoder = stb_vorbis_open_filename_w(wide_file_name, &error, NULL);
-	free(wide_file_name);
-#else
-	vorbis_decoder = stb_vorbis_open_filename(file_name, &error, NULL);
-#endif
+	size_t page_start = pages->size;
+	size_t bytes_read;
+	ga_result result;
 
-	result = convert_vorbis_result(error);
+	*page_size = 0;
+	result = append_tag_buffer(pages, NULL, 27);
 
-	if (vorbis_decoder == NULL || result != GA_SUCCESS)
+	if (result != GA_SUCCESS)
 	{
 		return result;
 	}
 
-	*decoder = (void*)vorbis_decoder;
-
-	return result;
-}
+	bytes_read = fread(pages->data + page_start, 1, 27, pFile);
 
-ga_result get_basic_vorbis_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset)
-{
-	if (decoder == NULL)
+	// A clean end of the file
+	if (bytes_read == 0)
 	{
-		return GA_E_GENERIC;
+		pages->size = page_start;
+		return GA_SUCCESS;
 	}
 
-	*channels = ((stb_vorbis*)decoder)->channels;
-	*sample_rate = ((stb_vorbis*)decoder)->sample_rate;
-	*read_offset = stb_vorbis_get_sample_offset((stb_vorbis*)decoder);
-
-	return GA_SUCCESS;
-}
-
-ga_result seek_vorbis_file(void* decoder, uint64_t offset, uint64_t* new_offset)
-{
-	if (decoder == NULL)
+	if (bytes_read != 27 || memcmp(pages->data + page_start, "OggS", 4) != 0 || pages->data[page_start + 4] != 0)
 	{
-		return GA_E_GENERIC;
+		pages->size = page_start;
+		return GA_E_DECODER;
 	}
 
-	// Clear any previous errors
-	stb_vorbis_get_error((stb_vorbis*)decoder);
+	uint32_t segments = pages->data[page_start + 26];
+	result = append_tag_buffer(pages, NULL, segments);
 
-	stb_vorbis_seek((stb_vorbis*)decoder, offset);
+	if (result != GA_SUCCESS || fread(pages->data + page_start + 27, 1, segments, pFile) != segments)
+	{
+		pages->size = page_start;
+		return (result != GA_SUCCESS ? result : GA_E_DECODER);
+	}
 
-	return convert_vorbis_result(stb_vorbis_get_error((stb_vorbis*)decoder));
-}
+	size_t body_size = 0;
 
-ga_result read_vorbis_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer)
-{
-	if (decoder == NULL)
+	for (uint32_t i = 0; i < segments; i++)
 	{
-		return GA_E_GENERIC;
+		body_size += pages->data[page_start + 27 + i];
 	}
 
-	// Clear any previous errors
-	stb_vorbis_get_error((stb_vorbis*)decoder);
-
-	void* temp_buffer = NULL;
+	result = append_tag_buffer(pages, NULL, body_size);
 
-	switch (audio_type)
+	if (result != GA_SUCCESS || fread(pages->data + page_start + 27 + segments, 1, body_size, pFile) != body_size)
 	{
-	case ga_data_type_u8:
-		temp_buffer = malloc(frames_to_read * ((stb_vorbis*)decoder)->channels * sizeof(short));
-		*frames_read = stb_vorbis_get_samples_short_interleaved((stb_vorbis*)decoder, ((stb_vorbis*)decoder)->channels, (short*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
-		break;
-	case ga_data_type_i16:
-		*frames_read = stb_vorbis_get_samples_short_interleaved((stb_vorbis*)decoder, ((stb_vorbis*)decoder)->channels, (short*)output_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		break;
-	case ga_data_type_i32:
-		temp_buffer = malloc(frames_to_read * ((stb_vorbis*)decoder)->channels * sizeof(short));
-		*frames_read = stb_vorbis_get_samples_short_interleaved((stb_vorbis*)decoder, ((stb_vorbis*)decoder)->channels, (short*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		s16_to_s32((int32_t*)output_buffer, (int16_t*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
-		break;
-	case ga_data_type_float:
-		temp_buffer = malloc(frames_to_read * ((stb_vorbis*)decoder)->channels * sizeof(short));
-		*frames_read = stb_vorbis_get_samples_short_interleaved((stb_vorbis*)decoder, ((stb_vorbis*)decoder)->channels, (short*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		s16_to_f32((float*)output_buffer, (int16_t*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
-		break;
-	case ga_data_type_double:
-		temp_buffer = malloc(frames_to_read * ((stb_vorbis*)decoder)->channels * sizeof(short));
-		*frames_read = stb_vorbis_get_samples_short_interleaved((stb_vorbis*)decoder, ((stb_vorbis*)decoder)->channels, (short*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		s16_to_f64((double*)output_buffer, (int16_t*)temp_buffer, frames_to_read * ((stb_vorbis*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
-		break;
-	default:
-		return GA_E_INVALID_TYPE;
-		break;
+		pages->size = page_start;
+		return (result != GA_SUCCESS ? result : GA_E_DECODER);
 	}
 
-	return convert_vorbis_result(stb_vorbis_get_error((stb_vorbis*)decoder));
+	*page_size = 27 + segments + body_size;
+
+	return GA_SUCCESS;
 }
 
-ga_result close_vorbis_file(void* decoder)
+uint64_t get_ogg_header_pages_size(size_t comment_size, size_t setup_size, uint32_t page_count)
 {
-	if (decoder == NULL)
+	// Each packet takes a lacing value per 255 bytes, plus one for the remainder (which may be 0).
+	uint64_t lacing_count = comment_size / 255 + 1 + setup_size / 255 + 1;
+
+	if (page_count == 0)
 	{
-		return GA_E_GENERIC;
+		page_count = (uint32_t)((lacing_count + 254) / 255);
+	}
+	else if (lacing_count < page_count || lacing_count > 255 * (uint64_t)page_count)
+	{
+		return 0;
 	}
 
-	stb_vorbis_close((stb_vorbis*)decoder);
-
-	return GA_SUCCESS;
+	return 27 * (uint64_t)page_count + lacing_count + comment_size + setup_size;
 }
 
-ga_result get_vorbis_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+ga_result write_ogg_header_pages(const uint8_t* comment, size_t comment_size, const uint8_t* setup, size_t setup_size, uint32_t serial, uint32_t sequence, uint32_t* page_count, tag_buffer* pages)
 {
+	uint64_t lacing_count = comment_size / 255 + 1 + setup_size / 255 + 1;
+	uint64_t lacing_index = 0;
+	const uint8_t* packets[2] = { comment, setup };
+	size_t packet_sizes[2] = { comment_size, setup_size };
+	uint32_t packet = 0;
+	size_t packet_offset = 0;
+	uint8_t continued = 0;
 	ga_result result = GA_SUCCESS;
-	int error = 0;
-	stb_vorbis* vorbis_decoder;
-	audio_file_tag_info tag_info = {};
-	int32_t length;
-	int32_t token_offset;
-	int32_t field_length;
-	int32_t value_length;
-
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	vorbis_decoder = stb_vorbis_open_filename_w(wide_file_name, &error, NULL);
-	free(wide_file_name);
-#else
-	vorbis_decoder = stb_vorbis_open_filename(file_name, &error, NULL);
-#endif
 
-	result = convert_vorbis_result(error);
-
-	if (vorbis_decoder == NULL || result != GA_SUCCESS)
+	if (*page_count == 0)
 	{
-		return GA_E_TAG;
+		*page_count = (uint32_t)((lacing_count + 254) / 255);
 	}
 
-	tag_info.tag_count = 0;
-	if (vorbis_decoder->comment_list_length > 0)
+	// The lacing values are spread evenly, so every page gets at least one.
+	for (uint32_t p = 0; p < *page_count && result == GA_SUCCESS; p++)
 	{
-		tag_info.tags = (audio_file_tag*)calloc(vorbis_decoder->comment_list_length, sizeof(audio_file_tag));
+		uint32_t segments = (uint32_t)(lacing_count / *page_count + (p < lacing_count % *page_count ? 1 : 0));
+		size_t page_start = pages->size;
+		uint8_t packet_ended = 0;
+
+		result = append_tag_buffer(pages, NULL, 27 + segments);
 
-		if (tag_info.tags == NULL)
+		if (result != GA_SUCCESS)
 		{
-			free_audio_file_tags(tag_info);
-			stb_vorbis_close(vorbis_decoder);
-			return GA_E_MEMORY;
+			break;
 		}
 
-		for (int i = 0; i < vorbis_decoder->comment_list_length; i++)
+		memcpy(pages->data + page_start, "OggS", 4);
+		pages->data[page_start + 5] = (continued ? 0x01 : 0);
+		write_u32_le(pages->data + page_start + 14, serial);
+		write_u32_le(pages->data + page_start + 18, sequence + p);
+		pages->data[page_start + 26] = (uint8_t)segments;
+
+		for (uint32_t s = 0; s < segments && result == GA_SUCCESS; s++, lacing_index++)
 		{
-			token_offset = ga_find_token(vorbis_decoder->comment_list[i], '=');
+			size_t remaining = packet_sizes[packet] - packet_offset;
+			uint8_t length = (uint8_t)(remaining >= 255 ? 255 : remaining);
 
-			if (token_offset > 0)
-			{
-				length = strlen(vorbis_decoder->comment_list[i]);
-				value_length = length - token_offset;
-				field_length = length - value_length - 1;
+			pages->data[page_start + 27 + s] = length;
+			result = append_tag_buffer(pages, packets[packet] + packet_offset, length);
+			packet_offset += length;
+			continued = (length == 255);
 
-				if (strncmp(vorbis_decoder->comment_list[i], "METADATA_BLOCK_PICTURE", field_length) == 0)
-				{
-					if (read_pictures)
-					{
-						audio_file_picture* temp_pictures_ptr = tag_info.pictures;
-						tag_info.pictures = (audio_file_picture*)realloc(temp_pictures_ptr, sizeof(audio_file_picture) * (tag_info.picture_count + 1));
-
-						if (tag_info.pictures == NULL)
-						{
-							tag_info.pictures = temp_pictures_ptr;
-							free_audio_file_tags(tag_info);
-							stb_vorbis_close(vorbis_decoder);
-							return GA_E_MEMORY;
-						}
-
-						int32_t block_size;
-						const uint8_t* picture_block = (const uint8_t*)base64_dec_malloc(vorbis_decoder->comment_list[i] + token_offset, &block_size);
-						parse_metadata_block_picture(picture_block, block_size, tag_info.pictures + tag_info.picture_count);
-						tag_info.picture_count++;
-						free((void*)picture_block);
-					}
-				}
-				else
-				{
-					tag_info.tags[tag_info.tag_count].field = (char*)malloc(field_length + 1);
-					tag_info.tags[tag_info.tag_count].value = (char*)malloc(value_length + 1);
+			if (length < 255)
+			{
+				packet_ended = 1;
+				packet++;
+				packet_offset = 0;
+			}
+		}
 
-					if (tag_info.tags[tag_info.tag_count].field == NULL || tag_info.tags[tag_info.tag_count].value == NULL)
-					{
-						free_audio_file_tags(tag_info);
-						stb_vorbis_close(vorbis_decoder);
-						return GA_E_MEMORY;
-					}
+		// Pages where no packet ends have no granule position.
+		write_u64_le(pages->data + page_start + 6, (packet_ended ? 0 : UINT64_MAX));
 
-					memcpy(tag_info.tags[tag_info.tag_count].field, vorbis_decoder->comment_list[i], field_length);
-					tag_info.tags[tag_info.tag_count].field[field_length] = '\0';
-					tag_info.tags[tag_info.tag_count].field_length = field_length;
-					memcpy(tag_info.tags[tag_info.tag_count].value, vorbis_decoder->comment_list[i] + token_offset, value_length);
-					tag_info.tags[tag_info.tag_count].value[value_length] = '\0';
-					tag_info.tags[tag_info.tag_count].value_length = value_length;
-					tag_info.tag_count++;
-				}
-			}
+		if (result == GA_SUCCESS)
+		{
+			set_ogg_page_crc(pages->data + page_start, pages->size - page_start);
 		}
 	}
 
-	stb_vorbis_close(vorbis_decoder);
+	return result;
+}
+
+ga_result copy_ogg_pages(FILE* input, FILE* output, uint32_t serial, int32_t sequence_delta)
+{
+	tag_buffer page = {};
+	size_t page_size;
+	ga_result result = GA_SUCCESS;
+
+	for (;;)
+	{
+		int64_t page_offset = ga_ftell(input);
+
+		page.size = 0;
+		result = read_ogg_page(input, &page, &page_size);
+
+		// Anything after the last whole page is copied as it is.
+		if (result == GA_E_DECODER)
+		{
+			result = (ga_fseek(input, page_offset, SEEK_SET) == 0 ? copy_file_data(input, output, UINT64_MAX) : GA_E_FILE);
+			break;
+		}
+
+		if (result != GA_SUCCESS || page_size == 0)
+		{
+			break;
+		}
+
+		if (read_u32_le(page.data + 14) == serial)
+		{
+			write_u32_le(page.data + 18, read_u32_le(page.data + 18) + (uint32_t)sequence_delta);
+			set_ogg_page_crc(page.data, page_size);
+		}
+
+		if (fwrite(page.data, 1, page_size, output) != page_size)
+		{
+			result = GA_E_FILE;
+			break;
+		}
+	}
 
-	*tags = (intptr_t)tag_info.tags;
-	*tag_count = tag_info.tag_count;
-	*pictures = (intptr_t)tag_info.pictures;
-	*picture_count = tag_info.picture_count;
+	free_tag_buffer(&page);
 
 	return result;
 }
 
+void set_ogg_page_crc(uint8_t* page, size_t page_size)
+{
+	uint32_t crc = 0;
+
+	crc32_init();
+	write_u32_le(page + 22, 0);
+
+	for (size_t i = 0; i < page_size; i++)
+	{
+		crc = crc32_update(crc, page[i]);
+	}
+
+	write_u32_le(page + 22, crc);
+}
+
 
 //////////////////////////
 // WAV decoding wrapper //
@@ -1674,18 +8284,25 @@ inline ga_result convert_wav_result(int32_t result)
 	return GA_E_GENERIC;
 }
 
-ga_result get_wav_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
+ga_result get_wav_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample)
 {
 	drwav pWav;
 	drwav_bool32 init_ok = DRWAV_FALSE;
 
+	if (io->data != NULL)
+	{
+		init_ok = drwav_init_memory(&pWav, io->data, io->size, NULL);
+	}
+	else
+	{
 #if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	init_ok = drwav_init_file_w(&pWav, wide_file_name, NULL);
-	free(wide_file_name);
+		wchar_t* wide_file_name = widen(io->file_name);
+		init_ok = drwav_init_file_w(&pWav, wide_file_name, NULL);
+		free(wide_file_name);
 #else
-	init_ok = drwav_init_file(&pWav, file_name, NULL);
+		init_ok = drwav_init_file(&pWav, io->file_name, NULL);
 #endif
+	}
 
 	if (init_ok == DRWAV_FALSE)
 	{
@@ -1704,28 +8321,60 @@ ga_result get_wav_info(const char* file_name, uint64_t* num_frames, uint32_t* ch
 
 int16_t* load_wav(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result)
 {
-	drwav_uint64 wav_num_frames = 0;
-	drwav_uint32 wav_channels = 0;
-	drwav_uint32 wav_sample_rate = 0;
+	void* decoder = NULL;
 	int16_t* sample_data = NULL;
+	uint64_t wav_num_frames = 0;
+	uint64_t frames_read = 0;
+	ga_scratch_buffer scratch = { NULL, 0 };
+	ga_io io;
 
-#if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	sample_data = drwav_open_file_and_read_pcm_frames_s16_w(wide_file_name, &wav_channels, &wav_sample_rate, &wav_num_frames, NULL);
-	free(wide_file_name);
-#else
-	sample_data = drwav_open_file_and_read_pcm_frames_s16(file_name, &wav_channels, &wav_sample_rate, &wav_num_frames, NULL);
-#endif
+	*result = ga_io_open(file_name, &io);
+
+	if (*result != GA_SUCCESS)
+	{
+		return NULL;
+	}
+
+	// The output is sized from the frames in the file, and 16-bit files are a single copy out of the mapped file.
+	*result = open_wav_file(&io, &decoder);
+
+	if (*result != GA_SUCCESS)
+	{
+		ga_io_close(&io);
+		return NULL;
+	}
+
+	drwav* wav = &(((wav_decoder*)decoder)->wav);
+	get_wav_file_length(decoder, &wav_num_frames);
+
+	// Corrupt headers can report any length, so make sure the buffer size doesn't overflow.
+	if (wav->channels > 0 && wav_num_frames <= SIZE_MAX / (wav->channels * sizeof(int16_t)))
+	{
+		sample_data = (int16_t*)malloc((wav_num_frames > 0 ? (size_t)wav_num_frames : 1) * wav->channels * sizeof(int16_t));
+	}
 
 	if (sample_data == NULL)
 	{
-		*result = GA_E_GENERIC;
+		*result = GA_E_MEMORY;
+	}
+	else
+	{
+		*result = read_wav_file(decoder, wav_num_frames, ga_data_type_i16, &frames_read, sample_data, &scratch);
 	}
 
-	*num_frames = wav_num_frames;
-	*channels = wav_channels;
-	*sample_rate = wav_sample_rate;
-	*result = GA_SUCCESS;
+	*num_frames = frames_read;
+	*channels = wav->channels;
+	*sample_rate = wav->sampleRate;
+
+	close_wav_file(decoder);
+	ga_io_close(&io);
+	free_scratch_buffer(&scratch);
+
+	if (*result != GA_SUCCESS)
+	{
+		free(sample_data);
+		return NULL;
+	}
 
 	return sample_data;
 }
@@ -1735,32 +8384,93 @@ void free_wav(int16_t* sample_data)
 	drwav_free((void*)sample_data, NULL);
 }
 
-ga_result open_wav_file(const char* file_name, void** decoder)
+ga_result open_wav_file(ga_io* io, void** decoder)
 {
 	drwav_bool32 result = DRWAV_FALSE;
-	drwav* wav_decoder = (drwav*)malloc(sizeof(drwav));
+	const uint8_t* mapped_data = NULL;
+	wav_decoder* wav_data = (wav_decoder*)malloc(sizeof(wav_decoder));
 
-	if (wav_decoder == NULL)
+	if (wav_data == NULL)
 	{
 		return GA_E_MEMORY;
 	}
 
+	wav_data->pcm_data = NULL;
+	wav_data->pcm_frames = 0;
+	wav_data->sample_type = ga_data_type_i16;
+
+	// Parse the header from a mapping of the file when possible, falling back to stdio for files which can't be mapped.
+	if (io->data != NULL)
+	{
+		result = drwav_init_memory(&(wav_data->wav), io->data, io->size, NULL);
+
+		if (result != DRWAV_FALSE)
+		{
+			mapped_data = io->data;
+		}
+	}
+
+	if (result == DRWAV_FALSE && io->file_name != NULL)
+	{
 #if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	result = drwav_init_file_w(wav_decoder, wide_file_name, NULL);
-	free(wide_file_name);
+		wchar_t* wide_file_name = widen(io->file_name);
+		result = drwav_init_file_w(&(wav_data->wav), wide_file_name, NULL);
+		free(wide_file_name);
 #else
-	result = drwav_init_file(wav_decoder, file_name, NULL);
+		result = drwav_init_file(&(wav_data->wav), io->file_name, NULL);
 #endif
+	}
 
 	if (result == DRWAV_FALSE)
 	{
-		free(wav_decoder);
-		wav_decoder = NULL;
+		free(wav_data);
+		wav_data = NULL;
 		return GA_E_GENERIC;
 	}
 
-	*decoder = (void*)wav_decoder;
+	// Samples can be read straight from the mapping when they're stored as a type G-Audio handles natively, with no padding in the frame.
+	drwav* wav = &(wav_data->wav);
+	uint32_t bytes_per_sample = wav->bitsPerSample / 8;
+
+	if (mapped_data != NULL && wav->channels > 0 && wav->fmt.blockAlign == wav->channels * bytes_per_sample && wav->dataChunkDataPos < io->size)
+	{
+		uint8_t direct = 1;
+
+		if (wav->translatedFormatTag == DR_WAVE_FORMAT_PCM && wav->bitsPerSample == 8)
+		{
+			wav_data->sample_type = ga_data_type_u8;
+		}
+		else if (wav->translatedFormatTag == DR_WAVE_FORMAT_PCM && wav->bitsPerSample == 16)
+		{
+			wav_data->sample_type = ga_data_type_i16;
+		}
+		else if (wav->translatedFormatTag == DR_WAVE_FORMAT_PCM && wav->bitsPerSample == 32)
+		{
+			wav_data->sample_type = ga_data_type_i32;
+		}
+		else if (wav->translatedFormatTag == DR_WAVE_FORMAT_IEEE_FLOAT && wav->bitsPerSample == 32)
+		{
+			wav_data->sample_type = ga_data_type_float;
+		}
+		else if (wav->translatedFormatTag == DR_WAVE_FORMAT_IEEE_FLOAT && wav->bitsPerSample == 64)
+		{
+			wav_data->sample_type = ga_data_type_double;
+		}
+		else
+		{
+			direct = 0;
+		}
+
+		if (direct)
+		{
+			// Truncated files can report more frames than are actually present.
+			uint64_t mapped_frames = (io->size - wav->dataChunkDataPos) / wav->fmt.blockAlign;
+			wav_data->pcm_data = mapped_data + wav->dataChunkDataPos;
+			wav_data->pcm_frames = (wav->totalPCMFrameCount < mapped_frames ? wav->totalPCMFrameCount : mapped_frames);
+		}
+	}
+
+	*decoder = (void*)wav_data;
 
 	return GA_SUCCESS;
 }
@@ -1818,9 +8528,26 @@ ga_result get_basic_wav_file_info(void* decoder, uint32_t* channels, uint32_t* s
 		return GA_E_GENERIC;
 	}
 
-	*channels = ((drwav*)decoder)->channels;
-	*sample_rate = ((drwav*)decoder)->sampleRate;
-	*read_offset = ((drwav*)decoder)->readCursorInPCMFrames;
+	drwav* wav = &(((wav_decoder*)decoder)->wav);
+
+	*channels = wav->channels;
+	*sample_rate = wav->sampleRate;
+	*read_offset = wav->readCursorInPCMFrames;
+
+	return GA_SUCCESS;
+}
+
+ga_result get_wav_file_length(void* decoder, uint64_t* num_frames)
+{
+	if (decoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	wav_decoder* wav_data = (wav_decoder*)decoder;
+
+	// Direct reads stop at the end of the mapped file, which may be short of the header's frame count.
+	*num_frames = (wav_data->pcm_data != NULL ? wav_data->pcm_frames : wav_data->wav.totalPCMFrameCount);
 
 	return GA_SUCCESS;
 }
@@ -1832,7 +8559,7 @@ ga_result seek_wav_file(void* decoder, uint64_t offset, uint64_t* new_offset)
 		return GA_E_GENERIC;
 	}
 
-	if (drwav_seek_to_pcm_frame((drwav*)decoder, offset) == DRWAV_FALSE)
+	if (drwav_seek_to_pcm_frame(&(((wav_decoder*)decoder)->wav), offset) == DRWAV_FALSE)
 	{
 		return GA_E_DECODER;
 	}
@@ -1840,7 +8567,7 @@ ga_result seek_wav_file(void* decoder, uint64_t offset, uint64_t* new_offset)
 	return GA_SUCCESS;
 }
 
-ga_result read_wav_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer)
+ga_result read_wav_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch)
 {
 	if (decoder == NULL)
 	{
@@ -1852,32 +8579,56 @@ ga_result read_wav_file(void* decoder, uint64_t frames_to_read, ga_data_type aud
 		return GA_E_MEMORY;
 	}
 
+	wav_decoder* wav_data = (wav_decoder*)decoder;
+	drwav* wav = &(wav_data->wav);
 	void* temp_buffer = NULL;
 
+	if (wav_data->pcm_data != NULL)
+	{
+		uint64_t read_offset = wav->readCursorInPCMFrames;
+		uint64_t frames_available = (wav_data->pcm_frames > read_offset ? wav_data->pcm_frames - read_offset : 0);
+		uint64_t frames_to_copy = (frames_to_read < frames_available ? frames_to_read : frames_available);
+
+		if (read_wav_direct(wav_data->sample_type, wav_data->pcm_data + (read_offset * wav->fmt.blockAlign), audio_type, output_buffer, (size_t)(frames_to_copy * wav->channels)) == GA_SUCCESS)
+		{
+			// Keep dr_wav's cursor in step. Seeking a memory stream is just an offset update.
+			if (frames_to_copy > 0 && drwav_seek_to_pcm_frame(wav, read_offset + frames_to_copy) == DRWAV_FALSE)
+			{
+				return GA_E_DECODER;
+			}
+			*frames_read = frames_to_copy;
+			return GA_SUCCESS;
+		}
+	}
+
 	switch (audio_type)
 	{
 		case ga_data_type_u8:
-		temp_buffer = malloc(frames_to_read * ((drwav*)decoder)->channels * sizeof(drwav_int16));
-		*frames_read = drwav_read_pcm_frames_s16((drwav*)decoder, frames_to_read, (drwav_int16*)temp_buffer);
-		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, frames_to_read * ((drwav*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * wav->channels * sizeof(drwav_int16));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = drwav_read_pcm_frames_s16(wav, frames_to_read, (drwav_int16*)temp_buffer);
+		s16_to_u8((uint8_t*)output_buffer, (int16_t*)temp_buffer, *frames_read * wav->channels);
 		break;
 	case ga_data_type_i16:
-		*frames_read = drwav_read_pcm_frames_s16((drwav*)decoder, frames_to_read, (drwav_int16*)output_buffer);
+		*frames_read = drwav_read_pcm_frames_s16(wav, frames_to_read, (drwav_int16*)output_buffer);
 		break;
 	case ga_data_type_i32:
-		*frames_read = drwav_read_pcm_frames_s32((drwav*)decoder, frames_to_read, (drwav_int32*)output_buffer);
+		*frames_read = drwav_read_pcm_frames_s32(wav, frames_to_read, (drwav_int32*)output_buffer);
 		break;
 	case ga_data_type_float:
-		*frames_read = drwav_read_pcm_frames_f32((drwav*)decoder, frames_to_read, (float*)output_buffer);
+		*frames_read = drwav_read_pcm_frames_f32(wav, frames_to_read, (float*)output_buffer);
 		break;
 	case ga_data_type_double:
-		temp_buffer = malloc(frames_to_read * ((drwav*)decoder)->channels * sizeof(float));
-		*frames_read = drwav_read_pcm_frames_f32((drwav*)decoder, frames_to_read, (float*)temp_buffer);
-		f32_to_f64((double*)output_buffer, (float*)temp_buffer, frames_to_read * ((drwav*)decoder)->channels);
-		free(temp_buffer);
-		temp_buffer = NULL;
+		temp_buffer = reserve_scratch_buffer(scratch, frames_to_read * wav->channels * sizeof(float));
+		if (temp_buffer == NULL)
+		{
+			return GA_E_MEMORY;
+		}
+		*frames_read = drwav_read_pcm_frames_f32(wav, frames_to_read, (float*)temp_buffer);
+		f32_to_f64((double*)output_buffer, (float*)temp_buffer, *frames_read * wav->channels);
 		break;
 	default:
 		return GA_E_INVALID_TYPE;
@@ -1887,6 +8638,84 @@ ga_result read_wav_file(void* decoder, uint64_t frames_to_read, ga_data_type aud
 	return GA_SUCCESS;
 }
 
+ga_result read_wav_direct(ga_data_type file_type, const uint8_t* pcm_data, ga_data_type audio_type, void* output_buffer, size_t num_samples)
+{
+	size_t sample_size = get_data_type_size(file_type);
+
+	if (file_type == audio_type)
+	{
+		memcpy(output_buffer, pcm_data, num_samples * sample_size);
+		return GA_SUCCESS;
+	}
+
+	// The conversion kernels expect naturally aligned input.
+	if (((uintptr_t)pcm_data % sample_size) != 0)
+	{
+		return GA_E_INVALID_TYPE;
+	}
+
+	// Only conversions which give the same result as dr_wav are done here. Double output goes through float, as dr_wav's path does.
+	switch (file_type)
+	{
+		case ga_data_type_u8:
+			switch (audio_type)
+			{
+				case ga_data_type_i16: u8_to_s16((int16_t*)output_buffer, pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_i32: u8_to_s32((int32_t*)output_buffer, pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_float: u8_to_f32((float*)output_buffer, pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_double:
+					u8_to_f32((float*)output_buffer + num_samples, pcm_data, num_samples);
+					f32_to_f64((double*)output_buffer, (float*)output_buffer + num_samples, num_samples);
+					return GA_SUCCESS;
+				default: break;
+			}
+			break;
+		case ga_data_type_i16:
+			switch (audio_type)
+			{
+				case ga_data_type_u8: s16_to_u8((uint8_t*)output_buffer, (const int16_t*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_i32: s16_to_s32((int32_t*)output_buffer, (const int16_t*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_float: s16_to_f32((float*)output_buffer, (const int16_t*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_double: s16_to_f64((double*)output_buffer, (const int16_t*)pcm_data, num_samples); return GA_SUCCESS;
+				default: break;
+			}
+			break;
+		case ga_data_type_i32:
+			switch (audio_type)
+			{
+				case ga_data_type_u8: s32_to_u8((uint8_t*)output_buffer, (const int32_t*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_i16: s32_to_s16((int16_t*)output_buffer, (const int32_t*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_float: s32_to_f32((float*)output_buffer, (const int32_t*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_double:
+					s32_to_f32((float*)output_buffer + num_samples, (const int32_t*)pcm_data, num_samples);
+					f32_to_f64((double*)output_buffer, (float*)output_buffer + num_samples, num_samples);
+					return GA_SUCCESS;
+				default: break;
+			}
+			break;
+		case ga_data_type_float:
+			switch (audio_type)
+			{
+				case ga_data_type_i16: f32_to_s16((int16_t*)output_buffer, (const float*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_double: f32_to_f64((double*)output_buffer, (const float*)pcm_data, num_samples); return GA_SUCCESS;
+				default: break;
+			}
+			break;
+		case ga_data_type_double:
+			switch (audio_type)
+			{
+				case ga_data_type_i16: f64_to_s16((int16_t*)output_buffer, (const double*)pcm_data, num_samples); return GA_SUCCESS;
+				case ga_data_type_float: f64_to_f32((float*)output_buffer, (const double*)pcm_data, num_samples); return GA_SUCCESS;
+				default: break;
+			}
+			break;
+		default:
+			break;
+	}
+
+	return GA_E_INVALID_TYPE;
+}
+
 ga_result write_wav_file(void* encoder, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written)
 {
 	if (encoder == NULL)
@@ -1899,11 +8728,7 @@ ga_result write_wav_file(void* encoder, uint64_t frames_to_write, void* input_bu
 		return GA_E_MEMORY;
 	}
 
-	// TODO
-	// If wav configured as PCM and input is float, convert to int and scale range
-	// If wav configured as IEEE Float and input is integer, convert to float and scale range
-	// Or simply throw error?
-
+	// Input is in the file's sample format. write_audio_file_ex() converts other types before they get here.
 	*frames_written = drwav_write_pcm_frames((drwav*)encoder, frames_to_write, input_buffer);
 
 	return GA_SUCCESS;
@@ -1918,7 +8743,7 @@ ga_result close_wav_file(void* decoder)
 		return GA_E_GENERIC;
 	}
 
-	result = drwav_uninit((drwav*)decoder);
+	result = drwav_uninit(&(((wav_decoder*)decoder)->wav));
 	free(decoder);
 
 	if (result != DRWAV_SUCCESS)
@@ -1929,7 +8754,27 @@ ga_result close_wav_file(void* decoder)
 	return GA_SUCCESS;
 }
 
-ga_result get_wav_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
+ga_result close_wav_file_write(void* encoder)
+{
+	drwav_result result = DRWAV_SUCCESS;
+
+	if (encoder == NULL)
+	{
+		return GA_E_GENERIC;
+	}
+
+	result = drwav_uninit((drwav*)encoder);
+	free(encoder);
+
+	if (result != DRWAV_SUCCESS)
+	{
+		return GA_E_DECODER;
+	}
+
+	return GA_SUCCESS;
+}
+
+ga_result get_wav_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count)
 {
 	enum fields_t
 	{
@@ -1960,29 +8805,29 @@ ga_result get_wav_tags(const char* file_name, uint8_t read_pictures, intptr_t* t
 	drwav wav_decoder = {};
 	int field_index = -1;
 
+	// RIFF INFO has no artwork, so there's nothing to thumbnail.
+	(void)thumbnail_size;
+
+	if (io->data != NULL)
+	{
+		result = drwav_init_memory_with_metadata(&wav_decoder, io->data, io->size, 0, NULL);
+	}
+	else
+	{
 #if defined(_WIN32)
-	wchar_t* wide_file_name = widen(file_name);
-	result = drwav_init_file_with_metadata_w(&wav_decoder, wide_file_name, 0, NULL);
-	free(wide_file_name);
+		wchar_t* wide_file_name = widen(io->file_name);
+		result = drwav_init_file_with_metadata_w(&wav_decoder, wide_file_name, 0, NULL);
+		free(wide_file_name);
 #else
-	result = drwav_init_file_with_metadata(&wav_decoder, file_name, 0, NULL);
+		result = drwav_init_file_with_metadata(&wav_decoder, io->file_name, 0, NULL);
 #endif
+	}
 
 	if (result == DRWAV_FALSE)
 	{
 		return GA_E_GENERIC;
 	}
 
-	tag_info.tag_count = 0;
-	tag_info.tags = (audio_file_tag*)calloc(FIELD_COUNT, sizeof(audio_file_tag));
-
-	if (tag_info.tags == NULL)
-	{
-		free_audio_file_tags(tag_info);
-		drwav_uninit(&wav_decoder);
-		return GA_E_MEMORY;
-	}
-
 	for (int i = 0; i < wav_decoder.metadataCount; i++)
 	{
 		field_index = -1;
@@ -2000,45 +8845,322 @@ ga_result get_wav_tags(const char* file_name, uint8_t read_pictures, intptr_t* t
 
 		if (field_index >= 0)
 		{
-			int tag_index = tag_info.tag_count;
-
-			tag_info.tags[tag_index].field_length = strlen(tag_field_prefix[field_index]);
-			tag_info.tags[tag_index].value_length = wav_decoder.pMetadata[i].data.infoText.stringLength;
-
-			tag_info.tags[tag_index].field = (char*)malloc(tag_info.tags[tag_index].field_length + 1); // Add 1 for '\0' termination
-			tag_info.tags[tag_index].value = (char*)malloc(tag_info.tags[tag_index].value_length + 1); // Add 1 for '\0' termination
+			ga_result tag_result = add_audio_file_tag(&tag_info, tag_field_prefix[field_index], strlen(tag_field_prefix[field_index]), wav_decoder.pMetadata[i].data.infoText.pString, wav_decoder.pMetadata[i].data.infoText.stringLength);
 
-			if (tag_info.tags == NULL)
+			if (tag_result != GA_SUCCESS)
 			{
-				free_audio_file_tags(tag_info);
+				free_audio_file_tag_info(&tag_info);
 				drwav_uninit(&wav_decoder);
-				return GA_E_MEMORY;
+				return tag_result;
 			}
-
-			memcpy(tag_info.tags[tag_index].field, tag_field_prefix[field_index], tag_info.tags[tag_index].field_length);
-			tag_info.tags[tag_index].field[tag_info.tags[tag_index].field_length] = '\0';
-			memcpy(tag_info.tags[tag_index].value, wav_decoder.pMetadata[i].data.infoText.pString, tag_info.tags[tag_index].value_length);
-			tag_info.tags[tag_index].value[tag_info.tags[tag_index].value_length] = '\0';
-			tag_info.tag_count++;
 		}
 	}
 
 	drwav_uninit(&wav_decoder);
 
-	*tags = (intptr_t)tag_info.tags;
-	*tag_count = tag_info.tag_count;
-	*pictures = 0;
-	*picture_count = 0;
+	ga_result pack_result = pack_audio_file_tags(&tag_info, tags, tag_count, pictures, picture_count);
 
-	if (read_pictures)
+	if (pack_result == GA_SUCCESS && picture_mode != ga_picture_none)
 	{
 		return GA_W_EMBEDDED_ARTWORK;
 	}
 
-	return GA_SUCCESS;
+	return pack_result;
 }
 
 
+ga_result set_wav_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten)
+{
+	const char* tag_fields[] = { "TITLE", "ARTIST", "ALBUM", "GENRE", "DATE", "TRACKNUMBER", "COMMENT" };
+	const char* info_ids[] = { "INAM", "IART", "IPRD", "IGNR", "ICRD", "ITRK", "ICMT" };
+	const int32_t info_count = sizeof(info_ids) / sizeof(info_ids[0]);
+
+	uint8_t header[12];
+	uint64_t file_size;
+	uint64_t list_start = 0, list_end = 0;
+	uint64_t junk_start = 0, junk_end = 0;
+	uint8_t found_fmt = 0;
+	ga_result result = GA_SUCCESS;
+	FILE* pFile;
+
+	pFile = ga_fopen_update(file_name);
+
+	if (pFile == NULL)
+	{
+		return GA_E_FILE;
+	}
+
+	if (fread(header, 1, 12, pFile) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0 || ga_fseek(pFile, 0, SEEK_END) != 0)
+	{
+		fclose(pFile);
+		return GA_E_UNSUPPORTED_TAG;
+	}
+
+	file_size = ga_ftell(pFile);
+
+	// Find the first LIST INFO chunk and the padding chunks straight after it, or failing that the first run of padding chunks after the format chunk.
+	for (uint64_t offset = 12; offset + 8 <= file_size; )
+	{
+		uint8_t chunk_header[12];
+
+		if (ga_fseek(pFile, offset, SEEK_SET) != 0 || fread(chunk_header, 1, 8, pFile) != 8)
+		{
+			result = GA_E_FILE;
+			break;
+		}
+
+		uint32_t chunk_size = read_u32_le(chunk_header + 4);
+		uint64_t chunk_end = offset + 8 + chunk_size + (chunk_size & 1);
+		uint8_t is_padding = (memcmp(chunk_header, "JUNK", 4) == 0 || memcmp(chunk_header, "junk", 4) == 0 || memcmp(chunk_header, "PAD ", 4) == 0);
+
+		if (offset + 8 + chunk_size > file_size)
+		{
+			result = GA_E_UNSUPPORTED_TAG;
+			break;
+		}
+
+		// The last chunk may be missing its pad byte.
+		chunk_end = (chunk_end > file_size ? file_size : chunk_end);
+
+		if (memcmp(chunk_header, "fmt ", 4) == 0)
+		{
+			found_fmt = 1;
+		}
+		else if (memcmp(chunk_header, "LIST", 4) == 0 && list_end == 0 && chunk_size >= 4)
+		{
+			if (fread(chunk_header + 8, 1, 4, pFile) != 4)
+			{
+				result = GA_E_FILE;
+				break;
+			}
+
+			if (memcmp(chunk_header + 8, "INFO", 4) == 0)
+			{
+				list_start = offset;
+				list_end = chunk_end;
+			}
+		}
+		else if (is_padding && list_end == offset)
+		{
+			list_end = chunk_end;
+		}
+		else if (is_padding && found_fmt && (junk_end == 0 || junk_end == offset))
+		{
+			junk_start = (junk_end == 0 ? offset : junk_start);
+			junk_end = chunk_end;
+		}
+
+		offset = chunk_end;
+	}
+
+	// Build the new chunk, with the mapped fields first, then any other INFO fields kept from the old chunk.
+	tag_buffer chunk = {};
+	uint8_t* old_list = NULL;
+	uint32_t old_list_size = 0;
+
+	if (result == GA_SUCCESS)
+	{
+		result = append_tag_buffer(&chunk, "LIST\0\0\0\0INFO", 12);
+	}
+
+	for (int32_t i = 0; i < info_count && result == GA_SUCCESS; i++)
+	{
+		const char* value = find_tag_value(fields, values, tag_count, tag_fields[i]);
+
+		if (value != NULL)
+		{
+			uint8_t subchunk_header[8];
+			uint32_t value_size = (uint32_t)strlen(value) + 1;
+
+			memcpy(subchunk_header, info_ids[i], 4);
+			write_u32_le(subchunk_header + 4, value_size);
+			result = append_tag_buffer(&chunk, subchunk_header, 8);
+			if (result == GA_SUCCESS)
+			{
+				result = append_tag_buffer(&chunk, value, value_size);
+			}
+			if (result == GA_SUCCESS && (value_size & 1))
+			{
+				result = append_tag_buffer(&chunk, NULL, 1);
+			}
+		}
+	}
+
+	if (result == GA_SUCCESS && list_end > 0)
+	{
+		uint8_t size_bytes[4];
+
+		if (ga_fseek(pFile, list_start + 4, SEEK_SET) != 0 || fread(size_bytes, 1, 4, pFile) != 4)
+		{
+			result = GA_E_FILE;
+		}
+		else
+		{
+			old_list_size = read_u32_le(size_bytes);
+			old_list = (uint8_t*)malloc(old_list_size);
+
+			if (old_list == NULL)
+			{
+				result = GA_E_MEMORY;
+			}
+			else if (fread(old_list, 1, old_list_size, pFile) != old_list_size)
+			{
+				result = GA_E_FILE;
+			}
+		}
+	}
+
+	for (uint32_t offset = 4; old_list != NULL && result == GA_SUCCESS && old_list_size - offset >= 8; )
+	{
+		uint32_t subchunk_size = read_u32_le(old_list + offset + 4);
+		uint32_t subchunk_end;
+		uint8_t managed = 0;
+
+		if (subchunk_size > old_list_size - offset - 8)
+		{
+			break;
+		}
+
+		subchunk_end = offset + 8 + subchunk_size;
+
+		for (int32_t i = 0; i < info_count; i++)
+		{
+			managed |= (memcmp(old_list + offset, info_ids[i], 4) == 0);
+		}
+
+		if (!managed)
+		{
+			result = append_tag_buffer(&chunk, old_list + offset, subchunk_end - offset);
+			if (result == GA_SUCCESS && (subchunk_size & 1))
+			{
+				result = append_tag_buffer(&chunk, NULL, 1);
+			}
+		}
+
+		offset = subchunk_end + (subchunk_size & 1);
+	}
+
+	free(old_list);
+
+	if (result != GA_SUCCESS)
+	{
+		fclose(pFile);
+		free_tag_buffer(&chunk);
+		return result;
+	}
+
+	write_u32_le(chunk.data + 4, (uint32_t)(chunk.size - 8));
+
+	// Place the chunk over the old one and its padding, or over other padding, filling what's left with a JUNK chunk. A region at the end of
+	// the file can always be used, since the file can grow. Otherwise the old chunk is renamed JUNK and the new one is appended.
+	uint64_t region_start = (list_end > 0 ? list_start : junk_start);
+	uint64_t region_end = (list_end > 0 ? list_end : junk_end);
+	uint64_t region_size = region_end - region_start;
+	uint64_t new_file_size = file_size;
+	uint64_t write_offset;
+	uint64_t filler_size = 0;
+
+	if (region_end > 0 && (chunk.size == region_size || chunk.size + 8 <= region_size || region_end == file_size))
+	{
+		write_offset = region_start;
+
+		if (chunk.size < region_size)
+		{
+			filler_size = (region_size - chunk.size < 8 ? 8 : region_size - chunk.size);
+		}
+
+		new_file_size = (write_offset + chunk.size + filler_size > file_size ? write_offset + chunk.size + filler_size : file_size);
+	}
+	else
+	{
+		write_offset = file_size + (file_size & 1);
+		new_file_size = write_offset + chunk.size;
+	}
+
+	if (new_file_size - 8 > UINT32_MAX)
+	{
+		fclose(pFile);
+		free_tag_buffer(&chunk);
+		return GA_E_UNSUPPORTED_TAG;
+	}
+
+	if (filler_size > 0)
+	{
+		size_t chunk_size = chunk.size;
+
+		result = append_tag_buffer(&chunk, "JUNK\0\0\0\0", 8);
+		if (result == GA_SUCCESS)
+		{
+			result = append_tag_buffer(&chunk, NULL, filler_size - 8);
+		}
+		if (result == GA_SUCCESS)
+		{
+			write_u32_le(chunk.data + chunk_size + 4, (uint32_t)(filler_size - 8));
+		}
+	}
+
+	if (result == GA_SUCCESS && write_offset >= file_size && list_end > 0)
+	{
+		if (ga_fseek(pFile, list_start, SEEK_SET) != 0 || fwrite("JUNK", 1, 4, pFile) != 4)
+		{
+			result = GA_E_FILE;
+		}
+	}
+
+	if (result == GA_SUCCESS && write_offset > file_size)
+	{
+		if (ga_fseek(pFile, file_size, SEEK_SET) != 0 || fputc(0, pFile) == EOF)
+		{
+			result = GA_E_FILE;
+		}
+	}
+
+	if (result == GA_SUCCESS)
+	{
+		if (ga_fseek(pFile, write_offset, SEEK_SET) != 0 || fwrite(chunk.data, 1, chunk.size, pFile) != chunk.size)
+		{
+			result = GA_E_FILE;
+		}
+	}
+
+	if (result == GA_SUCCESS && new_file_size != file_size)
+	{
+		write_u32_le(header + 4, (uint32_t)(new_file_size - 8));
+
+		if (ga_fseek(pFile, 4, SEEK_SET) != 0 || fwrite(header + 4, 1, 4, pFile) != 4)
+		{
+			result = GA_E_FILE;
+		}
+	}
+
+	if (fclose(pFile) != 0 && result == GA_SUCCESS)
+	{
+		result = GA_E_FILE;
+	}
+
+	free_tag_buffer(&chunk);
+
+	// Fields without an INFO equivalent are left out.
+	for (int32_t i = 0; i < tag_count && result == GA_SUCCESS; i++)
+	{
+		uint8_t mapped = 0;
+
+		for (int32_t j = 0; j < info_count; j++)
+		{
+			mapped |= tag_field_equals(fields[i], tag_fields[j]);
+		}
+
+		if (!mapped)
+		{
+			result = GA_W_TAG_FIELD;
+		}
+	}
+
+	*rewritten = 0;
+
+	return result;
+}
+
 
 //////////////////////////////
 // LabVIEW Audio Device API //
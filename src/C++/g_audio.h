@@ -72,6 +72,10 @@ For more information, please refer to <http://unlicense.org/>
 #include <stringapiset.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
 #define Sleep(x) usleep((x)*1000)
 #endif
 #include <vector>
@@ -86,6 +90,8 @@ For more information, please refer to <http://unlicense.org/>
 #define MINIMP3_IMPLEMENTATION
 //#define MINIMP3_FLOAT_OUTPUT
 #include "minimp3_ex.h"
+// Float build of minimp3 for float and double reads.
+#include "minimp3_f32.h"
 
 #define DR_WAV_IMPLEMENTATION
 #include "dr_wav.h"
@@ -99,6 +105,8 @@ For more information, please refer to <http://unlicense.org/>
 #include "stb_vorbis.h"
 #include "thread_safety.h"
 #include "base64.h"
+#include "sample_conversion.h"
+#include "flac_encoder.h"
 
 // Don't define miniaudio's encoders and decoders, as we're using those libraries separately.
 #define MA_NO_DECODING
@@ -155,11 +163,13 @@ typedef int32_t ga_result;
 #define GA_E_UNSUPPORTED_TAG	-17     // Unsupported tag format
 #define GA_E_TAG				-18     // An error ocurred trying to read the tags
 #define GA_E_PICTURE			-19     // An error ocurred trying to read the picture
+#define GA_E_CANCELLED			-20		// The operation was cancelled before it completed
 #define MA_ERROR_OFFSET			-1000	// Add this to miniaudio error codes for return to LabVIEW.
 // WARNINGS
 #define GA_W_BUFFER_SIZE		1		// The specified buffer size is smaller than the period, may cause glitches
 #define GA_W_UTF8_TO_UTF16		2		// UTF-8 to UTF-16 is unsupported on this OS
 #define GA_W_EMBEDDED_ARTWORK	3		// The file does not support embedded artwork
+#define GA_W_TAG_FIELD			4		// Some tag fields can't be stored in the file's tag format, and weren't written
 
 typedef struct
 {
@@ -205,6 +215,157 @@ typedef enum
 	ga_data_type_double
 } ga_data_type;
 
+// Grow-only buffer for intermediate sample data, reused across reads so steady-state reading doesn't allocate.
+typedef struct
+{
+	void* data;
+	size_t size;
+} ga_scratch_buffer;
+
+// Largest file that's mapped into memory. 32-bit builds read larger files by name, so a few long files can't use up the address space.
+#if SIZE_MAX > 0xFFFFFFFF
+#define GA_MAP_FILE_MAX_SIZE SIZE_MAX
+#else
+#define GA_MAP_FILE_MAX_SIZE (256 * 1024 * 1024)
+#endif
+
+// File information a stamp is made from, as returned for an open file.
+#if defined(_WIN32)
+typedef BY_HANDLE_FILE_INFORMATION ga_file_info;
+#else
+typedef struct stat ga_file_info;
+#endif
+
+// Read-only memory mapping of an entire file, with the information of the file that was mapped.
+typedef struct
+{
+	const uint8_t* data;
+	size_t size;
+	ga_file_info info;
+#if defined(_WIN32)
+	HANDLE file;
+	HANDLE mapping;
+#endif
+} ga_file_map;
+
+// Source of an audio file's data. The file is mapped once and shared by codec detection and the decoder.
+// If the file can't be mapped, data is NULL and the decoders read the file by name instead.
+// Sources in memory have no file name, and data points to either the caller's buffer or owned_data, a copy of it.
+typedef struct
+{
+	char* file_name;
+	const uint8_t* data;
+	size_t size;
+	ga_file_map map;
+	uint8_t* owned_data;
+} ga_io;
+
+// Format of sample cache entries created by load_audio_file_s16(), which decodes differently to load_audio_file() for some codecs.
+#define SAMPLE_CACHE_FORMAT_S16_LOAD -1
+
+// A decoded file held in the sample cache. Entries are shared by every load of the same file as the same type, and by
+// refnums opened on the file, so the data must be treated as read-only.
+typedef struct
+{
+	char* file_name;
+	uint64_t file_size;
+	int64_t modified_time;
+	uint64_t file_id;
+	int32_t format;
+	void* data;
+	size_t data_size;
+	uint64_t num_frames;
+	uint32_t channels;
+	uint32_t sample_rate;
+	ga_codec codec;
+	int32_t ref_count;
+	uint8_t evicted;
+	uint64_t last_used;
+} sample_cache_entry;
+
+// Process-wide cache of decoded files. Evicted entries which are still referenced stay in the list until released.
+typedef struct
+{
+	std::vector<sample_cache_entry*> entries;
+	uint64_t budget = 0;
+	uint64_t bytes_used = 0;
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t evictions = 0;
+	uint64_t clock = 0;
+} sample_cache;
+
+// Default read-ahead ring dimensions, used when open_audio_file_read_ahead() is passed 0.
+#define READ_AHEAD_DEFAULT_BLOCK_FRAMES 4096
+#define READ_AHEAD_DEFAULT_BLOCKS 8
+
+// Frames converted at a time by write_audio_file_ex(), bounding the size of a refnum's staging buffer.
+#define WRITE_CONVERT_BLOCK_FRAMES 16384
+
+// Default write-behind queue dimensions, used when open_audio_file_write_behind() is passed 0.
+#define WRITE_BEHIND_DEFAULT_BLOCK_FRAMES 16384
+#define WRITE_BEHIND_DEFAULT_BLOCKS 16
+
+// State shared between the workers of a batch load. Each worker takes the next unclaimed file until none are left.
+typedef struct
+{
+	const char** file_names;
+	int32_t num_files;
+	ga_data_type audio_type;
+	intptr_t* buffers;
+	uint64_t* num_frames;
+	uint32_t* channels;
+	uint32_t* sample_rates;
+	ga_codec* codecs;
+	ga_result* results;
+	// Threads each file's parallel decode may use, so a batch doesn't oversubscribe the cores.
+	uint32_t worker_budget;
+	volatile ma_uint32 next_file;
+} batch_load_job;
+
+// Background decoding for a read refnum. While the worker is running it owns the decoder, keeping the ring filled
+// with decoded blocks of audio_type so reads of that type are a copy. Seeks and reads of other types stop the worker.
+typedef struct
+{
+	ma_rb ring;
+	ma_thread thread;
+	ma_event data_ready;
+	ma_event space_ready;
+	ga_data_type audio_type;
+	uint32_t channels;
+	uint32_t sample_rate;
+	// Length of the stream, used to clamp seeks. Zero if the decoder couldn't provide it.
+	uint64_t num_frames;
+	size_t frame_size;
+	uint32_t block_frames;
+	uint8_t running;
+	// Offset of the next frame returned by a read, and of the next frame the decoder will produce.
+	uint64_t read_offset;
+	uint64_t decode_offset;
+	volatile ma_uint32 stop;
+	volatile ma_uint32 finished;
+	volatile ma_uint32 result;
+} read_ahead_state;
+
+// Background encoding for a write refnum. Writes are copied into the queue, and the worker owns the encoder,
+// passing queued frames to it once a block has built up. Only the writing thread adds to the queue, so the ring needs no lock.
+typedef struct
+{
+	ma_rb ring;
+	ma_thread thread;
+	ma_event data_ready;
+	ma_event space_ready;
+	size_t frame_size;
+	uint32_t block_frames;
+	uint64_t capacity_frames;
+	// Deepest the queue has been, in frames. Only updated by the writing thread.
+	uint64_t high_water_frames;
+	volatile ma_uint32 flush;
+	volatile ma_uint32 stop;
+	// First error from the encoder. Frames queued after an error are discarded.
+	volatile ma_uint32 result;
+} write_behind_state;
+
 // Structure to hold infomration about the current file
 typedef struct
 {
@@ -215,11 +376,26 @@ typedef struct
 	void* decoder;
 	void* encoder;
 	uint64_t read_offset;
-	ga_result (*open)(const char* file_name, void** decoder);
+	ga_scratch_buffer scratch;
+	ga_io io;
+	// Decoded copy of the file from the sample cache. Reads of its type are copied from the cache, other types use the decoder.
+	sample_cache_entry* cached;
+	uint64_t cached_offset;
+	uint8_t decoder_synced;
+	// Background decoder state, or NULL if the refnum wasn't opened with read-ahead.
+	read_ahead_state* read_ahead;
+	// Background encoder state, or NULL if the refnum wasn't opened with write-behind.
+	write_behind_state* write_behind;
+	// Sample format the encoder takes, used to convert the input of write_audio_file_ex().
+	uint32_t write_channels;
+	uint32_t write_bits_per_sample;
+	uint8_t write_float;
+	ga_result (*open)(ga_io* io, void** decoder);
 	ga_result (*open_write)(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, void* codec_specific, void** encoder);
 	ga_result (*get_basic_info)(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset);
+	ga_result (*get_length)(void* decoder, uint64_t* num_frames);
 	ga_result (*seek)(void* decoder, uint64_t offset, uint64_t* new_offset);
-	ga_result (*read)(void* decoder, uint64_t frames_to_read, ga_data_type data_type, uint64_t* frames_read, void* output_buffer);
+	ga_result (*read)(void* decoder, uint64_t frames_to_read, ga_data_type data_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch);
 	ga_result (*write)(void* encoder, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
 	ga_result (*close)(void* decoder);
 } audio_file_codec;
@@ -255,16 +431,121 @@ typedef struct
 	uint32_t depth;
 } audio_file_picture;
 
+// How embedded pictures are returned with the tags.
+typedef enum
+{
+	ga_picture_none = 0,	// Pictures aren't read
+	ga_picture_rgba,		// Decoded to 8-bit RGBA
+	ga_picture_compressed,	// The image file as stored (eg. JPEG or PNG). The dimensions are read from its header without decoding
+	ga_picture_thumbnail	// Decoded to 8-bit RGBA, and shrunk to fit within the thumbnail size
+} ga_picture_mode;
+
+// NOTE: This struct is replicated as a cluster in LabVIEW.
+// Offsets are in bytes from the start of the string block. Strings are UTF-8, and NULL terminated after length bytes.
 typedef struct
 {
-	audio_file_tag* tags;
-	audio_file_picture* pictures;
+	int32_t field_offset;
+	int32_t field_length;
+	int32_t value_offset;
+	int32_t value_length;
+} library_scan_tag;
+
+// Tags and pictures gathered while a file's tags are read. Strings are appended to a single block and referenced by offset, so a file
+// takes a few allocations however many tags it has. pack_audio_file_tags() then copies the lot into the single block returned to the caller.
+typedef struct
+{
+	library_scan_tag* tags;
 	int32_t tag_count;
+	int32_t tag_capacity;
+	char* strings;
+	size_t strings_size;
+	size_t strings_capacity;
+	audio_file_picture* pictures;
 	int32_t picture_count;
-	uint8_t read_pictures;
+	int32_t picture_capacity;
+	ga_picture_mode picture_mode;
+	uint32_t thumbnail_size;
 	ga_result result;
 } audio_file_tag_info;
 
+// NOTE: This struct is replicated as a cluster in LabVIEW.
+// Be careful of alignment issues - LV 32-bit is byte aligned, LV 64-bit is naturally aligned. Padded to 40 bytes so both agree.
+// The tags of an entry are tag_count entries starting at tag_index in the tag array.
+typedef struct
+{
+	uint64_t num_frames;
+	uint32_t channels;
+	uint32_t sample_rate;
+	uint32_t bits_per_sample;
+	int32_t codec;
+	ga_result result;
+	int32_t tag_index;
+	int32_t tag_count;
+	uint32_t is_exact;
+} library_scan_entry;
+
+// Result of scanning a single file, before the scan results are flattened.
+typedef struct
+{
+	library_scan_entry entry;
+	audio_file_tag* tags;
+	int32_t tag_count;
+	// Set when the tags were asked for, whether or not they could be read.
+	uint8_t tags_read;
+	// Size, modification time and ID of the file when it was scanned, for scans with an index.
+	uint8_t has_stamp;
+	uint64_t file_size;
+	int64_t modified_time;
+	uint64_t file_id;
+} library_scan_file;
+
+// Library index files hold the scan results of each file, keyed by path, size, modification time and file ID.
+#define LIBRARY_INDEX_MAGIC "GALI"
+#define LIBRARY_INDEX_VERSION 2
+#define LIBRARY_INDEX_HEADER_SIZE 32
+#define LIBRARY_INDEX_RECORD_SIZE 72
+#define LIBRARY_INDEX_TAG_SIZE 16
+
+// A library index file mapped for lookups. Records are found through an open addressing hash table of path hashes, and read straight from the mapping.
+typedef struct
+{
+	ga_file_map map;
+	uint32_t record_count;
+	uint32_t bucket_count;
+	uint32_t tag_count;
+	uint64_t strings_size;
+	const uint8_t* buckets;
+	const uint8_t* records;
+	const uint8_t* tags;
+	const char* strings;
+} library_index;
+
+// A library scan running on a pool of worker threads. Each worker takes the next unclaimed file until none are left or the scan is cancelled.
+// Once every worker has finished, the per-file results are flattened into a single block holding the entries, tags and strings.
+typedef struct
+{
+	thread_mutex_t mutex;
+	char** file_names;
+	library_scan_file* files;
+	int32_t num_files;
+	uint8_t read_tags;
+	uint8_t exact;
+	char* index_name;
+	library_index index;
+	volatile ma_uint32 index_misses;
+	uint8_t index_written;
+	ma_thread* threads;
+	uint32_t thread_count;
+	volatile ma_uint32 next_file;
+	volatile ma_uint32 files_scanned;
+	volatile ma_uint32 workers_running;
+	volatile ma_uint32 cancelled;
+	uint8_t joined;
+	uint8_t* results;
+	int32_t tag_count;
+	int32_t strings_size;
+} library_scan;
+
 
 ////////////////////////////
 // LabVIEW CLFN Callbacks //
@@ -275,16 +556,37 @@ extern "C" LV_DLL_EXPORT int32_t clfn_abort(void* data);
 // LabVIEW Audio File API //
 ////////////////////////////
 
-// Get detailed audio file information. Requires decoding some audio files (mp3).
+// Get detailed audio file information. MP3 lengths are read from the Xing / Info header when present, otherwise every frame is scanned.
 extern "C" LV_DLL_EXPORT ga_result get_audio_file_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, ga_codec* codec);
+// Get audio file information, choosing between speed and exactness for MP3 lengths. Set exact to force a scan of every MP3 frame.
+// Otherwise the length may be estimated from a VBRI header or the bitrate of a CBR file, and is_exact is cleared.
+extern "C" LV_DLL_EXPORT ga_result get_audio_file_info_ex(const char* file_name, uint8_t exact, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, ga_codec* codec, uint8_t* is_exact);
 // Load an entire audio file and return data in interleaved 16-bit integer format. Data returned by this function must be freed with free_sample_data().
 extern "C" LV_DLL_EXPORT int16_t* load_audio_file_s16(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+// Load an entire audio file and return data in interleaved audio_type format, decoded directly to that type. Data returned by this function must be freed with free_sample_data().
+extern "C" LV_DLL_EXPORT void* load_audio_file(const char* file_name, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+// Load audio held in memory and return data in interleaved audio_type format, as load_audio_file() does for files. The data isn't copied or modified.
+// Data returned by this function must be freed with free_sample_data().
+extern "C" LV_DLL_EXPORT void* load_audio_memory(const uint8_t* data, uint64_t size, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+// Load several audio files concurrently on a worker per core, decoding each as load_audio_file() does. The output arrays must hold num_files elements.
+// Each file's buffer and result are written to the same index. Buffers must be freed with free_sample_data(). Returns the first error in file order.
+extern "C" LV_DLL_EXPORT ga_result load_audio_files(const char** file_names, int32_t num_files, ga_data_type audio_type, intptr_t* buffers, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rates, ga_codec* codecs, ga_result* results);
 // Frees the memory allocated during a file load operation.
 extern "C" LV_DLL_EXPORT void free_sample_data(int16_t* buffer);
 // Opens an audio file in read mode. Call close_audio_file() to free memory related to the refnum.
 extern "C" LV_DLL_EXPORT ga_result open_audio_file(const char* file_name, int32_t* refnum);
+// Opens an audio file in read mode, decoding num_blocks blocks of block_frames ahead of the read position on a background thread.
+// Reads of audio_type are copied from the decoded blocks, other types are decoded on the calling thread. Pass 0 to use the default sizes.
+extern "C" LV_DLL_EXPORT ga_result open_audio_file_read_ahead(const char* file_name, ga_data_type audio_type, uint32_t block_frames, uint32_t num_blocks, int32_t* refnum);
+// Opens audio held in memory in read mode, eg. from a database or network payload. Call close_audio_file() to free memory related to the refnum.
+// With copy_data set the data is copied into the refnum, otherwise it's borrowed and must remain valid and unchanged until the refnum is closed.
+extern "C" LV_DLL_EXPORT ga_result open_audio_memory(const uint8_t* data, uint64_t size, uint8_t copy_data, int32_t* refnum);
 // Opens an audio file in write mode. Call close_audio_file() to free memory related to the refnum.
 extern "C" LV_DLL_EXPORT ga_result open_audio_file_write(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, ga_codec codec, int32_t has_specific_info, void* codec_specific, int32_t* refnum);
+// Opens an audio file in write mode, encoding on a background thread so disk stalls don't hold up the caller. Writes are copied into a queue of
+// num_blocks blocks of block_frames, which is written to the encoder a block or more at a time. A write only waits when the queue is full.
+// Pass 0 to use the default sizes. Call close_audio_file() to write out the queue and free memory related to the refnum.
+extern "C" LV_DLL_EXPORT ga_result open_audio_file_write_behind(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, ga_codec codec, int32_t has_specific_info, void* codec_specific, uint32_t block_frames, uint32_t num_blocks, int32_t* refnum);
 // Get basic audio file information. More detailed info can be accessed using get_audio_file_info().
 extern "C" LV_DLL_EXPORT ga_result get_basic_audio_file_info(int32_t refnum, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset);
 // Updates the file offset to the specified offset. Subsequent reads will be at the new offset.
@@ -294,16 +596,216 @@ extern "C" LV_DLL_EXPORT ga_result seek_audio_file(int32_t refnum, uint64_t offs
 extern "C" LV_DLL_EXPORT ga_result read_audio_file(int32_t refnum, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
 // Write a chunk of audio data to the file and update the file position ready for the next write.
 extern "C" LV_DLL_EXPORT ga_result write_audio_file(int32_t refnum, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
+// Write a chunk of audio data of audio_type, converting it to the sample format of the file. Conversions to 8, 16, 24 and 32-bit PCM,
+// and 32 and 64-bit float files are supported. Input of the file's own format is written without a copy.
+extern "C" LV_DLL_EXPORT ga_result write_audio_file_ex(int32_t refnum, uint64_t frames_to_write, ga_data_type audio_type, void* input_buffer, uint64_t* frames_written);
+// Wait until every queued frame of a write-behind refnum has been passed to the encoder. Returns the first error the encoder reported.
+// Refnums opened without write-behind have nothing queued, and return immediately.
+extern "C" LV_DLL_EXPORT ga_result flush_audio_file(int32_t refnum);
+// Get the number of frames waiting in the write-behind queue, the most there have been, and the queue's capacity.
+extern "C" LV_DLL_EXPORT ga_result get_write_behind_stats(int32_t refnum, uint64_t* queued_frames, uint64_t* high_water_frames, uint64_t* capacity_frames);
 // Close the audio file and release any resources allocated in the refnum.
+// A write-behind queue is written out first, and any error from encoding it is returned once the file is closed.
 extern "C" LV_DLL_EXPORT ga_result close_audio_file(int32_t refnum);
+// Configure the MP3 seek index cache. Indexes of recently opened files are kept in memory, and optionally in a sidecar file next to the MP3.
+// Disabling the cache releases all cached indexes.
+extern "C" LV_DLL_EXPORT ga_result configure_mp3_index_cache(uint8_t enabled, uint8_t use_sidecar_files);
+// Enable or disable the Vorbis page index cache. Seek indexes of recently seeked files are kept in memory, so reopening a file seeks without rescanning it.
+// Disabling the cache releases all cached indexes.
+extern "C" LV_DLL_EXPORT ga_result configure_vorbis_index_cache(uint8_t enabled);
+// Set the memory budget of the decoded sample cache. When enabled, whole-file loads are shared and the returned data is read-only.
+// A budget of 0 disables the cache (the default). Buffers still in use are released when freed with free_sample_data().
+extern "C" LV_DLL_EXPORT ga_result configure_sample_cache(uint64_t budget_bytes);
+// Get the sample cache counters, and the memory currently held by cached entries.
+extern "C" LV_DLL_EXPORT ga_result get_sample_cache_stats(uint64_t* hits, uint64_t* misses, uint64_t* evictions, uint64_t* bytes_used, uint32_t* num_entries);
 
 // Get the tag data for the associated file.
 extern "C" LV_DLL_EXPORT ga_result get_audio_file_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
-ga_result free_audio_file_tags(audio_file_tag_info tag_info);
+// Get the tag data, choosing how pictures are returned. Thumbnails are shrunk to at most thumbnail_size pixels wide and high, keeping their aspect ratio.
+// Compressed pictures have a data_size of the image file, and a width, height and depth of 0 if the format isn't recognised.
+extern "C" LV_DLL_EXPORT ga_result get_audio_file_tags_ex(const char* file_name, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Free the tags and pictures returned by get_audio_file_tags(). They share a single block starting at the tag array.
 extern "C" LV_DLL_EXPORT ga_result free_audio_file_tags(intptr_t tags, int32_t tag_count, intptr_t pictures, int32_t picture_count);
-
+// Replace the text tags of a file with tag_count UTF-8 field / value pairs, using the same field names get_audio_file_tags() returns. Embedded pictures are kept.
+// Tags are updated in place when the existing tag and its padding have room, otherwise the file is rewritten once with padding for later edits.
+// rewritten is set when the audio had to be copied to a new file.
+extern "C" LV_DLL_EXPORT ga_result set_audio_file_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten);
+// Start gathering the info, and optionally the tags, of many files on a worker per core. Returns immediately with a refnum for the scan.
+// Set exact to scan every MP3 frame for its length, otherwise lengths may be estimated as in get_audio_file_info_ex(). Call close_library_scan() to free the refnum.
+extern "C" LV_DLL_EXPORT ga_result start_library_scan(const char** file_names, int32_t num_files, uint8_t read_tags, uint8_t exact, int32_t* refnum);
+// Start a library scan which reuses the results held in an index file. Files whose size and modification time haven't changed are read from the index,
+// so only new and changed files are scanned. The index is created if it doesn't exist, and replaced with the scan's files when the results are fetched.
+extern "C" LV_DLL_EXPORT ga_result start_library_scan_ex(const char** file_names, int32_t num_files, uint8_t read_tags, uint8_t exact, const char* index_file_name, int32_t* refnum);
+// Get the number of files scanned so far, and whether the scan has finished.
+extern "C" LV_DLL_EXPORT ga_result get_library_scan_progress(int32_t refnum, int32_t* files_scanned, int32_t* num_files, uint8_t* finished);
+// Stop the scan once the files in progress are done. Files that weren't scanned have a result of GA_E_CANCELLED.
+extern "C" LV_DLL_EXPORT ga_result cancel_library_scan(int32_t refnum);
+// Wait for the scan to finish and get its results, with one entry per file in the order they were passed in. The three arrays are in a single block
+// owned by the refnum, and remain valid until close_library_scan() is called.
+extern "C" LV_DLL_EXPORT ga_result get_library_scan_results(int32_t refnum, intptr_t* entries, int32_t* entry_count, intptr_t* tags, int32_t* tag_count, intptr_t* strings, int32_t* strings_size);
+// Cancel the scan if it's still running, and release the refnum and its results.
+extern "C" LV_DLL_EXPORT ga_result close_library_scan(int32_t refnum);
+
+// Get audio file information from the decoder of an already detected codec.
+ga_result get_codec_file_info(ga_io* io, ga_codec codec, uint8_t exact, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, uint8_t* is_exact);
+// Get the tag data from the tag reader of an already detected codec.
+ga_result get_codec_file_tags(ga_io* io, ga_codec codec, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Write the tags with the tag writer of an already detected codec.
+ga_result set_codec_file_tags(const char* file_name, ga_codec codec, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten);
+// Append a tag, copying the field and value into the string block.
+ga_result add_audio_file_tag(audio_file_tag_info* tag_info, const char* field, size_t field_length, const char* value, size_t value_length);
+// Append a picture loaded from an embedded image file, as the tag info's picture_mode asks.
+ga_result add_audio_file_picture(audio_file_tag_info* tag_info, const uint8_t* data, size_t size, uint32_t type);
+// Copy the tags, pictures and strings into a single block laid out as audio_file_tag and audio_file_picture arrays, and free the tag info.
+// The block starts at the tag array, which is returned even if there are no tags so the block can be freed.
+ga_result pack_audio_file_tags(audio_file_tag_info* tag_info, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+void free_audio_file_tag_info(audio_file_tag_info* tag_info);
+// Fill in a tag picture from an embedded image file, as picture_mode asks. Data is freed by free_audio_file_tag_info(), unless packed.
+ga_result load_tag_picture(const uint8_t* data, size_t size, uint32_t type, ga_picture_mode picture_mode, uint32_t thumbnail_size, audio_file_picture* picture);
+// Shrink an RGBA image, averaging the input pixels covered by each output pixel.
+void downscale_rgba(const uint8_t* input, uint32_t input_width, uint32_t input_height, uint8_t* output, uint32_t output_width, uint32_t output_height);
 // Determine the codec of the audio file
 ga_result get_audio_file_codec(const char* file_name, ga_codec* codec);
+// Determine the codec of an opened file from its first bytes.
+ga_result get_io_codec(ga_io* io, ga_codec* codec);
+// Determine the codec from the file signature.
+ga_result get_codec_from_signature(const uint8_t* signature, size_t size, ga_codec* codec);
+// Open a file for decoding, mapping it into memory when possible. Call ga_io_close() once the decoder using it is closed.
+ga_result ga_io_open(const char* file_name, ga_io* io);
+// Open data in memory for decoding, either borrowing the caller's buffer or taking a copy of it.
+ga_result ga_io_open_memory(const uint8_t* data, uint64_t size, uint8_t copy_data, ga_io* io);
+void ga_io_close(ga_io* io);
+// Get the stamp of an opened file, from the mapped file if there is one. Data in memory has no stamp.
+ga_result ga_io_get_file_stamp(const ga_io* io, uint64_t* file_size, int64_t* modified_time, uint64_t* file_id);
+// Open a read refnum on an opened io. The refnum takes ownership of the io, which is closed on failure.
+ga_result open_audio_io(ga_io io, int32_t* refnum);
+// Initialise an audio_file_codec and assign the codec functions for the given file mode.
+ga_result init_audio_file_codec(audio_file_codec* audio_file, ga_codec codec, ga_file_mode file_mode);
+// Size in bytes of a single sample of the given type. Returns 0 for invalid types.
+size_t get_data_type_size(ga_data_type audio_type);
+// Pass frames in the encoder's sample format to the write-behind queue, or straight to the encoder. The refnum mutex must be held.
+ga_result write_encoder_frames(audio_file_codec* audio_file, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
+// Convert samples of audio_type to a file sample format. 24-bit output is packed, and buffer_out must hold 4 bytes per sample for the intermediate 32-bit samples.
+ga_result convert_write_samples(void* buffer_out, const void* buffer_in, ga_data_type audio_type, uint32_t bits_per_sample, uint8_t is_float, size_t num_samples);
+// Decode an entire file without going through the sample cache.
+int16_t* decode_audio_file_s16(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+void* decode_audio_file(const char* file_name, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+// Decode all of an opened io. The io is left open.
+void* decode_audio_io(ga_io* io, ga_data_type audio_type, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+ma_thread_result MA_THREADCALL batch_load_worker(void* user_data);
+
+//////////////////
+// Sample cache //
+//////////////////
+
+// Load an entire file through the sample cache. format is a ga_data_type, or SAMPLE_CACHE_FORMAT_S16_LOAD.
+void* load_cached_samples(const char* file_name, int32_t format, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_codec* codec, ga_result* result);
+// Find a cached decode of the file for a refnum to read from. Any load_audio_file() type can be used. Release with release_sample_cache_entry().
+sample_cache_entry* acquire_sample_cache_stream(const char* file_name);
+// Drop a reference to an entry, freeing it once it is evicted and unreferenced. The cache mutex must be held.
+void release_sample_cache_entry(sample_cache_entry* entry);
+// Remove an entry from the cache list and free it. The cache mutex must be held.
+void remove_sample_cache_entry(sample_cache_entry* entry);
+// Evict least recently used entries until the cache fits its budget. The cache mutex must be held.
+void trim_sample_cache();
+// Read from a refnum's cached samples, falling back to the decoder for other audio types.
+ga_result read_cached_samples(audio_file_codec* audio_file, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+// Get a scratch buffer of at least size bytes. Existing contents are not preserved when the buffer grows. Returns NULL on allocation failure.
+void* reserve_scratch_buffer(ga_scratch_buffer* scratch, size_t size);
+// Release the memory held by a scratch buffer.
+void free_scratch_buffer(ga_scratch_buffer* scratch);
+
+////////////////
+// Read-ahead //
+////////////////
+
+// Allocate the read-ahead state of a refnum and start decoding ahead of the current read position.
+ga_result init_read_ahead(audio_file_codec* audio_file, ga_data_type audio_type, uint32_t block_frames, uint32_t num_blocks);
+// Stop the worker and free the read-ahead state.
+void free_read_ahead(audio_file_codec* audio_file);
+// Start the worker from the read position. The refnum mutex must be held.
+ga_result start_read_ahead(audio_file_codec* audio_file);
+// Stop the worker and discard the decoded blocks. The decoder is left wherever the worker stopped. The refnum mutex must be held.
+void stop_read_ahead(audio_file_codec* audio_file);
+// Read from a refnum's decoded blocks, falling back to the decoder for other audio types.
+ga_result read_ahead_samples(audio_file_codec* audio_file, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+// Move the decoder to the read position if the worker left it elsewhere.
+ga_result sync_read_ahead_decoder(audio_file_codec* audio_file);
+ma_thread_result MA_THREADCALL read_ahead_worker(void* user_data);
+
+//////////////////
+// Write-behind //
+//////////////////
+
+// Allocate the write-behind state of a refnum and start the worker.
+ga_result init_write_behind(audio_file_codec* audio_file, uint32_t channels, uint32_t bits_per_sample, uint32_t block_frames, uint32_t num_blocks);
+// Write out the queue, stop the worker and free the write-behind state. Returns the first error from the encoder.
+ga_result free_write_behind(audio_file_codec* audio_file);
+// Copy frames into the queue, waiting for the worker to make space when it's full. The refnum mutex must be held.
+ga_result queue_write_behind(audio_file_codec* audio_file, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
+// Wait for the worker to empty the queue. The refnum mutex must be held.
+ga_result flush_write_behind(audio_file_codec* audio_file);
+ma_thread_result MA_THREADCALL write_behind_worker(void* user_data);
+
+/////////////////////
+// Library scanner //
+/////////////////////
+
+// Gather the info and tags of a single opened file, detecting the codec once for both. A NULL io is a file that couldn't be opened.
+ga_result scan_library_file(ga_io* io, uint8_t read_tags, uint8_t exact, library_scan_file* file);
+// Scan a file of a scan, opening it once for the stamp, codec, info and tags. Scans with an index use the file's record if it's still current.
+ga_result scan_next_library_file(library_scan* scan, uint32_t index);
+// Wait for every worker of a scan to finish. The scan mutex must be held.
+void join_library_scan(library_scan* scan);
+// Flatten the per-file results into the single results block. The scan must be joined.
+ga_result flatten_library_scan(library_scan* scan);
+// Cancel and join a scan, then free it.
+void free_library_scan(library_scan* scan);
+ma_thread_result MA_THREADCALL library_scan_worker(void* user_data);
+// Map an index file and check its layout. Fails if the file doesn't exist or isn't a valid index.
+ga_result open_library_index(const char* file_name, library_index* index);
+void close_library_index(library_index* index);
+// Find a file's record in the index. Succeeds if its size, modification time and ID match, and the record has the tags and exactness the scan needs.
+// The file's tags point into the index mapping.
+ga_result find_library_index_file(const library_index* index, const char* file_name, uint64_t file_size, int64_t modified_time, uint64_t file_id, uint8_t read_tags, uint8_t exact, library_scan_file* file);
+// Replace the scan's index file with its flattened results. Skipped if every file was found in the index, and the index holds no other files.
+ga_result write_library_index(library_scan* scan);
+// FNV-1a hash of a path, used to find its record in an index.
+uint64_t hash_library_index_path(const char* file_name, size_t length);
+
+////////////////
+// Tag writer //
+////////////////
+
+// Padding left after the tags when a file has to be rewritten, so later edits fit in place.
+#define TAG_PADDING_SIZE 4096
+
+// A block of tag data being built up for writing.
+typedef struct
+{
+	uint8_t* data;
+	size_t size;
+	size_t capacity;
+} tag_buffer;
+
+// Append data to a tag buffer, or zeros if data is NULL.
+ga_result append_tag_buffer(tag_buffer* buffer, const void* data, size_t size);
+void free_tag_buffer(tag_buffer* buffer);
+// Check the fields are valid Vorbis comment field names (printable ASCII other than '='), and every value is set.
+ga_result check_tag_fields(const char** fields, const char** values, int32_t tag_count);
+// Compare field names, ignoring ASCII case.
+uint8_t tag_field_equals(const char* field, const char* name);
+// Find the value of the first tag with the field name, or NULL if there isn't one.
+const char* find_tag_value(const char** fields, const char** values, int32_t tag_count, const char* name);
+// Build a Vorbis comment block (vendor string, comment count and comments) from the tags. The vendor string and any METADATA_BLOCK_PICTURE
+// comments are kept from the existing block if there is one.
+ga_result build_vorbis_comment(const uint8_t* old_comment, size_t old_size, const char** fields, const char** values, int32_t tag_count, tag_buffer* comment);
+// Copy size bytes, or up to the end of the input if size is UINT64_MAX.
+ga_result copy_file_data(FILE* input, FILE* output, uint64_t size);
+// Create a temporary file next to file_name to rewrite it into. Free temp_name once finish_rewrite_file() has been called.
+FILE* open_rewrite_file(const char* file_name, char** temp_name);
+// Close the temporary file, and replace the original with it if result is GA_SUCCESS. Otherwise the temporary file is deleted.
+ga_result finish_rewrite_file(FILE* pFile, const char* temp_name, const char* file_name, ga_result result);
 
 //////////////////////////////
 // LabVIEW Audio Device API //
@@ -361,47 +863,315 @@ inline ma_format ga_data_type_to_ma_format(ga_data_type audio_type);
 // FLAC codec wrappers //
 /////////////////////////
 
+// Smallest range of PCM frames handed to a parallel FLAC decode worker. Each range costs a decoder seek.
+#define FLAC_PARALLEL_MIN_RANGE 262144
+// Reads of at least this many frames are decoded in parallel.
+#define FLAC_PARALLEL_MIN_READ (FLAC_PARALLEL_MIN_RANGE * 2)
+
+// FLAC encoder settings passed to open_audio_file_write() as codec_specific. Defaults are used when none is given.
+typedef struct
+{
+	uint32_t compression_level;		// 0 (fastest, for real-time logging) to 8 (smallest). Default is 5.
+	uint32_t block_size;			// PCM frames per FLAC frame, 0 for the default of 4096
+	uint32_t max_threads;			// Threads encoding frames, 0 for one per core
+} flac_specific;
+
+// FLAC encoder used by the audio file API. Written samples are collected into a batch of blocks, which are encoded concurrently
+// once the batch is full and then written in order. STREAMINFO is rewritten with the length, frame sizes and MD5 on close.
+typedef struct
+{
+	FILE* file;
+	flac_encoder_config config;
+	uint32_t worker_count;
+	flac_frame_workspace** workspaces;
+	int32_t* samples;
+	uint32_t batch_blocks;
+	uint64_t buffered_frames;
+	uint8_t* frames;
+	size_t* frame_sizes;
+	size_t max_frame_size;
+	uint32_t frame_number;
+	uint64_t total_frames;
+	uint32_t min_written_size;
+	uint32_t max_written_size;
+	flac_md5 md5;
+	ga_result result;
+} flac_encoder;
+
+// State shared between the workers encoding a batch of FLAC frames.
+typedef struct
+{
+	flac_encoder* encoder;
+	uint64_t num_frames;
+	uint32_t num_blocks;
+	volatile ma_uint32 next_block;
+	volatile ma_uint32 next_worker;
+	volatile ma_uint32 failed;
+} flac_encode_job;
+
+// FLAC decoder used by the audio file API. The io is kept so parallel decodes can open more decoders on the same file.
+typedef struct
+{
+	drflac* flac;
+	ga_io* io;
+} flac_decoder;
+
+// State shared between the workers of a parallel FLAC decode.
+typedef struct
+{
+	ga_io* io;
+	uint64_t start_frame;
+	uint64_t num_frames;
+	uint64_t range_frames;
+	uint32_t num_ranges;
+	uint32_t channels;
+	ga_data_type audio_type;
+	size_t sample_size;
+	uint8_t* output_buffer;
+	volatile ma_uint32 next_range;
+	volatile ma_uint32 failed;
+} flac_parallel_job;
+
 inline ga_result convert_flac_result(int32_t result);
-ga_result get_flac_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
+ga_result get_flac_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
 int16_t* load_flac(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result);
 void free_flac(int16_t* buffer);
-ga_result open_flac_file(const char* file_name, void** decoder);
+ga_result open_flac_file(ga_io* io, void** decoder);
 ga_result get_basic_flac_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset);
+ga_result get_flac_file_length(void* decoder, uint64_t* num_frames);
 ga_result seek_flac_file(void* decoder, uint64_t offset, uint64_t* new_offset);
-ga_result read_flac_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+ga_result read_flac_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch);
 ga_result close_flac_file(void* decoder);
-ga_result get_flac_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Open a FLAC file for writing. bits_per_sample may be 8, 16 or 24, with samples laid out as for PCM WAV files: 8-bit unsigned, 16-bit signed
+// and packed 24-bit signed little endian. codec_specific is an optional flac_specific.
+ga_result open_flac_file_write(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, void* codec_specific, void** encoder);
+ga_result write_flac_file(void* encoder, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
+ga_result close_flac_file_write(void* encoder);
+void free_flac_encoder(flac_encoder* encoder);
+// Encode the buffered samples and append the frames to the file.
+ga_result encode_flac_batch(flac_encoder* encoder);
+ma_thread_result MA_THREADCALL flac_encode_worker(void* user_data);
+ga_result get_flac_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Fill in a metadata block header. last is set on the block before the audio.
+void set_flac_block_header(uint8_t* header, uint8_t type, uint8_t last, uint32_t size);
+// Replace the Vorbis comment block. It's written over the old block and any padding next to it, or into another padding block, before falling back to a rewrite.
+ga_result set_flac_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten);
+// Decode num_frames PCM frames starting at start_frame into output_buffer, splitting the range across worker threads.
+// FLAC frames decode independently, so each worker opens its own decoder and seeks to its range. output_buffer must hold num_frames x channels samples of audio_type.
+ga_result decode_flac_parallel(ga_io* io, uint64_t start_frame, uint64_t num_frames, uint32_t channels, ga_data_type audio_type, void* output_buffer);
+ma_thread_result MA_THREADCALL flac_parallel_worker(void* user_data);
+// Number of worker threads to use for parallel decoding. Limited on batch load workers to their share of the cores.
+uint32_t get_worker_count();
 
 
 ////////////////////////
 // MP3 codec wrappers //
 ////////////////////////
 
+// Number of MP3 seek indexes kept in memory. The least recently used index is evicted first.
+#define MP3_INDEX_CACHE_ENTRIES 16
+// Sidecar seek index files are named after the MP3, with this appended.
+#define MP3_INDEX_SIDECAR_EXTENSION ".gaidx"
+#define MP3_INDEX_SIDECAR_MAGIC "GAMI"
+#define MP3_INDEX_SIDECAR_VERSION 2
+#define MP3_INDEX_SIDECAR_HEADER_SIZE 64
+
+// MP3 decoder used by the audio file API. The file size, modification time and ID identify the file's seek index in the cache.
+typedef struct
+{
+	mp3dec_ex_t mp3;
+	ga_io* io;
+	uint64_t file_size;
+	int64_t modified_time;
+	uint64_t file_id;
+	uint8_t index_cached;
+	mp3_f32_decoder* mp3_f32;	// Opened by the first float or double read
+	uint8_t f32_current;		// The float decoder made the last read, so it holds the read position
+} mp3_decoder;
+
+// A cached MP3 seek index. Frames are stored as variable length deltas of their byte offset and sample position.
+typedef struct
+{
+	char* file_name;
+	uint64_t file_size;
+	int64_t modified_time;
+	uint64_t file_id;
+	uint64_t start_offset;
+	uint64_t samples;
+	uint64_t num_frames;
+	uint8_t* data;
+	size_t data_size;
+	uint64_t last_used;
+} mp3_index_entry;
+
+// Source of an ID3 tag, either the mapped file or the file itself when it isn't mapped. Reads past the end of the data behave as they do for files.
+typedef struct
+{
+	FILE* file;
+	const uint8_t* data;
+	size_t size;
+	size_t position;
+} id3_reader;
+
 inline ga_result convert_mp3_result(int32_t result);
-ga_result get_mp3_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
+ga_result get_mp3_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
+// Get MP3 information from the first frame and its Xing / Info / LAME or VBRI header, without scanning the file.
+// Fails when the length can't be determined from the headers or estimated, and the file must be scanned instead.
+ga_result get_mp3_header_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample, uint8_t* is_exact);
+ga_result parse_mp3_header_info(const uint8_t* data, size_t size, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint8_t* is_exact);
 int16_t* load_mp3(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result);
 void free_mp3(int16_t* buffer);
-ga_result open_mp3_file(const char* file_name, void** decoder);
+ga_result open_mp3_file(ga_io* io, void** decoder);
 ga_result get_basic_mp3_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset);
+ga_result get_mp3_file_length(void* decoder, uint64_t* num_frames);
 ga_result seek_mp3_file(void* decoder, uint64_t offset, uint64_t* new_offset);
-ga_result read_mp3_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+ga_result read_mp3_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch);
 ga_result close_mp3_file(void* decoder);
-ga_result get_id3_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Find a seek index for the file in the cache, or its sidecar file. The returned frames must be freed by the caller.
+ga_result find_mp3_index(const char* file_name, uint64_t file_size, int64_t modified_time, uint64_t file_id, uint64_t* start_offset, uint64_t* samples, mp3dec_frame_t** frames, size_t* num_frames);
+// Add the decoder's seek index to the cache once it has been built.
+void cache_mp3_index(mp3_decoder* decoder);
+// Copy an index into the cache, replacing any index for the same file. The cache mutex must be held.
+ga_result insert_mp3_index(const mp3_index_entry* index);
+void free_mp3_index_entry(mp3_index_entry* entry);
+// Open the minimp3 decoder on the mapped file, or by name if the file isn't mapped.
+ga_result open_mp3_decoder(ga_io* io, mp3dec_ex_t* mp3, int flags);
+// Open the float decoder on the mapped file, or by name if the file isn't mapped.
+ga_result open_mp3_f32_decoder(ga_io* io, mp3_f32_decoder** mp3_f32, int flags);
+// Make the 16-bit or float decoder ready to read, moving it to the read position if the other decoder made the last read.
+ga_result select_mp3_s16_decoder(mp3_decoder* decoder);
+ga_result select_mp3_f32_decoder(mp3_decoder* decoder);
+// Read position in samples, from whichever decoder made the last read.
+uint64_t get_mp3_read_position(const mp3_decoder* decoder);
+uint8_t* encode_mp3_index(const mp3dec_frame_t* frames, size_t num_frames, size_t* data_size);
+mp3dec_frame_t* decode_mp3_index(const uint8_t* data, size_t data_size, uint64_t num_frames);
+ga_result read_mp3_index_sidecar(const char* file_name, uint64_t file_size, int64_t modified_time, uint64_t file_id, mp3_index_entry* index);
+ga_result write_mp3_index_sidecar(const mp3_index_entry* index);
+char* get_mp3_index_sidecar_name(const char* file_name);
+size_t write_varint(uint8_t* data, uint64_t value);
+ga_result read_varint(const uint8_t* data, size_t data_size, size_t* position, uint64_t* value);
+void write_u64_le(uint8_t* data, uint64_t value);
+uint64_t read_u64_le(const uint8_t* data);
+void write_u32_le(uint8_t* data, uint32_t value);
+uint32_t read_u32_le(const uint8_t* data);
+// Load the ID3v2 tag of a file, or the ID3v1 tag if there isn't one. Only the ID3v2 frames needed for the requested fields are read.
+id3tag_t* load_id3_tag(ga_io* io, ID3TAG_U32 fields);
+// Read the ID3v2 frames wanted for the fields a frame at a time, seeking past the rest. Returns a tag holding just those frames, to pass to id3tag_load().
+void* read_id3_frames(id3_reader* reader, const ID3TAG_U8* header, size_t tag_size, ID3TAG_U32 fields, size_t* compact_size);
+// Read from the tag source as fread() does, returning the number of bytes read.
+size_t read_id3_data(id3_reader* reader, void* output, size_t size);
+// Skip forward in the tag source as fseek() does. Returns 0 on success.
+int skip_id3_data(id3_reader* reader, size_t size);
+uint8_t is_id3_frame_wanted(const char* frame_id, ID3TAG_U32 fields);
+ga_result get_id3_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Replace the text frames of the ID3v2 tag, keeping other frames. The tag is rewritten in place if it has the room, otherwise the file is rewritten.
+// An ID3v1 tag at the end of the file is updated to match. APEv2 tags aren't read, and are left as they are.
+ga_result set_id3_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten);
+// Overwrite the file's ID3v1 tag with the fields it can hold, truncated to fit and converted to Latin-1. Files without one are left alone.
+ga_result update_id3v1_tag(const char* file_name, const char** fields, const char** values, int32_t tag_count);
+// Append the ID3v2 frames for the tags. Fields without a frame of their own are written as TXXX frames.
+ga_result build_id3_text_frames(const char** fields, const char** values, int32_t tag_count, int version, tag_buffer* frames);
+// Append a frame of the given ID, with a text encoding byte followed by the strings. Strings are written as Latin-1 if they're ASCII, otherwise as UTF-16 with a BOM.
+// Each string but the last is terminated. A COMM frame also gets a language and an empty description.
+ga_result append_id3_text_frame(tag_buffer* frames, const char* frame_id, const char** strings, int32_t string_count, int version);
+// Convert UTF-8 to UTF-16 LE, returning the number of bytes written. Pass NULL for output to get the size. Invalid sequences become U+FFFD.
+size_t utf8_to_utf16_le(const char* input, uint8_t* output);
+// Convert UTF-8 to Latin-1, writing at most output_size bytes. Characters outside Latin-1 become '?'.
+void utf8_to_latin1(const char* input, uint8_t* output, size_t output_size);
+// Decode the UTF-8 sequence at c, setting length to the bytes it used. Invalid sequences are one byte long, and decode to U+FFFD.
+uint32_t read_utf8_code_point(const uint8_t* c, int* length);
 
 ///////////////////////////
 // Vorbis codec wrappers //
 ///////////////////////////
 
+// Number of Vorbis page indexes kept in memory for recently seeked files.
+#define VORBIS_INDEX_CACHE_ENTRIES 16
+
+// An Ogg page that completes a packet, with the offset it starts at and the last sample decoded from it (its granule position).
+typedef struct
+{
+	uint32_t page_start;
+	uint32_t last_sample;
+} vorbis_page;
+
+// Vorbis decoder used by the audio file API. The page index is built (or taken from the cache) the first time the refnum seeks.
+typedef struct
+{
+	stb_vorbis* vorbis;
+	ga_io* io;
+	vorbis_page* pages;
+	uint32_t num_pages;
+	uint8_t index_built;
+} vorbis_decoder;
+
+// A cached Vorbis page index. The file size, modification time and ID identify the version of the file it was built from.
+typedef struct
+{
+	char* file_name;
+	uint64_t file_size;
+	int64_t modified_time;
+	uint64_t file_id;
+	vorbis_page* pages;
+	uint32_t num_pages;
+	uint64_t last_used;
+} vorbis_index_entry;
+
+// Stream format and user comments from the identification and comment headers, read without setting up a decoder.
+// The comment strings point into comment_data, the reassembled comment header packet.
+typedef struct
+{
+	uint32_t channels;
+	uint32_t sample_rate;
+	size_t headers_end;
+	uint8_t* comment_data;
+	char** comment_list;
+	int32_t comment_count;
+} ogg_vorbis_headers;
+
 inline ga_result convert_vorbis_result(int32_t result);
-ga_result get_vorbis_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
+ga_result get_vorbis_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
 int16_t* load_vorbis(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result);
 void free_vorbis(int16_t* buffer);
-ga_result open_vorbis_file(const char* file_name, void** decoder);
+ga_result open_vorbis_file(ga_io* io, void** decoder);
 ga_result get_basic_vorbis_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset);
+ga_result get_vorbis_file_length(void* decoder, uint64_t* num_frames);
 ga_result seek_vorbis_file(void* decoder, uint64_t offset, uint64_t* new_offset);
-ga_result read_vorbis_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+ga_result read_vorbis_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch);
 ga_result close_vorbis_file(void* decoder);
-ga_result get_vorbis_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Build the decoder's page index, from the cache if the file has been indexed before. Streams that can't be fully indexed are left without one.
+void build_vorbis_index(vorbis_decoder* decoder);
+// Copy a page index into the cache, replacing any index for the same file. The cache mutex must be held.
+ga_result insert_vorbis_index(const vorbis_index_entry* index);
+void free_vorbis_index_entry(vorbis_index_entry* entry);
+ga_result get_vorbis_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Convert "FIELD=value" comments to tags, and METADATA_BLOCK_PICTURE comments to pictures unless the tag info's picture_mode is ga_picture_none.
+ga_result get_vorbis_comment_tags(char** comment_list, int32_t comment_count, audio_file_tag_info* tag_info);
+// Parse the headers of a mapped file, copying the comments if read_comments is set. headers_end is the offset of the first audio page, or 0 if it shares a page with the setup header.
+ga_result read_ogg_vorbis_headers(const uint8_t* data, size_t size, uint8_t read_comments, ogg_vorbis_headers* headers);
+void free_ogg_vorbis_headers(ogg_vorbis_headers* headers);
+// Walk the packet starting at segment of the page at offset, copying it to output if it isn't NULL. offset and segment are left at the next packet.
+ga_result read_ogg_packet(const uint8_t* data, size_t size, size_t* offset, uint32_t* segment, uint8_t* output, size_t* packet_size);
+// Returns the size of the complete Ogg page at offset, or 0 if there isn't one.
+size_t get_ogg_page_size(const uint8_t* data, size_t size, size_t offset);
+// Find the next page at or after offset with a valid CRC, the same way stb_vorbis does, including for a final page cut short. crc32_init() must have been called.
+uint8_t find_ogg_page(const uint8_t* data, size_t size, size_t offset, size_t* page_start, size_t* page_end, uint8_t* last_page);
+// Length in samples from the granule position of the last page, matching stb_vorbis_stream_length_in_samples().
+uint64_t get_ogg_vorbis_length(const uint8_t* data, size_t size, size_t audio_offset);
+// Replace the comment header. When the comment and setup headers can be laid out over the same pages they use now, the comment is padded to fit and
+// only those pages are written. Otherwise the file is rewritten, renumbering the later pages if the header page count changes.
+ga_result set_vorbis_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten);
+// Append one page from the file to the buffer. Returns GA_E_DECODER if there's no page there.
+ga_result read_ogg_page(FILE* pFile, tag_buffer* pages, size_t* page_size);
+// Lay out the comment and setup packets over page_count pages, numbered from sequence, and append them to the buffer.
+// If page_count is 0, it's set to the fewest pages that hold them.
+ga_result write_ogg_header_pages(const uint8_t* comment, size_t comment_size, const uint8_t* setup, size_t setup_size, uint32_t serial, uint32_t sequence, uint32_t* page_count, tag_buffer* pages);
+// Size in bytes of the header pages write_ogg_header_pages() would write.
+uint64_t get_ogg_header_pages_size(size_t comment_size, size_t setup_size, uint32_t page_count);
+// Copy pages to the end of the file, moving the sequence numbers of the stream's pages by sequence_delta.
+ga_result copy_ogg_pages(FILE* input, FILE* output, uint32_t serial, int32_t sequence_delta);
+// Fill in the CRC of a page.
+void set_ogg_page_crc(uint8_t* page, size_t page_size);
 
 
 ////////////////////////
@@ -414,18 +1184,35 @@ typedef struct
 	uint32_t data_format;
 } wav_specific;
 
+// WAV decoder used by the audio file API. When the file is mapped and the data chunk holds plain PCM or IEEE float samples,
+// reads are served straight from the mapping instead of through dr_wav.
+typedef struct
+{
+	drwav wav;
+	const uint8_t* pcm_data;
+	uint64_t pcm_frames;
+	ga_data_type sample_type;
+} wav_decoder;
+
 inline ga_result convert_wav_result(int32_t result);
-ga_result get_wav_info(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
+ga_result get_wav_info(ga_io* io, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, uint32_t* bits_per_sample);
 int16_t* load_wav(const char* file_name, uint64_t* num_frames, uint32_t* channels, uint32_t* sample_rate, ga_result* result);
 void free_wav(int16_t* sample_data);
-ga_result open_wav_file(const char* file_name, void** decoder);
+ga_result open_wav_file(ga_io* io, void** decoder);
 ga_result open_wav_file_write(const char* file_name, uint32_t channels, uint32_t sample_rate, uint32_t bits_per_sample, void* codec_specific, void** encoder);
 ga_result get_basic_wav_file_info(void* decoder, uint32_t* channels, uint32_t* sample_rate, uint64_t* read_offset);
+ga_result get_wav_file_length(void* decoder, uint64_t* num_frames);
 ga_result seek_wav_file(void* decoder, uint64_t offset, uint64_t* new_offset);
-ga_result read_wav_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer);
+ga_result read_wav_file(void* decoder, uint64_t frames_to_read, ga_data_type audio_type, uint64_t* frames_read, void* output_buffer, ga_scratch_buffer* scratch);
 ga_result write_wav_file(void* encoder, uint64_t frames_to_write, void* input_buffer, uint64_t* frames_written);
 ga_result close_wav_file(void* decoder);
-ga_result get_wav_tags(const char* file_name, uint8_t read_pictures, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+ga_result close_wav_file_write(void* encoder);
+// Copy or convert samples from the mapped data chunk. Returns GA_E_INVALID_TYPE when the conversion should be left to dr_wav.
+ga_result read_wav_direct(ga_data_type file_type, const uint8_t* pcm_data, ga_data_type audio_type, void* output_buffer, size_t num_samples);
+ga_result get_wav_tags(ga_io* io, ga_picture_mode picture_mode, uint32_t thumbnail_size, intptr_t* tags, int32_t* tag_count, intptr_t* pictures, int32_t* picture_count);
+// Replace the LIST INFO chunk. It's written over the old chunk and any JUNK chunks after it. If it doesn't fit, the old chunk becomes a JUNK chunk and the new
+// one is appended to the file, so WAV files are never rewritten.
+ga_result set_wav_tags(const char* file_name, const char** fields, const char** values, int32_t tag_count, uint8_t* rewritten);
 
 
 /////////////////////////
@@ -508,392 +1295,302 @@ FILE* ga_fopen(const char* file_name)
 	return pFile;
 }
 
-// Find the index of the first character past the specified token, or -1 if not found.
-int32_t ga_find_token(const char* string, char token)
+// Open a file for writing, replacing any existing file.
+FILE* ga_fopen_write(const char* file_name)
 {
-	const char* ptr = string;
-	int32_t offset = 0;
-
-	if (ptr == NULL)
-	{
-		return -1;
-	}
+	FILE* pFile;
 
-	while (*ptr != '\0')
-	{
-		if (*ptr == token)
-		{
-			return offset + 1;
-		}
-		offset++;
-		ptr++;
-	}
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	#if defined(__STDC_WANT_SECURE_LIB__)
+		if (0 != _wfopen_s(&pFile, wide_file_name, L"wb"))
+			pFile = NULL;
+	#else
+		pFile = _wfopen(wide_file_name, L"wb");
+	#endif
+	free(wide_file_name);
+#else
+	pFile = fopen(file_name, "wb");
+#endif
 
-	return -1;
+	return pFile;
 }
 
-//////////////////////////
-// Conversion functions //
-//////////////////////////
-void u8_to_s16(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+// Open an existing file for reading and writing in place.
+FILE* ga_fopen_update(const char* file_name)
 {
-	int32_t r;
-	size_t i;
+	FILE* pFile;
 
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	#if defined(__STDC_WANT_SECURE_LIB__)
+		if (0 != _wfopen_s(&pFile, wide_file_name, L"r+b"))
+			pFile = NULL;
+	#else
+		pFile = _wfopen(wide_file_name, L"r+b");
+	#endif
+	free(wide_file_name);
+#else
+	pFile = fopen(file_name, "r+b");
+#endif
 
-	for (i = 0; i < num_samples; i++)
-	{
-		int32_t x = buffer_in[i];
-		r = x << 8;
-		r = r - 32768;
-		buffer_out[i] = (int16_t)r;
-	}
+	return pFile;
 }
 
-void u8_to_s32(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+// Seek with 64-bit offsets, so tags past the first 2GB of a file can be reached.
+int ga_fseek(FILE* pFile, int64_t offset, int origin)
 {
-	int64_t r;
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
-
-	for (i = 0; i < num_samples; i++)
-	{
-		int64_t x = buffer_in[i];
-		r = x << 24;
-		r = r - 2147483648;
-		buffer_out[i] = (int32_t)r;
-	}
+#if defined(_WIN32)
+	return _fseeki64(pFile, offset, origin);
+#elif defined(__APPLE__)
+	return fseeko(pFile, (off_t)offset, origin);
+#else
+	return fseeko64(pFile, (off64_t)offset, origin);
+#endif
 }
 
-void u8_to_f32(float* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+int64_t ga_ftell(FILE* pFile)
 {
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
-
-	for (i = 0; i < num_samples; i++)
-	{
-		float x = buffer_in[i];
-		x = x * 0.00784313725490196078f;    /* 0..255 to 0..2 */
-		x = x - 1;                          /* 0..2 to -1..1 */
-		buffer_out[i] = x;
-	}
+#if defined(_WIN32)
+	return _ftelli64(pFile);
+#elif defined(__APPLE__)
+	return (int64_t)ftello(pFile);
+#else
+	return (int64_t)ftello64(pFile);
+#endif
 }
 
-void u8_to_f64(double* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+// Replace file_name with source_name, which is removed.
+ga_result ga_replace_file(const char* source_name, const char* file_name)
 {
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+#if defined(_WIN32)
+	wchar_t* wide_source_name = widen(source_name);
+	wchar_t* wide_file_name = widen(file_name);
+	BOOL ok = MoveFileExW(wide_source_name, wide_file_name, MOVEFILE_REPLACE_EXISTING);
+	free(wide_source_name);
+	free(wide_file_name);
 
-	for (i = 0; i < num_samples; i++)
-	{
-		double x = buffer_in[i];
-		x = x * 0.00784313725490196078;    /* 0..255 to 0..2 */
-		x = x - 1;                          /* 0..2 to -1..1 */
-		buffer_out[i] = x;
-	}
+	return (ok ? GA_SUCCESS : GA_E_FILE);
+#else
+	return (rename(source_name, file_name) == 0 ? GA_SUCCESS : GA_E_FILE);
+#endif
 }
 
-void s16_to_u8(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+ga_result ga_delete_file(const char* file_name)
 {
-	int32_t r;
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	int error = _wremove(wide_file_name);
+	free(wide_file_name);
+#else
+	int error = remove(file_name);
+#endif
 
-	for (i = 0; i < num_samples; i++)
-	{
-		int32_t x = buffer_in[i];
-		r = x + 32768;
-		r = r >> 8;
-		buffer_out[i] = (uint8_t)r;
-	}
+	return (error == 0 ? GA_SUCCESS : GA_E_FILE);
 }
 
-void s16_to_s32(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+// Release a mapping created by ga_map_file(). Safe to call on a partially created mapping.
+void ga_unmap_file(ga_file_map* map)
 {
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
+#if defined(_WIN32)
+	if (map->data != NULL)
 	{
-		return;
+		UnmapViewOfFile(map->data);
 	}
-
-	for (i = 0; i < num_samples; i++)
+	if (map->mapping != NULL)
 	{
-		buffer_out[i] = buffer_in[i] << 16;
+		CloseHandle(map->mapping);
 	}
-}
-
-void s16_to_f32(float* buffer_out, const int16_t* buffer_in, size_t num_samples)
-{
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (map->file != NULL)
 	{
-		return;
+		CloseHandle(map->file);
 	}
-
-	for (i = 0; i < num_samples; i++)
+	map->mapping = NULL;
+	map->file = NULL;
+#else
+	if (map->data != NULL)
 	{
-		buffer_out[i] = buffer_in[i] * 0.000030517578125f;
+		munmap((void*)map->data, map->size);
 	}
+#endif
+	map->data = NULL;
+	map->size = 0;
 }
 
-void s16_to_f64(double* buffer_out, const int16_t* buffer_in, size_t num_samples)
+// Map an entire file into memory for reading. Fails for empty files, or files larger than GA_MAP_FILE_MAX_SIZE.
+// Other processes can still write, rename and delete the file while it's mapped.
+ga_result ga_map_file(const char* file_name, ga_file_map* map)
 {
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+	map->data = NULL;
+	map->size = 0;
 
-	for (i = 0; i < num_samples; ++i)
-	{
-		buffer_out[i] = buffer_in[i] * 0.000030517578125;
-	}
-}
-
-void s32_to_u8(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
-{
-	int64_t r;
-	size_t i;
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	map->mapping = NULL;
+	map->file = CreateFileW(wide_file_name, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	free(wide_file_name);
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (map->file == INVALID_HANDLE_VALUE)
 	{
-		return;
+		map->file = NULL;
+		return GA_E_FILE;
 	}
 
-	for (i = 0; i < num_samples; i++)
+	// The file information is kept for stamping the file, so callers don't need to open it again.
+	if (!GetFileInformationByHandle(map->file, &(map->info)))
 	{
-		int64_t x = buffer_in[i];
-		r = x + 2147483648;
-		r = r >> 24;
-		buffer_out[i] = (uint8_t)r;
+		ga_unmap_file(map);
+		return GA_E_FILE;
 	}
-}
-
-void s32_to_s16(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
-{
-	int32_t r;
-	size_t i;
 
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+	uint64_t file_size = ((uint64_t)map->info.nFileSizeHigh << 32) | map->info.nFileSizeLow;
 
-	for (i = 0; i < num_samples; i++)
+	if (file_size == 0 || file_size > (uint64_t)GA_MAP_FILE_MAX_SIZE)
 	{
-		int32_t x = buffer_in[i];
-		r = x >> 16;
-		buffer_out[i] = (int16_t)r;
+		ga_unmap_file(map);
+		return GA_E_FILE;
 	}
-}
-
-void s32_to_f32(float* buffer_out, const int32_t* buffer_in, size_t num_samples)
-{
-	size_t i;
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	map->mapping = CreateFileMappingW(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (map->mapping != NULL)
 	{
-		return;
+		map->data = (const uint8_t*)MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
 	}
 
-	for (i = 0; i < num_samples; i++)
+	if (map->data == NULL)
 	{
-		buffer_out[i] = buffer_in[i] / 2147483648.0f;
+		ga_unmap_file(map);
+		return GA_E_FILE;
 	}
-}
 
-void s32_to_f64(double* buffer_out, const int32_t* buffer_in, size_t num_samples)
-{
-	size_t i;
+	map->size = (size_t)file_size;
+#else
+	int file = open(file_name, O_RDONLY);
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (file < 0)
 	{
-		return;
+		return GA_E_FILE;
 	}
 
-	for (i = 0; i < num_samples; i++)
+	// The file information is kept for stamping the file, so callers don't need to stat it again.
+	if (fstat(file, &(map->info)) != 0 || map->info.st_size <= 0 || (uint64_t)map->info.st_size > (uint64_t)GA_MAP_FILE_MAX_SIZE)
 	{
-		buffer_out[i] = buffer_in[i] / 2147483648.0;
+		close(file);
+		return GA_E_FILE;
 	}
-}
 
-void f32_to_u8(uint8_t* buffer_out, const float* buffer_in, size_t num_samples)
-{
-	size_t i;
+	void* data = mmap(NULL, (size_t)map->info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	// The mapping holds its own reference to the file.
+	close(file);
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (data == MAP_FAILED)
 	{
-		return;
+		return GA_E_FILE;
 	}
 
-	for (i = 0; i < num_samples; i++)
-	{
-		float x = buffer_in[i];
-		float c;
-		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
-		c = c + 1;
-		buffer_out[i] = (uint8_t)(c * 127.5f);
-	}
-}
-
-void f32_to_s16(int16_t* buffer_out, const float* buffer_in, size_t num_samples)
-{
-	int32_t r;
-	size_t i;
-
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+	map->data = (const uint8_t*)data;
+	map->size = (size_t)map->info.st_size;
+#endif
 
-	for (i = 0; i < num_samples; i++)
-	{
-		float x = buffer_in[i];
-		float c;
-		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
-		c = c + 1;
-		r = (int32_t)(c * 32767.5f);
-		r = r - 32768;
-		buffer_out[i] = (int16_t)r;
-	}
+	return GA_SUCCESS;
 }
 
-void f32_to_s32(int32_t* buffer_out, const float* buffer_in, size_t num_samples)
+// Get the size, last modification time and identity of a file from its information. Used to detect when cached data for a file is stale.
+// Modification times are in 100ns units on Windows and nanoseconds elsewhere, and the ID is the volume and file index or device and inode.
+// Fails for files modified in the last couple of seconds, which may still be changing within the timestamp resolution of the file system.
+ga_result ga_get_file_info_stamp(const ga_file_info* file_info, uint64_t* file_size, int64_t* modified_time, uint64_t* file_id)
 {
-	int64_t r;
-	size_t i;
+#if defined(_WIN32)
+	FILETIME now;
 
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+	GetSystemTimeAsFileTime(&now);
 
-	for (i = 0; i < num_samples; i++)
-	{
-		float x = buffer_in[i];
-		float c;
-		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
-		c = c + 1;
-		r = (int64_t)(c * 2147483647.5f);
-		r = r - 2147483648;
-		buffer_out[i] = (int32_t)r;
-	}
-}
+	*file_size = ((uint64_t)file_info->nFileSizeHigh << 32) | file_info->nFileSizeLow;
+	*modified_time = (int64_t)(((uint64_t)file_info->ftLastWriteTime.dwHighDateTime << 32) | file_info->ftLastWriteTime.dwLowDateTime);
+	*file_id = (((uint64_t)file_info->nFileIndexHigh << 32) | file_info->nFileIndexLow) ^ ((uint64_t)file_info->dwVolumeSerialNumber << 32);
 
-void f32_to_f64(double* buffer_out, const float* buffer_in, size_t num_samples)
-{
-	size_t i;
+	int64_t age = (int64_t)(((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime) - *modified_time;
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (age > -20000000 && age < 20000000)
 	{
-		return;
+		return GA_E_FILE;
 	}
+#else
+#if defined(__APPLE__)
+	int64_t nanoseconds = file_info->st_mtimespec.tv_nsec;
+#else
+	int64_t nanoseconds = file_info->st_mtim.tv_nsec;
+#endif
 
-	for (i = 0; i < num_samples; i++)
-	{
-		buffer_out[i] = (double)buffer_in[i];
-	}
-}
+	*file_size = (uint64_t)file_info->st_size;
+	*modified_time = (int64_t)file_info->st_mtime * 1000000000 + nanoseconds;
+	*file_id = (uint64_t)file_info->st_ino ^ ((uint64_t)file_info->st_dev << 32);
 
-void f64_to_u8(uint8_t* buffer_out, const double* buffer_in, size_t num_samples)
-{
-	size_t i;
+	int64_t age = (int64_t)time(NULL) - (int64_t)file_info->st_mtime;
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (age > -2 && age < 2)
 	{
-		return;
+		return GA_E_FILE;
 	}
+#endif
 
-	for (i = 0; i < num_samples; i++)
-	{
-		double x = buffer_in[i];
-		double c;
-		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
-		c = c + 1;
-		buffer_out[i] = (uint8_t)(c * 127.5);
-	}
+	return GA_SUCCESS;
 }
 
-void f64_to_s16(int16_t* buffer_out, const double* buffer_in, size_t num_samples)
+// Get the stamp of a file by name. See ga_get_file_info_stamp().
+ga_result ga_get_file_stamp(const char* file_name, uint64_t* file_size, int64_t* modified_time, uint64_t* file_id)
 {
-	int32_t r;
-	size_t i;
+	ga_file_info file_info;
 
-	if (buffer_out == NULL || buffer_in == NULL)
-	{
-		return;
-	}
+#if defined(_WIN32)
+	wchar_t* wide_file_name = widen(file_name);
+	HANDLE file = CreateFileW(wide_file_name, 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+	free(wide_file_name);
 
-	for (i = 0; i < num_samples; i++)
+	if (file == INVALID_HANDLE_VALUE)
 	{
-		double x = buffer_in[i];
-		double c;
-		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
-		c = c + 1;
-		r = (int32_t)(c * 32767.5);
-		r = r - 32768;
-		buffer_out[i] = (int16_t)r;
+		return GA_E_FILE;
 	}
-}
 
-void f64_to_s32(int32_t* buffer_out, const double* buffer_in, size_t num_samples)
-{
-	int64_t r;
-	size_t i;
+	BOOL ok = GetFileInformationByHandle(file, &file_info);
+	CloseHandle(file);
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (!ok)
 	{
-		return;
+		return GA_E_FILE;
 	}
-
-	for (i = 0; i < num_samples; i++)
+#else
+	if (stat(file_name, &file_info) != 0)
 	{
-		double x = buffer_in[i];
-		double c;
-		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
-		c = c + 1;
-		r = (int64_t)(c * 2147483647.5);
-		r = r - 2147483648;
-		buffer_out[i] = (int32_t)r;
+		return GA_E_FILE;
 	}
+#endif
+
+	return ga_get_file_info_stamp(&file_info, file_size, modified_time, file_id);
 }
 
-void f64_to_f32(float* buffer_out, const double* buffer_in, size_t num_samples)
+// Find the index of the first character past the specified token, or -1 if not found.
+int32_t ga_find_token(const char* string, char token)
 {
-	size_t i;
+	const char* ptr = string;
+	int32_t offset = 0;
 
-	if (buffer_out == NULL || buffer_in == NULL)
+	if (ptr == NULL)
 	{
-		return;
+		return -1;
 	}
 
-	for (i = 0; i < num_samples; i++)
+	while (*ptr != '\0')
 	{
-		buffer_out[i] = (float)buffer_in[i];
+		if (*ptr == token)
+		{
+			return offset + 1;
+		}
+		offset++;
+		ptr++;
 	}
+
+	return -1;
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -1315,9 +2012,198 @@ int stb_vorbis_decode_filename_w(const wchar_t *filename, int *channels, int *sa
 #endif // _WIN32
 #endif // STB_VORBIS_NO_STDIO
 
-ga_result parse_metadata_block_picture(const uint8_t* block, int32_t block_size, audio_file_picture* picture)
+// Indexed version of stb_vorbis_seek. Rather than bisecting the file with page scans, the page to start decoding from is looked up
+// in an index from stb_vorbis_build_page_index(). The decoder is left in the same state as stb_vorbis_seek would leave it.
+static int seek_to_sample_indexed(stb_vorbis *f, const vorbis_page *pages, uint32_t num_pages, uint32 sample_number)
+{
+	int i, start_seg_with_known_loc, end_pos;
+	uint32 stream_length, padding, last_sample_limit, page_start, lo, hi;
+
+	stream_length = stb_vorbis_stream_length_in_samples(f);
+	if (stream_length == 0)            return error(f, VORBIS_seek_without_length);
+	if (sample_number > stream_length) return error(f, VORBIS_seek_invalid);
+
+	padding = ((f->blocksize_1 - f->blocksize_0) >> 2);
+	if (sample_number < padding)
+		last_sample_limit = 0;
+	else
+		last_sample_limit = sample_number - padding;
+
+	if (num_pages < 2 || last_sample_limit <= pages[0].last_sample) {
+		if (stb_vorbis_seek_start(f)) {
+			if (f->current_loc > sample_number)
+				return error(f, VORBIS_seek_failed);
+			return 1;
+		}
+		return 0;
+	}
+
+	// find the last page ending at or before the limit. As with the bisection, the final page is never the starting point.
+	lo = 0;
+	hi = num_pages - 2;
+	while (lo < hi) {
+		uint32 mid = lo + ((hi - lo + 1) >> 1);
+		if (pages[mid].last_sample <= last_sample_limit)
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	// from here on this matches seek_to_sample_coarse, seeking back to the start of the last packet
+	page_start = pages[lo].page_start;
+	set_file_offset(f, page_start);
+	if (!start_page(f)) return error(f, VORBIS_seek_failed);
+	end_pos = f->end_seg_with_known_loc;
+	if (end_pos < 0) return error(f, VORBIS_seek_failed);
+
+	for (;;) {
+		for (i = end_pos; i > 0; --i)
+			if (f->segments[i-1] != 255)
+				break;
+
+		start_seg_with_known_loc = i;
+
+		if (start_seg_with_known_loc > 0 || !(f->page_flag & PAGEFLAG_continued_packet))
+			break;
+
+		// the final packet begins on an earlier page
+		if (!go_to_page_before(f, page_start))
+			goto error;
+
+		page_start = stb_vorbis_get_file_offset(f);
+		if (!start_page(f)) goto error;
+		end_pos = f->segment_count - 1;
+	}
+
+	f->current_loc_valid = FALSE;
+	f->last_seg = FALSE;
+	f->valid_bits = 0;
+	f->packet_bytes = 0;
+	f->bytes_in_seg = 0;
+	f->previous_length = 0;
+	f->next_seg = start_seg_with_known_loc;
+
+	for (i = 0; i < start_seg_with_known_loc; i++)
+		skip(f, f->segments[i]);
+
+	if (!vorbis_pump_first_frame(f))
+		return 0;
+	if (f->current_loc > sample_number)
+		return error(f, VORBIS_seek_failed);
+	return 1;
+
+error:
+	stb_vorbis_seek_start(f);
+	return error(f, VORBIS_seek_failed);
+}
+
+// As stb_vorbis_seek_frame and stb_vorbis_seek, using seek_to_sample_indexed for the page-level search.
+int stb_vorbis_seek_indexed(stb_vorbis *f, const vorbis_page *pages, uint32_t num_pages, unsigned int sample_number)
+{
+	uint32 max_frame_samples;
+
+	if (IS_PUSH_MODE(f)) return error(f, VORBIS_invalid_api_mixing);
+
+	if (!seek_to_sample_indexed(f, pages, num_pages, sample_number))
+		return 0;
+
+	max_frame_samples = (f->blocksize_1*3 - f->blocksize_0) >> 2;
+	while (f->current_loc < sample_number) {
+		int left_start, left_end, right_start, right_end, mode, frame_samples;
+		if (!peek_decode_initial(f, &left_start, &left_end, &right_start, &right_end, &mode))
+			return error(f, VORBIS_seek_failed);
+		frame_samples = right_start - left_start;
+		if (f->current_loc + frame_samples > sample_number) {
+			break;
+		} else if (f->current_loc + frame_samples + max_frame_samples > sample_number) {
+			vorbis_pump_first_frame(f);
+		} else {
+			f->current_loc += frame_samples;
+			f->previous_length = 0;
+			maybe_start_packet(f);
+			flush_packet(f);
+		}
+	}
+
+	if (sample_number != f->current_loc) {
+		int n;
+		uint32 frame_start = f->current_loc;
+		if (sample_number < frame_start) return error(f, VORBIS_seek_failed);
+		stb_vorbis_get_frame_float(f, &n, NULL);
+		if (f->channel_buffer_start + (int) (sample_number-frame_start) > f->channel_buffer_end) return error(f, VORBIS_seek_failed);
+		f->channel_buffer_start += (sample_number - frame_start);
+	}
+
+	return 1;
+}
+
+// Read the header of every page from the first audio page to the end of the stream, recording those with a known last sample.
+// The index is only returned if the scan reaches the final page, so every seek target is covered.
+int stb_vorbis_build_page_index(stb_vorbis *f, vorbis_page **pages, uint32_t *num_pages)
 {
-	if (picture == NULL || block == NULL)
+	uint8 header[27], lacing[255];
+	uint32 offset, restore_offset, capacity = 0, count = 0;
+	vorbis_page *index = NULL;
+
+	*pages = NULL;
+	*num_pages = 0;
+
+	if (IS_PUSH_MODE(f)) return error(f, VORBIS_invalid_api_mixing);
+	if (stb_vorbis_stream_length_in_samples(f) == 0) return 0;
+
+	// store the current decode position so it can be restored, as stb_vorbis_stream_length_in_samples does
+	restore_offset = stb_vorbis_get_file_offset(f);
+	offset = f->first_audio_page_offset;
+
+	while (set_file_offset(f, offset) && getn(f, header, 27)) {
+		uint32 i, len = 0, last_sample;
+
+		if (memcmp(header, ogg_page_header, 4) != 0 || !getn(f, lacing, header[26]))
+			break;
+
+		for (i = 0; i < header[26]; ++i)
+			len += lacing[i];
+
+		last_sample = header[6] + (header[7] << 8) + (header[8] << 16) + ((uint32)header[9] << 24);
+
+		if (last_sample != ~0U) {
+			if (count == capacity) {
+				vorbis_page *grown;
+				capacity = (capacity == 0 ? 1024 : capacity * 2);
+				grown = (vorbis_page *)realloc(index, capacity * sizeof(vorbis_page));
+				if (grown == NULL) {
+					free(index);
+					set_file_offset(f, restore_offset);
+					return error(f, VORBIS_outofmem);
+				}
+				index = grown;
+			}
+			index[count].page_start = offset;
+			index[count].last_sample = last_sample;
+			++count;
+		}
+
+		if (offset == f->p_last.page_start)
+			break;
+
+		offset += 27 + header[26] + len;
+	}
+
+	set_file_offset(f, restore_offset);
+
+	if (count == 0 || index[count - 1].page_start != f->p_last.page_start) {
+		free(index);
+		return 0;
+	}
+
+	*pages = index;
+	*num_pages = count;
+	return 1;
+}
+
+ga_result parse_metadata_block_picture(const uint8_t* block, int32_t block_size, audio_file_tag_info* tag_info)
+{
+	if (tag_info == NULL || block == NULL)
 	{
 		return GA_E_GENERIC;
 	}
@@ -1333,15 +2219,15 @@ ga_result parse_metadata_block_picture(const uint8_t* block, int32_t block_size,
 	pRunningData = (const char*)block;
 	pRunningDataEnd = (const char*)block + block_size;
 
-	int32_t type = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
-	int32_t mimeLength = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
+	uint32_t type = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
+	uint32_t mimeLength = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
 
 	/* Need space for the rest of the block */
 	if ((pRunningDataEnd - pRunningData) - 24 < (drflac_int64)mimeLength) { /* <-- Note the order of operations to avoid overflow to a valid value */
 		return GA_E_TAG;
 	}
 	const char* mime = pRunningData; pRunningData += mimeLength;
-	int32_t descriptionLength = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
+	uint32_t descriptionLength = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
 
 	/* Need space for the rest of the block */
 	if ((pRunningDataEnd - pRunningData) - 20 < (drflac_int64)descriptionLength) { /* <-- Note the order of operations to avoid overflow to a valid value */
@@ -1353,27 +2239,14 @@ ga_result parse_metadata_block_picture(const uint8_t* block, int32_t block_size,
 	metadata.data.picture.colorDepth = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
 	metadata.data.picture.indexColorCount = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;*/
 	pRunningData += 16;
-	int32_t pictureDataSize = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
+	uint32_t pictureDataSize = drflac__be2host_32_ptr_unaligned(pRunningData); pRunningData += 4;
 
 	/* Need space for the picture after the block */
 	if (pRunningDataEnd - pRunningData < (drflac_int64)pictureDataSize) { /* <-- Note the order of operations to avoid overflow to a valid value */
 		return GA_E_TAG;
 	}
 
-	int32_t x, y, n;
-	picture->data = stbi_load_from_memory((uint8_t*)pRunningData, pictureDataSize, &x, &y, &n, 4);
-	if (picture->data == NULL)
-	{
-		return GA_E_MEMORY;
-	}
-
-	picture->data_size = sizeof(uint8_t) * x * y * 4;
-	picture->type = type;
-	picture->width = x;
-	picture->height = y;
-	picture->depth = n * 8;
-
-	return GA_SUCCESS;
+	return add_audio_file_picture(tag_info, (const uint8_t*)pRunningData, pictureDataSize, type);
 }
 
 // Get the ma_backend enum given a string. Performs reverse of ma_get_backend_name().
@@ -471,12 +471,16 @@ size_t id3tag_size( void const* first_ten_bytes )
 char* id3tag_internal_get_string( int encoding, ID3TAG_U8* ptr, int size, void* memctx, int* bytes_consumed )
     {
     (void) memctx;
+    // Frames too short for their fields leave nothing for the string. The bytes consumed never run past the frame.
+    if( size < 0 ) size = 0;
+    int available = size;
     if( encoding == 0) // Latin1
         {
         char* str = (char*)ID3TAG_MALLOC( memctx, (size_t)( size + 1 ) );
         memcpy( str, ptr, (size_t) size );
         str[ size ] = '\0';
         if( bytes_consumed ) *bytes_consumed = (int) strlen( str ) + 1;
+        if( bytes_consumed && *bytes_consumed > available ) *bytes_consumed = available;
         return str;
         }
     else if( encoding == 1 ) // UTF16 with BOM
@@ -495,6 +499,7 @@ char* id3tag_internal_get_string( int encoding, ID3TAG_U8* ptr, int size, void*
             ID3TAG_U16* s = (ID3TAG_U16*) ptr;
             while( *s++ ) *bytes_consumed = ( *bytes_consumed ) + 2;
             *bytes_consumed = ( *bytes_consumed ) + 2;
+            if( *bytes_consumed > available ) *bytes_consumed = available;
             }
 
         //utf8_to_latin1( str );
@@ -514,6 +519,7 @@ char* id3tag_internal_get_string( int encoding, ID3TAG_U8* ptr, int size, void*
             ID3TAG_U16* s = (ID3TAG_U16*) ptr;
             while( *s++ ) *bytes_consumed = ( *bytes_consumed ) + 2;
             *bytes_consumed = ( *bytes_consumed ) + 2;
+            if( *bytes_consumed > available ) *bytes_consumed = available;
         }
 
         //utf8_to_latin1( str );
@@ -525,6 +531,7 @@ char* id3tag_internal_get_string( int encoding, ID3TAG_U8* ptr, int size, void*
         memcpy( str, ptr, (size_t) size );
         str[ size ] = '\0';
         if( bytes_consumed ) *bytes_consumed = (int) strlen( str ) + 1;
+        if( bytes_consumed && *bytes_consumed > available ) *bytes_consumed = available;
 
         utf8_to_latin1( str );
         return str;
@@ -723,7 +730,7 @@ id3tag_t* id3tag_load( void const* data, size_t size, ID3TAG_U32 fields, void* m
             fields_found[ FIELD_GENRE ] = true;
             }
 
-        if( ( fields & ID3TAG_FIELD_YEAR ) && ( strcmp( frame_id , "TYER" ) == 0 || strcmp( frame_id , "TYE" ) == 0 ) )
+        if( ( fields & ID3TAG_FIELD_YEAR ) && ( strcmp( frame_id , "TYER" ) == 0 || strcmp( frame_id , "TYE" ) == 0 || strcmp( frame_id , "TDRC" ) == 0 ) )
             {
             if( !tag->tag.year ) tag->tag.year = id3tag_internal_get_string( *ptr, ptr + 1, frame_size - 1, memctx, NULL );
             fields_found[ FIELD_YEAR ] = true;
@@ -921,7 +928,7 @@ id3tag_t* id3tag_load( void const* data, size_t size, ID3TAG_U32 fields, void* m
             ptr += bytes;
             frame_size -= bytes;
 
-            if( frame_size )
+            if( frame_size > 0 )
                 {
                 pic->data = ID3TAG_MALLOC( memctx, (size_t) frame_size );
                 memcpy( (void*) pic->data, ptr, (size_t) frame_size );
@@ -0,0 +1,2 @@
+#!/bin/bash
+g++ -o g_audio_bench bench/g_audio_bench.cpp *.cpp -lm -lpthread -ldl -O3
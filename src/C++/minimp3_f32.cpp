@@ -0,0 +1,160 @@
+/*
+G-Audio - An audio library for LabVIEW.
+
+See g_audio.h for license details.
+
+Float output build of minimp3, used for float and double MP3 reads.
+
+minimp3's sample type is fixed when it's compiled. g_audio.h builds it with the native 16-bit output, which load_mp3 and the
+integer reads use. This translation unit builds it again with MINIMP3_FLOAT_OUTPUT, with the public functions and the types holding
+samples renamed with an mp3dec_f32_ prefix so both builds link into the library. Only an opaque decoder is exposed.
+*/
+
+#include "stdafx.h"
+
+#define MINIMP3_IMPLEMENTATION
+#define MINIMP3_FLOAT_OUTPUT
+
+#define mp3dec_init				mp3dec_f32_init
+#define mp3dec_f32_to_s16		mp3dec_f32_f32_to_s16
+#define mp3dec_decode_frame		mp3dec_f32_decode_frame
+#define mp3dec_detect_buf		mp3dec_f32_detect_buf
+#define mp3dec_detect_cb		mp3dec_f32_detect_cb
+#define mp3dec_load_buf			mp3dec_f32_load_buf
+#define mp3dec_load_cb			mp3dec_f32_load_cb
+#define mp3dec_iterate_buf		mp3dec_f32_iterate_buf
+#define mp3dec_iterate_cb		mp3dec_f32_iterate_cb
+#define mp3dec_ex_open_buf		mp3dec_f32_ex_open_buf
+#define mp3dec_ex_open_cb		mp3dec_f32_ex_open_cb
+#define mp3dec_ex_close			mp3dec_f32_ex_close
+#define mp3dec_ex_seek			mp3dec_f32_ex_seek
+#define mp3dec_ex_read_frame	mp3dec_f32_ex_read_frame
+#define mp3dec_ex_read			mp3dec_f32_ex_read
+#define mp3dec_detect			mp3dec_f32_detect
+#define mp3dec_load				mp3dec_f32_load
+#define mp3dec_iterate			mp3dec_f32_iterate
+#define mp3dec_ex_open			mp3dec_f32_ex_open
+#define mp3dec_detect_w			mp3dec_f32_detect_w
+#define mp3dec_load_w			mp3dec_f32_load_w
+#define mp3dec_iterate_w		mp3dec_f32_iterate_w
+#define mp3dec_ex_open_w		mp3dec_f32_ex_open_w
+#define mp3dec_file_info_t		mp3dec_f32_file_info_t
+#define mp3dec_ex_t				mp3dec_f32_ex_t
+
+#include "minimp3_ex.h"
+#include "minimp3_f32.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+struct mp3_f32_decoder
+{
+	mp3dec_ex_t mp3;
+};
+
+// Hand over a decoder once it's opened, or release it if it failed.
+static int finish_mp3_f32_open(mp3_f32_decoder** decoder, mp3_f32_decoder* decoder_data, int result)
+{
+	if (result != 0)
+	{
+		mp3dec_ex_close(&(decoder_data->mp3));
+		free(decoder_data);
+		*decoder = NULL;
+		return result;
+	}
+
+	*decoder = decoder_data;
+
+	return 0;
+}
+
+int mp3_f32_open_buf(mp3_f32_decoder** decoder, const uint8_t* data, size_t size, int flags)
+{
+	// Zeroed, so the decoder can be closed whichever step of opening fails.
+	mp3_f32_decoder* decoder_data = (mp3_f32_decoder*)calloc(1, sizeof(mp3_f32_decoder));
+
+	if (decoder_data == NULL)
+	{
+		return MP3D_E_MEMORY;
+	}
+
+	return finish_mp3_f32_open(decoder, decoder_data, mp3dec_ex_open_buf(&(decoder_data->mp3), data, size, flags));
+}
+
+int mp3_f32_open_file(mp3_f32_decoder** decoder, const char* file_name, int flags)
+{
+	mp3_f32_decoder* decoder_data = (mp3_f32_decoder*)calloc(1, sizeof(mp3_f32_decoder));
+
+	if (decoder_data == NULL)
+	{
+		return MP3D_E_MEMORY;
+	}
+
+	return finish_mp3_f32_open(decoder, decoder_data, mp3dec_ex_open(&(decoder_data->mp3), file_name, flags));
+}
+
+#ifdef _WIN32
+int mp3_f32_open_file_w(mp3_f32_decoder** decoder, const wchar_t* file_name, int flags)
+{
+	mp3_f32_decoder* decoder_data = (mp3_f32_decoder*)calloc(1, sizeof(mp3_f32_decoder));
+
+	if (decoder_data == NULL)
+	{
+		return MP3D_E_MEMORY;
+	}
+
+	return finish_mp3_f32_open(decoder, decoder_data, mp3dec_ex_open_w(&(decoder_data->mp3), file_name, flags));
+}
+#endif
+
+int mp3_f32_set_index(mp3_f32_decoder* decoder, uint64_t start_offset, uint64_t samples, const mp3dec_frame_t* frames, size_t num_frames)
+{
+	if (decoder == NULL || frames == NULL || num_frames == 0 || decoder->mp3.start_offset != start_offset)
+	{
+		return MP3D_E_PARAM;
+	}
+
+	mp3dec_frame_t* index_frames = (mp3dec_frame_t*)malloc(num_frames * sizeof(mp3dec_frame_t));
+
+	if (index_frames == NULL)
+	{
+		return MP3D_E_MEMORY;
+	}
+
+	memcpy(index_frames, frames, num_frames * sizeof(mp3dec_frame_t));
+
+	free(decoder->mp3.index.frames);
+	decoder->mp3.index.frames = index_frames;
+	decoder->mp3.index.num_frames = num_frames;
+	decoder->mp3.index.capacity = num_frames;
+	decoder->mp3.samples = samples;
+	decoder->mp3.indexes_built = 1;
+
+	return 0;
+}
+
+int mp3_f32_seek(mp3_f32_decoder* decoder, uint64_t position)
+{
+	return mp3dec_ex_seek(&(decoder->mp3), position);
+}
+
+size_t mp3_f32_read(mp3_f32_decoder* decoder, float* buffer, size_t samples)
+{
+	return mp3dec_ex_read(&(decoder->mp3), buffer, samples);
+}
+
+uint64_t mp3_f32_get_position(const mp3_f32_decoder* decoder)
+{
+	return decoder->mp3.cur_sample;
+}
+
+void mp3_f32_close(mp3_f32_decoder* decoder)
+{
+	if (decoder == NULL)
+	{
+		return;
+	}
+
+	mp3dec_ex_close(&(decoder->mp3));
+	free(decoder);
+}
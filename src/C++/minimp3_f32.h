@@ -0,0 +1,27 @@
+#ifndef _MINIMP3_F32_H_
+#define _MINIMP3_F32_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// For mp3dec_frame_t, which is the same in the 16-bit and float builds.
+#include "minimp3_ex.h"
+
+// A minimp3_ex decoder from the float build. Positions and counts are in samples (ie. frames * channels), as they are for minimp3.
+typedef struct mp3_f32_decoder mp3_f32_decoder;
+
+// Open a decoder on an MP3 in memory, or by file name. Flags and results are minimp3's, as for mp3dec_ex_open.
+int mp3_f32_open_buf(mp3_f32_decoder** decoder, const uint8_t* data, size_t size, int flags);
+int mp3_f32_open_file(mp3_f32_decoder** decoder, const char* file_name, int flags);
+#ifdef _WIN32
+int mp3_f32_open_file_w(mp3_f32_decoder** decoder, const wchar_t* file_name, int flags);
+#endif
+// Use a seek index built by another decoder of the same file, rather than scanning the file again. The frames are copied.
+// The index is only used if it starts at the same offset as the decoder's first frame.
+int mp3_f32_set_index(mp3_f32_decoder* decoder, uint64_t start_offset, uint64_t samples, const mp3dec_frame_t* frames, size_t num_frames);
+int mp3_f32_seek(mp3_f32_decoder* decoder, uint64_t position);
+size_t mp3_f32_read(mp3_f32_decoder* decoder, float* buffer, size_t samples);
+uint64_t mp3_f32_get_position(const mp3_f32_decoder* decoder);
+void mp3_f32_close(mp3_f32_decoder* decoder);
+
+#endif
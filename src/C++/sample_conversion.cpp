@@ -0,0 +1,1689 @@
+/*
+G-Audio - An audio library for LabVIEW.
+
+See g_audio.h for license details.
+
+Sample format conversion kernels. Scalar reference kernels are always built, with SSE2 / AVX2 kernels on x86 and x64, and NEON
+kernels on ARM. The fastest kernel set supported by the CPU is selected once when the library is loaded.
+
+Every SIMD kernel must produce output bit-identical to its scalar reference for all non-NaN input. In practice this means:
+- Float math is done in the same precision, in the same order, without fused multiply-add.
+- Float to integer conversions truncate, like the C casts in the scalar kernels.
+- Integer narrowing wraps rather than saturates, like the C casts in the scalar kernels.
+*/
+
+#include "stdafx.h"
+#include "sample_conversion.h"
+
+#include <string.h>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GA_ARCH_X86
+#include <emmintrin.h>
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define GA_TARGET_SSE2
+#define GA_TARGET_AVX2
+#else
+#include <cpuid.h>
+#define GA_TARGET_SSE2 __attribute__((target("sse2")))
+#define GA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(__aarch64__)
+#define GA_ARCH_NEON
+#include <arm_neon.h>
+#if defined(__linux__) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+#endif
+
+typedef struct
+{
+	ga_simd_level level;
+	void (*u8_to_s16)(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+	void (*u8_to_s32)(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+	void (*u8_to_f32)(float* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+	void (*u8_to_f64)(double* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+	void (*s16_to_u8)(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples);
+	void (*s16_to_s32)(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples);
+	void (*s16_to_f32)(float* buffer_out, const int16_t* buffer_in, size_t num_samples);
+	void (*s16_to_f64)(double* buffer_out, const int16_t* buffer_in, size_t num_samples);
+	void (*s32_to_u8)(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+	void (*s32_to_s16)(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+	void (*s32_to_f32)(float* buffer_out, const int32_t* buffer_in, size_t num_samples);
+	void (*s32_to_f64)(double* buffer_out, const int32_t* buffer_in, size_t num_samples);
+	void (*f32_to_u8)(uint8_t* buffer_out, const float* buffer_in, size_t num_samples);
+	void (*f32_to_s16)(int16_t* buffer_out, const float* buffer_in, size_t num_samples);
+	void (*f32_to_s32)(int32_t* buffer_out, const float* buffer_in, size_t num_samples);
+	void (*f32_to_f64)(double* buffer_out, const float* buffer_in, size_t num_samples);
+	void (*f64_to_u8)(uint8_t* buffer_out, const double* buffer_in, size_t num_samples);
+	void (*f64_to_s16)(int16_t* buffer_out, const double* buffer_in, size_t num_samples);
+	void (*f64_to_s32)(int32_t* buffer_out, const double* buffer_in, size_t num_samples);
+	void (*f64_to_f32)(float* buffer_out, const double* buffer_in, size_t num_samples);
+	void (*s32_to_s24)(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+} conversion_kernels;
+
+//////////////////////////////////
+// Scalar conversion references //
+//////////////////////////////////
+void u8_to_s16_scalar(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	int32_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		int32_t x = buffer_in[i];
+		r = x << 8;
+		r = r - 32768;
+		buffer_out[i] = (int16_t)r;
+	}
+}
+
+void u8_to_s32_scalar(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	int64_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		int64_t x = buffer_in[i];
+		r = x << 24;
+		r = r - 2147483648;
+		buffer_out[i] = (int32_t)r;
+	}
+}
+
+void u8_to_f32_scalar(float* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		float x = buffer_in[i];
+		x = x * 0.00784313725490196078f;    /* 0..255 to 0..2 */
+		x = x - 1;                          /* 0..2 to -1..1 */
+		buffer_out[i] = x;
+	}
+}
+
+void u8_to_f64_scalar(double* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		double x = buffer_in[i];
+		x = x * 0.00784313725490196078;    /* 0..255 to 0..2 */
+		x = x - 1;                          /* 0..2 to -1..1 */
+		buffer_out[i] = x;
+	}
+}
+
+void s16_to_u8_scalar(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	int32_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		int32_t x = buffer_in[i];
+		r = x + 32768;
+		r = r >> 8;
+		buffer_out[i] = (uint8_t)r;
+	}
+}
+
+void s16_to_s32_scalar(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		buffer_out[i] = buffer_in[i] << 16;
+	}
+}
+
+void s16_to_f32_scalar(float* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		buffer_out[i] = buffer_in[i] * 0.000030517578125f;
+	}
+}
+
+void s16_to_f64_scalar(double* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; ++i)
+	{
+		buffer_out[i] = buffer_in[i] * 0.000030517578125;
+	}
+}
+
+void s32_to_u8_scalar(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	int64_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		int64_t x = buffer_in[i];
+		r = x + 2147483648;
+		r = r >> 24;
+		buffer_out[i] = (uint8_t)r;
+	}
+}
+
+void s32_to_s16_scalar(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	int32_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		int32_t x = buffer_in[i];
+		r = x >> 16;
+		buffer_out[i] = (int16_t)r;
+	}
+}
+
+void s32_to_f32_scalar(float* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		buffer_out[i] = buffer_in[i] / 2147483648.0f;
+	}
+}
+
+void s32_to_f64_scalar(double* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		buffer_out[i] = buffer_in[i] / 2147483648.0;
+	}
+}
+
+void f32_to_u8_scalar(uint8_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		float x = buffer_in[i];
+		float c;
+		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
+		c = c + 1;
+		buffer_out[i] = (uint8_t)(c * 127.5f);
+	}
+}
+
+void f32_to_s16_scalar(int16_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	int32_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		float x = buffer_in[i];
+		float c;
+		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
+		c = c + 1;
+		r = (int32_t)(c * 32767.5f);
+		r = r - 32768;
+		buffer_out[i] = (int16_t)r;
+	}
+}
+
+void f32_to_s32_scalar(int32_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	int64_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		float x = buffer_in[i];
+		float c;
+		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
+		c = c + 1;
+		r = (int64_t)(c * 2147483647.5f);
+		r = r - 2147483648;
+		buffer_out[i] = (int32_t)r;
+	}
+}
+
+void f32_to_f64_scalar(double* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		buffer_out[i] = (double)buffer_in[i];
+	}
+}
+
+void f64_to_u8_scalar(uint8_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		double x = buffer_in[i];
+		double c;
+		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
+		c = c + 1;
+		buffer_out[i] = (uint8_t)(c * 127.5);
+	}
+}
+
+void f64_to_s16_scalar(int16_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	int32_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		double x = buffer_in[i];
+		double c;
+		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
+		c = c + 1;
+		r = (int32_t)(c * 32767.5);
+		r = r - 32768;
+		buffer_out[i] = (int16_t)r;
+	}
+}
+
+void f64_to_s32_scalar(int32_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	int64_t r;
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		double x = buffer_in[i];
+		double c;
+		c = ((x < -1) ? -1 : ((x > 1) ? 1 : x));
+		c = c + 1;
+		r = (int64_t)(c * 2147483647.5);
+		r = r - 2147483648;
+		buffer_out[i] = (int32_t)r;
+	}
+}
+
+void f64_to_f32_scalar(float* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		buffer_out[i] = (float)buffer_in[i];
+	}
+}
+
+void s32_to_s24_scalar(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i;
+
+	for (i = 0; i < num_samples; i++)
+	{
+		uint32_t x = (uint32_t)buffer_in[i];
+		buffer_out[i * 3] = (uint8_t)(x >> 8);
+		buffer_out[i * 3 + 1] = (uint8_t)(x >> 16);
+		buffer_out[i * 3 + 2] = (uint8_t)(x >> 24);
+	}
+}
+
+static const conversion_kernels scalar_kernels =
+{
+	ga_simd_none,
+	u8_to_s16_scalar, u8_to_s32_scalar, u8_to_f32_scalar, u8_to_f64_scalar,
+	s16_to_u8_scalar, s16_to_s32_scalar, s16_to_f32_scalar, s16_to_f64_scalar,
+	s32_to_u8_scalar, s32_to_s16_scalar, s32_to_f32_scalar, s32_to_f64_scalar,
+	f32_to_u8_scalar, f32_to_s16_scalar, f32_to_s32_scalar, f32_to_f64_scalar,
+	f64_to_u8_scalar, f64_to_s16_scalar, f64_to_s32_scalar, f64_to_f32_scalar,
+	s32_to_s24_scalar
+};
+
+#if defined(GA_ARCH_X86)
+////////////////////////////
+// SSE2 conversion kernels //
+////////////////////////////
+
+// Clamp to -1..1 and offset to 0..2. A NaN input stays NaN, matching the scalar comparisons.
+GA_TARGET_SSE2 static inline __m128 clamp_offset_ps(__m128 x)
+{
+	const __m128 one = _mm_set1_ps(1.0f);
+	return _mm_add_ps(_mm_min_ps(one, _mm_max_ps(_mm_set1_ps(-1.0f), x)), one);
+}
+
+GA_TARGET_SSE2 static inline __m128d clamp_offset_pd(__m128d x)
+{
+	const __m128d one = _mm_set1_pd(1.0);
+	return _mm_add_pd(_mm_min_pd(one, _mm_max_pd(_mm_set1_pd(-1.0), x)), one);
+}
+
+// Truncate to 16 bits, sign extending the result. Equivalent to an (int16_t) cast, so the following signed pack never saturates.
+GA_TARGET_SSE2 static inline __m128i wrap_epi32_to_16(__m128i x)
+{
+	return _mm_srai_epi32(_mm_slli_epi32(x, 16), 16);
+}
+
+// (int32_t)((int64_t)p - 2147483648) for 0 <= p <= 2^32, as done by the f32/f64 to s32 scalar kernels.
+// Values at or above 2^31 are offset by exactly 2^31 before truncation so they fit the signed conversion.
+GA_TARGET_SSE2 static inline __m128i offset_truncate_ps(__m128 p)
+{
+	const __m128 half_range = _mm_set1_ps(2147483648.0f);
+	__m128 upper = _mm_cmpnlt_ps(p, half_range);
+	__m128i r = _mm_cvttps_epi32(_mm_sub_ps(p, _mm_and_ps(upper, half_range)));
+	return _mm_xor_si128(r, _mm_andnot_si128(_mm_castps_si128(upper), _mm_set1_epi32(INT32_MIN)));
+}
+
+// As offset_truncate_ps, returning two results in the low 64 bits.
+GA_TARGET_SSE2 static inline __m128i offset_truncate_pd(__m128d p)
+{
+	const __m128d half_range = _mm_set1_pd(2147483648.0);
+	__m128d upper = _mm_cmpnlt_pd(p, half_range);
+	__m128i r = _mm_cvttpd_epi32(_mm_sub_pd(p, _mm_and_pd(upper, half_range)));
+	__m128i upper32 = _mm_shuffle_epi32(_mm_castpd_si128(upper), _MM_SHUFFLE(2, 0, 2, 0));
+	return _mm_xor_si128(r, _mm_andnot_si128(upper32, _mm_set_epi32(0, 0, INT32_MIN, INT32_MIN)));
+}
+
+GA_TARGET_SSE2 static void u8_to_s16_sse2(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = _mm_set1_epi16(INT16_MIN);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(buffer_in + i));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_xor_si128(_mm_unpacklo_epi8(zero, x), offset));
+		_mm_storeu_si128((__m128i*)(buffer_out + i + 8), _mm_xor_si128(_mm_unpackhi_epi8(zero, x), offset));
+	}
+
+	u8_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void u8_to_s32_sse2(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i offset = _mm_set1_epi8(INT8_MIN);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i x = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(buffer_in + i)), offset);
+		__m128i lo = _mm_unpacklo_epi8(zero, x);
+		__m128i hi = _mm_unpackhi_epi8(zero, x);
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_unpacklo_epi16(zero, lo));
+		_mm_storeu_si128((__m128i*)(buffer_out + i + 4), _mm_unpackhi_epi16(zero, lo));
+		_mm_storeu_si128((__m128i*)(buffer_out + i + 8), _mm_unpacklo_epi16(zero, hi));
+		_mm_storeu_si128((__m128i*)(buffer_out + i + 12), _mm_unpackhi_epi16(zero, hi));
+	}
+
+	u8_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void u8_to_f32_sse2(float* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(0.00784313725490196078f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(buffer_in + i));
+		__m128i lo = _mm_unpacklo_epi8(x, zero);
+		__m128i hi = _mm_unpackhi_epi8(x, zero);
+		__m128i x32[4] = { _mm_unpacklo_epi16(lo, zero), _mm_unpackhi_epi16(lo, zero), _mm_unpacklo_epi16(hi, zero), _mm_unpackhi_epi16(hi, zero) };
+
+		for (int j = 0; j < 4; j++)
+		{
+			_mm_storeu_ps(buffer_out + i + j * 4, _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(x32[j]), scale), one));
+		}
+	}
+
+	u8_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void u8_to_f64_sse2(double* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128d scale = _mm_set1_pd(0.00784313725490196078);
+	const __m128d one = _mm_set1_pd(1.0);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i x = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(buffer_in + i)), zero);
+		__m128i lo = _mm_unpacklo_epi16(x, zero);
+		__m128i hi = _mm_unpackhi_epi16(x, zero);
+		_mm_storeu_pd(buffer_out + i, _mm_sub_pd(_mm_mul_pd(_mm_cvtepi32_pd(lo), scale), one));
+		_mm_storeu_pd(buffer_out + i + 2, _mm_sub_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(lo, lo)), scale), one));
+		_mm_storeu_pd(buffer_out + i + 4, _mm_sub_pd(_mm_mul_pd(_mm_cvtepi32_pd(hi), scale), one));
+		_mm_storeu_pd(buffer_out + i + 6, _mm_sub_pd(_mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(hi, hi)), scale), one));
+	}
+
+	u8_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s16_to_u8_sse2(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m128i offset = _mm_set1_epi16(INT16_MIN);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i lo = _mm_srli_epi16(_mm_xor_si128(_mm_loadu_si128((const __m128i*)(buffer_in + i)), offset), 8);
+		__m128i hi = _mm_srli_epi16(_mm_xor_si128(_mm_loadu_si128((const __m128i*)(buffer_in + i + 8)), offset), 8);
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packus_epi16(lo, hi));
+	}
+
+	s16_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s16_to_s32_sse2(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(buffer_in + i));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_unpacklo_epi16(zero, x));
+		_mm_storeu_si128((__m128i*)(buffer_out + i + 4), _mm_unpackhi_epi16(zero, x));
+	}
+
+	s16_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s16_to_f32_sse2(float* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128 scale = _mm_set1_ps(0.000030517578125f);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(buffer_in + i));
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(zero, x), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(zero, x), 16);
+		_mm_storeu_ps(buffer_out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale));
+		_mm_storeu_ps(buffer_out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale));
+	}
+
+	s16_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s16_to_f64_sse2(double* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128d scale = _mm_set1_pd(0.000030517578125);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m128i x = _mm_srai_epi32(_mm_unpacklo_epi16(zero, _mm_loadl_epi64((const __m128i*)(buffer_in + i))), 16);
+		_mm_storeu_pd(buffer_out + i, _mm_mul_pd(_mm_cvtepi32_pd(x), scale));
+		_mm_storeu_pd(buffer_out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(x, x)), scale));
+	}
+
+	s16_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s32_to_u8_sse2(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m128i offset = _mm_set1_epi32(INT32_MIN);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = _mm_srli_epi32(_mm_xor_si128(_mm_loadu_si128((const __m128i*)(buffer_in + i + j * 4)), offset), 24);
+		}
+
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packus_epi16(_mm_packs_epi32(x[0], x[1]), _mm_packs_epi32(x[2], x[3])));
+	}
+
+	s32_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s32_to_s16_sse2(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i lo = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(buffer_in + i)), 16);
+		__m128i hi = _mm_srai_epi32(_mm_loadu_si128((const __m128i*)(buffer_in + i + 4)), 16);
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packs_epi32(lo, hi));
+	}
+
+	s32_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s32_to_f32_sse2(float* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	// Division by a power of two is exact, so multiplying by the reciprocal matches the scalar division.
+	const __m128 scale = _mm_set1_ps(1.0f / 2147483648.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		_mm_storeu_ps(buffer_out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)(buffer_in + i))), scale));
+	}
+
+	s32_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void s32_to_f64_sse2(double* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m128d scale = _mm_set1_pd(1.0 / 2147483648.0);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i*)(buffer_in + i));
+		_mm_storeu_pd(buffer_out + i, _mm_mul_pd(_mm_cvtepi32_pd(x), scale));
+		_mm_storeu_pd(buffer_out + i + 2, _mm_mul_pd(_mm_cvtepi32_pd(_mm_unpackhi_epi64(x, x)), scale));
+	}
+
+	s32_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f32_to_u8_sse2(uint8_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	const __m128 scale = _mm_set1_ps(127.5f);
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = _mm_and_si128(_mm_cvttps_epi32(_mm_mul_ps(clamp_offset_ps(_mm_loadu_ps(buffer_in + i + j * 4)), scale)), mask);
+		}
+
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packus_epi16(_mm_packs_epi32(x[0], x[1]), _mm_packs_epi32(x[2], x[3])));
+	}
+
+	f32_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f32_to_s16_sse2(int16_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	const __m128 scale = _mm_set1_ps(32767.5f);
+	const __m128i offset = _mm_set1_epi32(32768);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i lo = _mm_cvttps_epi32(_mm_mul_ps(clamp_offset_ps(_mm_loadu_ps(buffer_in + i)), scale));
+		__m128i hi = _mm_cvttps_epi32(_mm_mul_ps(clamp_offset_ps(_mm_loadu_ps(buffer_in + i + 4)), scale));
+		lo = wrap_epi32_to_16(_mm_sub_epi32(lo, offset));
+		hi = wrap_epi32_to_16(_mm_sub_epi32(hi, offset));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packs_epi32(lo, hi));
+	}
+
+	f32_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f32_to_s32_sse2(int32_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	// The scalar kernel's 2147483647.5f rounds to 2147483648.0f in single precision.
+	const __m128 scale = _mm_set1_ps(2147483648.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m128 p = _mm_mul_ps(clamp_offset_ps(_mm_loadu_ps(buffer_in + i)), scale);
+		_mm_storeu_si128((__m128i*)(buffer_out + i), offset_truncate_ps(p));
+	}
+
+	f32_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f32_to_f64_sse2(double* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(buffer_in + i);
+		_mm_storeu_pd(buffer_out + i, _mm_cvtps_pd(x));
+		_mm_storeu_pd(buffer_out + i + 2, _mm_cvtps_pd(_mm_movehl_ps(x, x)));
+	}
+
+	f32_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f64_to_u8_sse2(uint8_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const __m128d scale = _mm_set1_pd(127.5);
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = _mm_cvttpd_epi32(_mm_mul_pd(clamp_offset_pd(_mm_loadu_pd(buffer_in + i + j * 2)), scale));
+		}
+
+		__m128i lo = _mm_and_si128(_mm_unpacklo_epi64(x[0], x[1]), mask);
+		__m128i hi = _mm_and_si128(_mm_unpacklo_epi64(x[2], x[3]), mask);
+		__m128i r = _mm_packs_epi32(lo, hi);
+		_mm_storel_epi64((__m128i*)(buffer_out + i), _mm_packus_epi16(r, r));
+	}
+
+	f64_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f64_to_s16_sse2(int16_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const __m128d scale = _mm_set1_pd(32767.5);
+	const __m128i offset = _mm_set1_epi32(32768);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = _mm_cvttpd_epi32(_mm_mul_pd(clamp_offset_pd(_mm_loadu_pd(buffer_in + i + j * 2)), scale));
+		}
+
+		__m128i lo = wrap_epi32_to_16(_mm_sub_epi32(_mm_unpacklo_epi64(x[0], x[1]), offset));
+		__m128i hi = wrap_epi32_to_16(_mm_sub_epi32(_mm_unpacklo_epi64(x[2], x[3]), offset));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packs_epi32(lo, hi));
+	}
+
+	f64_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f64_to_s32_sse2(int32_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const __m128d scale = _mm_set1_pd(2147483647.5);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m128i lo = offset_truncate_pd(_mm_mul_pd(clamp_offset_pd(_mm_loadu_pd(buffer_in + i)), scale));
+		__m128i hi = offset_truncate_pd(_mm_mul_pd(clamp_offset_pd(_mm_loadu_pd(buffer_in + i + 2)), scale));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_unpacklo_epi64(lo, hi));
+	}
+
+	f64_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_SSE2 static void f64_to_f32_sse2(float* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(buffer_in + i));
+		__m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(buffer_in + i + 2));
+		_mm_storeu_ps(buffer_out + i, _mm_movelh_ps(lo, hi));
+	}
+
+	f64_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+// Each 64-bit lane packs two samples into its low 6 bytes. The 8 byte stores overlap the next sample, so the loop
+// stops while there's at least one more sample to be written after it.
+GA_TARGET_SSE2 static void s32_to_s24_sse2(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m128i low_mask = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+	const __m128i high_mask = _mm_set_epi32(0x00FFFFFF, 0, 0x00FFFFFF, 0);
+	size_t i = 0;
+
+	for (; i + 5 <= num_samples; i += 4)
+	{
+		__m128i x = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(buffer_in + i)), 8);
+		__m128i packed = _mm_or_si128(_mm_and_si128(x, low_mask), _mm_srli_epi64(_mm_and_si128(x, high_mask), 8));
+		_mm_storel_epi64((__m128i*)(buffer_out + i * 3), packed);
+		_mm_storel_epi64((__m128i*)(buffer_out + i * 3 + 6), _mm_unpackhi_epi64(packed, packed));
+	}
+
+	s32_to_s24_scalar(buffer_out + i * 3, buffer_in + i, num_samples - i);
+}
+
+static const conversion_kernels sse2_kernels =
+{
+	ga_simd_sse2,
+	u8_to_s16_sse2, u8_to_s32_sse2, u8_to_f32_sse2, u8_to_f64_sse2,
+	s16_to_u8_sse2, s16_to_s32_sse2, s16_to_f32_sse2, s16_to_f64_sse2,
+	s32_to_u8_sse2, s32_to_s16_sse2, s32_to_f32_sse2, s32_to_f64_sse2,
+	f32_to_u8_sse2, f32_to_s16_sse2, f32_to_s32_sse2, f32_to_f64_sse2,
+	f64_to_u8_sse2, f64_to_s16_sse2, f64_to_s32_sse2, f64_to_f32_sse2,
+	s32_to_s24_sse2
+};
+
+////////////////////////////
+// AVX2 conversion kernels //
+////////////////////////////
+
+GA_TARGET_AVX2 static inline __m256 clamp_offset_ps_avx2(__m256 x)
+{
+	const __m256 one = _mm256_set1_ps(1.0f);
+	return _mm256_add_ps(_mm256_min_ps(one, _mm256_max_ps(_mm256_set1_ps(-1.0f), x)), one);
+}
+
+GA_TARGET_AVX2 static inline __m256d clamp_offset_pd_avx2(__m256d x)
+{
+	const __m256d one = _mm256_set1_pd(1.0);
+	return _mm256_add_pd(_mm256_min_pd(one, _mm256_max_pd(_mm256_set1_pd(-1.0), x)), one);
+}
+
+// Pack two vectors of eight 32-bit values into sixteen 16-bit values, in order. The signed pack works per 128-bit lane, so restore the lane order after.
+GA_TARGET_AVX2 static inline __m256i packs_epi32_ordered(__m256i lo, __m256i hi)
+{
+	return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+GA_TARGET_AVX2 static inline __m256i wrap_epi32_to_16_avx2(__m256i x)
+{
+	return _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+}
+
+GA_TARGET_AVX2 static void u8_to_s16_avx2(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m256i offset = _mm256_set1_epi16(INT16_MIN);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*)(buffer_in + i)));
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), _mm256_xor_si256(_mm256_slli_epi16(x, 8), offset));
+	}
+
+	u8_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void u8_to_s32_avx2(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m256i offset = _mm256_set1_epi32(INT32_MIN);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(buffer_in + i)));
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), _mm256_xor_si256(_mm256_slli_epi32(x, 24), offset));
+	}
+
+	u8_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void u8_to_f32_avx2(float* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m256 scale = _mm256_set1_ps(0.00784313725490196078f);
+	const __m256 one = _mm256_set1_ps(1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256 x = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(buffer_in + i))));
+		_mm256_storeu_ps(buffer_out + i, _mm256_sub_ps(_mm256_mul_ps(x, scale), one));
+	}
+
+	u8_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void u8_to_f64_avx2(double* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const __m256d scale = _mm256_set1_pd(0.00784313725490196078);
+	const __m256d one = _mm256_set1_pd(1.0);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256i x = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(buffer_in + i)));
+		__m256d lo = _mm256_cvtepi32_pd(_mm256_castsi256_si128(x));
+		__m256d hi = _mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1));
+		_mm256_storeu_pd(buffer_out + i, _mm256_sub_pd(_mm256_mul_pd(lo, scale), one));
+		_mm256_storeu_pd(buffer_out + i + 4, _mm256_sub_pd(_mm256_mul_pd(hi, scale), one));
+	}
+
+	u8_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s16_to_u8_avx2(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m256i offset = _mm256_set1_epi16(INT16_MIN);
+	size_t i = 0;
+
+	for (; i + 32 <= num_samples; i += 32)
+	{
+		__m256i lo = _mm256_srli_epi16(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buffer_in + i)), offset), 8);
+		__m256i hi = _mm256_srli_epi16(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buffer_in + i + 16)), offset), 8);
+		__m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), r);
+	}
+
+	s16_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s16_to_s32_avx2(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(buffer_in + i)));
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), _mm256_slli_epi32(x, 16));
+	}
+
+	s16_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s16_to_f32_avx2(float* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m256 scale = _mm256_set1_ps(0.000030517578125f);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(buffer_in + i)));
+		_mm256_storeu_ps(buffer_out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(x), scale));
+	}
+
+	s16_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s16_to_f64_avx2(double* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const __m256d scale = _mm256_set1_pd(0.000030517578125);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256i x = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i*)(buffer_in + i)));
+		_mm256_storeu_pd(buffer_out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(x)), scale));
+		_mm256_storeu_pd(buffer_out + i + 4, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(x, 1)), scale));
+	}
+
+	s16_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s32_to_u8_avx2(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m256i offset = _mm256_set1_epi32(INT32_MIN);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m256i lo = _mm256_srli_epi32(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buffer_in + i)), offset), 24);
+		__m256i hi = _mm256_srli_epi32(_mm256_xor_si256(_mm256_loadu_si256((const __m256i*)(buffer_in + i + 8)), offset), 24);
+		__m256i r = packs_epi32_ordered(lo, hi);
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packus_epi16(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+	}
+
+	s32_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s32_to_s16_avx2(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m256i lo = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i*)(buffer_in + i)), 16);
+		__m256i hi = _mm256_srai_epi32(_mm256_loadu_si256((const __m256i*)(buffer_in + i + 8)), 16);
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), packs_epi32_ordered(lo, hi));
+	}
+
+	s32_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s32_to_f32_avx2(float* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m256 scale = _mm256_set1_ps(1.0f / 2147483648.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		_mm256_storeu_ps(buffer_out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i*)(buffer_in + i))), scale));
+	}
+
+	s32_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void s32_to_f64_avx2(double* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m256d scale = _mm256_set1_pd(1.0 / 2147483648.0);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		_mm256_storeu_pd(buffer_out + i, _mm256_mul_pd(_mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*)(buffer_in + i))), scale));
+	}
+
+	s32_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f32_to_u8_avx2(uint8_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	const __m256 scale = _mm256_set1_ps(127.5f);
+	const __m256i mask = _mm256_set1_epi32(0xFF);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m256i lo = _mm256_cvttps_epi32(_mm256_mul_ps(clamp_offset_ps_avx2(_mm256_loadu_ps(buffer_in + i)), scale));
+		__m256i hi = _mm256_cvttps_epi32(_mm256_mul_ps(clamp_offset_ps_avx2(_mm256_loadu_ps(buffer_in + i + 8)), scale));
+		__m256i r = packs_epi32_ordered(_mm256_and_si256(lo, mask), _mm256_and_si256(hi, mask));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packus_epi16(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+	}
+
+	f32_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f32_to_s16_avx2(int16_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	const __m256 scale = _mm256_set1_ps(32767.5f);
+	const __m256i offset = _mm256_set1_epi32(32768);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m256i lo = _mm256_cvttps_epi32(_mm256_mul_ps(clamp_offset_ps_avx2(_mm256_loadu_ps(buffer_in + i)), scale));
+		__m256i hi = _mm256_cvttps_epi32(_mm256_mul_ps(clamp_offset_ps_avx2(_mm256_loadu_ps(buffer_in + i + 8)), scale));
+		lo = wrap_epi32_to_16_avx2(_mm256_sub_epi32(lo, offset));
+		hi = wrap_epi32_to_16_avx2(_mm256_sub_epi32(hi, offset));
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), packs_epi32_ordered(lo, hi));
+	}
+
+	f32_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f32_to_s32_avx2(int32_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	const __m256 scale = _mm256_set1_ps(2147483648.0f);
+	const __m256 half_range = _mm256_set1_ps(2147483648.0f);
+	const __m256i sign = _mm256_set1_epi32(INT32_MIN);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m256 p = _mm256_mul_ps(clamp_offset_ps_avx2(_mm256_loadu_ps(buffer_in + i)), scale);
+		__m256 upper = _mm256_cmp_ps(p, half_range, _CMP_NLT_UQ);
+		__m256i r = _mm256_cvttps_epi32(_mm256_sub_ps(p, _mm256_and_ps(upper, half_range)));
+		r = _mm256_xor_si256(r, _mm256_andnot_si256(_mm256_castps_si256(upper), sign));
+		_mm256_storeu_si256((__m256i*)(buffer_out + i), r);
+	}
+
+	f32_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f32_to_f64_avx2(double* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		_mm256_storeu_pd(buffer_out + i, _mm256_cvtps_pd(_mm_loadu_ps(buffer_in + i)));
+		_mm256_storeu_pd(buffer_out + i + 4, _mm256_cvtps_pd(_mm_loadu_ps(buffer_in + i + 4)));
+	}
+
+	f32_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f64_to_u8_avx2(uint8_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const __m256d scale = _mm256_set1_pd(127.5);
+	const __m128i mask = _mm_set1_epi32(0xFF);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		__m128i x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = _mm_and_si128(_mm256_cvttpd_epi32(_mm256_mul_pd(clamp_offset_pd_avx2(_mm256_loadu_pd(buffer_in + i + j * 4)), scale)), mask);
+		}
+
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packus_epi16(_mm_packs_epi32(x[0], x[1]), _mm_packs_epi32(x[2], x[3])));
+	}
+
+	f64_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f64_to_s16_avx2(int16_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const __m256d scale = _mm256_set1_pd(32767.5);
+	const __m128i offset = _mm_set1_epi32(32768);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		__m128i lo = _mm256_cvttpd_epi32(_mm256_mul_pd(clamp_offset_pd_avx2(_mm256_loadu_pd(buffer_in + i)), scale));
+		__m128i hi = _mm256_cvttpd_epi32(_mm256_mul_pd(clamp_offset_pd_avx2(_mm256_loadu_pd(buffer_in + i + 4)), scale));
+		lo = wrap_epi32_to_16(_mm_sub_epi32(lo, offset));
+		hi = wrap_epi32_to_16(_mm_sub_epi32(hi, offset));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_packs_epi32(lo, hi));
+	}
+
+	f64_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f64_to_s32_avx2(int32_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const __m256d scale = _mm256_set1_pd(2147483647.5);
+	const __m256d half_range = _mm256_set1_pd(2147483648.0);
+	const __m256i even_lanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+	const __m128i sign = _mm_set1_epi32(INT32_MIN);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		__m256d p = _mm256_mul_pd(clamp_offset_pd_avx2(_mm256_loadu_pd(buffer_in + i)), scale);
+		__m256d upper = _mm256_cmp_pd(p, half_range, _CMP_NLT_UQ);
+		__m128i r = _mm256_cvttpd_epi32(_mm256_sub_pd(p, _mm256_and_pd(upper, half_range)));
+		__m128i upper32 = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(_mm256_castpd_si256(upper), even_lanes));
+		_mm_storeu_si128((__m128i*)(buffer_out + i), _mm_xor_si128(r, _mm_andnot_si128(upper32, sign)));
+	}
+
+	f64_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+GA_TARGET_AVX2 static void f64_to_f32_avx2(float* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		_mm_storeu_ps(buffer_out + i, _mm256_cvtpd_ps(_mm256_loadu_pd(buffer_in + i)));
+		_mm_storeu_ps(buffer_out + i + 4, _mm256_cvtpd_ps(_mm256_loadu_pd(buffer_in + i + 4)));
+	}
+
+	f64_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+// Each 128-bit lane packs four samples into its low 12 bytes. The 16 byte stores overlap the next samples, so the loop
+// stops while there are at least two more samples to be written after it.
+GA_TARGET_AVX2 static void s32_to_s24_avx2(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const __m256i shuffle = _mm256_setr_epi8(1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1, 1, 2, 3, 5, 6, 7, 9, 10, 11, 13, 14, 15, -1, -1, -1, -1);
+	size_t i = 0;
+
+	for (; i + 10 <= num_samples; i += 8)
+	{
+		__m256i packed = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)(buffer_in + i)), shuffle);
+		_mm_storeu_si128((__m128i*)(buffer_out + i * 3), _mm256_castsi256_si128(packed));
+		_mm_storeu_si128((__m128i*)(buffer_out + i * 3 + 12), _mm256_extracti128_si256(packed, 1));
+	}
+
+	s32_to_s24_scalar(buffer_out + i * 3, buffer_in + i, num_samples - i);
+}
+
+static const conversion_kernels avx2_kernels =
+{
+	ga_simd_avx2,
+	u8_to_s16_avx2, u8_to_s32_avx2, u8_to_f32_avx2, u8_to_f64_avx2,
+	s16_to_u8_avx2, s16_to_s32_avx2, s16_to_f32_avx2, s16_to_f64_avx2,
+	s32_to_u8_avx2, s32_to_s16_avx2, s32_to_f32_avx2, s32_to_f64_avx2,
+	f32_to_u8_avx2, f32_to_s16_avx2, f32_to_s32_avx2, f32_to_f64_avx2,
+	f64_to_u8_avx2, f64_to_s16_avx2, f64_to_s32_avx2, f64_to_f32_avx2,
+	s32_to_s24_avx2
+};
+#endif // GA_ARCH_X86
+
+#if defined(GA_ARCH_NEON)
+////////////////////////////
+// NEON conversion kernels //
+////////////////////////////
+
+static inline float32x4_t clamp_offset_f32_neon(float32x4_t x)
+{
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	return vaddq_f32(vminq_f32(vmaxq_f32(x, vdupq_n_f32(-1.0f)), one), one);
+}
+
+static void u8_to_s16_neon(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const uint16x8_t offset = vdupq_n_u16(0x8000);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		uint8x16_t x = vld1q_u8(buffer_in + i);
+		vst1q_s16(buffer_out + i, vreinterpretq_s16_u16(veorq_u16(vshll_n_u8(vget_low_u8(x), 8), offset)));
+		vst1q_s16(buffer_out + i + 8, vreinterpretq_s16_u16(veorq_u16(vshll_n_u8(vget_high_u8(x), 8), offset)));
+	}
+
+	u8_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void u8_to_s32_neon(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		uint16x8_t x = vshll_n_u8(veor_u8(vld1_u8(buffer_in + i), vdup_n_u8(0x80)), 8);
+		vst1q_s32(buffer_out + i, vreinterpretq_s32_u32(vshll_n_u16(vget_low_u16(x), 16)));
+		vst1q_s32(buffer_out + i + 4, vreinterpretq_s32_u32(vshll_n_u16(vget_high_u16(x), 16)));
+	}
+
+	u8_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void u8_to_f32_neon(float* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const float32x4_t scale = vdupq_n_f32(0.00784313725490196078f);
+	const float32x4_t one = vdupq_n_f32(1.0f);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		uint16x8_t x = vmovl_u8(vld1_u8(buffer_in + i));
+		float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(x)));
+		float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(x)));
+		vst1q_f32(buffer_out + i, vsubq_f32(vmulq_f32(lo, scale), one));
+		vst1q_f32(buffer_out + i + 4, vsubq_f32(vmulq_f32(hi, scale), one));
+	}
+
+	u8_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s16_to_u8_neon(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	const uint16x8_t offset = vdupq_n_u16(0x8000);
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		uint8x8_t lo = vshrn_n_u16(veorq_u16(vreinterpretq_u16_s16(vld1q_s16(buffer_in + i)), offset), 8);
+		uint8x8_t hi = vshrn_n_u16(veorq_u16(vreinterpretq_u16_s16(vld1q_s16(buffer_in + i + 8)), offset), 8);
+		vst1q_u8(buffer_out + i, vcombine_u8(lo, hi));
+	}
+
+	s16_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s16_to_s32_neon(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		int16x8_t x = vld1q_s16(buffer_in + i);
+		vst1q_s32(buffer_out + i, vshll_n_s16(vget_low_s16(x), 16));
+		vst1q_s32(buffer_out + i + 4, vshll_n_s16(vget_high_s16(x), 16));
+	}
+
+	s16_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s16_to_f32_neon(float* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		int16x8_t x = vld1q_s16(buffer_in + i);
+		vst1q_f32(buffer_out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(x))), 0.000030517578125f));
+		vst1q_f32(buffer_out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(x))), 0.000030517578125f));
+	}
+
+	s16_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s32_to_u8_neon(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	const uint32x4_t offset = vdupq_n_u32(0x80000000);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		uint16x4_t lo = vshrn_n_u32(veorq_u32(vreinterpretq_u32_s32(vld1q_s32(buffer_in + i)), offset), 16);
+		uint16x4_t hi = vshrn_n_u32(veorq_u32(vreinterpretq_u32_s32(vld1q_s32(buffer_in + i + 4)), offset), 16);
+		vst1_u8(buffer_out + i, vshrn_n_u16(vcombine_u16(lo, hi), 8));
+	}
+
+	s32_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s32_to_s16_neon(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		int16x4_t lo = vshrn_n_s32(vld1q_s32(buffer_in + i), 16);
+		int16x4_t hi = vshrn_n_s32(vld1q_s32(buffer_in + i + 4), 16);
+		vst1q_s16(buffer_out + i, vcombine_s16(lo, hi));
+	}
+
+	s32_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s32_to_f32_neon(float* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		vst1q_f32(buffer_out + i, vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(buffer_in + i)), 1.0f / 2147483648.0f));
+	}
+
+	s32_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f32_to_u8_neon(uint8_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		uint32x4_t lo = vcvtq_u32_f32(vmulq_n_f32(clamp_offset_f32_neon(vld1q_f32(buffer_in + i)), 127.5f));
+		uint32x4_t hi = vcvtq_u32_f32(vmulq_n_f32(clamp_offset_f32_neon(vld1q_f32(buffer_in + i + 4)), 127.5f));
+		vst1_u8(buffer_out + i, vmovn_u16(vcombine_u16(vmovn_u32(lo), vmovn_u32(hi))));
+	}
+
+	f32_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f32_to_s16_neon(int16_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	const int32x4_t offset = vdupq_n_s32(32768);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		int32x4_t lo = vcvtq_s32_f32(vmulq_n_f32(clamp_offset_f32_neon(vld1q_f32(buffer_in + i)), 32767.5f));
+		int32x4_t hi = vcvtq_s32_f32(vmulq_n_f32(clamp_offset_f32_neon(vld1q_f32(buffer_in + i + 4)), 32767.5f));
+		vst1q_s16(buffer_out + i, vcombine_s16(vmovn_s32(vsubq_s32(lo, offset)), vmovn_s32(vsubq_s32(hi, offset))));
+	}
+
+	f32_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f32_to_s32_neon(int32_t* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	// The clamped input is a multiple of 2^-24, so c * 2^30 - 2^30 is an exact integer within the signed conversion range.
+	// Doubling it wraps the +1.0 case to INT32_MIN, the same as the scalar kernel's cast from 64-bit.
+	const float32x4_t quarter_range = vdupq_n_f32(1073741824.0f);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		float32x4_t p = vsubq_f32(vmulq_f32(clamp_offset_f32_neon(vld1q_f32(buffer_in + i)), quarter_range), quarter_range);
+		vst1q_s32(buffer_out + i, vshlq_n_s32(vcvtq_s32_f32(p), 1));
+	}
+
+	f32_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+// De-interleave the bytes of sixteen samples, and store the top three bytes of each.
+static void s32_to_s24_neon(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 16 <= num_samples; i += 16)
+	{
+		uint8x16x4_t x = vld4q_u8((const uint8_t*)(buffer_in + i));
+		uint8x16x3_t packed;
+		packed.val[0] = x.val[1];
+		packed.val[1] = x.val[2];
+		packed.val[2] = x.val[3];
+		vst3q_u8(buffer_out + i * 3, packed);
+	}
+
+	s32_to_s24_scalar(buffer_out + i * 3, buffer_in + i, num_samples - i);
+}
+
+#if defined(__aarch64__)
+// Double precision vectors are only available on AArch64. 32-bit ARM uses the scalar kernels for these.
+static inline float64x2_t clamp_offset_f64_neon(float64x2_t x)
+{
+	const float64x2_t one = vdupq_n_f64(1.0);
+	return vaddq_f64(vminq_f64(vmaxq_f64(x, vdupq_n_f64(-1.0)), one), one);
+}
+
+static void u8_to_f64_neon(double* buffer_out, const uint8_t* buffer_in, size_t num_samples)
+{
+	const float64x2_t scale = vdupq_n_f64(0.00784313725490196078);
+	const float64x2_t one = vdupq_n_f64(1.0);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		uint16x8_t x = vmovl_u8(vld1_u8(buffer_in + i));
+		float32x4_t lo = vcvtq_f32_u32(vmovl_u16(vget_low_u16(x)));
+		float32x4_t hi = vcvtq_f32_u32(vmovl_u16(vget_high_u16(x)));
+		vst1q_f64(buffer_out + i, vsubq_f64(vmulq_f64(vcvt_f64_f32(vget_low_f32(lo)), scale), one));
+		vst1q_f64(buffer_out + i + 2, vsubq_f64(vmulq_f64(vcvt_high_f64_f32(lo), scale), one));
+		vst1q_f64(buffer_out + i + 4, vsubq_f64(vmulq_f64(vcvt_f64_f32(vget_low_f32(hi)), scale), one));
+		vst1q_f64(buffer_out + i + 6, vsubq_f64(vmulq_f64(vcvt_high_f64_f32(hi), scale), one));
+	}
+
+	u8_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s16_to_f64_neon(double* buffer_out, const int16_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		int32x4_t x = vmovl_s16(vld1_s16(buffer_in + i));
+		vst1q_f64(buffer_out + i, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(x))), 0.000030517578125));
+		vst1q_f64(buffer_out + i + 2, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(x))), 0.000030517578125));
+	}
+
+	s16_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void s32_to_f64_neon(double* buffer_out, const int32_t* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		int32x4_t x = vld1q_s32(buffer_in + i);
+		vst1q_f64(buffer_out + i, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_low_s32(x))), 1.0 / 2147483648.0));
+		vst1q_f64(buffer_out + i + 2, vmulq_n_f64(vcvtq_f64_s64(vmovl_s32(vget_high_s32(x))), 1.0 / 2147483648.0));
+	}
+
+	s32_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f32_to_f64_neon(double* buffer_out, const float* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		float32x4_t x = vld1q_f32(buffer_in + i);
+		vst1q_f64(buffer_out + i, vcvt_f64_f32(vget_low_f32(x)));
+		vst1q_f64(buffer_out + i + 2, vcvt_high_f64_f32(x));
+	}
+
+	f32_to_f64_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f64_to_u8_neon(uint8_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		uint32x2_t x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = vmovn_u64(vcvtq_u64_f64(vmulq_n_f64(clamp_offset_f64_neon(vld1q_f64(buffer_in + i + j * 2)), 127.5)));
+		}
+
+		uint16x4_t lo = vmovn_u32(vcombine_u32(x[0], x[1]));
+		uint16x4_t hi = vmovn_u32(vcombine_u32(x[2], x[3]));
+		vst1_u8(buffer_out + i, vmovn_u16(vcombine_u16(lo, hi)));
+	}
+
+	f64_to_u8_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f64_to_s16_neon(int16_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const int32x4_t offset = vdupq_n_s32(32768);
+	size_t i = 0;
+
+	for (; i + 8 <= num_samples; i += 8)
+	{
+		int32x2_t x[4];
+
+		for (int j = 0; j < 4; j++)
+		{
+			x[j] = vmovn_s64(vcvtq_s64_f64(vmulq_n_f64(clamp_offset_f64_neon(vld1q_f64(buffer_in + i + j * 2)), 32767.5)));
+		}
+
+		int16x4_t lo = vmovn_s32(vsubq_s32(vcombine_s32(x[0], x[1]), offset));
+		int16x4_t hi = vmovn_s32(vsubq_s32(vcombine_s32(x[2], x[3]), offset));
+		vst1q_s16(buffer_out + i, vcombine_s16(lo, hi));
+	}
+
+	f64_to_s16_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f64_to_s32_neon(int32_t* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	const int64x2_t offset = vdupq_n_s64(2147483648LL);
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		int64x2_t lo = vcvtq_s64_f64(vmulq_n_f64(clamp_offset_f64_neon(vld1q_f64(buffer_in + i)), 2147483647.5));
+		int64x2_t hi = vcvtq_s64_f64(vmulq_n_f64(clamp_offset_f64_neon(vld1q_f64(buffer_in + i + 2)), 2147483647.5));
+		vst1q_s32(buffer_out + i, vcombine_s32(vmovn_s64(vsubq_s64(lo, offset)), vmovn_s64(vsubq_s64(hi, offset))));
+	}
+
+	f64_to_s32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+
+static void f64_to_f32_neon(float* buffer_out, const double* buffer_in, size_t num_samples)
+{
+	size_t i = 0;
+
+	for (; i + 4 <= num_samples; i += 4)
+	{
+		float32x2_t lo = vcvt_f32_f64(vld1q_f64(buffer_in + i));
+		vst1q_f32(buffer_out + i, vcvt_high_f32_f64(lo, vld1q_f64(buffer_in + i + 2)));
+	}
+
+	f64_to_f32_scalar(buffer_out + i, buffer_in + i, num_samples - i);
+}
+#else
+#define u8_to_f64_neon u8_to_f64_scalar
+#define s16_to_f64_neon s16_to_f64_scalar
+#define s32_to_f64_neon s32_to_f64_scalar
+#define f32_to_f64_neon f32_to_f64_scalar
+#define f64_to_u8_neon f64_to_u8_scalar
+#define f64_to_s16_neon f64_to_s16_scalar
+#define f64_to_s32_neon f64_to_s32_scalar
+#define f64_to_f32_neon f64_to_f32_scalar
+#endif // __aarch64__
+
+static const conversion_kernels neon_kernels =
+{
+	ga_simd_neon,
+	u8_to_s16_neon, u8_to_s32_neon, u8_to_f32_neon, u8_to_f64_neon,
+	s16_to_u8_neon, s16_to_s32_neon, s16_to_f32_neon, s16_to_f64_neon,
+	s32_to_u8_neon, s32_to_s16_neon, s32_to_f32_neon, s32_to_f64_neon,
+	f32_to_u8_neon, f32_to_s16_neon, f32_to_s32_neon, f32_to_f64_neon,
+	f64_to_u8_neon, f64_to_s16_neon, f64_to_s32_neon, f64_to_f32_neon,
+	s32_to_s24_neon
+};
+#endif // GA_ARCH_NEON
+
+////////////////////////
+// Kernel dispatching //
+////////////////////////
+
+static ga_simd_level detect_simd_level()
+{
+#if defined(GA_ARCH_X86)
+	uint32_t regs[4] = { 0 };
+	uint32_t max_leaf = 0;
+	uint32_t xcr0 = 0;
+	bool has_sse2 = false;
+	bool has_avx = false;
+	bool has_avx2 = false;
+
+#if defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	max_leaf = (uint32_t)info[0];
+	__cpuid(info, 1);
+	memcpy(regs, info, sizeof(regs));
+#else
+	max_leaf = __get_cpuid_max(0, NULL);
+	__cpuid(1, regs[0], regs[1], regs[2], regs[3]);
+#endif
+
+	has_sse2 = (regs[3] & (1 << 26)) != 0;
+	// AVX requires the OS to save the YMM registers (OSXSAVE, then XCR0 bits 1 and 2).
+	if ((regs[2] & (1 << 27)) && (regs[2] & (1 << 28)))
+	{
+#if defined(_MSC_VER)
+		xcr0 = (uint32_t)_xgetbv(0);
+#else
+		uint32_t xcr0_high;
+		// xgetbv, encoded directly for older assemblers
+		__asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+#endif
+		has_avx = (xcr0 & 0x6) == 0x6;
+	}
+
+	if (has_avx && max_leaf >= 7)
+	{
+#if defined(_MSC_VER)
+		__cpuidex(info, 7, 0);
+		memcpy(regs, info, sizeof(regs));
+#else
+		__cpuid_count(7, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+		has_avx2 = (regs[1] & (1 << 5)) != 0;
+	}
+
+	if (has_avx2)
+	{
+		return ga_simd_avx2;
+	}
+	if (has_sse2)
+	{
+		return ga_simd_sse2;
+	}
+#elif defined(GA_ARCH_NEON)
+#if defined(__aarch64__)
+	return ga_simd_neon;
+#elif defined(__linux__)
+	if (getauxval(AT_HWCAP) & HWCAP_NEON)
+	{
+		return ga_simd_neon;
+	}
+#else
+	// Built with NEON enabled, so the target is assumed to support it.
+	return ga_simd_neon;
+#endif
+#endif
+
+	return ga_simd_none;
+}
+
+static const conversion_kernels* select_kernels(ga_simd_level level)
+{
+	switch (level)
+	{
+#if defined(GA_ARCH_X86)
+		case ga_simd_avx2: return &avx2_kernels; break;
+		case ga_simd_sse2: return &sse2_kernels; break;
+#endif
+#if defined(GA_ARCH_NEON)
+		case ga_simd_neon: return &neon_kernels; break;
+#endif
+		default: break;
+	}
+
+	return &scalar_kernels;
+}
+
+// Both are initialized when the library is loaded.
+static const ga_simd_level supported_simd_level = detect_simd_level();
+static const conversion_kernels* active_kernels = select_kernels(supported_simd_level);
+
+ga_simd_level get_conversion_simd_level()
+{
+	return active_kernels->level;
+}
+
+ga_simd_level get_supported_simd_level()
+{
+	return supported_simd_level;
+}
+
+ga_simd_level set_conversion_simd_level(ga_simd_level level)
+{
+	switch (level)
+	{
+		case ga_simd_none:
+			break;
+		case ga_simd_sse2:
+		case ga_simd_avx2:
+			// AVX2 implies SSE2, so SSE2 can be requested on an AVX2 CPU. NEON can't be requested on x86, or vice versa.
+			if (supported_simd_level != ga_simd_avx2 && supported_simd_level != ga_simd_sse2)
+			{
+				level = ga_simd_none;
+			}
+			else if (level == ga_simd_avx2 && supported_simd_level != ga_simd_avx2)
+			{
+				level = ga_simd_sse2;
+			}
+			break;
+		case ga_simd_neon:
+			if (supported_simd_level != ga_simd_neon)
+			{
+				level = ga_simd_none;
+			}
+			break;
+		default:
+			level = supported_simd_level;
+			break;
+	}
+
+	active_kernels = select_kernels(level);
+
+	return active_kernels->level;
+}
+
+#define GA_DEFINE_CONVERSION(name, type_out, type_in) \
+void name(type_out* buffer_out, const type_in* buffer_in, size_t num_samples) \
+{ \
+	if (buffer_out == NULL || buffer_in == NULL) \
+	{ \
+		return; \
+	} \
+	active_kernels->name(buffer_out, buffer_in, num_samples); \
+}
+
+GA_DEFINE_CONVERSION(u8_to_s16, int16_t, uint8_t)
+GA_DEFINE_CONVERSION(u8_to_s32, int32_t, uint8_t)
+GA_DEFINE_CONVERSION(u8_to_f32, float, uint8_t)
+GA_DEFINE_CONVERSION(u8_to_f64, double, uint8_t)
+GA_DEFINE_CONVERSION(s16_to_u8, uint8_t, int16_t)
+GA_DEFINE_CONVERSION(s16_to_s32, int32_t, int16_t)
+GA_DEFINE_CONVERSION(s16_to_f32, float, int16_t)
+GA_DEFINE_CONVERSION(s16_to_f64, double, int16_t)
+GA_DEFINE_CONVERSION(s32_to_u8, uint8_t, int32_t)
+GA_DEFINE_CONVERSION(s32_to_s16, int16_t, int32_t)
+GA_DEFINE_CONVERSION(s32_to_f32, float, int32_t)
+GA_DEFINE_CONVERSION(s32_to_f64, double, int32_t)
+GA_DEFINE_CONVERSION(f32_to_u8, uint8_t, float)
+GA_DEFINE_CONVERSION(f32_to_s16, int16_t, float)
+GA_DEFINE_CONVERSION(f32_to_s32, int32_t, float)
+GA_DEFINE_CONVERSION(f32_to_f64, double, float)
+GA_DEFINE_CONVERSION(f64_to_u8, uint8_t, double)
+GA_DEFINE_CONVERSION(f64_to_s16, int16_t, double)
+GA_DEFINE_CONVERSION(f64_to_s32, int32_t, double)
+GA_DEFINE_CONVERSION(f64_to_f32, float, double)
+GA_DEFINE_CONVERSION(s32_to_s24, uint8_t, int32_t)
@@ -0,0 +1,79 @@
+#ifndef _SAMPLE_CONVERSION_H_
+#define _SAMPLE_CONVERSION_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Instruction sets the conversion kernels can be dispatched to.
+typedef enum
+{
+	ga_simd_none = 0,
+	ga_simd_sse2,
+	ga_simd_avx2,
+	ga_simd_neon
+} ga_simd_level;
+
+//////////////////////////
+// Conversion functions //
+//////////////////////////
+// These dispatch to the fastest kernel the CPU supports. The kernel set is selected once when the library is loaded.
+// Every kernel produces output bit-identical to the scalar reference kernels below for all non-NaN input.
+// Narrowing conversions (eg. f32_to_s16) may be performed in place, with buffer_out == buffer_in.
+// Widening conversions (eg. f32_to_f64) may be performed in place when the input occupies the end of the output buffer.
+void u8_to_s16(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void u8_to_s32(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void u8_to_f32(float* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void u8_to_f64(double* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void s16_to_u8(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s16_to_s32(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s16_to_f32(float* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s16_to_f64(double* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s32_to_u8(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void s32_to_s16(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void s32_to_f32(float* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void s32_to_f64(double* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void f32_to_u8(uint8_t* buffer_out, const float* buffer_in, size_t num_samples);
+void f32_to_s16(int16_t* buffer_out, const float* buffer_in, size_t num_samples);
+void f32_to_s32(int32_t* buffer_out, const float* buffer_in, size_t num_samples);
+void f32_to_f64(double* buffer_out, const float* buffer_in, size_t num_samples);
+void f64_to_u8(uint8_t* buffer_out, const double* buffer_in, size_t num_samples);
+void f64_to_s16(int16_t* buffer_out, const double* buffer_in, size_t num_samples);
+void f64_to_s32(int32_t* buffer_out, const double* buffer_in, size_t num_samples);
+void f64_to_f32(float* buffer_out, const double* buffer_in, size_t num_samples);
+// Pack to 24-bit little endian samples of 3 bytes, keeping the top 24 bits of each sample. Used to write 24-bit files.
+void s32_to_s24(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+
+// The instruction set of the active kernels.
+ga_simd_level get_conversion_simd_level();
+// The best instruction set supported by this CPU and build.
+ga_simd_level get_supported_simd_level();
+// Force a specific kernel set, primarily for benchmarking and verification. Requests above the supported level are clamped.
+// Returns the level actually selected.
+ga_simd_level set_conversion_simd_level(ga_simd_level level);
+
+//////////////////////////////////
+// Scalar conversion references //
+//////////////////////////////////
+void u8_to_s16_scalar(int16_t* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void u8_to_s32_scalar(int32_t* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void u8_to_f32_scalar(float* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void u8_to_f64_scalar(double* buffer_out, const uint8_t* buffer_in, size_t num_samples);
+void s16_to_u8_scalar(uint8_t* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s16_to_s32_scalar(int32_t* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s16_to_f32_scalar(float* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s16_to_f64_scalar(double* buffer_out, const int16_t* buffer_in, size_t num_samples);
+void s32_to_u8_scalar(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void s32_to_s16_scalar(int16_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void s32_to_f32_scalar(float* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void s32_to_f64_scalar(double* buffer_out, const int32_t* buffer_in, size_t num_samples);
+void f32_to_u8_scalar(uint8_t* buffer_out, const float* buffer_in, size_t num_samples);
+void f32_to_s16_scalar(int16_t* buffer_out, const float* buffer_in, size_t num_samples);
+void f32_to_s32_scalar(int32_t* buffer_out, const float* buffer_in, size_t num_samples);
+void f32_to_f64_scalar(double* buffer_out, const float* buffer_in, size_t num_samples);
+void f64_to_u8_scalar(uint8_t* buffer_out, const double* buffer_in, size_t num_samples);
+void f64_to_s16_scalar(int16_t* buffer_out, const double* buffer_in, size_t num_samples);
+void f64_to_s32_scalar(int32_t* buffer_out, const double* buffer_in, size_t num_samples);
+void f64_to_f32_scalar(float* buffer_out, const double* buffer_in, size_t num_samples);
+void s32_to_s24_scalar(uint8_t* buffer_out, const int32_t* buffer_in, size_t num_samples);
+
+#endif
@@ -8,22 +8,41 @@
 ga_refnum refnums[ga_refnum_count];
 thread_mutex_t ga_mutexes[ga_mutex_count] = { 0 };
 
-// Create the refnums mutex if it doesn't already exist.
-// If it does exist, do nothing.
-// Could maybe use the CLFN's reserve callback to call this rather than every lock / unlock
-static inline void create_refnums_mutex(ga_refnum_type refnum_type)
+// Initialise every refnums and global mutex. Called once, from the first lock or unlock.
+// The contents of a mutex can't be used to tell if it's been initialised, as an unlocked pthread mutex starts with zero bytes.
+static bool init_mutexes()
 {
-	// Init the mutex if it doesn't exist
-	if (strlen(refnums[refnum_type].refnums_mutex.data) == 0)
+	for (int i = 0; i < ga_refnum_count; i++)
+	{
+		thread_mutex_init(&(refnums[i].refnums_mutex));
+	}
+
+	for (int i = 0; i < ga_mutex_count; i++)
 	{
-		thread_mutex_init(&(refnums[refnum_type].refnums_mutex));
+		thread_mutex_init(&ga_mutexes[i]);
 	}
+
+	return true;
+}
+
+// Initialise the mutexes on first use. Initialisation of a local static is thread safe, so concurrent first calls wait for it to finish.
+static inline void create_mutexes()
+{
+	static bool initialised = init_mutexes();
+	(void)initialised;
+}
+
+// Create every refnums and global mutex, the first time any of them is used.
+// Could maybe use the CLFN's reserve callback to call this rather than every lock / unlock
+static inline void create_refnums_mutex()
+{
+	create_mutexes();
 }
 
 // Lock the refnums mutex. Will attempt to create the mutex first in case it doesn't exist.
 static void lock_refnums_mutex(ga_refnum_type refnum_type)
 {
-	create_refnums_mutex(refnum_type);
+	create_refnums_mutex();
 	thread_mutex_lock(&(refnums[refnum_type].refnums_mutex));
 	return;
 }
@@ -31,7 +50,7 @@ static void lock_refnums_mutex(ga_refnum_type refnum_type)
 // Unlock the refnums mutex. Will attempt to create the mutex first in case it doesn't exist.
 static void unlock_refnums_mutex(ga_refnum_type refnum_type)
 {
-	create_refnums_mutex(refnum_type);
+	create_refnums_mutex();
 	thread_mutex_unlock(&(refnums[refnum_type].refnums_mutex));
 	return;
 }
@@ -139,16 +158,11 @@ std::vector<int32_t> get_all_references(ga_refnum_type refnum_type)
 
 
 
-// Create the context mutex if it doesn't already exist.
-// If it does exist, do nothing.
+// Create every refnums and global mutex, the first time any of them is used. All the mutexes are created at once, so the type isn't needed.
 // Could maybe use the CLFN's reserve callback to call this rather than every lock / unlock
-inline void create_ga_mutex(ga_mutex_type mutex_type)
+inline void create_ga_mutex(ga_mutex_type)
 {
-	// Init the mutex if it doesn't exist
-	if (strlen(ga_mutexes[mutex_type].data) == 0)
-	{
-		thread_mutex_init(&ga_mutexes[mutex_type]);
-	}
+	create_mutexes();
 }
 
 // Lock the context mutex. Will attempt to create the mutex first in case it doesn't exist.
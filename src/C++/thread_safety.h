@@ -24,6 +24,7 @@ typedef enum
 {
 	ga_refnum_audio_file = 0,
 	ga_refnum_audio_device,
+	ga_refnum_library_scan,
 	ga_refnum_count
 } ga_refnum_type;
 
@@ -32,10 +33,13 @@ typedef enum
 	ga_mutex_common = 0,
 	ga_mutex_context,
 	ga_mutex_device,
+	ga_mutex_mp3_index,
+	ga_mutex_sample_cache,
+	ga_mutex_vorbis_index,
 	ga_mutex_count
 } ga_mutex_type;
 
-static inline void create_refnums_mutex(ga_refnum_type refnum_type);
+static inline void create_refnums_mutex();
 static void lock_refnums_mutex(ga_refnum_type refnum_type);
 static void unlock_refnums_mutex(ga_refnum_type refnum_type);
 